@@ -54,6 +54,7 @@ using namespace nlohmann;
 #include "libslic3r/Platform.hpp"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/SLAPrint.hpp"
+#include "libslic3r/SliceResultCache.hpp"
 #include "libslic3r/TriangleMesh.hpp"
 #include "libslic3r/Format/AMF.hpp"
 #include "libslic3r/Format/3mf.hpp"
@@ -1608,6 +1609,24 @@ int CLI::run(int argc, char **argv)
     if (camera_view_option)
         camera_view = (Slic3r::GUI::Camera::ViewAngleType)(camera_view_option->value);
 
+    ConfigOptionInt* gcode_memory_limit_option = m_config.option<ConfigOptionInt>("gcode_memory_limit");
+    ConfigOptionInt* filament_group_time_limit_option = m_config.option<ConfigOptionInt>("filament_group_time_limit");
+    ConfigOptionInt* filament_group_threads_option = m_config.option<ConfigOptionInt>("filament_group_threads");
+
+    std::shared_ptr<SliceResultCache> slice_result_cache;
+    ConfigOptionString* slice_cache_option = m_config.option<ConfigOptionString>("slice_cache");
+    if (slice_cache_option && !slice_cache_option->value.empty()) {
+        ConfigOptionInt* slice_cache_size_option = m_config.option<ConfigOptionInt>("slice_cache_size");
+        uint64_t slice_cache_size = uint64_t(slice_cache_size_option ? slice_cache_size_option->value : 4096) << 20;
+        try {
+            slice_result_cache = std::make_shared<SliceResultCache>(slice_cache_option->value, slice_cache_size);
+        }
+        catch (std::exception &err) {
+            //the cache is an optimization only, go on without it
+            BOOST_LOG_TRIVIAL(warning) << boost::format("can not use slice result cache %1%, reason = %2%")%slice_cache_option->value %err.what();
+        }
+    }
+
     ConfigOptionBool* avoid_extrusion_cali_region_option = m_config.option<ConfigOptionBool>("avoid_extrusion_cali_region");
     if (avoid_extrusion_cali_region_option)
         avoid_extrusion_cali_region = avoid_extrusion_cali_region_option->value;
@@ -4535,6 +4554,19 @@ int CLI::run(int argc, char **argv)
     bool user_center_specified = false;
     Points beds = get_bed_shape(m_print_config);
     ArrangeParams arrange_cfg;
+    //set the multi-start and raster options of the arrangement, called after each reset of arrange_cfg
+    auto apply_arrange_attempts = [this](ArrangeParams& params) {
+        ConfigOptionInt* arrange_attempts_option = m_config.option<ConfigOptionInt>("arrange_attempts");
+        if (arrange_attempts_option)
+            params.multi_start = std::max(arrange_attempts_option->value, 1);
+        ConfigOptionFloat* arrange_time_limit_option = m_config.option<ConfigOptionFloat>("arrange_time_limit");
+        if (arrange_time_limit_option)
+            params.time_budget = std::max(arrange_time_limit_option->value, 0.);
+        ConfigOptionInt* arrange_raster_threshold_option = m_config.option<ConfigOptionInt>("arrange_raster_threshold");
+        if (arrange_raster_threshold_option)
+            params.raster_threshold = std::max(arrange_raster_threshold_option->value, 0);
+    };
+    apply_arrange_attempts(arrange_cfg);
 
     BOOST_LOG_TRIVIAL(info) << "will start transforms, commands count " << m_transforms.size() << "\n";
 #if defined(__linux__) || defined(__LINUX__)
@@ -4971,6 +5003,7 @@ int CLI::run(int argc, char **argv)
                 ArrangePolygons selected, unselected;
                 Model& model = m_models[0];
                 arrange_cfg = ArrangeParams();  // reset all params
+                apply_arrange_attempts(arrange_cfg);
                 get_print_sequence(cur_plate, m_print_config, arrange_cfg.is_seq_print);
 
                 //Step-1: prepare the arranged data
@@ -5195,6 +5228,7 @@ int CLI::run(int argc, char **argv)
             while(!finished_arrange)
             {
                 arrange_cfg = ArrangeParams();  // reset all params
+                apply_arrange_attempts(arrange_cfg);
                 arrange_count++;
                 //step-0: duplicate model
                 if (duplicate_count > 0)
@@ -6124,6 +6158,13 @@ int CLI::run(int argc, char **argv)
                         part_plate->get_print(&print, &gcode_result, &print_index);
 
                         print_fff = dynamic_cast<Print *>(print);
+                        if (print_fff && slice_result_cache)
+                            print_fff->set_slice_result_cache(slice_result_cache);
+                        if (print_fff && gcode_memory_limit_option)
+                            print_fff->set_gcode_memory_limit(size_t(gcode_memory_limit_option->value) << 20);
+                        if (print_fff)
+                            print_fff->set_filament_group_solver(filament_group_time_limit_option ? filament_group_time_limit_option->value : 0,
+                                filament_group_threads_option ? filament_group_threads_option->value : 0);
                         /*if (outfile_config.empty())
                         {
                             outfile = "plate_" + std::to_string(index + 1) + ".gcode";
@@ -14,15 +14,24 @@ bool g_use_actual_silhouette = false;
 #include <libnest2d/selections/firstfit.hpp>
 #include <libnest2d/utils/rotcalipers.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <numeric>
+#include <unordered_map>
 #include <ClipperUtils.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 #include <boost/geometry/index/rtree.hpp>
 
 #if defined(_MSC_VER) && defined(__clang__)
 #define BOOST_NO_CXX17_HDR_STRING_VIEW
 #endif
 
+#include <boost/format.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/multiprecision/integer.hpp>
 #include <boost/rational.hpp>
@@ -45,11 +54,89 @@ template<class T> struct _NumTag<boost::rational<T>>
 
 namespace nfp {
 
+// BBS: cache of the convex no fit polygons, keyed by the contours of both shapes moved to their first vertex. Moving
+// the shapes only moves their no fit polygon, which the placer then puts next to the stationary shape with
+// correctNfpPosition(), thus plates full of duplicates compute the no fit polygon of each pair of shapes once.
+// The cache is used while at least one arrangement asks for it and is dropped afterwards.
+class NfpCache
+{
+public:
+    static NfpCache &instance()
+    {
+        static NfpCache cache;
+        return cache;
+    }
+
+    bool enabled() const { return m_users.load(std::memory_order_relaxed) > 0; }
+    void acquire() { ++ m_users; }
+    void release()
+    {
+        if (-- m_users == 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_nfps.clear();
+        }
+    }
+
+    template<class Fn> NfpResult<Slic3r::ExPolygon> get(const Slic3r::ExPolygon &sh, const Slic3r::ExPolygon &other, Fn &&compute)
+    {
+        const Slic3r::Points &pts       = sh.contour.points;
+        const Slic3r::Points &other_pts = other.contour.points;
+        if (pts.empty() || other_pts.empty())
+            return compute(sh, other);
+        Slic3r::Points key;
+        key.reserve(pts.size() + other_pts.size() + 1);
+        key.emplace_back(coord_t(pts.size()), coord_t(other_pts.size()));
+        for (const Slic3r::Point &pt : pts) key.emplace_back(pt - pts.front());
+        for (const Slic3r::Point &pt : other_pts) key.emplace_back(pt - other_pts.front());
+        NfpResult<Slic3r::ExPolygon> nfp;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (auto it = m_nfps.find(key); it != m_nfps.end())
+                nfp = it->second;
+        }
+        if (nfp.first.contour.empty()) {
+            Slic3r::ExPolygon sh_moved(sh), other_moved(other);
+            sh_moved.translate(-pts.front());
+            other_moved.translate(-other_pts.front());
+            nfp = compute(sh_moved, other_moved);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_nfps.size() >= MAX_ENTRIES)
+                m_nfps.clear();
+            m_nfps.emplace(std::move(key), nfp);
+        }
+        nfp.first.translate(pts.front());
+        nfp.second += pts.front();
+        return nfp;
+    }
+
+private:
+    static constexpr size_t MAX_ENTRIES = 100000;
+
+    struct KeyHash
+    {
+        size_t operator()(const Slic3r::Points &key) const
+        {
+            size_t seed = key.size();
+            for (const Slic3r::Point &pt : key)
+                boost::hash_combine(seed, (uint64_t(pt.x()) * 0x9e3779b97f4a7c15ull) ^ uint64_t(pt.y()));
+            return seed;
+        }
+    };
+
+    std::atomic<int>                                                              m_users { 0 };
+    std::mutex                                                                    m_mutex;
+    std::unordered_map<Slic3r::Points, NfpResult<Slic3r::ExPolygon>, KeyHash>     m_nfps;
+};
+
 template<class S> struct NfpImpl<S, NfpLevel::CONVEX_ONLY>
 {
     NfpResult<S> operator()(const S &sh, const S &other)
     {
-        return nfpConvexOnly<S, boost::rational<LargeInt>>(sh, other);
+        auto compute = [](const S &sh, const S &other) { return nfpConvexOnly<S, boost::rational<LargeInt>>(sh, other); };
+        if constexpr (std::is_same_v<S, Slic3r::ExPolygon>)
+            if (NfpCache::instance().enabled())
+                return NfpCache::instance().get(sh, other, compute);
+        return compute(sh, other);
     }
 };
 
@@ -299,6 +386,20 @@ protected:
     std::vector<Box> m_excluded_and_extruCali_regions;  // excluded and extrusion calib regions
     size_t    m_item_count = 0; // Number of all items to be packed
     ArrangeParams params;
+    unsigned  m_order_seed = 0; // Perturbs the order of the items of a multi start arrangement, 0 keeps the greedy order.
+
+    // Area used to order the items. For a non zero order seed it is scaled by a factor from 0.7 to 1.3 drawn from the
+    // item id and the seed, so that the attempts of a multi start arrangement place the items in different orders.
+    double order_area(const Item &itm) const
+    {
+        if (m_order_seed == 0)
+            return itm.area();
+        uint64_t h = uint64_t(itm.itemId() + 1) * 0x9e3779b97f4a7c15ull ^ uint64_t(m_order_seed) * 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 31;
+        h *= 0x94d049bb133111ebull;
+        h ^= h >> 29;
+        return itm.area() * (0.7 + 0.6 * double(h >> 11) / double(1ull << 53));
+    }
 
     template<class T> ArithmeticOnly<T, double> norm(T val)
     {
@@ -710,7 +811,7 @@ public:
 
         m_pconf.progressFunc = [](const std::string& name) { BOOST_LOG_TRIVIAL(debug) << "arrange progress in NFP: " + name; };
 
-        m_pconf.sortfunc= [&params](Item& i1, Item& i2) {
+        m_pconf.sortfunc= [this, &params](Item& i1, Item& i2) {
             int p1 = i1.priority(), p2 = i2.priority();
             if (p1 != p2)
                 return p1 > p2;
@@ -732,7 +833,7 @@ public:
                     return i1.bed_temp != i2.bed_temp ? (i1.bed_temp > i2.bed_temp) :
                            i1.extrude_id_filament_types != i2.extrude_id_filament_types ? (i1.extrude_id_filament_types.begin()->first < i2.extrude_id_filament_types.begin()->first) :
                     std::abs(i1.height/params.printable_height - i2.height/params.printable_height)>0.05 ? i1.height > i2.height:
-                    (i1.area() > i2.area());
+                    (order_area(i1) > order_area(i2));
             }
         };
 
@@ -749,6 +850,8 @@ public:
     PConfig& config() { return m_pconf; }
     const PConfig& config() const { return m_pconf; }
 
+    void set_order_seed(unsigned seed) { m_order_seed = seed; }
+
     inline void preload(std::vector<Item>& fixeditems) {
         for(unsigned idx = 0; idx < fixeditems.size(); ++idx) {
             Item& itm = fixeditems[idx];
@@ -885,7 +988,9 @@ void _arrange(
         const BinT &                  bin,
         const ArrangeParams           &params,
         std::function<void(unsigned,std::string)> progressfn,
-        std::function<bool()>         stopfn)
+        std::function<bool()>         stopfn,
+        unsigned                      order_seed = 0,
+        double                        rotation_offset = 0.)
 {
     ArrangeParams mod_params    = params;
     mod_params.min_obj_distance = 0; // items are already inflated
@@ -932,6 +1037,9 @@ void _arrange(
                 } else {
                     allowed_angles = {0., angle, angle + PI * 0.25, angle + PI * 0.5, angle + PI * 0.75};
                 }
+                // BBS: the attempts of a multi start arrangement try other rotations besides the unrotated one.
+                for (size_t i = 1; i < allowed_angles.size(); ++i)
+                    allowed_angles[i] += rotation_offset;
             }
 
             itm.allowed_rotations.clear();
@@ -972,6 +1080,7 @@ void _arrange(
     //sl::offset(corrected_bin, md);
 
     AutoArranger<BinT> arranger{corrected_bin, mod_params, progressfn, stopfn};
+    arranger.set_order_seed(order_seed);
 
     // If there is something on the plate
     if (!excludes.empty()) arranger.preload(excludes);
@@ -986,6 +1095,123 @@ void _arrange(
     for (Item &itm : inp) itm.inflation(0);
 }
 
+// BBS: score of an arrangement, lower is better: the number of items left out, the number of beds used, then
+// the area of the bounding boxes of the piles on the beds.
+static std::tuple<size_t, int, double> arrangement_score(const std::vector<Item> &items)
+{
+    size_t           unfit = 0;
+    int              beds  = 0;
+    std::map<int, Box> piles;
+    for (const Item &itm : items) {
+        if (itm.is_virt_object)
+            continue;
+        if (itm.binId() < 0) {
+            ++ unfit;
+            continue;
+        }
+        beds = std::max(beds, itm.binId() + 1);
+        auto [it, inserted] = piles.emplace(itm.binId(), itm.boundingBox());
+        if (! inserted)
+            it->second = sl::boundingBox(it->second, itm.boundingBox());
+    }
+    double area = 0.;
+    for (const auto &pile : piles)
+        area += double(pile.second.width()) * double(pile.second.height());
+    return { unfit, beds, area };
+}
+
+// BBS: runs params.multi_start arrangements concurrently and keeps the best one. The first attempt is the greedy
+// arrangement of _arrange(), the others order the items of similar kind by a perturbed area and, if rotations are
+// allowed, try other rotations. The attempts other than the first one are dropped if they do not finish within
+// params.time_budget. params.on_packed is called for the items of the best arrangement only.
+template<class BinT>
+void _arrange_multi_start(std::vector<Item> &shapes, std::vector<Item> &excludes, const BinT &bin, const ArrangeParams &params)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(params.time_budget));
+
+    struct Attempt
+    {
+        std::vector<Item> shapes;
+        std::vector<Item> excludes;
+        bool              finished { false };
+    };
+    std::vector<Attempt> attempts(size_t(std::max(params.multi_start, 1)));
+    // A copied item would keep the cached vertex iterators into the original, setting the inflation drops the caches.
+    // The items of an arrangement always have their inflation set.
+    auto copy_items = [](const std::vector<Item> &items) {
+        std::vector<Item> out = items;
+        for (Item &itm : out)
+            itm.inflation(itm.inflation());
+        return out;
+    };
+    ArrangeParams        silent_params = params;
+    silent_params.on_packed            = nullptr;
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, attempts.size(), 1), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t idx = range.begin(); idx < range.end(); ++ idx) {
+            Attempt &attempt = attempts[idx];
+            if (idx > 0 && params.time_budget > 0. && Clock::now() > deadline)
+                continue;
+            attempt.shapes   = copy_items(shapes);
+            attempt.excludes = copy_items(excludes);
+            if (idx == 0) {
+                _arrange(attempt.shapes, attempt.excludes, bin, silent_params, params.progressind, params.stopcondition);
+                attempt.finished = true;
+                continue;
+            }
+            // The order perturbation is drawn from the item ids, the packer assigns the final ids.
+            for (size_t i = 0; i < attempt.shapes.size(); ++ i)
+                attempt.shapes[i].itemId(int(i));
+            bool stopped = false;
+            auto stopfn  = [&params, &stopped, deadline]() {
+                stopped = stopped || (params.stopcondition && params.stopcondition()) || (params.time_budget > 0. && Clock::now() > deadline);
+                return stopped;
+            };
+            double rotation_offset = params.allow_rotations ? PI / 4. * double(idx) / double(attempts.size()) : 0.;
+            _arrange(attempt.shapes, attempt.excludes, bin, silent_params, nullptr, stopfn, unsigned(idx), rotation_offset);
+            attempt.finished = ! stopped;
+        }
+    });
+
+    size_t best = 0;
+    auto   best_score = arrangement_score(attempts.front().shapes);
+    size_t finished   = 1;
+    for (size_t idx = 1; idx < attempts.size(); ++ idx)
+        if (attempts[idx].finished) {
+            ++ finished;
+            if (auto score = arrangement_score(attempts[idx].shapes); score < best_score) {
+                best       = idx;
+                best_score = score;
+            }
+        }
+    BOOST_LOG_TRIVIAL(info) << boost::format("multi start arrange: %1% of %2% attempts finished, best attempt %3%, unfit %4%, beds %5%, piles area %6%")
+        % finished % attempts.size() % best % std::get<0>(best_score) % std::get<1>(best_score) % std::get<2>(best_score);
+
+    std::vector<Item> &result = attempts[best].shapes;
+    if (best > 0)
+        for (size_t i = 0; i < result.size(); ++ i)
+            if (result[i].binId() < 0)
+                result[i].itemId(shapes[i].itemId());
+    shapes   = std::move(result);
+    excludes = std::move(attempts[best].excludes);
+
+    // The attempts pack silently, the items of the winning attempt are reported once it is chosen, bed by bed.
+    if (params.on_packed) {
+        std::vector<const Item *> packed;
+        for (const Item &itm : shapes)
+            if (itm.binId() >= 0)
+                packed.emplace_back(&itm);
+        std::stable_sort(packed.begin(), packed.end(), [](const Item *l, const Item *r) { return l->binId() < r->binId(); });
+        for (const Item *itm : packed) {
+            ArrangePolygon ap;
+            ap.bed_idx  = itm->binId();
+            ap.priority = itm->priority();
+            params.on_packed(ap);
+        }
+    }
+}
+
 inline Box to_nestbin(const BoundingBox &bb) { return Box{{bb.min(X), bb.min(Y)}, {bb.max(X), bb.max(Y)}};}
 inline Circle to_nestbin(const CircleBed &c) { return Circle({c.center()(0), c.center()(1)}, c.radius()); }
 inline ExPolygon to_nestbin(const Polygon &p) { return ExPolygon{p}; }
@@ -1088,7 +1314,9 @@ void arrange(ArrangePolygons &      items,
              const ArrangeParams &  params)
 {
     // Use bitmap-based arrangement when space_saving is enabled
-    if (params.space_saving) {
+    // BBS: and for the numbers of items the no fit polygons are too slow for. The raster needs a finite bed and does not
+    // keep the clearances of a sequential print.
+    if (bed.size() >= 3 && (params.space_saving || (! params.is_seq_print && params.raster_threshold > 0 && int(items.size()) > params.raster_threshold))) {
         arrange_bitmap(items, excludes, bed, params);
         return;
     }
@@ -1117,7 +1345,19 @@ void arrange(ArrangePolygons &      arrangables,
 
     for (Item &itm : fixeditems) itm.inflate(scaled(-2. * EPSILON));
 
-    _arrange(items, fixeditems, to_nestbin(bed), params, params.progressind, params.stopcondition);
+    // BBS: the no fit polygons of identical shapes are computed once.
+    struct NfpCacheScope
+    {
+        bool enabled;
+        explicit NfpCacheScope(bool enabled) : enabled(enabled) { if (enabled) libnest2d::nfp::NfpCache::instance().acquire(); }
+        ~NfpCacheScope() { if (enabled) libnest2d::nfp::NfpCache::instance().release(); }
+    } nfp_cache_scope(params.cache_nfp);
+
+    // The order of the items is the print order of a sequential print, it is not searched.
+    if (params.multi_start > 1 && ! params.is_seq_print)
+        _arrange_multi_start(items, fixeditems, to_nestbin(bed), params);
+    else
+        _arrange(items, fixeditems, to_nestbin(bed), params, params.progressind, params.stopcondition);
 
     for(size_t i = 0; i < items.size(); ++i) {
         Point tr = items[i].translation();
@@ -121,6 +121,24 @@ struct ArrangeParams {
     /// Allow parallel execution.
     bool parallel = true;
 
+    /// BBS: number of arrangements run concurrently with different item orders and rotations, the best one is kept.
+    /// 1 runs the single greedy arrangement. Ignored for the sequential print, where the order is the print order.
+    int multi_start = 1;
+
+    /// BBS: time budget of the multi start arrangement in seconds, 0 means no limit. The attempts not finished in time are
+    /// dropped, except for the greedy one.
+    double time_budget = 0.;
+
+    /// BBS: compute the no fit polygons of identical shapes once.
+    bool cache_nfp = true;
+
+    /// BBS: arrange with the raster engine of BitmapArrange.hpp once there are more items than this, 0 never does.
+    /// The no fit polygons get too slow for plates of hundreds of small parts, the raster loses up to a pixel of spacing.
+    int raster_threshold = 0;
+
+    /// BBS: pixel size of the raster engine in mm.
+    double raster_precision = 0.5;
+
     bool allow_rotations = false;
 
     bool do_final_align = true;
@@ -166,6 +184,9 @@ struct ArrangeParams {
         ret += "\"min_obj_distance\":" + std::to_string(min_obj_distance) + ",";
         ret += "\"accuracy\":" + std::to_string(accuracy) + ",";
         ret += "\"parallel\":" + std::to_string(parallel) + ",";
+        ret += "\"multi_start\":" + std::to_string(multi_start) + ",";
+        ret += "\"time_budget\":" + std::to_string(time_budget) + ",";
+        ret += "\"raster_threshold\":" + std::to_string(raster_threshold) + ",";
         ret += "\"allow_rotations\":" + std::to_string(allow_rotations) + ",";
         ret += "\"do_final_align\":" + std::to_string(do_final_align) + ",";
         ret += "\"allow_multi_materials_on_same_plate\":" + std::to_string(allow_multi_materials_on_same_plate) + ",";
@@ -1,601 +1,569 @@
 #include "BitmapArrange.hpp"
 #include "ClipperUtils.hpp"
+#include "Fingerprint.hpp"
 #include "Geometry.hpp"
 #include <algorithm>
+#include <bitset>
+#include <cassert>
 #include <cmath>
 #include <limits>
 #include <numeric>
-#include <fstream>
+#include <unordered_map>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <boost/format.hpp>
 #include <boost/log/trivial.hpp>
 
-// Debug log file
-static std::ofstream g_debug_log;
-static void init_debug_log() {
-    if (!g_debug_log.is_open()) {
-        g_debug_log.open("E:/Desktop/bitmap_arrange_debug.txt", std::ios::out | std::ios::trunc);
-    }
-}
-#define DEBUG_LOG(x) do { init_debug_log(); g_debug_log << x << std::endl; g_debug_log.flush(); } while(0)
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define SLIC3R_BITMAPARRANGE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SLIC3R_BITMAPARRANGE_SSE2
+#endif
 
 namespace Slic3r { namespace arrangement {
 
-// Simple bitmap class for fast collision detection (like Plater)
-class FastBitmap {
-public:
-    int width, height;
-    std::vector<uint8_t> data;
-    int centerX, centerY;  // Gravity center in pixels
+// Growing a shape by half of the pixel diagonal before sampling it at the pixel centers sets every pixel the shape touches.
+static constexpr const float CONSERVATIVE_GROWTH = 0.7072f;
 
-    FastBitmap(int w, int h) : width(w), height(h), data(w * h, 0), centerX(w/2), centerY(h/2) {}
+static inline coord_t floor_div(coord_t a, coord_t b)
+{
+    return a >= 0 ? a / b : - ((- a + b - 1) / b);
+}
 
-    inline bool getPoint(int x, int y) const {
-        if (x < 0 || x >= width || y < 0 || y >= height) return false;
-        return data[y * width + x] != 0;
+static inline void set_bits(uint64_t *row, int x0, int x1)
+{
+    const int      w0 = x0 >> 6;
+    const int      w1 = x1 >> 6;
+    const uint64_t m0 = ~uint64_t(0) << (x0 & 63);
+    const uint64_t m1 = ~uint64_t(0) >> (63 - (x1 & 63));
+    if (w0 == w1) {
+        row[w0] |= m0 & m1;
+        return;
     }
+    row[w0] |= m0;
+    for (int w = w0 + 1; w < w1; ++ w)
+        row[w] = ~uint64_t(0);
+    row[w1] |= m1;
+}
 
-    inline void setPoint(int x, int y, uint8_t val = 1) {
-        if (x >= 0 && x < width && y >= 0 && y < height) {
-            data[y * width + x] = val;
-        }
+static inline void clear_bits(uint64_t *row, int x0, int x1)
+{
+    const int      w0 = x0 >> 6;
+    const int      w1 = x1 >> 6;
+    const uint64_t m0 = ~uint64_t(0) << (x0 & 63);
+    const uint64_t m1 = ~uint64_t(0) >> (63 - (x1 & 63));
+    if (w0 == w1) {
+        row[w0] &= ~(m0 & m1);
+        return;
     }
+    row[w0] &= ~m0;
+    for (int w = w0 + 1; w < w1; ++ w)
+        row[w] = 0;
+    row[w1] &= ~m1;
+}
 
-    // Check if this bitmap overlaps with another at offset (offx, offy)
-    bool overlaps(const FastBitmap& other, int offx, int offy) const {
-        // Iterate over this bitmap's pixels
-        for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-                if (getPoint(x, y) && other.getPoint(x + offx, y + offy)) {
-                    return true;
-                }
-            }
-        }
-        return false;
-    }
+static inline bool any_bits(const uint64_t *row, int x0, int x1)
+{
+    const int      w0 = x0 >> 6;
+    const int      w1 = x1 >> 6;
+    const uint64_t m0 = ~uint64_t(0) << (x0 & 63);
+    const uint64_t m1 = ~uint64_t(0) >> (63 - (x1 & 63));
+    if (w0 == w1)
+        return (row[w0] & m0 & m1) != 0;
+    if (row[w0] & m0)
+        return true;
+    for (int w = w0 + 1; w < w1; ++ w)
+        if (row[w])
+            return true;
+    return (row[w1] & m1) != 0;
+}
 
-    // Write another bitmap onto this one at offset
-    void write(const FastBitmap& other, int offx, int offy) {
-        for (int y = 0; y < other.height; y++) {
-            for (int x = 0; x < other.width; x++) {
-                if (other.getPoint(x, y)) {
-                    setPoint(x + offx, y + offy, other.getPoint(x, y));
-                }
+// Calls fn(y, x0, x1) for the runs x0..x1 of the pixels of the rows y in [0, height), which have their centers inside
+// of the polygons (even-odd rule). Pixel (x, y) has its lower left corner at origin + (x, y) * pixel_size.
+template<class Fn>
+static void for_each_span(const Polygons &polys, const Point &origin, coord_t pixel_size, int width, int height, Fn &&fn)
+{
+    BoundingBox bbox = get_extents(polys);
+    if (! bbox.defined || width <= 0 || height <= 0)
+        return;
+    const double px    = double(pixel_size);
+    const int    y_min = int(std::clamp(std::floor(double(bbox.min.y() - origin.y()) / px - 0.5), 0., double(height)));
+    const int    y_max = int(std::clamp(std::ceil(double(bbox.max.y() - origin.y()) / px - 0.5), -1., double(height - 1)));
+    std::vector<double> xs;
+    for (int y = y_min; y <= y_max; ++ y) {
+        const double yc = double(origin.y()) + (y + 0.5) * px;
+        xs.clear();
+        for (const Polygon &poly : polys) {
+            const Points &pts = poly.points;
+            for (size_t i = 0, j = pts.size() - 1; i < pts.size(); j = i ++) {
+                const Point &a = pts[j];
+                const Point &b = pts[i];
+                if ((double(a.y()) <= yc) != (double(b.y()) <= yc))
+                    xs.emplace_back(double(a.x()) + (yc - double(a.y())) * double(b.x() - a.x()) / double(b.y() - a.y()));
             }
         }
-    }
-
-    // Dilate the bitmap by N iterations (for spacing)
-    void dilate(int iterations) {
-        for (int i = 0; i < iterations; i++) {
-            std::vector<uint8_t> old_data = data;
-            for (int y = 0; y < height; y++) {
-                for (int x = 0; x < width; x++) {
-                    if (old_data[y * width + x] == 0) {
-                        // Check 8-neighbors
-                        bool has_neighbor = false;
-                        for (int dy = -1; dy <= 1 && !has_neighbor; dy++) {
-                            for (int dx = -1; dx <= 1 && !has_neighbor; dx++) {
-                                int nx = x + dx, ny = y + dy;
-                                if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
-                                    if (old_data[ny * width + nx] != 0) {
-                                        has_neighbor = true;
-                                    }
-                                }
-                            }
-                        }
-                        if (has_neighbor) {
-                            data[y * width + x] = 1;
-                        }
-                    }
-                }
-            }
+        std::sort(xs.begin(), xs.end());
+        for (size_t i = 0; i + 1 < xs.size(); i += 2) {
+            const int x0 = int(std::clamp(std::ceil((xs[i] - double(origin.x())) / px - 0.5), 0., double(width)));
+            const int x1 = int(std::clamp(std::floor((xs[i + 1] - double(origin.x())) / px - 0.5), -1., double(width - 1)));
+            if (x0 <= x1)
+                fn(y, x0, x1);
         }
     }
+}
 
-    // Dilate only outer edges (not holes) - uses flood fill to identify exterior
-    void dilate_outer_only(int iterations) {
-        if (iterations <= 0) return;
-
-        // First, flood fill from edges to mark exterior region
-        std::vector<uint8_t> exterior(width * height, 0);
-        std::vector<std::pair<int,int>> queue;
-
-        // Add all edge pixels that are empty to queue
-        for (int x = 0; x < width; x++) {
-            if (data[0 * width + x] == 0 && exterior[0 * width + x] == 0) {
-                exterior[0 * width + x] = 1;
-                queue.push_back({x, 0});
-            }
-            if (data[(height-1) * width + x] == 0 && exterior[(height-1) * width + x] == 0) {
-                exterior[(height-1) * width + x] = 1;
-                queue.push_back({x, height-1});
-            }
-        }
-        for (int y = 0; y < height; y++) {
-            if (data[y * width + 0] == 0 && exterior[y * width + 0] == 0) {
-                exterior[y * width + 0] = 1;
-                queue.push_back({0, y});
-            }
-            if (data[y * width + width-1] == 0 && exterior[y * width + width-1] == 0) {
-                exterior[y * width + width-1] = 1;
-                queue.push_back({width-1, y});
-            }
-        }
+RasterMask::RasterMask(const ExPolygon &poly, coord_t pixel_size, coord_t inflation, const Point &grid_anchor)
+{
+    Polygons grown = to_polygons(offset_ex(poly, float(inflation) + float(pixel_size) * CONSERVATIVE_GROWTH));
+    if (grown.empty())
+        return;
+    BoundingBox bbox = get_extents(grown);
+    m_origin = grid_anchor + Point(floor_div(bbox.min.x() - grid_anchor.x(), pixel_size) * pixel_size,
+                                   floor_div(bbox.min.y() - grid_anchor.y(), pixel_size) * pixel_size);
+    m_width  = int((bbox.max.x() - m_origin.x()) / pixel_size) + 1;
+    m_height = int((bbox.max.y() - m_origin.y()) / pixel_size) + 1;
+    m_words  = (m_width + 63) >> 6;
+    m_stride = m_words + 2;
+    m_bits.assign(size_t(m_height) * m_stride, 0);
+    for_each_span(grown, m_origin, pixel_size, m_width, m_height, [this](int y, int x0, int x1) {
+        set_bits(m_bits.data() + size_t(y) * m_stride + 1, x0, x1);
+    });
+}
 
-        // Flood fill using 4-connectivity (to be conservative about holes)
-        size_t head = 0;
-        while (head < queue.size()) {
-            int x = queue[head].first;
-            int y = queue[head].second;
-            head++;
-
-            const int dx[] = {0, 0, 1, -1};
-            const int dy[] = {1, -1, 0, 0};
-            for (int d = 0; d < 4; d++) {
-                int nx = x + dx[d];
-                int ny = y + dy[d];
-                if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
-                    if (data[ny * width + nx] == 0 && exterior[ny * width + nx] == 0) {
-                        exterior[ny * width + nx] = 1;
-                        queue.push_back({nx, ny});
-                    }
-                }
-            }
-        }
+size_t RasterMask::count() const
+{
+    size_t cnt = 0;
+    for (uint64_t word : m_bits)
+        cnt += std::bitset<64>(word).count();
+    return cnt;
+}
 
-        // Now dilate: only fill exterior pixels adjacent to occupied pixels
-        for (int iter = 0; iter < iterations; iter++) {
-            std::vector<uint8_t> old_data = data;
-            std::vector<uint8_t> old_exterior = exterior;
-
-            for (int y = 0; y < height; y++) {
-                for (int x = 0; x < width; x++) {
-                    // Only consider exterior empty pixels
-                    if (old_exterior[y * width + x] && old_data[y * width + x] == 0) {
-                        // Check if adjacent to occupied pixel
-                        bool adjacent_to_occupied = false;
-                        for (int dy = -1; dy <= 1 && !adjacent_to_occupied; dy++) {
-                            for (int dx = -1; dx <= 1 && !adjacent_to_occupied; dx++) {
-                                int nx = x + dx, ny = y + dy;
-                                if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
-                                    if (old_data[ny * width + nx] != 0) {
-                                        adjacent_to_occupied = true;
-                                    }
-                                }
-                            }
-                        }
-                        if (adjacent_to_occupied) {
-                            data[y * width + x] = 1;
-                            exterior[y * width + x] = 0; // No longer exterior
-                        }
-                    }
-                }
-            }
-        }
+// Whether the mask row shifted up by shift bits intersects the bed row. bed points to the word of the bed row holding
+// the first pixel of the mask row, mask[-1] and mask[words] are zero. Word k of the shifted row is made of the words
+// k and k - 1 of the mask row, the shift right by 64 bits of the SIMD instructions gives zero as required for shift 0.
+static inline bool row_collides(const uint64_t *mask, const uint64_t *bed, int words, unsigned shift)
+{
+    int k = 0;
+#if defined(SLIC3R_BITMAPARRANGE_AVX2)
+    const __m128i cnt  = _mm_cvtsi32_si128(int(shift));
+    const __m128i rcnt = _mm_cvtsi32_si128(int(64 - shift));
+    for (; k + 4 <= words + 1; k += 4) {
+        const __m256i cur  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + k));
+        const __m256i prev = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + k - 1));
+        const __m256i row  = _mm256_or_si256(_mm256_sll_epi64(cur, cnt), _mm256_srl_epi64(prev, rcnt));
+        if (! _mm256_testz_si256(row, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bed + k))))
+            return true;
     }
-};
-
-// Rasterize a polygon to a FastBitmap
-static FastBitmap* rasterize_polygon(const ExPolygon& poly, double precision, int dilate_pixels = 0) {
-    BoundingBox bbox = get_extents(poly);
-
-    // Add extra margin for dilatation so shape can expand
-    int margin = dilate_pixels + 1;
-    int width = static_cast<int>(std::ceil(unscaled(bbox.size().x()) / precision)) + 2 + 2 * dilate_pixels;
-    int height = static_cast<int>(std::ceil(unscaled(bbox.size().y()) / precision)) + 2 + 2 * dilate_pixels;
-
-    FastBitmap* bmp = new FastBitmap(width, height);
-
-    // Compute center offset (account for dilate margin)
-    Point center = bbox.center();
-    bmp->centerX = static_cast<int>((unscaled(center.x()) - unscaled(bbox.min.x())) / precision) + 1 + dilate_pixels;
-    bmp->centerY = static_cast<int>((unscaled(center.y()) - unscaled(bbox.min.y())) / precision) + 1 + dilate_pixels;
-
-    // Offset for rasterization (account for margin)
-    int raster_offset = 1 + dilate_pixels;
-
-    // Rasterize using scanline for initial bitmap creation only
-    auto to_pixel = [&](coord_t v, coord_t min_v) -> int {
-        return static_cast<int>((unscaled(v) - unscaled(min_v)) / precision) + raster_offset;
-    };
-
-    // Rasterize contour
-    const Points& pts = poly.contour.points;
-    size_t n = pts.size();
-    if (n < 3) return bmp;
-
-    // Scanline rasterization with offset
-    int base_height = height - 2 * raster_offset;  // Original polygon height in pixels
-    for (int py = 0; py < base_height; py++) {
-        double scan_y = unscaled(bbox.min.y()) + py * precision;
-        coord_t scan_y_scaled = scaled(scan_y);
-
-        std::vector<double> intersections;
-
-        for (size_t i = 0; i < n; i++) {
-            const Point& p1 = pts[i];
-            const Point& p2 = pts[(i + 1) % n];
-
-            if ((p1.y() <= scan_y_scaled && p2.y() > scan_y_scaled) ||
-                (p2.y() <= scan_y_scaled && p1.y() > scan_y_scaled)) {
-                double t = static_cast<double>(scan_y_scaled - p1.y()) / (p2.y() - p1.y());
-                double x = unscaled(p1.x()) + t * unscaled(p2.x() - p1.x());
-                intersections.push_back(x);
-            }
-        }
-
-        std::sort(intersections.begin(), intersections.end());
-
-        for (size_t i = 0; i + 1 < intersections.size(); i += 2) {
-            int x_start = static_cast<int>((intersections[i] - unscaled(bbox.min.x())) / precision) + raster_offset;
-            int x_end = static_cast<int>((intersections[i + 1] - unscaled(bbox.min.x())) / precision) + raster_offset;
-            x_start = std::max(0, x_start);
-            x_end = std::min(width - 1, x_end);
-            for (int px = x_start; px <= x_end; px++) {
-                bmp->setPoint(px, py + raster_offset, 1);
-            }
-        }
+#elif defined(SLIC3R_BITMAPARRANGE_SSE2)
+    const __m128i cnt  = _mm_cvtsi32_si128(int(shift));
+    const __m128i rcnt = _mm_cvtsi32_si128(int(64 - shift));
+    const __m128i zero = _mm_setzero_si128();
+    for (; k + 2 <= words + 1; k += 2) {
+        const __m128i cur  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + k));
+        const __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + k - 1));
+        const __m128i row  = _mm_or_si128(_mm_sll_epi64(cur, cnt), _mm_srl_epi64(prev, rcnt));
+        const __m128i hit  = _mm_and_si128(row, _mm_loadu_si128(reinterpret_cast<const __m128i*>(bed + k)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(hit, zero)) != 0xFFFF)
+            return true;
+    }
+#endif
+    for (; k <= words; ++ k) {
+        uint64_t row = mask[k] << shift;
+        if (shift != 0)
+            row |= mask[k - 1] >> (64 - shift);
+        if (row & bed[k])
+            return true;
     }
+    return false;
+}
 
-    // Rasterize holes (unfill)
-    for (const Polygon& hole : poly.holes) {
-        const Points& hpts = hole.points;
-        size_t hn = hpts.size();
-        if (hn < 3) continue;
+ArrangeBitmap::ArrangeBitmap(const BoundingBox& bed_bbox, double precision_mm)
+    : m_precision(precision_mm)
+    , m_pixel_size(std::max<coord_t>(scaled<coord_t>(precision_mm), 1))
+    , m_bed_bbox(bed_bbox)
+{
+    // Only the pixels fully inside of the bed.
+    m_width_px  = std::max(0, int(bed_bbox.size().x() / m_pixel_size));
+    m_height_px = std::max(0, int(bed_bbox.size().y() / m_pixel_size));
+    m_words     = ((m_width_px + 63) >> 6) + 1;
+    this->clear();
+}
 
-        for (int py = 0; py < base_height; py++) {
-            double scan_y = unscaled(bbox.min.y()) + py * precision;
-            coord_t scan_y_scaled = scaled(scan_y);
+void ArrangeBitmap::clear()
+{
+    m_data.assign(size_t(m_height_px) * m_words, 0);
+    // The padding right of the bed is occupied.
+    for (int y = 0; y < m_height_px; ++ y)
+        set_bits(this->row(y), m_width_px, m_words * 64 - 1);
+}
 
-            std::vector<double> intersections;
+void ArrangeBitmap::set_span(int y, int x0, int x1, bool value)
+{
+    if (value)
+        set_bits(this->row(y), x0, x1);
+    else
+        clear_bits(this->row(y), x0, x1);
+}
 
-            for (size_t i = 0; i < hn; i++) {
-                const Point& p1 = hpts[i];
-                const Point& p2 = hpts[(i + 1) % hn];
+void ArrangeBitmap::rasterize(const ExPolygon& poly, const Point& offset, coord_t inflation)
+{
+    ExPolygon moved = poly;
+    moved.translate(offset);
+    Polygons grown = to_polygons(offset_ex(moved, float(inflation) + float(m_pixel_size) * CONSERVATIVE_GROWTH));
+    for_each_span(grown, this->origin(), m_pixel_size, m_width_px, m_height_px, [this](int y, int x0, int x1) {
+        this->set_span(y, x0, x1, true);
+    });
+}
 
-                if ((p1.y() <= scan_y_scaled && p2.y() > scan_y_scaled) ||
-                    (p2.y() <= scan_y_scaled && p1.y() > scan_y_scaled)) {
-                    double t = static_cast<double>(scan_y_scaled - p1.y()) / (p2.y() - p1.y());
-                    double x = unscaled(p1.x()) + t * unscaled(p2.x() - p1.x());
-                    intersections.push_back(x);
-                }
-            }
+bool ArrangeBitmap::collides(const ExPolygon& poly, const Point& offset) const
+{
+    ExPolygon moved = poly;
+    moved.translate(offset);
+    Polygons    grown = to_polygons(offset_ex(moved, float(m_pixel_size) * CONSERVATIVE_GROWTH));
+    BoundingBox bbox  = get_extents(grown);
+    if (! bbox.defined)
+        return false;
+    const Point top_right = this->from_pixel(m_width_px, m_height_px);
+    if (bbox.min.x() < this->origin().x() || bbox.min.y() < this->origin().y() || bbox.max.x() > top_right.x() || bbox.max.y() > top_right.y())
+        return true;
+    bool hit = false;
+    for_each_span(grown, this->origin(), m_pixel_size, m_width_px, m_height_px, [this, &hit](int y, int x0, int x1) {
+        hit = hit || any_bits(this->row(y), x0, x1);
+    });
+    return hit;
+}
 
-            std::sort(intersections.begin(), intersections.end());
+bool ArrangeBitmap::collides(const RasterMask& mask, int x, int y) const
+{
+    assert(x >= 0 && y >= 0 && x + mask.width() <= m_width_px && y + mask.height() <= m_height_px);
+    const unsigned shift = unsigned(x & 63);
+    const int      w0    = x >> 6;
+    for (int r = 0; r < mask.height(); ++ r)
+        if (row_collides(mask.row(r), this->row(y + r) + w0, mask.words(), shift))
+            return true;
+    return false;
+}
 
-            for (size_t i = 0; i + 1 < intersections.size(); i += 2) {
-                int x_start = static_cast<int>((intersections[i] - unscaled(bbox.min.x())) / precision) + raster_offset;
-                int x_end = static_cast<int>((intersections[i + 1] - unscaled(bbox.min.x())) / precision) + raster_offset;
-                x_start = std::max(0, x_start);
-                x_end = std::min(width - 1, x_end);
-                for (int px = x_start; px <= x_end; px++) {
-                    bmp->setPoint(px, py + raster_offset, 0);
-                }
-            }
+void ArrangeBitmap::mark_occupied(const RasterMask& mask, int x, int y)
+{
+    assert(x >= 0 && y >= 0 && x + mask.width() <= m_width_px && y + mask.height() <= m_height_px);
+    const unsigned shift = unsigned(x & 63);
+    const int      w0    = x >> 6;
+    for (int r = 0; r < mask.height(); ++ r) {
+        const uint64_t *src = mask.row(r);
+        uint64_t       *dst = this->row(y + r) + w0;
+        for (int k = 0; k <= mask.words(); ++ k) {
+            uint64_t word = src[k] << shift;
+            if (shift != 0)
+                word |= src[k - 1] >> (64 - shift);
+            dst[k] |= word;
         }
     }
+}
 
-    // Dilate for spacing
-    if (dilate_pixels > 0) {
-        bmp->dilate(dilate_pixels);
-    }
+void ArrangeBitmap::mark_bed_exterior(const Polygon& bed)
+{
+    // Only the pixels with their centers inside of the shrunk bed are fully inside of the bed.
+    std::vector<uint64_t> inside(m_data.size(), 0);
+    for_each_span(offset(bed, - float(m_pixel_size) * CONSERVATIVE_GROWTH), this->origin(), m_pixel_size, m_width_px, m_height_px,
+        [this, &inside](int y, int x0, int x1) { set_bits(inside.data() + size_t(y) * m_words, x0, x1); });
+    for (size_t i = 0; i < m_data.size(); ++ i)
+        m_data[i] |= ~inside[i];
+}
 
-    return bmp;
+size_t ArrangeBitmap::occupied() const
+{
+    size_t cnt = 0;
+    for (uint64_t word : m_data)
+        cnt += std::bitset<64>(word).count();
+    // Minus the padding.
+    return cnt - size_t(m_height_px) * size_t(m_words * 64 - m_width_px);
 }
 
-// Rotate a bitmap (like Plater)
-static FastBitmap* rotate_bitmap(const FastBitmap* src, double angle) {
-    if (std::abs(angle) < 0.001) {
-        // No rotation, just copy
-        FastBitmap* dst = new FastBitmap(src->width, src->height);
-        dst->data = src->data;
-        dst->centerX = src->centerX;
-        dst->centerY = src->centerY;
-        return dst;
-    }
+Point ArrangeBitmap::to_pixel(const Point& p) const
+{
+    return { floor_div(p.x() - this->origin().x(), m_pixel_size), floor_div(p.y() - this->origin().y(), m_pixel_size) };
+}
 
-    double r = -angle;
-    double cos_r = std::cos(r);
-    double sin_r = std::sin(r);
-
-    // Compute rotated bounding box
-    double w = src->width;
-    double h = src->height;
-
-    double ax = w * cos_r - h * sin_r;
-    double ay = w * sin_r + h * cos_r;
-    double bx = -h * sin_r;
-    double by = h * cos_r;
-    double cx = w * cos_r;
-    double cy = w * sin_r;
-
-    double xMin = std::min({0.0, ax, bx, cx});
-    double xMax = std::max({0.0, ax, bx, cx});
-    double yMin = std::min({0.0, ay, by, cy});
-    double yMax = std::max({0.0, ay, by, cy});
-
-    int new_width = static_cast<int>(std::ceil(xMax - xMin));
-    int new_height = static_cast<int>(std::ceil(yMax - yMin));
-
-    FastBitmap* dst = new FastBitmap(new_width, new_height);
-
-    double old_cx = src->centerX;
-    double old_cy = src->centerY;
-    double new_cx = new_width / 2.0;
-    double new_cy = new_height / 2.0;
-
-    // Compute new center position
-    dst->centerX = static_cast<int>(new_cx);
-    dst->centerY = static_cast<int>(new_cy);
-
-    for (int y = 0; y < new_height; y++) {
-        for (int x = 0; x < new_width; x++) {
-            double dx = x - new_cx;
-            double dy = y - new_cy;
-            int srcX = static_cast<int>(std::round(cos_r * dx - sin_r * dy + old_cx));
-            int srcY = static_cast<int>(std::round(sin_r * dx + cos_r * dy + old_cy));
-            if (src->getPoint(srcX, srcY)) {
-                dst->setPoint(x, y, 1);
-            }
-        }
-    }
+Point ArrangeBitmap::from_pixel(int x, int y) const
+{
+    return this->origin() + Point(coord_t(x) * m_pixel_size, coord_t(y) * m_pixel_size);
+}
 
-    return dst;
+bool ArrangeBitmap::get_pixel(int x, int y) const
+{
+    if (x < 0 || x >= m_width_px || y < 0 || y >= m_height_px)
+        return false;
+    return (this->row(y)[x >> 6] >> (x & 63)) & 1;
 }
 
-// Result of a single placement attempt
-struct PlacementResult {
-    Vec2crd translation;
-    double rotation;
-    int bed_idx;
-    bool placed;
-};
+void ArrangeBitmap::set_pixel(int x, int y, bool value)
+{
+    if (x >= 0 && x < m_width_px && y >= 0 && y < m_height_px)
+        this->set_span(y, x, x, value);
+}
+
+namespace {
 
-// Try one arrangement configuration and return results + score
-static double try_arrangement(
-    const ArrangePolygons& items,
-    const std::vector<size_t>& order,
-    const std::vector<double>& rotations,
-    const BoundingBox& bed_bbox,
-    double precision,
-    int spacing_pixels,
-    int step_pixels,
-    int plate_width,
-    int plate_height,
-    std::vector<PlacementResult>& results)
+// The masks of the items sharing the shape, the inflation and the rotations.
+struct RasterShape
 {
-    FastBitmap plate(plate_width, plate_height);
-    double plate_cx = plate_width / 2.0;
-    double plate_cy = plate_height / 2.0;
-
-    results.resize(items.size());
-    for (auto& r : results) {
-        r.placed = false;
-        r.bed_idx = UNARRANGED;
-    }
+    const ArrangePolygon       *sample { nullptr };
+    std::vector<double>         rotations;
+    std::vector<RasterMask>     masks;
+    // Step of the coarse placement search in pixels.
+    int                         step { 1 };
+};
 
-    // Track bounding box of placed items for scoring
-    double min_x = std::numeric_limits<double>::max();
-    double min_y = std::numeric_limits<double>::max();
-    double max_x = std::numeric_limits<double>::lowest();
-    double max_y = std::numeric_limits<double>::lowest();
-    int placed_count = 0;
+struct RasterPlate
+{
+    ArrangeBitmap       bitmap;
+    // Per shape, the positions of the coarse search closer than this ring to the alignment point were all occupied.
+    std::vector<int>    min_ring;
+};
 
-    for (size_t idx : order) {
-        const ArrangePolygon& item = items[idx];
+struct RasterPlacement
+{
+    int     rotation { -1 };
+    int     x { 0 };
+    int     y { 0 };
+    double  cost { std::numeric_limits<double>::max() };
+};
 
-        // Pre-rasterize part at all rotations
-        std::vector<FastBitmap*> part_bmps;
-        std::vector<FastBitmap*> part_bmps_dilated;
+// The position closest to the alignment point: first on a lattice with the step of the shape, searched ring by ring
+// around the alignment point, then improved with steps halving down to a single pixel.
+static bool find_placement(RasterPlate &plate, size_t shape_idx, const RasterShape &shape, const Vec2d &align, RasterPlacement &out)
+{
+    const ArrangeBitmap &bitmap = plate.bitmap;
+    const int            step   = shape.step;
+    auto cost = [&shape, &align](int rot, int x, int y) {
+        const RasterMask &mask = shape.masks[rot];
+        const double      dx   = x + 0.5 * mask.width() - align.x();
+        const double      dy   = y + 0.5 * mask.height() - align.y();
+        return dx * dx + dy * dy;
+    };
+    auto fits = [&shape, &bitmap](int rot, int x, int y) {
+        const RasterMask &mask = shape.masks[rot];
+        return x >= 0 && y >= 0 && x + mask.width() <= bitmap.width() && y + mask.height() <= bitmap.height() && ! bitmap.collides(mask, x, y);
+    };
+    RasterPlacement best;
+    auto try_position = [&](int rot, int x, int y) {
+        if (double c = cost(rot, x, y); c < best.cost && fits(rot, x, y))
+            best = { rot, x, y, c };
+    };
 
-        for (double rot : rotations) {
-            ExPolygon rotated_poly = item.poly;
-            if (rot != 0) {
-                rotated_poly.rotate(rot);
+    const int max_ring   = (std::max(bitmap.width(), bitmap.height()) + step - 1) / step + 1;
+    int       found_ring = -1;
+    for (int ring = plate.min_ring[shape_idx]; ring <= max_ring; ++ ring) {
+        // The positions of the further rings are further than the best one.
+        if (found_ring >= 0 && double(ring - 1) * step > std::sqrt(best.cost) + 1.)
+            break;
+        for (int rot = 0; rot < int(shape.masks.size()); ++ rot) {
+            const RasterMask &mask = shape.masks[rot];
+            if (mask.empty())
+                continue;
+            const int         cx   = int(std::lround(align.x() - 0.5 * mask.width()));
+            const int         cy   = int(std::lround(align.y() - 0.5 * mask.height()));
+            if (ring == 0) {
+                try_position(rot, cx, cy);
+                continue;
+            }
+            const int r = ring * step;
+            for (int i = - ring; i <= ring; ++ i) {
+                try_position(rot, cx + i * step, cy - r);
+                try_position(rot, cx + i * step, cy + r);
+            }
+            for (int i = - ring + 1; i < ring; ++ i) {
+                try_position(rot, cx - r, cy + i * step);
+                try_position(rot, cx + r, cy + i * step);
             }
-            FastBitmap* bmp = rasterize_polygon(rotated_poly, precision, 0);
-            part_bmps.push_back(bmp);
-            FastBitmap* bmp_dilated = rasterize_polygon(rotated_poly, precision, spacing_pixels);
-            part_bmps_dilated.push_back(bmp_dilated);
         }
+        if (found_ring < 0 && best.rotation >= 0)
+            found_ring = ring;
+    }
+    // The bitmap only fills up, the closer rings stay occupied for the next items of the shape.
+    plate.min_ring[shape_idx] = found_ring >= 0 ? found_ring : max_ring + 1;
+    if (best.rotation < 0)
+        return false;
 
-        // Find best position using spiral search from center
-        bool found = false;
-        int best_x = 0, best_y = 0;
-        size_t best_rot_idx = 0;
-        int max_radius = std::max(plate_width, plate_height);
-
-        for (int radius = 0; radius <= max_radius && !found; radius += step_pixels) {
-            for (size_t rot_idx = 0; rot_idx < rotations.size() && !found; rot_idx++) {
-                FastBitmap* part_bmp_dilated = part_bmps_dilated[rot_idx];
-                int center_x = static_cast<int>(plate_cx) - part_bmp_dilated->centerX;
-                int center_y = static_cast<int>(plate_cy) - part_bmp_dilated->centerY;
-
-                for (int dy = -radius; dy <= radius && !found; dy += step_pixels) {
-                    for (int dx = -radius; dx <= radius && !found; dx += step_pixels) {
-                        if (radius > 0 && std::abs(dx) < radius && std::abs(dy) < radius)
-                            continue;
-
-                        int x = center_x + dx;
-                        int y = center_y + dy;
-
-                        if (x < 0 || y < 0 ||
-                            x + part_bmp_dilated->width > plate_width ||
-                            y + part_bmp_dilated->height > plate_height)
-                            continue;
-
-                        if (!part_bmp_dilated->overlaps(plate, x, y)) {
-                            found = true;
-                            best_x = x;
-                            best_y = y;
-                            best_rot_idx = rot_idx;
-                        }
-                    }
+    static const int dirs[8][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {1, -1}, {-1, 1}, {1, 1} };
+    for (int s = step / 2; s >= 1; s /= 2)
+        for (bool improved = true; improved;) {
+            improved = false;
+            for (const auto &dir : dirs) {
+                const int x = best.x + dir[0] * s;
+                const int y = best.y + dir[1] * s;
+                if (double c = cost(best.rotation, x, y); c < best.cost && fits(best.rotation, x, y)) {
+                    best     = { best.rotation, x, y, c };
+                    improved = true;
+                    break;
                 }
             }
         }
-
-        if (found) {
-            FastBitmap* best_bmp = part_bmps[best_rot_idx];
-            FastBitmap* best_bmp_dilated = part_bmps_dilated[best_rot_idx];
-
-            int offset_x = best_x + (best_bmp_dilated->width - best_bmp->width) / 2;
-            int offset_y = best_y + (best_bmp_dilated->height - best_bmp->height) / 2;
-            plate.write(*best_bmp, offset_x, offset_y);
-
-            // Compute center position in mm
-            double placed_cx_mm = (offset_x + best_bmp->centerX) * precision;
-            double placed_cy_mm = (offset_y + best_bmp->centerY) * precision;
-
-            coord_t bed_x = bed_bbox.min.x() + scaled(placed_cx_mm);
-            coord_t bed_y = bed_bbox.min.y() + scaled(placed_cy_mm);
-
-            results[idx].translation = Vec2crd(bed_x, bed_y);
-            results[idx].rotation = rotations[best_rot_idx];
-            results[idx].bed_idx = 0;
-            results[idx].placed = true;
-            placed_count++;
-
-            // Update bounding box (using bitmap extents)
-            double bmp_min_x = offset_x * precision;
-            double bmp_min_y = offset_y * precision;
-            double bmp_max_x = (offset_x + best_bmp->width) * precision;
-            double bmp_max_y = (offset_y + best_bmp->height) * precision;
-            min_x = std::min(min_x, bmp_min_x);
-            min_y = std::min(min_y, bmp_min_y);
-            max_x = std::max(max_x, bmp_max_x);
-            max_y = std::max(max_y, bmp_max_y);
-        }
-
-        // Cleanup
-        for (auto bmp : part_bmps) delete bmp;
-        for (auto bmp : part_bmps_dilated) delete bmp;
-    }
-
-    // Score: smaller bounding box area is better (lower score = better)
-    // Also consider how compact the arrangement is (less empty space in bbox)
-    double bbox_area = (max_x - min_x) * (max_y - min_y);
-
-    // Count actual occupied pixels in the plate bitmap for density calculation
-    int occupied_pixels = 0;
-    for (int i = 0; i < plate_width * plate_height; i++) {
-        if (plate.data[i]) occupied_pixels++;
-    }
-    double occupied_area = occupied_pixels * precision * precision;
-
-    // Density ratio: higher is better (more of bbox is actually used)
-    double density = (bbox_area > 0) ? (occupied_area / bbox_area) : 0;
-
-    // Score combines bbox area (smaller better) and density (higher better)
-    // Lower score = better arrangement
-    double score = bbox_area * (2.0 - density);  // Penalize low density
-
-    // Huge penalty for unplaced items
-    score += (items.size() - placed_count) * 1000000;
-
-    return score;
+    out = best;
+    return true;
 }
 
-// Main bitmap arrangement function (Plater-style with multiple attempts)
+} // namespace
+
+// Main bitmap arrangement function
 void arrange_bitmap(
     ArrangePolygons& items,
     const ArrangePolygons& excludes,
     const Points& bed,
     const ArrangeParams& params)
 {
-    DEBUG_LOG("========== arrange_bitmap START (Plater-style) ==========");
-    DEBUG_LOG("Number of items: " << items.size());
-
-    if (items.empty()) return;
-
-    BoundingBox bed_bbox = BoundingBox(bed);
-    double bed_width_mm = unscaled(bed_bbox.size().x());
-    double bed_height_mm = unscaled(bed_bbox.size().y());
-
-    DEBUG_LOG("Bed size: " << bed_width_mm << " x " << bed_height_mm << " mm");
-
-    // Settings
-    double precision = 0.5;
-    double spacing_mm = 1.0;
-    double delta = 0.5;
-
-    int spacing_pixels = static_cast<int>(std::ceil(spacing_mm / precision));
-    int step_pixels = std::max(1, static_cast<int>(std::ceil(delta / precision)));
-
-    int plate_width = static_cast<int>(std::ceil(bed_width_mm / precision));
-    int plate_height = static_cast<int>(std::ceil(bed_height_mm / precision));
+    if (items.empty() || bed.size() < 3)
+        return;
+
+    const BoundingBox bed_bbox(bed);
+    const Polygon     bed_poly(bed);
+    const double      precision       = params.raster_precision > 0. ? params.raster_precision : 0.5;
+    const bool        rectangular_bed = std::abs(bed_poly.area()) > (1. - 1e-3) * double(bed_bbox.size().x()) * double(bed_bbox.size().y());
+
+    // Group the items by shape, inflation and rotations, the masks are shared by the group.
+    std::vector<RasterShape> shapes;
+    std::vector<size_t>      item_shape(items.size(), size_t(-1));
+    {
+        std::unordered_map<Fingerprint128, size_t, Fingerprint128::Hash> shape_map;
+        for (size_t i = 0; i < items.size(); ++ i) {
+            const ArrangePolygon &ap = items[i];
+            if (ap.poly.contour.size() < 3)
+                continue;
+            const Point         &first     = ap.poly.contour.points.front();
+            const size_t         rotations = params.allow_rotations && ! ap.is_virt_object ? 4 : 1;
+            Fingerprint128Builder builder;
+            auto add_polygon = [&builder, &first](const Polygon &poly) {
+                builder.update(uint64_t(poly.size()));
+                for (const Point &pt : poly.points) {
+                    builder.update(uint64_t(pt.x() - first.x()));
+                    builder.update(uint64_t(pt.y() - first.y()));
+                }
+            };
+            add_polygon(ap.poly.contour);
+            builder.update(uint64_t(ap.poly.holes.size()));
+            for (const Polygon &hole : ap.poly.holes)
+                add_polygon(hole);
+            builder.update(uint64_t(ap.inflation));
+            builder.update(ap.rotation);
+            builder.update(uint64_t(rotations));
+            auto [it, inserted] = shape_map.emplace(builder.result(), shapes.size());
+            if (inserted) {
+                RasterShape shape;
+                shape.sample = &ap;
+                // Quarter turns keep the raster of the shape exact.
+                for (size_t r = 0; r < rotations; ++ r)
+                    shape.rotations.emplace_back(ap.rotation + double(r) * PI / 2.);
+                shapes.emplace_back(std::move(shape));
+            }
+            item_shape[i] = it->second;
+        }
+    }
 
-    DEBUG_LOG("Plate bitmap size: " << plate_width << " x " << plate_height << " pixels");
+    const coord_t pixel_size = ArrangeBitmap(bed_bbox, precision).pixel_size();
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, shapes.size()), [&shapes, pixel_size](const tbb::blocked_range<size_t> &range) {
+        for (size_t shape_idx = range.begin(); shape_idx < range.end(); ++ shape_idx) {
+            RasterShape &shape = shapes[shape_idx];
+            int          min_size = std::numeric_limits<int>::max();
+            for (double rotation : shape.rotations) {
+                // In the frame of the first contour point, which the items of the shape have at different positions.
+                ExPolygon poly = shape.sample->poly;
+                poly.translate(- shape.sample->poly.contour.points.front());
+                poly.rotate(rotation);
+                shape.masks.emplace_back(poly, pixel_size, shape.sample->inflation, Point(0, 0));
+                if (! shape.masks.back().empty())
+                    min_size = std::min({ min_size, shape.masks.back().width(), shape.masks.back().height() });
+            }
+            shape.step = min_size == std::numeric_limits<int>::max() ? 1 : std::clamp(min_size / 4, 1, 16);
+        }
+    });
 
-    // Rotation angles
-    std::vector<double> rotations = {0.0};
-    if (params.allow_rotations) {
-        rotations = {0.0, M_PI / 2, M_PI, 3 * M_PI / 2};
-    }
+    std::vector<RasterPlate> plates;
+    auto add_plate = [&]() {
+        RasterPlate plate { ArrangeBitmap(bed_bbox, precision), std::vector<int>(shapes.size(), 0) };
+        if (! rectangular_bed)
+            plate.bitmap.mark_bed_exterior(bed_poly);
+        for (const ArrangePolygon &region : params.excluded_regions)
+            plate.bitmap.rasterize(region.transformed_poly(), Point(0, 0), region.inflation);
+        const int bed_idx = int(plates.size());
+        for (const ArrangePolygon &fixed : excludes)
+            if (fixed.bed_idx == bed_idx)
+                plate.bitmap.rasterize(fixed.transformed_poly(), Point(0, 0), fixed.inflation);
+        plates.emplace_back(std::move(plate));
+    };
+    int num_fixed_beds = 1;
+    for (const ArrangePolygon &fixed : excludes)
+        num_fixed_beds = std::max(num_fixed_beds, fixed.bed_idx + 1);
+    while (int(plates.size()) < num_fixed_beds)
+        add_plate();
+    const Vec2d align(params.align_center.x() * plates.front().bitmap.width(), params.align_center.y() * plates.front().bitmap.height());
 
     // Sort by area (largest first) - this gives best packing results
-    std::vector<size_t> order(items.size());
-    std::iota(order.begin(), order.end(), 0);
-    std::sort(order.begin(), order.end(), [&items](size_t a, size_t b) {
+    // The items without a raster are left out unarranged.
+    std::vector<size_t> order;
+    order.reserve(items.size());
+    for (size_t i = 0; i < items.size(); ++ i) {
+        items[i].bed_idx = UNARRANGED;
+        if (item_shape[i] != size_t(-1) && ! shapes[item_shape[i]].masks.front().empty())
+            order.emplace_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&items](size_t a, size_t b) {
         if (items[a].priority != items[b].priority)
             return items[a].priority > items[b].priority;
         return std::abs(items[a].poly.contour.area()) > std::abs(items[b].poly.contour.area());
     });
 
-    // Run single arrangement pass
-    std::vector<PlacementResult> best_results;
-    double best_score = try_arrangement(items, order, rotations,
-                                        bed_bbox, precision, spacing_pixels, step_pixels,
-                                        plate_width, plate_height, best_results);
-
-    DEBUG_LOG("Arrangement score: " << best_score);
-
-    // Apply best results
-    int placed_count = 0;
-    for (size_t i = 0; i < items.size(); i++) {
-        if (best_results[i].placed) {
-            items[i].translation = best_results[i].translation;
-            items[i].rotation = best_results[i].rotation;
-            items[i].bed_idx = best_results[i].bed_idx;
-            placed_count++;
-
-            if (params.on_packed) {
-                params.on_packed(items[i]);
+    auto place = [&](ArrangePolygon &ap, size_t shape_idx) {
+        const RasterShape &shape = shapes[shape_idx];
+        RasterPlacement    placement;
+        int                plate_idx = 0;
+        for (; plate_idx < int(plates.size()); ++ plate_idx)
+            if (find_placement(plates[plate_idx], shape_idx, shape, align, placement))
+                break;
+        if (plate_idx == int(plates.size())) {
+            // Open a new bed, unless the item does not fit an empty one.
+            add_plate();
+            if (! find_placement(plates.back(), shape_idx, shape, align, placement)) {
+                plates.pop_back();
+                return false;
             }
-        } else {
-            items[i].bed_idx = UNARRANGED;
         }
-    }
 
-    if (params.progressind) {
-        params.progressind(0, "");
-    }
+        const RasterMask &mask = shape.masks[placement.rotation];
+        plates[plate_idx].bitmap.mark_occupied(mask, placement.x, placement.y);
+        const double rotation = shape.rotations[placement.rotation];
+        const Point &first    = ap.poly.contour.points.front();
+        const double c        = std::cos(rotation);
+        const double s        = std::sin(rotation);
+        const Point  first_rotated(coord_t(std::round(c * double(first.x()) - s * double(first.y()))),
+                                   coord_t(std::round(c * double(first.y()) + s * double(first.x()))));
+        const Point  tr = plates[plate_idx].bitmap.from_pixel(placement.x, placement.y) - mask.origin() - first_rotated;
+        ap.translation  = { tr.x(), tr.y() };
+        ap.rotation     = rotation;
+        ap.bed_idx      = plate_idx;
+        return true;
+    };
 
-    DEBUG_LOG("========== arrange_bitmap END ==========");
-    DEBUG_LOG("Best score: " << best_score << ", placed " << placed_count << " of " << items.size() << " items");
-}
+    size_t placed    = 0;
+    size_t remaining = order.size();
+    for (size_t idx : order) {
+        ArrangePolygon &ap = items[idx];
+        if (! (params.stopcondition && params.stopcondition()) && place(ap, item_shape[idx])) {
+            // The packing order, as assigned by the no fit polygon arrangement.
+            ap.itemid = int(placed ++);
+            if (params.on_packed)
+                params.on_packed(ap);
+        }
+        if (params.progressind)
+            params.progressind(unsigned(-- remaining), "");
+    }
 
-// Keep the old ArrangeBitmap class for compatibility but it's not used now
-ArrangeBitmap::ArrangeBitmap(const BoundingBox& bed_bbox, double precision_mm)
-    : m_precision(precision_mm)
-    , m_bed_bbox(bed_bbox)
-{
-    double width_mm = unscaled(bed_bbox.size().x());
-    double height_mm = unscaled(bed_bbox.size().y());
-    m_width_px = static_cast<int>(std::ceil(width_mm / precision_mm)) + 1;
-    m_height_px = static_cast<int>(std::ceil(height_mm / precision_mm)) + 1;
-    m_data.resize(m_width_px * m_height_px, 0);
+    BOOST_LOG_TRIVIAL(info) << boost::format("raster arrange: placed %1% of %2% items with %3% shapes on %4% beds, pixel %5% mm")
+        % placed % items.size() % shapes.size() % plates.size() % precision;
 }
 
-void ArrangeBitmap::clear() { std::fill(m_data.begin(), m_data.end(), 0); }
-Point ArrangeBitmap::to_pixel(const Point& p) const { return Point(0, 0); }
-Point ArrangeBitmap::from_pixel(int x, int y) const { return Point(0, 0); }
-bool ArrangeBitmap::get_pixel(int x, int y) const { return false; }
-void ArrangeBitmap::set_pixel(int x, int y, bool value) {}
-void ArrangeBitmap::rasterize_polygon(const Polygon& poly, const Point& offset, bool value) {}
-void ArrangeBitmap::rasterize(const ExPolygon& poly, const Point& offset) {}
-void ArrangeBitmap::mark_occupied(const ExPolygon& poly, const Point& offset) {}
-bool ArrangeBitmap::collides(const ExPolygon& poly, const Point& offset) const { return true; }
-void ArrangeBitmap::mark_bed_exterior(const Polygon& bed) {}
-
 }} // namespace Slic3r::arrangement
@@ -4,26 +4,68 @@
 #include "Arrange.hpp"
 #include "ExPolygon.hpp"
 #include "BoundingBox.hpp"
+#include <cstdint>
 #include <vector>
 
 namespace Slic3r { namespace arrangement {
 
+// BBS: bit packed raster of a shape, one bit per square pixel, 64 pixels per word. The raster is conservative:
+// every pixel touched by the shape grown by the inflation is set. Each row is padded with a zero word on both
+// sides, so that the row may be shifted by any number of bits and tested word by word against a bed row.
+class RasterMask
+{
+public:
+    RasterMask() = default;
+    // The pixel grid is aligned to grid_anchor, pixel (0, 0) has its lower left corner at origin().
+    RasterMask(const ExPolygon &poly, coord_t pixel_size, coord_t inflation, const Point &grid_anchor);
+
+    bool            empty() const { return m_width == 0 || m_height == 0; }
+    int             width() const { return m_width; }
+    int             height() const { return m_height; }
+    // Number of words of a row without the padding.
+    int             words() const { return m_words; }
+    const Point&    origin() const { return m_origin; }
+    // row(y)[-1] and row(y)[words()] are the zero padding.
+    const uint64_t* row(int y) const { return m_bits.data() + size_t(y) * m_stride + 1; }
+    bool            get(int x, int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1; }
+    // Number of the pixels set.
+    size_t          count() const;
+
+private:
+    int                     m_width  { 0 };
+    int                     m_height { 0 };
+    int                     m_words  { 0 };
+    int                     m_stride { 0 };
+    Point                   m_origin { 0, 0 };
+    std::vector<uint64_t>   m_bits;
+};
+
 // Bitmap-based collision detection for arrangement
 // Unlike NFP algorithm, this properly handles hollow spaces in objects
+// BBS: the occupancy is bit packed, the masks are tested against it word by word, with SSE2 / AVX2 where available.
 class ArrangeBitmap {
 public:
+    // The pixels cover the bed_bbox, the pixels reaching out of it are left out.
     ArrangeBitmap(const BoundingBox& bed_bbox, double precision_mm);
 
     // Rasterize an ExPolygon to the bitmap (respects holes)
-    void rasterize(const ExPolygon& poly, const Point& offset);
+    // The parts outside of the bitmap are clipped.
+    void rasterize(const ExPolygon& poly, const Point& offset, coord_t inflation = 0);
 
     // Check if placing poly at offset would collide with existing occupied pixels
+    // Leaving the bitmap counts as a collision.
     bool collides(const ExPolygon& poly, const Point& offset) const;
 
     // Mark region as occupied after placement
-    void mark_occupied(const ExPolygon& poly, const Point& offset);
+    void mark_occupied(const ExPolygon& poly, const Point& offset) { this->rasterize(poly, offset); }
+
+    // Mask with its pixel (0, 0) at pixel (x, y) of the bitmap, the mask has to fit into the bitmap.
+    // The mask has to be aligned to the pixel grid of the bitmap, see to_pixel().
+    bool collides(const RasterMask& mask, int x, int y) const;
+    void mark_occupied(const RasterMask& mask, int x, int y);
 
     // Mark exterior of bed polygon as occupied (for non-rectangular beds)
+    // The pixels crossing the bed boundary are marked as well.
     void mark_bed_exterior(const Polygon& bed);
 
     // Clear the bitmap
@@ -33,28 +75,40 @@ public:
     int width() const { return m_width_px; }
     int height() const { return m_height_px; }
     double precision() const { return m_precision; }
+    coord_t pixel_size() const { return m_pixel_size; }
+    // Lower left corner of pixel (0, 0).
+    const Point& origin() const { return m_bed_bbox.min; }
+    size_t occupied() const;
 
-private:
-    std::vector<uint8_t> m_data;
-    int m_width_px;
-    int m_height_px;
-    double m_precision;  // mm per pixel
-    BoundingBox m_bed_bbox;
-
-    // Convert between scaled coordinates and pixel coordinates
+    // Pixel with its lower left corner at p, which is expected to lie on the pixel grid.
     Point to_pixel(const Point& p) const;
+    // Lower left corner of a pixel.
     Point from_pixel(int x, int y) const;
 
     // Get/set pixel value
     bool get_pixel(int x, int y) const;
     void set_pixel(int x, int y, bool value);
 
-    // Rasterize a single polygon (without holes) - internal use
-    void rasterize_polygon(const Polygon& poly, const Point& offset, bool value);
+private:
+    std::vector<uint64_t> m_data;
+    int m_width_px;
+    int m_height_px;
+    // Words per row, including a padding word at the end for the shifted mask rows.
+    int m_words;
+    double m_precision;  // mm per pixel
+    coord_t m_pixel_size;
+    BoundingBox m_bed_bbox;
+
+    uint64_t*       row(int y) { return m_data.data() + size_t(y) * m_words; }
+    const uint64_t* row(int y) const { return m_data.data() + size_t(y) * m_words; }
+    void set_span(int y, int x0, int x1, bool value);
 };
 
 // Bitmap-based arrangement algorithm
 // This is an alternative to the NFP-based arrangement that properly handles hollow spaces
+// BBS: it is also the arrangement for large numbers of items, see ArrangeParams::raster_threshold. The masks of each
+// distinct shape and rotation are computed once, the positions are searched on a coarse lattice around the alignment
+// point and then refined pixel by pixel. Items which do not fit the existing beds open a new one.
 void arrange_bitmap(
     ArrangePolygons& items,
     const ArrangePolygons& excludes,
@@ -5,8 +5,13 @@
 #include <random>
 #include <cassert>
 #include <sstream>
+#include <boost/format.hpp>
 #include <boost/log/trivial.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
 namespace Slic3r
 {
     using namespace FilamentGroupUtils;
@@ -55,6 +60,28 @@ namespace Slic3r
         return h;
     }
 
+    // BBS: run f in an arena limited to the given number of threads, 0 threads uses the current arena
+    template<class Fn>
+    static void execute_in_arena(int threads, Fn &&f)
+    {
+        if (threads > 0) {
+            tbb::task_arena arena(threads);
+            arena.execute(f);
+        } else
+            f();
+    }
+
+    static int arena_concurrency(int threads)
+    {
+        return threads > 0 ? threads : tbb::this_task_arena::max_concurrency();
+    }
+
+    static void log_solver_stats(const char *solver, const SolverStats &stats)
+    {
+        BOOST_LOG_TRIVIAL(info) << boost::format("Filament group %1%: cost %2%, %3% restarts, %4% evaluations, %5% cache hits, %6% threads, %7% ms%8%")
+            % solver % stats.best_cost % stats.restarts % stats.evaluations % stats.cache_hits % stats.threads % stats.elapsed_ms % (stats.timed_out ? ", timed out" : "");
+    }
+
     static double evaluate_score(const double flush, const double time, const bool with_time = false) {
         if (!with_time) return flush;
 
@@ -225,19 +252,26 @@ namespace Slic3r
 
     FlushDistanceEvaluator::FlushDistanceEvaluator(const std::vector<FlushMatrix>& flush_matrix, const std::vector<unsigned int>& used_filaments, const std::vector<std::vector<unsigned int>>& layer_filaments, double p)
     {
+        // BBS: filament id -> idx in used_filaments, -1 if not used
+        std::vector<int> used_idx;
+        for (size_t idx = 0; idx < used_filaments.size(); ++idx) {
+            if (used_filaments[idx] >= used_idx.size())
+                used_idx.resize(used_filaments[idx] + 1, -1);
+            used_idx[used_filaments[idx]] = int(idx);
+        }
+        auto find_used_idx = [&used_idx](unsigned int f) { return f < used_idx.size() ? used_idx[f] : -1; };
+
         //calc pair counts
         std::vector<std::vector<int>>count_matrix(used_filaments.size(), std::vector<int>(used_filaments.size()));
         for (const auto& lf : layer_filaments) {
             for (auto iter = lf.begin(); iter != lf.end(); ++iter) {
-                auto id_iter1 = std::find(used_filaments.begin(), used_filaments.end(), *iter);
-                if (id_iter1 == used_filaments.end())
+                int idx1 = find_used_idx(*iter);
+                if (idx1 == -1)
                     continue;
-                auto idx1 = id_iter1 - used_filaments.begin();
                 for (auto niter = std::next(iter); niter != lf.end(); ++niter) {
-                    auto id_iter2 = std::find(used_filaments.begin(), used_filaments.end(), *niter);
-                    if (id_iter2 == used_filaments.end())
+                    int idx2 = find_used_idx(*niter);
+                    if (idx2 == -1)
                         continue;
-                    auto idx2 = id_iter2 - used_filaments.begin();
                     count_matrix[idx1][idx2] += 1;
                     count_matrix[idx2][idx1] += 1;
                 }
@@ -394,6 +428,7 @@ namespace Slic3r
     {
         FlushTimeMachine T;
         T.time_machine_start();
+        m_stats = SolverStats();
 
         if (m_elem_count < m_k) {
             m_cluster_labels = cluster_small_data(m_unplaceable_limits, m_max_cluster_size);
@@ -409,39 +444,54 @@ namespace Slic3r
             return;
         }
 
-        std::vector<int>best_labels;
-        int best_cost = std::numeric_limits<int>::max();
-
-        for (int center_0 = 0; center_0 < m_elem_count; ++center_0) {
-            if (auto iter = m_unplaceable_limits.find(center_0); iter != m_unplaceable_limits.end() && iter->second == 0)
-                continue;
-            for (int center_1 = 0; center_1 < m_elem_count; ++center_1) {
-                if (center_0 == center_1)
-                    continue;
-                if (auto iter = m_unplaceable_limits.find(center_1); iter != m_unplaceable_limits.end() && iter->second == 1)
-                    continue;
-
-                std::vector<int>new_centers = { center_0,center_1 };
-                std::vector<int>new_labels = assign_cluster_label(new_centers, m_unplaceable_limits, m_max_cluster_size, g_strategy);
+        // BBS: the center pairs sharing the first center are tried by one task, the results are merged in the order
+        // of the sequential enumeration, so that the result does not depend on the number of threads
+        std::vector<std::vector<MemoryedGroup>> center_groups(m_elem_count);
+        std::atomic<bool> timed_out{ false };
+        execute_in_arena(m_threads, [&]() {
+            tbb::parallel_for(tbb::blocked_range<int>(0, m_elem_count, 1), [&](const tbb::blocked_range<int>& range) {
+                for (int center_0 = range.begin(); center_0 < range.end(); ++center_0) {
+                    if (auto iter = m_unplaceable_limits.find(center_0); iter != m_unplaceable_limits.end() && iter->second == 0)
+                        continue;
+                    for (int center_1 = 0; center_1 < m_elem_count; ++center_1) {
+                        if (center_0 == center_1)
+                            continue;
+                        if (auto iter = m_unplaceable_limits.find(center_1); iter != m_unplaceable_limits.end() && iter->second == 1)
+                            continue;
+                        if (T.time_machine_end() > timeout_ms) {
+                            timed_out = true;
+                            break;
+                        }
 
-                int new_cost = calc_cost(new_labels, new_centers);
-                if (new_cost < best_cost) {
-                    best_cost = new_cost;
-                    best_labels = new_labels;
+                        std::vector<int>new_centers = { center_0,center_1 };
+                        std::vector<int>new_labels = assign_cluster_label(new_centers, m_unplaceable_limits, m_max_cluster_size, g_strategy);
+                        int new_cost = calc_cost(new_labels, new_centers);
+                        center_groups[center_0].emplace_back(std::move(new_labels), new_cost, 1);
+                    }
                 }
+            });
+        });
 
-                {
-                    MemoryedGroup g(new_labels,new_cost,1);
-                    update_memoryed_groups(g, memory_threshold, memoryed_groups);
+        std::vector<int>best_labels;
+        int best_cost = std::numeric_limits<int>::max();
+        for (const std::vector<MemoryedGroup>& groups : center_groups) {
+            for (const MemoryedGroup& g : groups) {
+                if (g.cost < best_cost) {
+                    best_cost = g.cost;
+                    best_labels = g.group;
                 }
-
-                if (T.time_machine_end() > timeout_ms)
-                    break;
+                update_memoryed_groups(g, memory_threshold, memoryed_groups);
+                ++m_stats.evaluations;
             }
-            if (T.time_machine_end() > timeout_ms)
-                break;
         }
         this->m_cluster_labels = best_labels;
+
+        m_stats.threads = arena_concurrency(m_threads);
+        m_stats.restarts = m_stats.evaluations;
+        m_stats.best_cost = best_labels.empty() ? 0 : best_cost;
+        m_stats.elapsed_ms = T.time_machine_end();
+        m_stats.timed_out = timed_out;
+        log_solver_stats("enumeration of center pairs", m_stats);
     }
 
     void KMediods::set_cluster_group_size(const std::vector<std::pair<std::set<int>, int>> &cluster_group_size)
@@ -725,80 +775,163 @@ namespace Slic3r
         return labels;
     }
 
+    size_t KMediods::CentersHash::operator()(const std::vector<int>& centers) const
+    {
+        size_t h = 0;
+        for (int c : centers)
+            h ^= std::hash<int>{}(c) + GOLDEN_RATIO_32 + (h << 6) + (h >> 2);
+        return h;
+    }
+
+    bool KMediods::is_unplaceable(int elem, int cluster_id) const
+    {
+        // the limits are looked up by the cluster id, as the sequential solver did
+        auto iter = m_unplaceable_limits.find(cluster_id);
+        return iter != m_unplaceable_limits.end() && std::find(iter->second.begin(), iter->second.end(), elem) != iter->second.end();
+    }
+
+    KMediods::Evaluation& KMediods::evaluate(const std::vector<int>& centers)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_evaluations_mutex);
+            if (auto iter = m_evaluations.find(centers); iter != m_evaluations.end()) {
+                ++m_cache_hits;
+                return iter->second;
+            }
+        }
+        // the labels depend on the centers only, a concurrent evaluation of the same centers gives the same result
+        Evaluation evaluation;
+        evaluation.labels = assign_cluster_label(centers, m_placeable_limits, m_unplaceable_limits, m_max_cluster_size, m_cluster_group_size);
+        evaluation.cost   = calc_cost(evaluation.labels, centers);
+
+        std::lock_guard<std::mutex> lock(m_evaluations_mutex);
+        // the nodes of an unordered_map are stable, the labels and the cost are never modified after the insertion
+        return m_evaluations.emplace(centers, std::move(evaluation)).first->second;
+    }
+
+    const KMediods::Evaluation* KMediods::claim(const std::vector<int>& centers)
+    {
+        Evaluation& evaluation = this->evaluate(centers);
+        std::lock_guard<std::mutex> lock(m_evaluations_mutex);
+        if (evaluation.claimed)
+            return nullptr;
+        evaluation.claimed = true;
+        return &evaluation;
+    }
+
+    std::vector<FilamentGroupUtils::MemoryedGroup> KMediods::run_restart(int seed, FlushTimeMachine& T, int timeout_ms)
+    {
+        std::vector<MemoryedGroup> groups;
+
+        std::vector<int> curr_cluster_centers = init_cluster_center(m_placeable_limits, m_unplaceable_limits, m_max_cluster_size, m_cluster_group_size, seed);
+        const Evaluation* curr = claim(curr_cluster_centers);
+        if (!curr)
+            return groups;
+        int curr_cluster_cost = curr->cost;
+        groups.emplace_back(curr->labels, curr_cluster_cost, 1); // in non enum mode, we use the same prefer level
+
+        bool mediods_changed = true;
+        while (mediods_changed) {
+            if (T.time_machine_end() >= timeout_ms) {
+                m_timed_out = true;
+                break;
+            }
+            mediods_changed       = false;
+            int best_swap_cost    = curr_cluster_cost;
+            int best_swap_cluster = -1;
+            int best_swap_elem    = -1;
+
+            for (size_t cluster_id = 0; cluster_id < m_k; ++cluster_id) {
+                if (curr_cluster_centers[cluster_id] == -1) continue; // skip the empty cluster
+                for (int elem = 0; elem < m_elem_count; ++elem) {
+                    if (std::find(curr_cluster_centers.begin(), curr_cluster_centers.end(), elem) != curr_cluster_centers.end() ||
+                        is_unplaceable(elem, cluster_id))
+                        continue;
+                    std::vector<int> tmp_centers = curr_cluster_centers;
+                    tmp_centers[cluster_id]      = elem; // swap the mediod
+                    int tmp_cost = evaluate(tmp_centers).cost;
+
+                    if (tmp_cost < best_swap_cost) {
+                        best_swap_cost    = tmp_cost;
+                        best_swap_cluster = cluster_id;
+                        best_swap_elem    = elem;
+                        mediods_changed   = true;
+                    }
+                }
+            }
+
+            if (mediods_changed) {
+                curr_cluster_centers[best_swap_cluster] = best_swap_elem;
+                // another restart has been here already and goes on the same way
+                curr = claim(curr_cluster_centers);
+                if (!curr)
+                    break;
+                curr_cluster_cost = curr->cost;
+                groups.emplace_back(curr->labels, curr_cluster_cost, 1);
+            }
+        }
+        return groups;
+    }
+
     /*
     1.Select initial medoids randomly
     2.Iterate while the cost decreases:
       2.1 In each cluster, make the point that minimizes the sum of distances within the cluster the medoid
       2.2 Reassign each point to the cluster defined by the closest medoid determined in the previous step
+    BBS: the restarts run in parallel and share the evaluations of the center sets. The groups found are merged in a
+    fixed order, so that the result does not depend on the number of threads unless the time runs out.
     */
     void KMediods::do_clustering(const FilamentGroupContext &context, int timeout_ms, int retry)
     {
         FlushTimeMachine T;
         T.time_machine_start();
+        m_stats = SolverStats();
 
         if (m_elem_count <= m_k) {
             m_cluster_labels = cluster_small_data(context);
             return;
         }
 
-        std::vector<int> best_cluster_centers = std::vector<int>(m_k, 0);
-        std::vector<int> best_cluster_labels  = std::vector<int>(m_elem_count, m_default_group_id);
-        int              best_cluster_cost    = std::numeric_limits<int>::max();
-        int              retry_count          = 0;
-
-        while (retry_count < retry && T.time_machine_end() < timeout_ms) {
-            std::vector<int> curr_cluster_centers = init_cluster_center(m_placeable_limits, m_unplaceable_limits, m_max_cluster_size, m_cluster_group_size, retry_count);
-            std::vector<int> curr_cluster_labels = assign_cluster_label(curr_cluster_centers, m_placeable_limits, m_unplaceable_limits, m_max_cluster_size, m_cluster_group_size);
-            int              curr_cluster_cost   = calc_cost(curr_cluster_labels, curr_cluster_centers);
-
-            MemoryedGroup g(curr_cluster_labels, curr_cluster_cost, 1);
-            update_memoryed_groups(g, memory_threshold, memoryed_groups);
-
-            bool mediods_changed = true;
-            while (mediods_changed && T.time_machine_end() < timeout_ms) {
-                mediods_changed       = false;
-                int best_swap_cost    = curr_cluster_cost;
-                int best_swap_cluster = -1;
-                int best_swap_elem    = -1;
-
-                for (size_t cluster_id = 0; cluster_id < m_k; ++cluster_id) {
-                    if (curr_cluster_centers[cluster_id] == -1) continue; // skip the empty cluster
-                    for (int elem = 0; elem < m_elem_count; ++elem) {
-                        if (std::find(curr_cluster_centers.begin(), curr_cluster_centers.end(), elem) != curr_cluster_centers.end() ||
-                            std::find(m_unplaceable_limits[cluster_id].begin(), m_unplaceable_limits[cluster_id].end(), elem) != m_unplaceable_limits[cluster_id].end())
-                            continue;
-                        std::vector<int> tmp_centers = curr_cluster_centers;
-                        tmp_centers[cluster_id]      = elem; // swap the mediod
-                        std::vector<int> tmp_labels  = assign_cluster_label(tmp_centers, m_placeable_limits, m_unplaceable_limits, m_max_cluster_size, m_cluster_group_size);
-                        int              tmp_cost    = calc_cost(tmp_labels, tmp_centers);
-
-                        if (tmp_cost < best_swap_cost) {
-                            best_swap_cost    = tmp_cost;
-                            best_swap_cluster = cluster_id;
-                            best_swap_elem    = elem;
-                            mediods_changed   = true;
-                        }
+        m_evaluations.clear();
+        m_cache_hits = 0;
+        m_timed_out  = false;
+
+        std::vector<std::vector<MemoryedGroup>> restart_groups(std::max(retry, 0));
+        std::atomic<int> restarts{ 0 };
+        execute_in_arena(m_threads, [&]() {
+            tbb::parallel_for(tbb::blocked_range<int>(0, int(restart_groups.size()), 1), [&](const tbb::blocked_range<int>& range) {
+                for (int seed = range.begin(); seed < range.end(); ++seed) {
+                    if (T.time_machine_end() >= timeout_ms) {
+                        m_timed_out = true;
+                        continue;
                     }
+                    ++restarts;
+                    restart_groups[seed] = run_restart(seed, T, timeout_ms);
                 }
+            });
+        });
 
-                if (mediods_changed) {
-                    curr_cluster_centers[best_swap_cluster] = best_swap_elem;
-                    curr_cluster_labels = assign_cluster_label(curr_cluster_centers, m_placeable_limits, m_unplaceable_limits, m_max_cluster_size, m_cluster_group_size);
-                    curr_cluster_cost   = calc_cost(curr_cluster_labels, curr_cluster_centers);
+        // the same group may be reached by several restarts
+        std::vector<MemoryedGroup> groups;
+        for (std::vector<MemoryedGroup>& rg : restart_groups)
+            groups.insert(groups.end(), std::make_move_iterator(rg.begin()), std::make_move_iterator(rg.end()));
+        std::sort(groups.begin(), groups.end(), [](const MemoryedGroup& a, const MemoryedGroup& b) { return a.group < b.group; });
+        groups.erase(std::unique(groups.begin(), groups.end(), [](const MemoryedGroup& a, const MemoryedGroup& b) { return a.group == b.group; }), groups.end());
+        std::sort(groups.begin(), groups.end(), [](const MemoryedGroup& a, const MemoryedGroup& b) { return a.cost < b.cost || (a.cost == b.cost && a.group < b.group); });
 
-                    MemoryedGroup g(curr_cluster_labels, curr_cluster_cost, 1); // in non enum mode, we use the same prefer level
-                    update_memoryed_groups(g, memory_threshold, memoryed_groups);
-                }
-            }
+        for (const MemoryedGroup& g : groups)
+            update_memoryed_groups(g, memory_threshold, memoryed_groups);
 
-            if (curr_cluster_cost < best_cluster_cost) {
-                best_cluster_centers = curr_cluster_centers;
-                best_cluster_cost    = curr_cluster_cost;
-                best_cluster_labels  = curr_cluster_labels;
-            }
-            retry_count += 1;
-        }
-        m_cluster_labels = best_cluster_labels;
+        m_cluster_labels = groups.empty() ? std::vector<int>(m_elem_count, m_default_group_id) : groups.front().group;
+
+        m_stats.threads     = arena_concurrency(m_threads);
+        m_stats.restarts    = restarts;
+        m_stats.evaluations = int(m_evaluations.size());
+        m_stats.cache_hits  = m_cache_hits;
+        m_stats.best_cost   = groups.empty() ? 0 : groups.front().cost;
+        m_stats.elapsed_ms  = T.time_machine_end();
+        m_stats.timed_out   = m_timed_out;
+        log_solver_stats("k-medoids", m_stats);
     }
 
     std::vector<int> FilamentGroup::calc_min_flush_group(int* cost)
@@ -809,7 +942,7 @@ namespace Slic3r
         if (used_filament_num < 10)
             return calc_min_flush_group_by_enum(used_filaments, cost);
         else
-            return calc_min_flush_group_by_pam2(used_filaments, cost, 500);
+            return calc_min_flush_group_by_pam2(used_filaments, cost, ctx.solver_info.time_limit_ms > 0 ? ctx.solver_info.time_limit_ms : 500);
     }
 
     std::unordered_map<int, std::vector<int>> FilamentGroup::try_merge_filaments()
@@ -1125,13 +1258,18 @@ namespace Slic3r
             double score{1};
         };
 
+        FlushTimeMachine T;
+        T.time_machine_start();
+
         CachedGroup best_group;
-        std::vector<CachedGroup> cached_groups;
+        // BBS: the groups are evaluated in parallel, the flush of each one is reordered over all layers
+        std::vector<CachedGroup> cached_groups(max_group_num);
+        const TimeEvaluator time_evaluator(ctx.speed_info);
 
-        for (uint64_t i = 0; i < max_group_num; ++i) {
+        auto evaluate_group = [&](uint64_t mask) {
             std::vector<std::set<int>>groups(2);
             for (int j = 0; j < used_filament_num; ++j) {
-                if (i & (static_cast<uint64_t>(1) << j))
+                if (mask & (static_cast<uint64_t>(1) << j))
                     groups[1].insert(j);
                 else
                     groups[0].insert(j);
@@ -1185,10 +1323,16 @@ namespace Slic3r
             for (size_t i = 0; i < filament_maps.size(); ++i)
                 curr_group.filament_map[used_filaments[i]] = filament_maps[i];
 
-            TimeEvaluator time_evaluator(ctx.speed_info);
             curr_group.time = time_evaluator.get_estimated_time(curr_group.filament_map);
-            cached_groups.emplace_back(std::move(curr_group));
-        }
+            cached_groups[mask] = std::move(curr_group);
+        };
+
+        execute_in_arena(ctx.solver_info.threads, [&]() {
+            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, max_group_num, 1), [&](const tbb::blocked_range<uint64_t>& range) {
+                for (uint64_t mask = range.begin(); mask < range.end(); ++mask)
+                    evaluate_group(mask);
+            });
+        });
 
         // 如果归一化，没法处理边界情况
         {
@@ -1219,6 +1363,14 @@ namespace Slic3r
         if (cost)
             *cost =best_group.flush;
 
+        m_solver_stats             = SolverStats();
+        m_solver_stats.threads     = arena_concurrency(ctx.solver_info.threads);
+        m_solver_stats.restarts    = int(max_group_num);
+        m_solver_stats.evaluations = int(max_group_num);
+        m_solver_stats.best_cost   = int(best_group.flush);
+        m_solver_stats.elapsed_ms  = T.time_machine_end();
+        log_solver_stats("enumeration", m_solver_stats);
+
         m_memoryed_groups.clear();
         while(!memoryed_groups.empty()){
             auto top = memoryed_groups.top();
@@ -1242,7 +1394,9 @@ namespace Slic3r
         PAM.set_max_cluster_size(ctx.machine_info.max_group_size);
         PAM.set_unplaceable_limits(unplaceable_limits);
         PAM.set_memory_threshold(ctx.group_info.max_gap_threshold);
+        PAM.set_threads(ctx.solver_info.threads);
         PAM.do_clustering(ctx.group_info.strategy, timeout_ms);
+        m_solver_stats = PAM.get_stats();
 
         std::vector<int>filament_labels = PAM.get_cluster_labels();
 
@@ -1302,6 +1456,7 @@ namespace Slic3r
             KMediods2 PAM((int)used_filaments.size(), distance_evaluator);
             PAM.set_max_cluster_size({(int)m_context.nozzle_info.extruder_nozzle_list[0].size(),(int)m_context.nozzle_info.extruder_nozzle_list[1].size()});
             PAM.set_unplaceable_limits(unplaceable_limits);
+            PAM.set_threads(m_context.solver_info.threads);
             PAM.do_clustering(FGStrategy::BestFit);
             auto first_clustered_labels = PAM.get_cluster_labels();
             int total_nozzle_num = m_context.nozzle_info.nozzle_list.size();
@@ -1339,7 +1494,9 @@ namespace Slic3r
             KMediods2 PAM((int)used_filaments.size(), distance_evaluator);
             PAM.set_max_cluster_size(m_context.machine_info.max_group_size);
             PAM.set_unplaceable_limits(unplaceable_limits);
+            PAM.set_threads(m_context.solver_info.threads);
             PAM.do_clustering(FGStrategy::BestFit);
+            m_solver_stats = PAM.get_stats();
             auto labels = PAM.get_cluster_labels();
 
             for (size_t idx = 0; idx < labels.size(); ++idx)
@@ -1375,7 +1532,9 @@ namespace Slic3r
 
         PAM.set_cluster_group_size(cluster_size_limit);
         PAM.set_memory_threshold(m_context.group_info.max_gap_threshold);
-        PAM.do_clustering(m_context, 1500);
+        PAM.set_threads(m_context.solver_info.threads);
+        PAM.do_clustering(m_context, m_context.solver_info.time_limit_ms > 0 ? m_context.solver_info.time_limit_ms : 1500);
+        m_solver_stats = PAM.get_stats();
 
         auto memoryed_groups = PAM.get_memoryed_groups();
         std::vector<std::vector<int>> filament_to_nozzles;
@@ -1,8 +1,10 @@
 #ifndef FILAMENT_GROUP_HPP
 #define FILAMENT_GROUP_HPP
 
+#include <atomic>
 #include <chrono>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <set>
 #include <map>
@@ -67,6 +69,18 @@ namespace Slic3r
         using MemoryedGroupHeap = std::priority_queue<MemoryedGroup, std::vector<MemoryedGroup>, std::greater<MemoryedGroup>>;
 
         void update_memoryed_groups(const MemoryedGroup& item,const double gap_threshold, MemoryedGroupHeap& groups);
+
+        // BBS: statistics of the last run of a grouping solver
+        struct SolverStats
+        {
+            int  threads{ 1 };
+            int  restarts{ 0 };      // restarts run, or center sets tried by the enumeration
+            int  evaluations{ 0 };   // groupings evaluated
+            int  cache_hits{ 0 };    // groupings taken from the evaluation cache
+            int  best_cost{ 0 };
+            int  elapsed_ms{ 0 };
+            bool timed_out{ false };
+        };
     }
 
     struct FilamentGroupContext
@@ -106,6 +120,12 @@ namespace Slic3r
             std::map<int, std::vector<int>> extruder_nozzle_list;
             std::vector<MultiNozzleUtils::NozzleInfo> nozzle_list;
         } nozzle_info;
+
+        // BBS: budget of the grouping solvers
+        struct SolverInfo {
+            int time_limit_ms{ 0 };  // 0 uses the default time limit of each solver
+            int threads{ 0 };        // 0 uses all the cores
+        } solver_info;
     };
 
     std::vector<int> select_best_group_for_ams(const std::vector<std::vector<int>> &filament_to_nozzles,
@@ -146,6 +166,7 @@ namespace Slic3r
     public:
         std::vector<int> calc_filament_group(int * cost = nullptr);
         std::vector<std::vector<int>> get_memoryed_groups()const { return m_memoryed_groups; }
+        const FilamentGroupUtils::SolverStats& get_solver_stats() const { return m_solver_stats; }
 
     public:
         std::vector<int> calc_filament_group_for_match(int* cost = nullptr);
@@ -164,6 +185,7 @@ namespace Slic3r
     private:
         FilamentGroupContext ctx;
         std::vector<std::vector<int>> m_memoryed_groups;
+        FilamentGroupUtils::SolverStats m_solver_stats;
         friend FilamentGroupMultiNozzle;
 
     public:
@@ -177,11 +199,13 @@ namespace Slic3r
     public:
         std::vector<int> calc_filament_group_by_mcmf();
         std::vector<int> calc_filament_group_by_pam();
+        const FilamentGroupUtils::SolverStats& get_solver_stats() const { return m_solver_stats; }
 
     private:
         std::unordered_map<int, std::vector<int>> rebuild_nozzle_unprintables(const std::vector<unsigned int>& used_filaments, const std::unordered_map<int, std::vector<int>>& extruder_unprintables, const std::vector<int>& filament_volume_map);
     private:
         FilamentGroupContext m_context;
+        FilamentGroupUtils::SolverStats m_solver_stats;
     };
 
     std::vector<int> calc_filament_group_for_manual_multi_nozzle(const std::vector<int>& filament_map_manual,const FilamentGroupContext& ctx);
@@ -213,12 +237,15 @@ namespace Slic3r
         // key stores elem idx, value stores the cluster id that elem cnanot be placed
         void set_unplaceable_limits(const std::map<int, int>& placeable_limits) { m_unplaceable_limits = placeable_limits; }
 
+        // BBS: the center pairs are tried in parallel, 0 threads uses all the cores
+        void set_threads(int threads) { m_threads = threads; }
         void do_clustering(const FGStrategy& g_strategy,int timeout_ms = 100);
 
         void set_memory_threshold(double threshold) { memory_threshold = threshold; }
         MemoryedGroupHeap get_memoryed_groups()const { return memoryed_groups; }
 
         std::vector<int>get_cluster_labels()const { return m_cluster_labels; }
+        const FilamentGroupUtils::SolverStats& get_stats() const { return m_stats; }
 
     private:
         std::vector<int>cluster_small_data(const std::map<int, int>& unplaceable_limits, const std::vector<int>& group_size);
@@ -234,7 +261,9 @@ namespace Slic3r
         const int m_k = 2;
         int m_elem_count;
         int m_default_group_id{ 0 };
+        int m_threads{ 0 };
         double memory_threshold{ 0 };
+        FilamentGroupUtils::SolverStats m_stats;
     };
 
     // non_zero_clusters
@@ -265,10 +294,30 @@ namespace Slic3r
         void set_memory_threshold(double threshold) { memory_threshold = threshold; }
         MemoryedGroupHeap get_memoryed_groups()const { return memoryed_groups; }
 
+        // BBS: the restarts run in parallel, 0 threads uses all the cores
+        void set_threads(int threads) { m_threads = threads; }
         void do_clustering(const FilamentGroupContext& context, int timeout_ms = 100, int retry = 10);
         std::vector<int> get_cluster_labels()const { return m_cluster_labels; }
+        const FilamentGroupUtils::SolverStats& get_stats() const { return m_stats; }
 
     protected:
+        // BBS: labels and cost of a set of cluster centers, shared by the restarts. A center set reached by a restart is
+        // claimed, any other restart reaching it would continue along the same path and stops.
+        struct Evaluation {
+            std::vector<int> labels;
+            int cost{ 0 };
+            bool claimed{ false };
+        };
+        struct CentersHash {
+            size_t operator()(const std::vector<int>& centers) const;
+        };
+        Evaluation& evaluate(const std::vector<int>& centers);
+        // nullptr if the centers have been claimed already
+        const Evaluation* claim(const std::vector<int>& centers);
+        // a restart from the initial centers of seed, returns the groups it went through, the last one is the best
+        std::vector<MemoryedGroup> run_restart(int seed, FilamentGroupUtils::FlushTimeMachine& T, int timeout_ms);
+        bool is_unplaceable(int elem, int cluster_id) const;
+
         bool have_enough_size(const std::vector<int>& cluster_size, const std::vector<std::pair<std::set<int>, int>>& cluster_group_size,int elem_count);
         // calculate cluster distance
         int calc_cost(const std::vector<int>& clusters, const std::vector<int>& cluster_centers, int cluster_id = -1);
@@ -289,11 +338,17 @@ namespace Slic3r
         std::vector<std::pair<std::set<int>,int>> m_cluster_group_size;
         std::vector<int> m_nozzle_to_extruder;
 
+        std::mutex m_evaluations_mutex;
+        std::unordered_map<std::vector<int>, Evaluation, CentersHash> m_evaluations;
+        std::atomic<int> m_cache_hits{ 0 };
+        std::atomic<bool> m_timed_out{ false };
 
         int m_k;
         int m_elem_count;
         int m_default_group_id{ 0 };
+        int m_threads{ 0 };
         double memory_threshold{ 0 };
+        FilamentGroupUtils::SolverStats m_stats;
     };
 }
 #endif // !FILAMENT_GROUP_HPP
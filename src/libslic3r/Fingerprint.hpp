@@ -0,0 +1,104 @@
+#ifndef slic3r_Fingerprint_hpp_
+#define slic3r_Fingerprint_hpp_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace Slic3r {
+
+// BBS: 128 bit content fingerprint. The value only depends on the data fed into Fingerprint128Builder,
+// not on addresses or the process, thus it may be stored and compared across slicing sessions.
+struct Fingerprint128
+{
+    uint64_t lo { 0 };
+    uint64_t hi { 0 };
+
+    bool valid() const { return lo != 0 || hi != 0; }
+    bool operator==(const Fingerprint128 &rhs) const { return lo == rhs.lo && hi == rhs.hi; }
+    bool operator!=(const Fingerprint128 &rhs) const { return ! (*this == rhs); }
+    bool operator<(const Fingerprint128 &rhs) const { return hi < rhs.hi || (hi == rhs.hi && lo < rhs.lo); }
+
+    // 32 hex digits, usable as a file name.
+    std::string to_string() const {
+        static constexpr const char digits[] = "0123456789abcdef";
+        std::string out(32, '0');
+        for (int i = 0; i < 16; ++ i) {
+            out[15 - i] = digits[(hi >> (4 * i)) & 0xf];
+            out[31 - i] = digits[(lo >> (4 * i)) & 0xf];
+        }
+        return out;
+    }
+
+    struct Hash {
+        size_t operator()(const Fingerprint128 &f) const { return size_t(f.lo ^ (f.hi * 0x9e3779b97f4a7c15ull)); }
+    };
+};
+
+// Two independent 64 bit lanes over the input processed in 8 byte words, finalized with the MurmurHash3 mixer.
+// Not a cryptographic hash, but fast enough to fingerprint large meshes.
+class Fingerprint128Builder
+{
+public:
+    Fingerprint128Builder &update(const void *data, size_t size) {
+        const unsigned char *ptr = static_cast<const unsigned char*>(data);
+        for (; size >= 8; ptr += 8, size -= 8) {
+            uint64_t word;
+            std::memcpy(&word, ptr, 8);
+            this->mix(word);
+        }
+        if (size > 0) {
+            uint64_t word = 0;
+            std::memcpy(&word, ptr, size);
+            this->mix(word ^ (uint64_t(size) << 56));
+        }
+        return *this;
+    }
+    Fingerprint128Builder &update(uint64_t v)               { this->mix(v); return *this; }
+    Fingerprint128Builder &update(double v)                 { uint64_t w; std::memcpy(&w, &v, 8); this->mix(w); return *this; }
+    Fingerprint128Builder &update(const std::string &s)     { this->mix(s.size()); return this->update(s.data(), s.size()); }
+    Fingerprint128Builder &update(const Fingerprint128 &f)  { this->mix(f.lo); this->mix(f.hi); return *this; }
+    template<typename T>
+    Fingerprint128Builder &update(const std::vector<T> &v)  { this->mix(v.size()); return this->update(v.data(), v.size() * sizeof(T)); }
+
+    Fingerprint128 result() const {
+        uint64_t h1 = m_h1 ^ m_length;
+        uint64_t h2 = m_h2 ^ m_length;
+        h1 += h2;
+        h2 += h1;
+        h1 = fmix64(h1);
+        h2 = fmix64(h2);
+        h1 += h2;
+        h2 += h1;
+        return { h1, h2 };
+    }
+
+private:
+    static uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t fmix64(uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdull;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ull;
+        k ^= k >> 33;
+        return k;
+    }
+    void mix(uint64_t k) {
+        static constexpr uint64_t c1 = 0x87c37b91114253d5ull;
+        static constexpr uint64_t c2 = 0x4cf5ad432745937full;
+        uint64_t k1 = rotl64(k * c1, 31) * c2;
+        uint64_t k2 = rotl64(k * c2, 33) * c1;
+        m_h1 = (rotl64(m_h1 ^ k1, 27) + m_h2) * 5 + 0x52dce729;
+        m_h2 = (rotl64(m_h2 ^ k2, 31) + m_h1) * 5 + 0x38495ab5;
+        m_length += 8;
+    }
+
+    uint64_t m_h1     { 0x9368e53c2f6af274ull };
+    uint64_t m_h2     { 0x586dcd208f7cd3fdull };
+    uint64_t m_length { 0 };
+};
+
+} // namespace Slic3r
+
+#endif // slic3r_Fingerprint_hpp_
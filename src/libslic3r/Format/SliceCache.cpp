@@ -0,0 +1,666 @@
+#include "../libslic3r.h"
+#include "../Exception.hpp"
+#include "../ExtrusionEntity.hpp"
+#include "../ExtrusionEntityCollection.hpp"
+#include "../Layer.hpp"
+#include "../Model.hpp"
+#include "../Print.hpp"
+
+#include "SliceCache.hpp"
+
+#include <cstring>
+#include <memory>
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/format.hpp>
+
+namespace Slic3r {
+namespace SliceCache {
+
+static constexpr const char MAGIC[4] = { 'B', 'B', 'S', 'C' };
+
+enum class EntityType : uint8_t {
+    Path,
+    MultiPath,
+    Loop,
+    Collection
+};
+
+// Append only encoder of the primitives used by the slice cache.
+class Encoder
+{
+public:
+    explicit Encoder(std::string &out) : m_out(out) {}
+
+    void u8(uint8_t v) { m_out.push_back(char(v)); }
+    void varint(uint64_t v)
+    {
+        while (v >= 0x80) {
+            m_out.push_back(char(uint8_t(v) | 0x80));
+            v >>= 7;
+        }
+        m_out.push_back(char(v));
+    }
+    // Zigzag encoding, so that small negative deltas are short as well.
+    void svarint(int64_t v) { this->varint((uint64_t(v) << 1) ^ uint64_t(v >> 63)); }
+    void f64(double v) { this->raw(&v, sizeof(v)); }
+    void f32(float v) { this->raw(&v, sizeof(v)); }
+    void raw(const void *data, size_t size) { m_out.append(reinterpret_cast<const char*>(data), size); }
+    void str(const std::string &s) { this->varint(s.size()); m_out.append(s); }
+
+    void point(const Point &pt)
+    {
+        this->svarint(pt.x());
+        this->svarint(pt.y());
+    }
+    void points(const Points &pts)
+    {
+        this->varint(pts.size());
+        Point prev(0, 0);
+        for (const Point &pt : pts) {
+            this->svarint(pt.x() - prev.x());
+            this->svarint(pt.y() - prev.y());
+            prev = pt;
+        }
+    }
+    void bbox(const BoundingBox &bb)
+    {
+        this->u8(bb.defined);
+        this->point(bb.min);
+        this->point(bb.max);
+    }
+    void expolygon(const ExPolygon &expoly)
+    {
+        this->points(expoly.contour.points);
+        this->varint(expoly.holes.size());
+        for (const Polygon &hole : expoly.holes)
+            this->points(hole.points);
+    }
+    void expolygons(const ExPolygons &expolys)
+    {
+        this->varint(expolys.size());
+        for (const ExPolygon &expoly : expolys)
+            this->expolygon(expoly);
+    }
+    void surfaces(const Surfaces &surfaces)
+    {
+        this->varint(surfaces.size());
+        for (const Surface &surf : surfaces) {
+            this->expolygon(surf.expolygon);
+            this->u8(uint8_t(surf.surface_type));
+            this->f64(surf.thickness);
+            this->varint(surf.thickness_layers);
+            this->f64(surf.bridge_angle);
+            this->varint(surf.extra_perimeters);
+        }
+    }
+    void arc(const ArcSegment &arc)
+    {
+        this->f64(arc.length);
+        this->f64(arc.angle_radians);
+        this->f64(arc.polar_start_theta);
+        this->f64(arc.polar_end_theta);
+        this->point(arc.start_point);
+        this->point(arc.end_point);
+        this->u8(uint8_t(arc.direction));
+        this->f64(arc.radius);
+        this->point(arc.center);
+    }
+    void polyline(const Polyline &polyline)
+    {
+        this->points(polyline.points);
+        this->varint(polyline.fitting_result.size());
+        for (const PathFittingData &fitting : polyline.fitting_result) {
+            this->varint(fitting.start_point_index);
+            this->varint(fitting.end_point_index);
+            this->u8(uint8_t(fitting.path_type));
+            this->u8(fitting.arc_data.is_arc);
+            if (fitting.arc_data.is_arc)
+                this->arc(fitting.arc_data);
+        }
+    }
+    void polylines(const Polylines &polylines)
+    {
+        this->varint(polylines.size());
+        for (const Polyline &polyline : polylines)
+            this->polyline(polyline);
+    }
+    void path(const ExtrusionPath &path)
+    {
+        this->polyline(path.polyline);
+        this->f64(path.overhang_degree);
+        this->svarint(path.curve_degree);
+        this->f64(path.mm3_per_mm);
+        this->f32(path.width);
+        this->f32(path.height);
+        this->u8(uint8_t(path.role()));
+        this->u8(path.is_force_no_extrusion());
+    }
+    void paths(const ExtrusionPaths &paths)
+    {
+        this->varint(paths.size());
+        for (const ExtrusionPath &path : paths)
+            this->path(path);
+    }
+    void collection(const ExtrusionEntityCollection &collection)
+    {
+        this->u8(collection.no_sort);
+        // Entities of unknown type are skipped, the count is patched afterwards.
+        size_t count_pos = m_out.size();
+        this->raw("\0\0\0\0", 4);
+        uint32_t count = 0;
+        for (const ExtrusionEntity *entity : collection.entities)
+            if (this->entity(entity))
+                ++ count;
+        std::memcpy(&m_out[count_pos], &count, sizeof(count));
+    }
+    bool entity(const ExtrusionEntity *entity)
+    {
+        if (const auto *collection = dynamic_cast<const ExtrusionEntityCollection*>(entity)) {
+            this->u8(uint8_t(EntityType::Collection));
+            this->collection(*collection);
+        } else if (const auto *path = dynamic_cast<const ExtrusionPath*>(entity)) {
+            this->u8(uint8_t(EntityType::Path));
+            this->path(*path);
+        } else if (const auto *multipath = dynamic_cast<const ExtrusionMultiPath*>(entity)) {
+            this->u8(uint8_t(EntityType::MultiPath));
+            this->paths(multipath->paths);
+        } else if (const auto *loop = dynamic_cast<const ExtrusionLoop*>(entity)) {
+            this->u8(uint8_t(EntityType::Loop));
+            this->varint(uint64_t(loop->loop_role()));
+            this->paths(loop->paths);
+        } else {
+            BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << boost::format(":invalid extrusion path type Found");
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::string &m_out;
+};
+
+// Bounds checked decoder over a (memory mapped) buffer.
+class Decoder
+{
+public:
+    Decoder(const char *begin, const char *end) : m_ptr(begin), m_end(end) {}
+
+    size_t  remaining() const { return size_t(m_end - m_ptr); }
+
+    uint8_t u8()
+    {
+        this->require(1);
+        return uint8_t(*m_ptr ++);
+    }
+    uint64_t varint()
+    {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = this->u8();
+            v |= uint64_t(b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+                return v;
+        }
+        throw Slic3r::FileIOError("Slice cache: invalid varint");
+    }
+    int64_t svarint()
+    {
+        uint64_t v = this->varint();
+        return int64_t(v >> 1) ^ -int64_t(v & 1);
+    }
+    // Element count, sanity checked against the remaining size so that a corrupted count
+    // does not trigger a huge allocation.
+    size_t count()
+    {
+        uint64_t n = this->varint();
+        if (n > this->remaining())
+            throw Slic3r::FileIOError("Slice cache: invalid element count");
+        return size_t(n);
+    }
+    double f64() { double v; this->raw(&v, sizeof(v)); return v; }
+    float  f32() { float v; this->raw(&v, sizeof(v)); return v; }
+    uint32_t u32() { uint32_t v; this->raw(&v, sizeof(v)); return v; }
+    void raw(void *data, size_t size)
+    {
+        this->require(size);
+        std::memcpy(data, m_ptr, size);
+        m_ptr += size;
+    }
+    std::string str()
+    {
+        size_t n = this->count();
+        std::string s(m_ptr, n);
+        m_ptr += n;
+        return s;
+    }
+
+    Point point()
+    {
+        coord_t x = coord_t(this->svarint());
+        coord_t y = coord_t(this->svarint());
+        return { x, y };
+    }
+    void points(Points &pts)
+    {
+        size_t n = this->count();
+        pts.reserve(pts.size() + n);
+        Point prev(0, 0);
+        for (size_t i = 0; i < n; ++ i) {
+            prev.x() += coord_t(this->svarint());
+            prev.y() += coord_t(this->svarint());
+            pts.emplace_back(prev);
+        }
+    }
+    void bbox(BoundingBox &bb)
+    {
+        bb.defined = this->u8() != 0;
+        bb.min = this->point();
+        bb.max = this->point();
+    }
+    void expolygon(ExPolygon &expoly)
+    {
+        this->points(expoly.contour.points);
+        size_t num_holes = this->count();
+        expoly.holes.assign(num_holes, Polygon());
+        for (Polygon &hole : expoly.holes)
+            this->points(hole.points);
+    }
+    void expolygons(ExPolygons &expolys)
+    {
+        size_t n = this->count();
+        expolys.reserve(expolys.size() + n);
+        for (size_t i = 0; i < n; ++ i) {
+            expolys.emplace_back();
+            this->expolygon(expolys.back());
+        }
+    }
+    void surfaces(Surfaces &surfaces)
+    {
+        size_t n = this->count();
+        surfaces.reserve(surfaces.size() + n);
+        for (size_t i = 0; i < n; ++ i) {
+            Surface surf;
+            this->expolygon(surf.expolygon);
+            surf.surface_type     = SurfaceType(this->u8());
+            surf.thickness        = this->f64();
+            surf.thickness_layers = (unsigned short)this->varint();
+            surf.bridge_angle     = this->f64();
+            surf.extra_perimeters = (unsigned short)this->varint();
+            surfaces.push_back(std::move(surf));
+        }
+    }
+    void arc(ArcSegment &arc)
+    {
+        arc.is_arc            = true;
+        arc.length            = this->f64();
+        arc.angle_radians     = this->f64();
+        arc.polar_start_theta = this->f64();
+        arc.polar_end_theta   = this->f64();
+        arc.start_point       = this->point();
+        arc.end_point         = this->point();
+        arc.direction         = ArcDirection(this->u8());
+        arc.radius            = this->f64();
+        arc.center            = this->point();
+    }
+    void polyline(Polyline &polyline)
+    {
+        this->points(polyline.points);
+        size_t n = this->count();
+        polyline.fitting_result.reserve(n);
+        for (size_t i = 0; i < n; ++ i) {
+            PathFittingData fitting;
+            fitting.start_point_index = size_t(this->varint());
+            fitting.end_point_index   = size_t(this->varint());
+            fitting.path_type         = EMovePathType(this->u8());
+            if (this->u8())
+                this->arc(fitting.arc_data);
+            polyline.fitting_result.push_back(std::move(fitting));
+        }
+    }
+    void polylines(Polylines &polylines)
+    {
+        size_t n = this->count();
+        polylines.reserve(polylines.size() + n);
+        for (size_t i = 0; i < n; ++ i) {
+            polylines.emplace_back();
+            this->polyline(polylines.back());
+        }
+    }
+    void path(ExtrusionPath &path)
+    {
+        this->polyline(path.polyline);
+        path.overhang_degree = this->f64();
+        path.curve_degree    = int(this->svarint());
+        path.mm3_per_mm      = this->f64();
+        path.width           = this->f32();
+        path.height          = this->f32();
+        path.set_extrusion_role(ExtrusionRole(this->u8()));
+        path.set_force_no_extrusion(this->u8() != 0);
+    }
+    void paths(ExtrusionPaths &paths)
+    {
+        size_t n = this->count();
+        paths.reserve(n);
+        for (size_t i = 0; i < n; ++ i) {
+            paths.emplace_back();
+            this->path(paths.back());
+        }
+    }
+    void collection(ExtrusionEntityCollection &collection)
+    {
+        collection.no_sort = this->u8() != 0;
+        uint32_t n = this->u32();
+        if (n > this->remaining())
+            throw Slic3r::FileIOError("Slice cache: invalid entity count");
+        collection.entities.reserve(collection.entities.size() + n);
+        for (uint32_t i = 0; i < n; ++ i)
+            collection.entities.push_back(this->entity());
+    }
+    ExtrusionEntity* entity()
+    {
+        switch (EntityType(this->u8())) {
+        case EntityType::Path: {
+            auto path = std::make_unique<ExtrusionPath>();
+            this->path(*path);
+            return path.release();
+        }
+        case EntityType::MultiPath: {
+            auto multipath = std::make_unique<ExtrusionMultiPath>();
+            this->paths(multipath->paths);
+            return multipath.release();
+        }
+        case EntityType::Loop: {
+            auto loop = std::make_unique<ExtrusionLoop>();
+            loop->set_loop_role(ExtrusionLoopRole(this->varint()));
+            this->paths(loop->paths);
+            return loop.release();
+        }
+        case EntityType::Collection: {
+            auto collection = std::make_unique<ExtrusionEntityCollection>();
+            this->collection(*collection);
+            return collection.release();
+        }
+        default:
+            throw Slic3r::FileIOError("Slice cache: invalid extrusion entity type");
+        }
+    }
+
+private:
+    void require(size_t size) const
+    {
+        if (size > this->remaining())
+            throw Slic3r::FileIOError("Slice cache: unexpected end of data");
+    }
+
+    const char *m_ptr;
+    const char *m_end;
+};
+
+static void encode_layer(Encoder &enc, const Layer &layer)
+{
+    enc.expolygons(layer.lslices);
+    enc.varint(layer.lslices_bboxes.size());
+    for (const BoundingBox &bbox : layer.lslices_bboxes)
+        enc.bbox(bbox);
+    enc.expolygons(layer.loverhangs);
+    enc.bbox(layer.loverhangs_bbox);
+
+    enc.varint(layer.region_count());
+    for (const LayerRegion *layer_region : layer.regions()) {
+        enc.surfaces(layer_region->slices.surfaces);
+        enc.expolygons(layer_region->raw_slices);
+        enc.collection(layer_region->thin_fills);
+        enc.expolygons(layer_region->fill_expolygons);
+        enc.surfaces(layer_region->fill_surfaces.surfaces);
+        enc.expolygons(layer_region->fill_no_overlap_expolygons);
+        enc.polylines(layer_region->unsupported_bridge_edges);
+        enc.collection(layer_region->perimeters);
+        enc.collection(layer_region->fills);
+    }
+}
+
+static void decode_layer_data(Decoder &dec, Layer &layer)
+{
+    dec.expolygons(layer.lslices);
+    size_t num_bboxes = dec.count();
+    layer.lslices_bboxes.reserve(layer.lslices_bboxes.size() + num_bboxes);
+    for (size_t i = 0; i < num_bboxes; ++ i) {
+        BoundingBox bbox;
+        dec.bbox(bbox);
+        layer.lslices_bboxes.push_back(bbox);
+    }
+    dec.expolygons(layer.loverhangs);
+    dec.bbox(layer.loverhangs_bbox);
+
+    size_t num_regions = dec.count();
+    if (num_regions != layer.region_count())
+        throw Slic3r::FileIOError((boost::format("Slice cache: region count mismatch at layer %1%, print_z %2%") % layer.id() % layer.print_z).str());
+    for (size_t region_id = 0; region_id < num_regions; ++ region_id) {
+        LayerRegion *layer_region = layer.get_region(int(region_id));
+        dec.surfaces(layer_region->slices.surfaces);
+        dec.expolygons(layer_region->raw_slices);
+        dec.collection(layer_region->thin_fills);
+        dec.expolygons(layer_region->fill_expolygons);
+        dec.surfaces(layer_region->fill_surfaces.surfaces);
+        dec.expolygons(layer_region->fill_no_overlap_expolygons);
+        dec.polylines(layer_region->unsupported_bridge_edges);
+        dec.collection(layer_region->perimeters);
+        dec.collection(layer_region->fills);
+    }
+}
+
+std::vector<groupedVolumeSlices> first_layer_groups_with_volume_indices(const PrintObject &object)
+{
+    std::vector<groupedVolumeSlices> groups = object.firstLayerObjGroups();
+    //BBS: support shared object logic
+    const PrintObject *shared_object = object.get_shared_object();
+    if (! shared_object)
+        shared_object = &object;
+    const ModelVolumePtrs &volumes = shared_object->model_object()->volumes;
+    for (groupedVolumeSlices &group : groups)
+        for (ObjectID &volume_id : group.volume_ids)
+            for (size_t index = 0; index < volumes.size(); ++ index)
+                if (volumes[index]->id() == volume_id) {
+                    volume_id.id = index;
+                    break;
+                }
+    return groups;
+}
+
+std::string encode_object(const PrintObject &object, const std::string &name, size_t identify_id, const std::vector<groupedVolumeSlices> &first_layer_groups)
+{
+    // Encode the layer blobs first, the offsets have to be known when writing the tables.
+    std::string blobs;
+    std::vector<LayerEntry> layers(object.layer_count());
+    std::vector<LayerEntry> support_layers(object.support_layer_count());
+    {
+        Encoder enc(blobs);
+        for (size_t idx = 0; idx < layers.size(); ++ idx) {
+            const Layer *layer = object.get_layer(int(idx));
+            LayerEntry  &entry = layers[idx];
+            entry.id      = int(layer->id());
+            entry.height  = layer->height;
+            entry.print_z = layer->print_z;
+            entry.slice_z = layer->slice_z;
+            for (const LayerRegion *layer_region : layer->regions())
+                entry.region_config_hashes.push_back(layer_region->region().config_hash());
+            entry.offset  = blobs.size();
+            encode_layer(enc, *layer);
+            entry.size    = blobs.size() - entry.offset;
+        }
+        for (size_t idx = 0; idx < support_layers.size(); ++ idx) {
+            const SupportLayer *support_layer = object.support_layers()[idx];
+            LayerEntry         &entry         = support_layers[idx];
+            entry.id           = int(support_layer->id());
+            entry.interface_id = support_layer->interface_id();
+            entry.height       = support_layer->height;
+            entry.print_z      = support_layer->print_z;
+            entry.slice_z      = support_layer->slice_z;
+            entry.offset       = blobs.size();
+            encode_layer(enc, *support_layer);
+            enc.expolygons(support_layer->support_islands);
+            enc.collection(support_layer->support_fills);
+            entry.size         = blobs.size() - entry.offset;
+        }
+    }
+
+    std::string out;
+    Encoder enc(out);
+    enc.raw(MAGIC, sizeof(MAGIC));
+    enc.varint(FORMAT_VERSION);
+    enc.str(name);
+    enc.varint(identify_id);
+    enc.varint(layers.size());
+    enc.varint(support_layers.size());
+    enc.varint(first_layer_groups.size());
+    for (const LayerEntry &entry : layers) {
+        enc.svarint(entry.id);
+        enc.f64(entry.height);
+        enc.f64(entry.print_z);
+        enc.f64(entry.slice_z);
+        enc.varint(entry.region_config_hashes.size());
+        for (size_t hash : entry.region_config_hashes)
+            enc.varint(hash);
+        enc.varint(entry.offset);
+        enc.varint(entry.size);
+    }
+    for (const LayerEntry &entry : support_layers) {
+        enc.svarint(entry.id);
+        enc.varint(entry.interface_id);
+        enc.f64(entry.height);
+        enc.f64(entry.print_z);
+        enc.f64(entry.slice_z);
+        enc.varint(entry.offset);
+        enc.varint(entry.size);
+    }
+    for (const groupedVolumeSlices &group : first_layer_groups) {
+        enc.svarint(group.groupId);
+        enc.varint(group.volume_ids.size());
+        for (const ObjectID &volume_id : group.volume_ids)
+            enc.varint(volume_id.id);
+        enc.expolygons(group.slices);
+    }
+    enc.varint(blobs.size());
+    out += blobs;
+    return out;
+}
+
+void save_object(const std::string &path, const PrintObject &object, const std::string &name, size_t identify_id, const std::vector<groupedVolumeSlices> &first_layer_groups)
+{
+    std::string data = encode_object(object, name, identify_id, first_layer_groups);
+    boost::nowide::ofstream c(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (! c.good())
+        throw Slic3r::FileIOError("Slice cache: failed to open " + path + " for writing");
+    c.write(data.data(), std::streamsize(data.size()));
+    c.close();
+    if (c.fail())
+        throw Slic3r::FileIOError("Slice cache: failed to write " + path);
+}
+
+Reader::Reader(const std::string &path)
+{
+    try {
+        m_file.open(boost::filesystem::path(path));
+    } catch (const std::exception &err) {
+        throw Slic3r::FileIOError("Slice cache: failed to map " + path + ": " + err.what());
+    }
+    if (! m_file.is_open())
+        throw Slic3r::FileIOError("Slice cache: failed to map " + path);
+    m_data = m_file.data();
+    m_size = m_file.size();
+    this->parse_header();
+}
+
+Reader::Reader(const char *data, size_t size) : m_data(data), m_size(size)
+{
+    this->parse_header();
+}
+
+Reader::~Reader() = default;
+
+void Reader::parse_header()
+{
+    Decoder dec(m_data, m_data + m_size);
+    char magic[sizeof(MAGIC)];
+    dec.raw(magic, sizeof(magic));
+    if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+        throw Slic3r::FileIOError("Slice cache: invalid file signature");
+    uint64_t version = dec.varint();
+    if (version != FORMAT_VERSION)
+        throw Slic3r::FileIOError((boost::format("Slice cache: unsupported version %1%") % version).str());
+
+    m_object_name = dec.str();
+    m_identify_id = size_t(dec.varint());
+    size_t num_layers         = dec.count();
+    size_t num_support_layers = dec.count();
+    size_t num_groups         = dec.count();
+
+    m_layers.assign(num_layers, LayerEntry());
+    for (LayerEntry &entry : m_layers) {
+        entry.id      = int(dec.svarint());
+        entry.height  = dec.f64();
+        entry.print_z = dec.f64();
+        entry.slice_z = dec.f64();
+        size_t num_regions = dec.count();
+        entry.region_config_hashes.reserve(num_regions);
+        for (size_t i = 0; i < num_regions; ++ i)
+            entry.region_config_hashes.push_back(size_t(dec.varint()));
+        entry.offset  = dec.varint();
+        entry.size    = dec.varint();
+    }
+    m_support_layers.assign(num_support_layers, LayerEntry());
+    for (LayerEntry &entry : m_support_layers) {
+        entry.id           = int(dec.svarint());
+        entry.interface_id = size_t(dec.varint());
+        entry.height       = dec.f64();
+        entry.print_z      = dec.f64();
+        entry.slice_z      = dec.f64();
+        entry.offset       = dec.varint();
+        entry.size         = dec.varint();
+    }
+    m_first_layer_groups.assign(num_groups, groupedVolumeSlices());
+    for (groupedVolumeSlices &group : m_first_layer_groups) {
+        group.groupId = int(dec.svarint());
+        size_t num_volumes = dec.count();
+        group.volume_ids.reserve(num_volumes);
+        for (size_t i = 0; i < num_volumes; ++ i)
+            group.volume_ids.emplace_back(size_t(dec.varint()));
+        dec.expolygons(group.slices);
+    }
+
+    uint64_t blobs_size = dec.varint();
+    if (blobs_size != dec.remaining())
+        throw Slic3r::FileIOError("Slice cache: truncated file");
+    m_blobs_offset = m_size - dec.remaining();
+    auto validate = [blobs_size](const std::vector<LayerEntry> &entries) {
+        for (const LayerEntry &entry : entries)
+            if (entry.offset > blobs_size || entry.size > blobs_size - entry.offset)
+                throw Slic3r::FileIOError("Slice cache: layer offset out of range");
+    };
+    validate(m_layers);
+    validate(m_support_layers);
+}
+
+void Reader::decode_layer(size_t idx, Layer &layer) const
+{
+    const LayerEntry &entry = m_layers[idx];
+    const char       *begin = m_data + m_blobs_offset + entry.offset;
+    Decoder dec(begin, begin + entry.size);
+    decode_layer_data(dec, layer);
+}
+
+void Reader::decode_support_layer(size_t idx, SupportLayer &support_layer) const
+{
+    const LayerEntry &entry = m_support_layers[idx];
+    const char       *begin = m_data + m_blobs_offset + entry.offset;
+    Decoder dec(begin, begin + entry.size);
+    decode_layer_data(dec, support_layer);
+    dec.expolygons(support_layer.support_islands);
+    dec.collection(support_layer.support_fills);
+}
+
+} // namespace SliceCache
+} // namespace Slic3r
@@ -0,0 +1,100 @@
+#ifndef slic3r_Format_SliceCache_hpp_
+#define slic3r_Format_SliceCache_hpp_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace Slic3r {
+
+class Layer;
+class SupportLayer;
+class PrintObject;
+struct groupedVolumeSlices;
+
+// BBS: compact binary format of the per object slicing data written by Print::export_cached_data().
+// The JSON format is kept as a fallback, see Print::load_cached_data().
+//
+// File layout (all integers are LEB128 varints unless noted otherwise):
+//   header         : magic "BBSC" (4 bytes), format version, object name, identify_id,
+//                    layer count, support layer count, first layer group count
+//   layer table    : per layer {id, height, print_z, slice_z, region config hashes, blob offset, blob size}
+//   support table  : per support layer {id, interface_id, height, print_z, slice_z, blob offset, blob size}
+//   first layers   : first layer groups, volume ids are stored as indices into ModelObject::volumes
+//   layer blobs    : one blob per (support) layer, offsets are relative to the start of the blob area
+//
+// Point coordinates are stored as zigzag encoded deltas to the previous point of the same polygon / polyline,
+// doubles and floats are stored verbatim (little endian). The tables are decoded when the file is opened,
+// the layer blobs are decoded on demand straight from the memory mapped file, therefore layers may be decoded
+// in parallel and a layer that is not requested is never touched.
+namespace SliceCache {
+
+constexpr const char    *FILE_EXTENSION = ".bbsc";
+constexpr uint32_t       FORMAT_VERSION = 1;
+
+struct LayerEntry
+{
+    int                      id           { 0 };
+    // Only valid for support layers.
+    size_t                   interface_id { 0 };
+    double                   height       { 0. };
+    double                   print_z      { 0. };
+    double                   slice_z      { 0. };
+    // PrintRegion::config_hash() of each LayerRegion, in the order of Layer::regions().
+    std::vector<size_t>      region_config_hashes;
+    uint64_t                 offset       { 0 };
+    uint64_t                 size         { 0 };
+};
+
+// Copy of PrintObject::firstLayerObjGroups() with the volume ids converted to indices into ModelObject::volumes
+// of the object (or of its shared object), so that the groups may be restored into another ModelObject.
+std::vector<groupedVolumeSlices> first_layer_groups_with_volume_indices(const PrintObject &object);
+
+// Serialize the layers, support layers and first layer groups of a PrintObject into a binary blob.
+// The volume ids of first_layer_groups are expected to be converted to volume indices by the caller.
+std::string encode_object(const PrintObject &object, const std::string &name, size_t identify_id, const std::vector<groupedVolumeSlices> &first_layer_groups);
+// Encode and write to path. Throws Slic3r::FileIOError on failure.
+void        save_object(const std::string &path, const PrintObject &object, const std::string &name, size_t identify_id, const std::vector<groupedVolumeSlices> &first_layer_groups);
+
+class Reader
+{
+public:
+    // Memory map the file and decode the header and the layer tables. Throws Slic3r::FileIOError on failure.
+    explicit Reader(const std::string &path);
+    // Read from an in-memory buffer, which has to outlive the reader.
+    Reader(const char *data, size_t size);
+    ~Reader();
+
+    const std::string&                      object_name() const         { return m_object_name; }
+    size_t                                  identify_id() const         { return m_identify_id; }
+    const std::vector<LayerEntry>&          layers() const              { return m_layers; }
+    const std::vector<LayerEntry>&          support_layers() const      { return m_support_layers; }
+    // Volume ids are indices into ModelObject::volumes, see encode_object().
+    const std::vector<groupedVolumeSlices>& first_layer_groups() const  { return m_first_layer_groups; }
+
+    // Decode a layer blob into a layer, which has been created with the regions listed in the layer table.
+    // Thread safe, throws Slic3r::FileIOError if the blob is corrupted.
+    void    decode_layer(size_t idx, Layer &layer) const;
+    void    decode_support_layer(size_t idx, SupportLayer &support_layer) const;
+
+private:
+    void    parse_header();
+
+    boost::iostreams::mapped_file_source    m_file;
+    const char                             *m_data { nullptr };
+    size_t                                  m_size { 0 };
+    size_t                                  m_blobs_offset { 0 };
+
+    std::string                             m_object_name;
+    size_t                                  m_identify_id { 0 };
+    std::vector<LayerEntry>                 m_layers;
+    std::vector<LayerEntry>                 m_support_layers;
+    std::vector<groupedVolumeSlices>        m_first_layer_groups;
+};
+
+} // namespace SliceCache
+} // namespace Slic3r
+
+#endif /* slic3r_Format_SliceCache_hpp_ */
@@ -929,29 +929,17 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
             bool _extract_object_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat);
 
-            bool extract_object_model()
+            // BBS: the archive is a reader opened by the calling thread, it is shared by the objects extracted by that thread only.
+            bool extract_object_model(mz_zip_archive& archive)
             {
-                mz_zip_archive archive;
-                //mz_zip_archive_file_stat stat;
-                mz_zip_zero_struct(&archive);
-
-                if (!open_zip_reader(&archive, zip_path)) {
-                    top_importer->add_error("Unable to open the zipfile "+ zip_path);
-                    return false;
-                }
-
                 if (!top_importer->_extract_from_archive(archive, object_path, [this] (mz_zip_archive& archive, const mz_zip_archive_file_stat& stat) {
                     return _extract_object_from_archive(archive, stat);
                 }, top_importer->m_load_restore)) {
                     std::string error_msg = std::string("Archive does not contain a valid model for ") + object_path;
                     top_importer->add_error(error_msg);
-
-                    close_zip_reader(&archive);
                     return false;
                 }
 
-                close_zip_reader(&archive);
-
                 if (obj_parse_error) {
                     //already add_error inside
                     //top_importer->add_error(object_parse_error_message());
@@ -1077,6 +1065,15 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         std::vector<ObjectImporter*> m_object_importers;
 
         std::map<int, ModelVolume*> m_shared_meshes;
+        // BBS: meshes of the sub objects built in parallel by _prepare_volume_meshes() and taken by _generate_volumes_new().
+        struct PreparedMesh
+        {
+            RepairedMeshErrors          mesh_stats;
+            std::optional<TriangleMesh> mesh;
+        };
+        std::map<Id, PreparedMesh> m_prepared_meshes;
+        // BBS: volumes created by _generate_volumes_new(), their convex hulls are calculated in parallel by _calculate_convex_hulls().
+        std::vector<ModelVolume*> m_volumes_without_convex_hull;
 
         //BBS: plater related structures
         bool m_is_bbl_3mf { false };
@@ -1249,6 +1246,12 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         bool _handle_start_relationship(const char** attributes, unsigned int num_attributes);
 
         void _generate_current_object_list(std::vector<Component> &sub_objects, Id object_id, IdToCurrentObjectMap& current_objects);
+        static const ObjectMetadata::VolumeMetadata* _find_volume_metadata(const ObjectMetadata::VolumeMetadataList& volumes, size_t index, int subobject_id);
+        // Builds the meshes of the sub objects of the objects to be assembled in parallel, see m_prepared_meshes.
+        void _prepare_volume_meshes(const PlateData* current_plate_data);
+        // Returns false if the geometry references a vertex which does not exist.
+        static bool _build_volume_mesh(const Geometry& geometry, const RepairedMeshErrors& mesh_stats, TriangleMesh& mesh);
+        void _calculate_convex_hulls();
         bool _generate_volumes_new(ModelObject& object, const std::vector<Component> &sub_objects, const ObjectMetadata::VolumeMetadataList& volumes, ConfigSubstitutionContext& config_substitutions);
         bool _generate_volumes(ModelObject& object, const Geometry& geometry, const ObjectMetadata::VolumeMetadataList& volumes, ConfigSubstitutionContext& config_substitutions);
 
@@ -1320,6 +1323,8 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         m_unit_factor = 1.0f;
         m_curr_object = nullptr;
         m_current_objects.clear();
+        m_prepared_meshes.clear();
+        m_volumes_without_convex_hull.clear();
         m_index_paths.clear();
         m_objects.clear();
         //m_objects_aliases.clear();
@@ -1717,31 +1722,38 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
             bool object_load_result = true;
             boost::mutex mutex;
+            // BBS: miniz keeps the decompression state in the reader, thus each range of the objects opens its own reader.
             tbb::parallel_for(
                 tbb::blocked_range<size_t>(0, m_object_importers.size()),
-                [this, &mutex, &object_load_result](const tbb::blocked_range<size_t>& importer_range) {
+                [this, &filename, &mutex, &object_load_result](const tbb::blocked_range<size_t>& importer_range) {
                     CNumericLocalesSetter locales_setter;
-                    for (size_t object_index = importer_range.begin(); object_index < importer_range.end(); ++ object_index) {
-                        bool result = m_object_importers[object_index]->extract_object_model();
-                        {
-                            boost::unique_lock l(mutex);
-                            object_load_result &= result;
-                        }
+                    mz_zip_archive object_archive;
+                    mz_zip_zero_struct(&object_archive);
+                    bool result = open_zip_reader(&object_archive, filename);
+                    if (! result)
+                        add_error("Unable to open the zipfile " + PathSanitizer::sanitize(filename));
+                    for (size_t object_index = importer_range.begin(); result && object_index < importer_range.end(); ++ object_index)
+                        result = m_object_importers[object_index]->extract_object_model(object_archive);
+                    close_zip_reader(&object_archive);
+                    if (! result) {
+                        boost::unique_lock l(mutex);
+                        object_load_result = false;
                     }
                 }
             );
 
             if (!object_load_result) {
                 BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format(", loading sub-objects error\n");
+                for (auto obj_importer : m_object_importers)
+                    delete obj_importer;
+                m_object_importers.clear();
                 return false;
             }
 
-            //merge these objects into one
+            //merge these objects into one, in the order of the sub models, the meshes are moved, not copied
             for (auto obj_importer : m_object_importers) {
-                for (const IdToCurrentObjectMap::value_type&  obj : obj_importer->object_list)
-                    m_current_objects.insert({ std::move(obj.first), std::move(obj.second)});
-                for (auto group_color : obj_importer->object_group_id_to_color)
-                    m_group_id_to_color.insert(std::move(group_color));
+                m_current_objects.merge(obj_importer->object_list);
+                m_group_id_to_color.merge(obj_importer->object_group_id_to_color);
 
                 delete obj_importer;
             }
@@ -1926,6 +1938,16 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
         lock.close();
 
+        //only load objects in plate_id
+        PlateData* current_plate_data = nullptr;
+        if ((plate_id > 0) && (plate_id <= m_plater_data.size())) {
+            std::map<int, PlateData*>::iterator it =m_plater_data.find(plate_id);
+            if (it != m_plater_data.end()) {
+                current_plate_data = it->second;
+            }
+        }
+        _prepare_volume_meshes(current_plate_data);
+
         if (!m_is_bbl_3mf) {
             // if the 3mf was not produced by BambuStudio and there is more than one instance,
             // split the object in as many objects as instances
@@ -1987,14 +2009,6 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         }
 
         BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << ":" << __LINE__ << boost::format(", begin to assemble objects, size %1%\n")%m_objects.size();
-        //only load objects in plate_id
-        PlateData* current_plate_data = nullptr;
-        if ((plate_id > 0) && (plate_id <= m_plater_data.size())) {
-            std::map<int, PlateData*>::iterator it =m_plater_data.find(plate_id);
-            if (it != m_plater_data.end()) {
-                current_plate_data = it->second;
-            }
-        }
         for (const IdToModelObjectMap::value_type& object : m_objects) {
             if (object.second >= int(m_model->objects.size())) {
                 add_error("invalid object, id: "+std::to_string(object.first.second));
@@ -2111,6 +2125,9 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
                 }
             }
         }
+        // the meshes not taken are shared with another volume
+        m_prepared_meshes.clear();
+        _calculate_convex_hulls();
 
         // If instances contain a single volume, the volume offset should be 0,0,0
         // This equals to say that instance world position and volume world position should match
@@ -4732,6 +4749,92 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         }
     }
 
+    const _BBS_3MF_Importer::ObjectMetadata::VolumeMetadata* _BBS_3MF_Importer::_find_volume_metadata(const ObjectMetadata::VolumeMetadataList& volumes, size_t index, int subobject_id)
+    {
+        if (index < volumes.size() && volumes[index].subobject_id == subobject_id)
+            return &volumes[index];
+        for (const ObjectMetadata::VolumeMetadata& volume_iter : volumes)
+            if (volume_iter.subobject_id == subobject_id)
+                return &volume_iter;
+        return nullptr;
+    }
+
+    bool _BBS_3MF_Importer::_build_volume_mesh(const Geometry& geometry, const RepairedMeshErrors& mesh_stats, TriangleMesh& mesh)
+    {
+        indexed_triangle_set its;
+        its.indices.assign(geometry.triangles.begin(), geometry.triangles.end());
+        for (const Vec3i& face : its.indices) {
+            for (const int tri_id : face) {
+                if (tri_id < 0 || tri_id >= int(geometry.vertices.size()))
+                    return false;
+            }
+        }
+
+        its.vertices.assign(geometry.vertices.begin(), geometry.vertices.end());
+
+        // BBS
+        its.properties.reserve(geometry.face_properties.size());
+        for (const std::string& prop_str : geometry.face_properties) {
+            FaceProperty face_prop;
+            face_prop.from_string(prop_str);
+            its.properties.push_back(face_prop);
+        }
+
+        mesh = TriangleMesh(std::move(its), mesh_stats);
+        if (mesh.volume() < 0)
+            mesh.flip_triangles();
+        return true;
+    }
+
+    void _BBS_3MF_Importer::_prepare_volume_meshes(const PlateData* current_plate_data)
+    {
+        // Collect the sub objects in the order _generate_volumes_new() will visit them, each one once,
+        // with the repair statistics of the first volume referencing it.
+        std::vector<std::pair<const CurrentObject*, PreparedMesh*>> jobs;
+        for (const IdToModelObjectMap::value_type& object : m_objects) {
+            if (object.second >= int(m_model->objects.size()))
+                continue;
+            if (current_plate_data && current_plate_data->obj_inst_map.find(object.first.second) == current_plate_data->obj_inst_map.end())
+                continue;
+
+            std::vector<Component> object_id_list;
+            _generate_current_object_list(object_id_list, object.first, m_current_objects);
+            IdToMetadataMap::const_iterator obj_metadata = m_objects_metadata.find(object.first.second);
+            for (size_t index = 0; index < object_id_list.size(); ++ index) {
+                const Id& object_id = object_id_list[index].object_id;
+                IdToCurrentObjectMap::const_iterator current_object = m_current_objects.find(object_id);
+                if (current_object == m_current_objects.end() || current_object->second.geometry.triangles.empty() || m_prepared_meshes.count(object_id))
+                    continue;
+                const ObjectMetadata::VolumeMetadata* volume_data = obj_metadata == m_objects_metadata.end() ? nullptr :
+                    _find_volume_metadata(obj_metadata->second.volumes, index, current_object->second.id);
+                PreparedMesh& prepared = m_prepared_meshes[object_id];
+                if (volume_data)
+                    prepared.mesh_stats = volume_data->mesh_stats;
+                jobs.emplace_back(&current_object->second, &prepared);
+            }
+        }
+
+        BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << ":" << __LINE__ << boost::format(", build %1% meshes in parallel\n") % jobs.size();
+        // The map is not modified any more, each job writes its own mesh only. The meshes failing the validation are left empty,
+        // _generate_volumes_new() reports the error.
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, jobs.size(), 1), [&jobs](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                TriangleMesh mesh;
+                if (_build_volume_mesh(jobs[i].first->geometry, jobs[i].second->mesh_stats, mesh))
+                    jobs[i].second->mesh = std::move(mesh);
+            }
+        });
+    }
+
+    void _BBS_3MF_Importer::_calculate_convex_hulls()
+    {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, m_volumes_without_convex_hull.size(), 1), [this](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                m_volumes_without_convex_hull[i]->calculate_convex_hull();
+        });
+        m_volumes_without_convex_hull.clear();
+    }
+
     bool _BBS_3MF_Importer::_generate_volumes_new(ModelObject& object, const std::vector<Component> &sub_objects, const ObjectMetadata::VolumeMetadataList& volumes, ConfigSubstitutionContext& config_substitutions)
     {
         if (!object.volumes.empty()) {
@@ -4754,16 +4857,8 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
             }
             CurrentObject* sub_object = &(current_object->second);
 
-            const ObjectMetadata::VolumeMetadata* volume_data = nullptr;
+            const ObjectMetadata::VolumeMetadata* volume_data = _find_volume_metadata(volumes, index, sub_object->id);
             ObjectMetadata::VolumeMetadata default_volume_data(sub_object->id);
-            if (index < volumes.size() && volumes[index].subobject_id == sub_object->id)
-                volume_data = &volumes[index];
-            else for (const ObjectMetadata::VolumeMetadata& volume_iter : volumes) {
-                if (volume_iter.subobject_id == sub_object->id) {
-                    volume_data = &volume_iter;
-                    break;
-                }
-            }
 
             Transform3d volume_matrix_to_object = Transform3d::Identity();
             bool        has_transform 		    = false;
@@ -4820,33 +4915,20 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
             }
             if (!shared_volume){
                 // splits volume out of imported geometry
-                indexed_triangle_set its;
-                its.indices.assign(sub_object->geometry.triangles.begin(), sub_object->geometry.triangles.end());
-                //const size_t triangles_count = its.indices.size();
-                //if (triangles_count == 0) {
-                //    add_error("found no trianges in the object " + std::to_string(sub_object->id));
-                //    return false;
-                //}
-                for (const Vec3i& face : its.indices) {
-                    for (const int tri_id : face) {
-                        if (tri_id < 0 || tri_id >= int(sub_object->geometry.vertices.size())) {
-                            add_error("invalid vertex id in object " + std::to_string(sub_object->id));
-                            return false;
-                        }
-                    }
-                }
-
-                its.vertices.assign(sub_object->geometry.vertices.begin(), sub_object->geometry.vertices.end());
-
-                // BBS
-                for (const std::string prop_str : sub_object->geometry.face_properties) {
-                    FaceProperty face_prop;
-                    face_prop.from_string(prop_str);
-                    its.properties.push_back(face_prop);
+                TriangleMesh triangle_mesh;
+                auto prepared = m_prepared_meshes.find(object_id);
+                auto same_stats = [](const RepairedMeshErrors& lhs, const RepairedMeshErrors& rhs) {
+                    return lhs.edges_fixed == rhs.edges_fixed && lhs.degenerate_facets == rhs.degenerate_facets && lhs.facets_removed == rhs.facets_removed &&
+                           lhs.facets_reversed == rhs.facets_reversed && lhs.backwards_edges == rhs.backwards_edges;
+                };
+                if (prepared != m_prepared_meshes.end() && prepared->second.mesh && same_stats(prepared->second.mesh_stats, volume_data->mesh_stats)) {
+                    triangle_mesh = std::move(*prepared->second.mesh);
+                    prepared->second.mesh.reset();
+                } else if (!_build_volume_mesh(sub_object->geometry, volume_data->mesh_stats, triangle_mesh)) {
+                    add_error("invalid vertex id in object " + std::to_string(sub_object->id));
+                    return false;
                 }
 
-                TriangleMesh triangle_mesh(std::move(its), volume_data->mesh_stats);
-
                 // BBS: no need to multiply the instance matrix into the volume
                 //if (!m_is_bbl_3mf) {
                 //    // if the 3mf was not produced by BambuStudio and there is only one instance,
@@ -4858,8 +4940,6 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
                 //        //FIXME do the mesh fixing?
                 //    }
                 //}
-                if (triangle_mesh.volume() < 0)
-                    triangle_mesh.flip_triangles();
 
                 bool is_text = !volume_data->text_info.m_text.empty();
                 bool modify_to_center_geometry = is_text ? false : true;//text do not modify_to_center_geometry
@@ -4881,7 +4961,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
             if (has_transform)
                 volume->source.transform = Slic3r::Geometry::Transformation(volume_matrix_to_object);
 
-            volume->calculate_convex_hull();
+            m_volumes_without_convex_hull.emplace_back(volume);
 
             //set transform from 3mf
             Slic3r::Geometry::Transformation comp_transformatino(sub_comp.transform);
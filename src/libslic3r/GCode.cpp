@@ -5,6 +5,7 @@
 #include "ExtrusionEntity.hpp"
 #include "EdgeGrid.hpp"
 #include "Geometry/ConvexHull.hpp"
+#include "GCode/LayerGCodeSpill.hpp"
 #include "GCode/PrintExtents.hpp"
 #include "GCode/WipeTower.hpp"
 #include "ShortestPath.hpp"
@@ -16,6 +17,8 @@
 #include "libslic3r/format.hpp"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdlib>
 #include <chrono>
 #include <math.h>
@@ -2683,7 +2686,7 @@ void GCode::_do_export(Print& print, GCodeOutputStream &file, ThumbnailsGenerato
 
     // Collect custom seam data from all objects.
     std::function<void(void)> throw_if_canceled_func = [&print]() { print.throw_if_canceled(); };
-    m_seam_placer.init(print, throw_if_canceled_func);
+    m_seam_placer.init(print, print.seam_visibility_cache(), throw_if_canceled_func);
 
     // BBS: get path for change filament
     if (m_writer.multiple_extruders) {
@@ -3133,9 +3136,39 @@ void GCode::set_extrude_acceleration(bool is_first_layer)
     }
 }
 
+// BBS: wall time spent in the stages of the G-code export pipeline, summed over the layers.
+// Stages running in parallel may sum up to more than the elapsed time.
+struct PipelineStageTimes
+{
+    enum Stage { Generate, SpiralVase, Parse, Cooling, BuildNode, LayerTime, Rewrite, Output, Count };
+
+    struct Scope
+    {
+        std::atomic<int64_t>                    &counter;
+        std::chrono::steady_clock::time_point    start;
+        ~Scope() { counter += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count(); }
+    };
+    Scope measure(Stage stage) { return { microseconds[stage], std::chrono::steady_clock::now() }; }
+
+    void log() const {
+        static constexpr const char *names[Count] = { "generate", "spiral vase", "parse", "cooling", "build node", "layer time", "rewrite", "output" };
+        std::string msg = "G-code export pipeline stage times [ms]:";
+        for (int stage = 0; stage < Count; ++ stage)
+            if (int64_t us = microseconds[stage].load(); us > 0)
+                msg += (boost::format(" %1% %2%,") % names[stage] % (us / 1000)).str();
+        msg.pop_back();
+        BOOST_LOG_TRIVIAL(info) << msg;
+    }
+
+    std::array<std::atomic<int64_t>, Count> microseconds {};
+};
+
 // Process all layers of all objects (non-sequential mode) with a parallel pipeline:
 // Generate G-code, run the filters (vase mode, cooling buffer), run the G-code analyser
 // and export G-code into file.
+// The stages carrying state from layer to layer (G-code generation, vase mode, parsing with its position and extruder,
+// rewriting with its fan state, output) run serial in order, the per layer computations (cooling slow down,
+// smoothing nodes, layer time) run in parallel.
 void GCode::process_layers(
     const Print                                                         &print,
     const ToolOrdering                                                  &tool_ordering,
@@ -3154,12 +3187,25 @@ void GCode::process_layers(
     layers_results.resize(layers_to_print.size());
 
     // The pipeline is variable: The vase mode filter is optional.
+    PipelineStageTimes stage_times;
+
     const auto generator = tbb::make_filter<void, GCode::LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-        [this, &print, &tool_ordering, &print_object_instances_ordering, &layers_to_print, &layer_to_print_idx](tbb::flow_control& fc) -> GCode::LayerResult {
+        [this, &print, &tool_ordering, &print_object_instances_ordering, &layers_to_print, &layer_to_print_idx, &stage_times](tbb::flow_control& fc) -> GCode::LayerResult {
             if (layer_to_print_idx == layers_to_print.size()) {
+                m_avoid_crossing_perimeters.clear_precomputed_layers();
                 fc.stop();
                 return {};
             } else {
+                auto timer = stage_times.measure(PipelineStageTimes::Generate);
+                // BBS: precompute the travel boundaries of the next layers in parallel, once per lookahead window.
+                if (m_travel_boundaries_lookahead > 0 && print.config().reduce_crossing_wall && layer_to_print_idx % m_travel_boundaries_lookahead == 0) {
+                    std::vector<const Layer*> layers;
+                    for (size_t idx = layer_to_print_idx; idx < std::min(layer_to_print_idx + m_travel_boundaries_lookahead, layers_to_print.size()); ++ idx)
+                        for (const LayerToPrint &layer_to_print : layers_to_print[idx].second)
+                            layers.emplace_back(layer_to_print.layer());
+                    // Travels around the objects only happen between objects or instances.
+                    m_avoid_crossing_perimeters.precompute_layers(layers, print.config().avoid_crossing_wall_includes_support, print_object_instances_ordering.size() > 1);
+                }
                 const std::pair<coordf_t, std::vector<LayerToPrint>>& layer = layers_to_print[layer_to_print_idx++];
                 const LayerTools& layer_tools = tool_ordering.tools_for_layer(layer.first);
                 print.set_status(80, Slic3r::format(_(L("Generating G-code: layer %1%")), std::to_string(layer_to_print_idx)));
@@ -3179,7 +3225,8 @@ void GCode::process_layers(
         this->m_spiral_vase->set_max_xy_smoothing(max_xy_smoothing);
     }
     const auto spiral_mode = tbb::make_filter<GCode::LayerResult, GCode::LayerResult>(
-        slic3r_tbb_filtermode::serial_in_order, [&spiral_mode = *this->m_spiral_vase.get(), & layers_to_print](GCode::LayerResult in) -> GCode::LayerResult {
+        slic3r_tbb_filtermode::serial_in_order, [&spiral_mode = *this->m_spiral_vase.get(), &layers_to_print, &stage_times](GCode::LayerResult in) -> GCode::LayerResult {
+            auto timer = stage_times.measure(PipelineStageTimes::SpiralVase);
             spiral_mode.enable(in.spiral_vase_enable);
             bool last_layer = in.layer_id == layers_to_print.size() - 1;
             return {spiral_mode.process_layer(std::move(in.gcode), last_layer), in.layer_id, in.spiral_vase_enable, in.cooling_buffer_flush, in.gcode_store_pos};
@@ -3188,7 +3235,8 @@ void GCode::process_layers(
     std::vector<std::vector<PerExtruderAdjustments>> layers_extruder_adjustments(layers_to_print.size());
 
     const auto parsing = tbb::make_filter<GCode::LayerResult, GCode::LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-    [&gcode_editer = *this->m_gcode_editer.get(), &layers_extruder_adjustments, object_label](GCode::LayerResult in) -> GCode::LayerResult{
+    [&gcode_editer = *this->m_gcode_editer.get(), &layers_extruder_adjustments, object_label, &stage_times](GCode::LayerResult in) -> GCode::LayerResult{
+        auto timer = stage_times.measure(PipelineStageTimes::Parse);
         //record gcode
         in.gcode = gcode_editer.process_layer(std::move(in.gcode), in.not_set_additional_fan, in.layer_id, layers_extruder_adjustments[in.gcode_store_pos], object_label, in.cooling_buffer_flush, false);
          return std::move(in);
@@ -3199,17 +3247,24 @@ void GCode::process_layers(
 
     CoolingBuffer cooling_processor;
 
-    const auto cooling = tbb::make_filter<GCode::LayerResult, GCode::LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-    [&cooling_processor, &layers_extruder_adjustments](GCode::LayerResult in) -> GCode::LayerResult {
+    // The slow down only depends on the adjustments of the layer itself.
+    const auto cooling = tbb::make_filter<GCode::LayerResult, GCode::LayerResult>(slic3r_tbb_filtermode::parallel,
+    [&cooling_processor, &layers_extruder_adjustments, &stage_times](GCode::LayerResult in) -> GCode::LayerResult {
+        auto timer = stage_times.measure(PipelineStageTimes::Cooling);
         in.layer_time = cooling_processor.calculate_layer_slowdown(layers_extruder_adjustments[in.gcode_store_pos]);
          return std::move(in);
     });
 
     // step 4.1: record node date
     SmoothCalculator smooth_calculator(object_label.size());
-
-    const auto build_node = tbb::make_filter<GCode::LayerResult, void>(slic3r_tbb_filtermode::serial_in_order,
-    [&smooth_calculator, &layers_wall_collection, &layers_extruder_adjustments, object_label, &layers_results](GCode::LayerResult in){
+    // The G-code of all layers is held until the smoothing is done, bound the memory used.
+    LayerGCodeSpill  layers_gcode(layers_to_print.size(), m_layer_gcode_memory_limit);
+
+    // Only writes the slots of the layer.
+    const auto build_node = tbb::make_filter<GCode::LayerResult, void>(slic3r_tbb_filtermode::parallel,
+    [&smooth_calculator, &layers_wall_collection, &layers_extruder_adjustments, object_label, &layers_results, &layers_gcode, &stage_times](GCode::LayerResult in){
+         auto timer = stage_times.measure(PipelineStageTimes::BuildNode);
+         layers_gcode.store(in.gcode_store_pos, std::move(in.gcode));
          smooth_calculator.build_node(layers_wall_collection[in.gcode_store_pos], object_label, layers_extruder_adjustments[in.gcode_store_pos]);
          layers_results[in.gcode_store_pos] = std::move(in);
          return;
@@ -3217,29 +3272,42 @@ void GCode::process_layers(
 
     // step 5: rewite
     const auto write_gocde= tbb::make_filter<GCode::LayerResult, std::string>(slic3r_tbb_filtermode::serial_in_order,
-    [&gcode_editer = *this->m_gcode_editer.get(), &layers_extruder_adjustments](GCode::LayerResult in) -> std::string {
-         return gcode_editer.write_layer_gcode(std::move(in.gcode), in.not_set_additional_fan, in.layer_id, in.layer_time, layers_extruder_adjustments[in.gcode_store_pos]);
+    [&gcode_editer = *this->m_gcode_editer.get(), &layers_extruder_adjustments, &stage_times](GCode::LayerResult in) -> std::string {
+         auto timer = stage_times.measure(PipelineStageTimes::Rewrite);
+         std::vector<PerExtruderAdjustments> &adjustments = layers_extruder_adjustments[in.gcode_store_pos];
+         std::string gcode = gcode_editer.write_layer_gcode(std::move(in.gcode), in.not_set_additional_fan, in.layer_id, in.layer_time, adjustments);
+         // The adjustments of a written layer are not used anymore, release them so that they do not pile up until the end of the export.
+         std::vector<PerExtruderAdjustments>().swap(adjustments);
+         return gcode;
     });
 
     std::vector<GCode::LayerResult> gcode_res;
 
     // BBS: apply new feedrate of outwall and recalculate layer time
     int layer_idx = 0;
-     const auto calculate_layer_time= tbb::make_filter<void, GCode::LayerResult>(slic3r_tbb_filtermode::serial_in_order, [&layer_idx, &smooth_calculator, &layers_extruder_adjustments, &gcode_res](tbb::flow_control& fc) -> GCode::LayerResult {
-         if(layer_idx == gcode_res.size()){
+    const auto next_layer = tbb::make_filter<void, int>(slic3r_tbb_filtermode::serial_in_order, [&layer_idx, &gcode_res](tbb::flow_control& fc) -> int {
+        if (layer_idx == gcode_res.size()) {
             fc.stop();
-            return{};
-        }else{
-             if (layer_idx > 0){
-                gcode_res[layer_idx].layer_time = smooth_calculator.recaculate_layer_time(layer_idx, layers_extruder_adjustments[gcode_res[layer_idx].gcode_store_pos]);
-             }
-             return gcode_res[layer_idx++];
+            return 0;
         }
-        });
+        return layer_idx ++;
+    });
+    // Only touches the smoothing nodes and the adjustments of the layer.
+    const auto calculate_layer_time = tbb::make_filter<int, GCode::LayerResult>(slic3r_tbb_filtermode::parallel, [&smooth_calculator, &layers_extruder_adjustments, &gcode_res, &layers_gcode, &stage_times](int idx) -> GCode::LayerResult {
+        auto timer = stage_times.measure(PipelineStageTimes::LayerTime);
+        if (idx > 0)
+            gcode_res[idx].layer_time = smooth_calculator.recaculate_layer_time(idx, layers_extruder_adjustments[gcode_res[idx].gcode_store_pos]);
+        GCode::LayerResult res = std::move(gcode_res[idx]);
+        res.gcode = layers_gcode.take(res.gcode_store_pos);
+        return res;
+    });
 
 
     const auto output = tbb::make_filter<std::string, void>(slic3r_tbb_filtermode::serial_in_order,
-    [&output_stream](std::string s) { output_stream.write(s); });
+    [&output_stream, &stage_times](std::string s) {
+        auto timer = stage_times.measure(PipelineStageTimes::Output);
+        output_stream.write(s);
+    });
 
     // BBS: apply cooling
     // The pipeline elements are joined using const references, thus no copying is performed.
@@ -3253,7 +3321,7 @@ void GCode::process_layers(
         message = _L("Smoothing z direction speed");
         m_print->set_status(85, message);
         //append data
-        for (const LayerResult &res : layers_results) {
+        for (LayerResult &res : layers_results) {
             //remove empty gcode layer caused by support independent layers
             if (res.cooling_buffer_flush) {
                 smooth_calculator.append_data(layers_wall_collection[res.gcode_store_pos]);
@@ -3264,14 +3332,19 @@ void GCode::process_layers(
         smooth_calculator.smooth_layer_speed();
         message = _L("Exporting G-code");
         m_print->set_status(90, message);
-        tbb::parallel_pipeline(12, calculate_layer_time & write_gocde & output);
-    }
-
+        tbb::parallel_pipeline(12, next_layer & calculate_layer_time & write_gocde & output);
+        BOOST_LOG_TRIVIAL(info) << boost::format("Layer G-code held for smoothing: peak %1% bytes of G-code in memory, %2% layers with %3% bytes spilled, process memory:")
+            % layers_gcode.gcode_bytes_peak() % layers_gcode.spilled_layers() % layers_gcode.spilled_bytes() << log_memory_info();
+    }
+    stage_times.log();
+    const AvoidCrossingPerimeters::Stats &travel_stats = m_avoid_crossing_perimeters.stats();
+    BOOST_LOG_TRIVIAL(info) << boost::format("Travels avoiding crossing walls: %1% planned in %2% s, %3% of them taken from the cache")
+        % travel_stats.travels % travel_stats.planning_time % travel_stats.cache_hits;
 }
 
 // Process all layers of a single object instance (sequential mode) with a parallel pipeline:
 // Generate G-code, run the filters (vase mode, cooling buffer), run the G-code analyser
-// and export G-code into file.
+// and export G-code into file. The stages are scheduled as in the non-sequential variant above.
 void GCode::process_layers(
     const Print                             &print,
     const ToolOrdering                      &tool_ordering,
@@ -3296,12 +3369,24 @@ void GCode::process_layers(
 
     //step 1: generator
     // The pipeline is variable: The vase mode filter is optional.
+    PipelineStageTimes stage_times;
+
     const auto generator = tbb::make_filter<void, GCode::LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-        [this, &print, &tool_ordering, &layers_to_print, &layer_to_print_idx, single_object_idx, prime_extruder](tbb::flow_control& fc) -> GCode::LayerResult {
+        [this, &print, &tool_ordering, &layers_to_print, &layer_to_print_idx, single_object_idx, prime_extruder, &stage_times](tbb::flow_control& fc) -> GCode::LayerResult {
             if (layer_to_print_idx == layers_to_print.size()) {
+                m_avoid_crossing_perimeters.clear_precomputed_layers();
                 fc.stop();
                 return {};
             } else {
+                auto timer = stage_times.measure(PipelineStageTimes::Generate);
+                // BBS: precompute the travel boundaries of the next layers in parallel, once per lookahead window.
+                if (m_travel_boundaries_lookahead > 0 && print.config().reduce_crossing_wall && layer_to_print_idx % m_travel_boundaries_lookahead == 0) {
+                    std::vector<const Layer*> layers;
+                    for (size_t idx = layer_to_print_idx; idx < std::min(layer_to_print_idx + m_travel_boundaries_lookahead, layers_to_print.size()); ++ idx)
+                        layers.emplace_back(layers_to_print[idx].layer());
+                    // A single object instance is printed, its external travels are rare, leave their boundary to travel_to().
+                    m_avoid_crossing_perimeters.precompute_layers(layers, print.config().avoid_crossing_wall_includes_support, false);
+                }
                 LayerToPrint &layer = layers_to_print[layer_to_print_idx ++];
                 print.set_status(80, Slic3r::format(_(L("Generating G-code: layer %1%")), std::to_string(layer_to_print_idx)));
                 //BBS
@@ -3318,7 +3403,8 @@ void GCode::process_layers(
         this->m_spiral_vase->set_max_xy_smoothing(max_xy_smoothing);
     }
     const auto spiral_mode = tbb::make_filter<GCode::LayerResult, GCode::LayerResult>(
-        slic3r_tbb_filtermode::serial_in_order, [&spiral_mode = *this->m_spiral_vase.get(), &layers_to_print](GCode::LayerResult in) -> GCode::LayerResult {
+        slic3r_tbb_filtermode::serial_in_order, [&spiral_mode = *this->m_spiral_vase.get(), &layers_to_print, &stage_times](GCode::LayerResult in) -> GCode::LayerResult {
+            auto timer = stage_times.measure(PipelineStageTimes::SpiralVase);
             spiral_mode.enable(in.spiral_vase_enable);
             bool last_layer = in.layer_id == layers_to_print.size() - 1;
             return {spiral_mode.process_layer(std::move(in.gcode), last_layer), in.layer_id, in.spiral_vase_enable, in.cooling_buffer_flush, in.gcode_store_pos};
@@ -3331,7 +3417,8 @@ void GCode::process_layers(
     std::vector<std::vector<PerExtruderAdjustments>> layers_extruder_adjustments(layers_to_print.size());
 
     const auto parsing = tbb::make_filter<GCode::LayerResult, GCode::LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-    [&gcode_editer = *this->m_gcode_editer.get(), &layers_extruder_adjustments, object_label](GCode::LayerResult in) -> GCode::LayerResult{
+    [&gcode_editer = *this->m_gcode_editer.get(), &layers_extruder_adjustments, object_label, &stage_times](GCode::LayerResult in) -> GCode::LayerResult{
+        auto timer = stage_times.measure(PipelineStageTimes::Parse);
         //record gcode
         in.gcode = gcode_editer.process_layer(std::move(in.gcode), in.not_set_additional_fan, in.layer_id, layers_extruder_adjustments[in.gcode_store_pos], object_label, in.cooling_buffer_flush, false);
          return std::move(in);
@@ -3341,17 +3428,24 @@ void GCode::process_layers(
     std::vector<std::vector<OutwallCollection>> layers_wall_collection(layers_to_print.size());
     CoolingBuffer cooling_processor;
 
-    const auto cooling = tbb::make_filter<GCode::LayerResult, GCode::LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-    [&cooling_processor, &layers_extruder_adjustments](GCode::LayerResult in) -> GCode::LayerResult {
+    // The slow down only depends on the adjustments of the layer itself.
+    const auto cooling = tbb::make_filter<GCode::LayerResult, GCode::LayerResult>(slic3r_tbb_filtermode::parallel,
+    [&cooling_processor, &layers_extruder_adjustments, &stage_times](GCode::LayerResult in) -> GCode::LayerResult {
+        auto timer = stage_times.measure(PipelineStageTimes::Cooling);
         in.layer_time = cooling_processor.calculate_layer_slowdown(layers_extruder_adjustments[in.gcode_store_pos]);
          return std::move(in);
     });
 
     // step 4.1: record node date
     SmoothCalculator smooth_calculator(object_label.size());
-
-    const auto build_node = tbb::make_filter<GCode::LayerResult, void>(slic3r_tbb_filtermode::serial_in_order,
-    [&smooth_calculator, &layers_wall_collection, &layers_extruder_adjustments, object_label, &layers_results](GCode::LayerResult in){
+    // The G-code of all layers is held until the smoothing is done, bound the memory used.
+    LayerGCodeSpill  layers_gcode(layers_to_print.size(), m_layer_gcode_memory_limit);
+
+    // Only writes the slots of the layer.
+    const auto build_node = tbb::make_filter<GCode::LayerResult, void>(slic3r_tbb_filtermode::parallel,
+    [&smooth_calculator, &layers_wall_collection, &layers_extruder_adjustments, object_label, &layers_results, &layers_gcode, &stage_times](GCode::LayerResult in){
+         auto timer = stage_times.measure(PipelineStageTimes::BuildNode);
+         layers_gcode.store(in.gcode_store_pos, std::move(in.gcode));
          smooth_calculator.build_node(layers_wall_collection[in.gcode_store_pos], object_label, layers_extruder_adjustments[in.gcode_store_pos]);
          layers_results[in.gcode_store_pos] = std::move(in);
          return;
@@ -3359,8 +3453,13 @@ void GCode::process_layers(
 
     // step 5: rewite
     const auto write_gocde= tbb::make_filter<GCode::LayerResult, std::string>(slic3r_tbb_filtermode::serial_in_order,
-    [&gcode_editer = *this->m_gcode_editer.get(), &layers_extruder_adjustments](GCode::LayerResult in) -> std::string {
-         return gcode_editer.write_layer_gcode(std::move(in.gcode), in.not_set_additional_fan, in.layer_id, in.layer_time, layers_extruder_adjustments[in.gcode_store_pos]);
+    [&gcode_editer = *this->m_gcode_editer.get(), &layers_extruder_adjustments, &stage_times](GCode::LayerResult in) -> std::string {
+         auto timer = stage_times.measure(PipelineStageTimes::Rewrite);
+         std::vector<PerExtruderAdjustments> &adjustments = layers_extruder_adjustments[in.gcode_store_pos];
+         std::string gcode = gcode_editer.write_layer_gcode(std::move(in.gcode), in.not_set_additional_fan, in.layer_id, in.layer_time, adjustments);
+         // The adjustments of a written layer are not used anymore, release them so that they do not pile up until the end of the export.
+         std::vector<PerExtruderAdjustments>().swap(adjustments);
+         return gcode;
     });
 
     std::vector<GCode::LayerResult> gcode_res;
@@ -3368,21 +3467,29 @@ void GCode::process_layers(
      // BBS: apply new feedrate of outwall and recalculate layer time
      int layer_idx = 0;
      //restart pipeline
-     const auto calculate_layer_time = tbb::make_filter<void, GCode::LayerResult>(slic3r_tbb_filtermode::serial_in_order, [&layer_idx, &gcode_res, &smooth_calculator, &layers_extruder_adjustments](tbb::flow_control& fc) -> GCode::LayerResult {
-         if(layer_idx == gcode_res.size()){
+    const auto next_layer = tbb::make_filter<void, int>(slic3r_tbb_filtermode::serial_in_order, [&layer_idx, &gcode_res](tbb::flow_control& fc) -> int {
+        if (layer_idx == gcode_res.size()) {
             fc.stop();
-            return{};
-        }else{
-             if (layer_idx > 0) {
-                gcode_res[layer_idx].layer_time = smooth_calculator.recaculate_layer_time(layer_idx, layers_extruder_adjustments[gcode_res[layer_idx].gcode_store_pos]);
-             }
-             return gcode_res[layer_idx++];
+            return 0;
         }
-        });
+        return layer_idx ++;
+    });
+    // Only touches the smoothing nodes and the adjustments of the layer.
+    const auto calculate_layer_time = tbb::make_filter<int, GCode::LayerResult>(slic3r_tbb_filtermode::parallel, [&smooth_calculator, &layers_extruder_adjustments, &gcode_res, &layers_gcode, &stage_times](int idx) -> GCode::LayerResult {
+        auto timer = stage_times.measure(PipelineStageTimes::LayerTime);
+        if (idx > 0)
+            gcode_res[idx].layer_time = smooth_calculator.recaculate_layer_time(idx, layers_extruder_adjustments[gcode_res[idx].gcode_store_pos]);
+        GCode::LayerResult res = std::move(gcode_res[idx]);
+        res.gcode = layers_gcode.take(res.gcode_store_pos);
+        return res;
+    });
 
 
     const auto output = tbb::make_filter<std::string, void>(slic3r_tbb_filtermode::serial_in_order,
-    [&output_stream](std::string s) { output_stream.write(s); });
+    [&output_stream, &stage_times](std::string s) {
+        auto timer = stage_times.measure(PipelineStageTimes::Output);
+        output_stream.write(s);
+    });
 
     // BBS: apply cooling
     // The pipeline elements are joined using const references, thus no copying is performed.
@@ -3395,18 +3502,24 @@ void GCode::process_layers(
         // step 4.2: smoothing
         // break pipeline and do z smoothing
         // append data
-        for (const LayerResult &res : layers_results) {
+        for (LayerResult &res : layers_results) {
             // remove empty gcode layer caused by support independent layers
             if (res.cooling_buffer_flush) {
                 smooth_calculator.append_data(layers_wall_collection[res.gcode_store_pos]);
-                gcode_res.push_back(res);
+                gcode_res.push_back(std::move(res));
             }
         }
 
         smooth_calculator.smooth_layer_speed();
 
-        tbb::parallel_pipeline(12, calculate_layer_time & write_gocde & output);
+        tbb::parallel_pipeline(12, next_layer & calculate_layer_time & write_gocde & output);
+        BOOST_LOG_TRIVIAL(info) << boost::format("Layer G-code held for smoothing: peak %1% bytes of G-code in memory, %2% layers with %3% bytes spilled, process memory:")
+            % layers_gcode.gcode_bytes_peak() % layers_gcode.spilled_layers() % layers_gcode.spilled_bytes() << log_memory_info();
     }
+    stage_times.log();
+    const AvoidCrossingPerimeters::Stats &travel_stats = m_avoid_crossing_perimeters.stats();
+    BOOST_LOG_TRIVIAL(info) << boost::format("Travels avoiding crossing walls: %1% planned in %2% s, %3% of them taken from the cache")
+        % travel_stats.travels % travel_stats.planning_time % travel_stats.cache_hits;
 }
 
 std::string GCode::placeholder_parser_process(const std::string &name, const std::string &templ, unsigned int current_filament_id, const DynamicConfig *config_override)
@@ -193,6 +193,13 @@ public:
     void            export_layer_filaments(GCodeProcessorResult* result);
     //BBS: set offset for gcode writer
     void set_gcode_offset(double x, double y) { m_writer.set_xy_offset(x, y); m_processor.set_xy_offset(x, y);}
+    // BBS: limit of the layer G-code held in memory for the z direction speed smoothing in bytes, 0 means no limit.
+    // The layers above the limit are spilled to a temporary file.
+    void set_layer_gcode_memory_limit(size_t bytes) { m_layer_gcode_memory_limit = bytes; }
+    // BBS: number of the layers whose travel boundaries are precomputed in parallel ahead of the G-code generation, 0 computes them on demand.
+    void set_travel_boundaries_lookahead(size_t layers) { m_travel_boundaries_lookahead = layers; }
+    // BBS: number of the boundary geometries whose planned travels are cached, 0 disables the cache.
+    void set_travel_cache_size(size_t geometries) { m_avoid_crossing_perimeters.set_travel_cache_size(geometries); }
 
     // Exported for the helper classes (OozePrevention, Wipe) and for the Perl binding for unit tests.
     const Vec2d&    origin() const { return m_origin; }
@@ -545,6 +552,8 @@ private:
     bool                                m_last_scarf_seam_flag;
     std::unique_ptr<GCodeEditor>        m_gcode_editer;
     std::unique_ptr<SpiralVase>         m_spiral_vase;
+    size_t                              m_layer_gcode_memory_limit { 0 };
+    size_t                              m_travel_boundaries_lookahead { 16 };
 #ifdef HAS_PRESSURE_EQUALIZER
     std::unique_ptr<PressureEqualizer>  m_pressure_equalizer;
 #endif /* HAS_PRESSURE_EQUALIZER */
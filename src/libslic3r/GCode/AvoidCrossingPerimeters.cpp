@@ -9,9 +9,14 @@
 #include "../SVG.hpp"
 #include "AvoidCrossingPerimeters.hpp"
 
+#include <chrono>
 #include <numeric>
 #include <unordered_set>
 #include <boost/range/adaptor/reversed.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <tbb/parallel_for.h>
 
 namespace Slic3r {
 
@@ -1326,6 +1331,75 @@ void SaveInitTravelToSVG(const AvoidCrossingPerimeters::Boundary &boundary, cons
 }
 #endif
 
+struct AvoidCrossingPerimeters::TravelCache
+{
+    struct TravelHash {
+        size_t operator()(const std::pair<Point, Point> &travel) const { return PointHash()(travel.first) * 31 + PointHash()(travel.second); }
+    };
+    struct Travel {
+        Polyline path;
+        size_t   intersections;
+    };
+
+    Polygons boundaries;
+    float    perimeter_spacing;
+    size_t   hash;
+    size_t   last_used { 0 };
+    std::unordered_map<std::pair<Point, Point>, Travel, TravelHash> travels;
+};
+
+// Maximum number of the travels cached for a single boundary.
+static constexpr size_t travel_cache_max_travels = 4096;
+
+std::shared_ptr<AvoidCrossingPerimeters::TravelCache> AvoidCrossingPerimeters::travel_cache(const Polygons &boundaries, float perimeter_spacing)
+{
+    size_t hash = std::hash<float>()(perimeter_spacing);
+    for (const Polygon &polygon : boundaries) {
+        boost::hash_combine(hash, polygon.size());
+        for (const Point &point : polygon)
+            boost::hash_combine(hash, PointHash()(point));
+    }
+    ++ m_travel_cache_clock;
+    for (const std::shared_ptr<TravelCache> &cache : m_travel_caches)
+        if (cache->hash == hash && cache->perimeter_spacing == perimeter_spacing && cache->boundaries == boundaries) {
+            cache->last_used = m_travel_cache_clock;
+            return cache;
+        }
+    if (m_travel_caches.size() >= m_travel_cache_size)
+        m_travel_caches.erase(std::min_element(m_travel_caches.begin(), m_travel_caches.end(),
+            [](const std::shared_ptr<TravelCache> &lhs, const std::shared_ptr<TravelCache> &rhs) { return lhs->last_used < rhs->last_used; }));
+    auto cache = std::make_shared<TravelCache>();
+    cache->boundaries        = boundaries;
+    cache->perimeter_spacing = perimeter_spacing;
+    cache->hash              = hash;
+    cache->last_used         = m_travel_cache_clock;
+    m_travel_caches.emplace_back(cache);
+    return cache;
+}
+
+size_t AvoidCrossingPerimeters::plan_travel(const Boundary &boundary, std::shared_ptr<TravelCache> &cache, const Point &start, const Point &end, const Layer &layer, Polyline &result_out)
+{
+    auto   start_time = std::chrono::steady_clock::now();
+    size_t intersections;
+    ++ m_stats.travels;
+    if (! cache && m_travel_cache_size > 0)
+        cache = this->travel_cache(boundary.boundaries, get_perimeter_spacing(layer));
+    if (! cache) {
+        intersections = avoid_perimeters(boundary, start, end, layer, result_out);
+    } else if (auto it = cache->travels.find({ start, end }); it != cache->travels.end()) {
+        result_out    = it->second.path;
+        intersections = it->second.intersections;
+        ++ m_stats.cache_hits;
+    } else {
+        intersections = avoid_perimeters(boundary, start, end, layer, result_out);
+        if (cache->travels.size() >= travel_cache_max_travels)
+            cache->travels.clear();
+        cache->travels.insert({ { start, end }, { result_out, intersections } });
+    }
+    m_stats.planning_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    return intersections;
+}
+
 // Plan travel, which avoids perimeter crossings by following the boundaries of the layer.
 Polyline AvoidCrossingPerimeters::travel_to(const GCode &gcodegen, const Point &point, bool *could_be_wipe_disabled)
 {
@@ -1345,38 +1419,41 @@ Polyline AvoidCrossingPerimeters::travel_to(const GCode &gcodegen, const Point &
     const std::vector<BoundingBox> &lslices_bboxes   = gcodegen.layer()->lslices_bboxes;
     bool                            is_support_layer = (dynamic_cast<const SupportLayer *>(gcodegen.layer()) != nullptr);
     bool                            include_supports_in_boundary = gcodegen.config().avoid_crossing_wall_includes_support;
-    if (!use_external && (is_support_layer || (!m_lslices_offset.empty() && !any_expolygon_contains(m_lslices_offset, m_lslices_offset_bboxes, m_grid_lslice, travel)))) {
-        // Initialize m_internal only when it is necessary.
-        if (m_internal.boundaries.empty()) {
-            init_boundary(&m_internal, to_polygons(get_boundary(*gcodegen.layer(), get_perimeter_spacing(*gcodegen.layer()), include_supports_in_boundary)), {start, end});
-        } else if (!(m_internal.bbox.contains(startf) && m_internal.bbox.contains(endf))) {
+    const LayerBoundaries          &layer_boundaries = *m_layer_boundaries;
+    if (!use_external && (is_support_layer || (!layer_boundaries.lslices_offset.empty() &&
+        !any_expolygon_contains(layer_boundaries.lslices_offset, layer_boundaries.lslices_offset_bboxes, layer_boundaries.grid_lslice, travel)))) {
+        // Use the precomputed boundary if it covers the travel, otherwise initialize m_internal only when it is necessary.
+        const Boundary *internal = layer_boundaries.internal.get();
+        if (internal == nullptr || !(internal->boundaries.empty() || (internal->bbox.contains(startf) && internal->bbox.contains(endf)))) {
             // check if start and end are in bbox, if not, merge start and end points to bbox
-            m_internal.clear();
-            init_boundary(&m_internal, to_polygons(get_boundary(*gcodegen.layer(), get_perimeter_spacing(*gcodegen.layer()), include_supports_in_boundary)), {start, end});
+            if (m_internal.boundaries.empty() || !(m_internal.bbox.contains(startf) && m_internal.bbox.contains(endf)))
+                init_boundary(&m_internal, internal ? Polygons(internal->boundaries) :
+                    to_polygons(get_boundary(*gcodegen.layer(), get_perimeter_spacing(*gcodegen.layer()), include_supports_in_boundary)), {start, end});
+            internal = &m_internal;
         }
 
-        if (!m_internal.boundaries.empty()) {
-            travel_intersection_count = avoid_perimeters(m_internal, start, end, *gcodegen.layer(), result_pl);
+        if (!internal->boundaries.empty()) {
+            travel_intersection_count = this->plan_travel(*internal, m_internal_cache, start, end, *gcodegen.layer(), result_pl);
             result_pl.points.front()  = start;
             result_pl.points.back()   = end;
         }
     } else if (use_external) {
-        // Initialize m_external only when exist any external travel for the current layer.
-        if (m_external.boundaries.empty()) {
-            init_boundary(&m_external, get_boundary_external(*gcodegen.layer(), include_supports_in_boundary), {start, end});
-        } else if (!(m_external.bbox.contains(startf) && m_external.bbox.contains(endf))) {
+        // Initialize m_external only when exist any external travel for the current layer and the precomputed boundary does not cover it.
+        const Boundary *external = layer_boundaries.external.get();
+        if (external == nullptr || !(external->boundaries.empty() || (external->bbox.contains(startf) && external->bbox.contains(endf)))) {
             // check if start and end are in bbox
-            m_external.clear();
-            init_boundary(&m_external, get_boundary_external(*gcodegen.layer(), include_supports_in_boundary), {start, end});
+            if (m_external.boundaries.empty() || !(m_external.bbox.contains(startf) && m_external.bbox.contains(endf)))
+                init_boundary(&m_external, external ? Polygons(external->boundaries) :
+                    get_boundary_external(*gcodegen.layer(), include_supports_in_boundary), {start, end});
+            external = &m_external;
         }
-        
+
         // Trim the travel line by the bounding box.
-        if (!m_external.boundaries.empty()) 
+        if (!external->boundaries.empty())
         {
-            travel_intersection_count = avoid_perimeters(m_external, start, end, *gcodegen.layer(), result_pl);
+            travel_intersection_count = this->plan_travel(*external, m_external_cache, start, end, *gcodegen.layer(), result_pl);
             result_pl.points.front()  = start;
             result_pl.points.back()   = end;
-            
         }
     }
 
@@ -1406,33 +1483,85 @@ Polyline AvoidCrossingPerimeters::travel_to(const GCode &gcodegen, const Point &
     } else if (max_detour_length_exceeded) {
         *could_be_wipe_disabled = false;
     } else
-        *could_be_wipe_disabled = !need_wipe(gcodegen, m_lslices_offset, m_lslices_offset_bboxes, m_grid_lslice, travel, result_pl, travel_intersection_count);
+        *could_be_wipe_disabled = !need_wipe(gcodegen, layer_boundaries.lslices_offset, layer_boundaries.lslices_offset_bboxes, layer_boundaries.grid_lslice, travel, result_pl, travel_intersection_count);
 
     return result_pl;
 }
 
 // ************************************* AvoidCrossingPerimeters::init_layer() *****************************************
 
-void AvoidCrossingPerimeters::init_layer(const Layer &layer)
+static void init_layer_lslices(AvoidCrossingPerimeters::LayerBoundaries &out, const Layer &layer)
 {
-    m_internal.clear();
-    m_external.clear();
-
-    m_lslices_offset.clear();
-    m_lslices_offset_bboxes.clear();
     for (auto coeff : {0.6f, 0.5f, 0.45f}) {
-        m_lslices_offset = offset_ex(layer.lslices, -get_external_perimeter_width(layer) * coeff);
-        if (!m_lslices_offset.empty()) break;
-    }    
-    m_lslices_offset_bboxes.reserve(m_lslices_offset.size());
-    for (const auto &ex_polygon : m_lslices_offset) m_lslices_offset_bboxes.emplace_back(get_extents(ex_polygon));
+        out.lslices_offset = offset_ex(layer.lslices, -get_external_perimeter_width(layer) * coeff);
+        if (!out.lslices_offset.empty()) break;
+    }
+    out.lslices_offset_bboxes.reserve(out.lslices_offset.size());
+    for (const auto &ex_polygon : out.lslices_offset) out.lslices_offset_bboxes.emplace_back(get_extents(ex_polygon));
 
     BoundingBox bbox_slice(get_extents(layer.lslices));
     bbox_slice.offset(SCALED_EPSILON);
 
-    m_grid_lslice.set_bbox(bbox_slice);
+    out.grid_lslice.set_bbox(bbox_slice);
     //FIXME 1mm grid?
-    m_grid_lslice.create(m_lslices_offset, coord_t(scale_(1.)));
+    out.grid_lslice.create(out.lslices_offset, coord_t(scale_(1.)));
+}
+
+void AvoidCrossingPerimeters::init_layer(const Layer &layer)
+{
+    m_internal.clear();
+    m_external.clear();
+
+    if (auto it = m_precomputed_layers.find(&layer); it != m_precomputed_layers.end()) {
+        // The instances of an object share the precomputed boundaries and thus the travel caches.
+        if (m_layer_boundaries != it->second) {
+            m_layer_boundaries = it->second;
+            m_internal_cache.reset();
+            m_external_cache.reset();
+        }
+        return;
+    }
+    m_internal_cache.reset();
+    m_external_cache.reset();
+    auto layer_boundaries = std::make_shared<LayerBoundaries>();
+    init_layer_lslices(*layer_boundaries, layer);
+    m_layer_boundaries = std::move(layer_boundaries);
+}
+
+void AvoidCrossingPerimeters::precompute_layers(const std::vector<const Layer*> &layers, bool include_supports_in_boundary, bool external)
+{
+    std::unordered_map<const Layer*, std::shared_ptr<const LayerBoundaries>> precomputed;
+    std::vector<std::pair<const Layer*, std::shared_ptr<LayerBoundaries>>>  to_compute;
+    for (const Layer *layer : layers)
+        if (layer != nullptr && precomputed.find(layer) == precomputed.end()) {
+            if (auto it = m_precomputed_layers.find(layer); it != m_precomputed_layers.end())
+                precomputed.emplace(layer, it->second);
+            else {
+                to_compute.emplace_back(layer, std::make_shared<LayerBoundaries>());
+                precomputed.emplace(layer, to_compute.back().second);
+            }
+        }
+    // Release the layers out of the lookahead before computing the new ones.
+    m_precomputed_layers = std::move(precomputed);
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, to_compute.size()), [&to_compute, include_supports_in_boundary, external](const tbb::blocked_range<size_t> &range) {
+        for (size_t idx = range.begin(); idx < range.end(); ++ idx) {
+            const Layer     &layer = *to_compute[idx].first;
+            LayerBoundaries &out   = *to_compute[idx].second;
+            init_layer_lslices(out, layer);
+            // The boundaries do not depend on the travel, only their bounding boxes do, see travel_to().
+            out.internal = std::make_unique<Boundary>();
+            if (Polygons internal = to_polygons(get_boundary(layer, get_perimeter_spacing(layer), include_supports_in_boundary)); ! internal.empty())
+                init_boundary(out.internal.get(), std::move(internal), {});
+            // Without the external boundary travel_to() builds it on the first external travel of the layer.
+            if (external) {
+                out.external = std::make_unique<Boundary>();
+                if (Polygons external_boundary = get_boundary_external(layer, include_supports_in_boundary); ! external_boundary.empty())
+                    init_boundary(out.external.get(), std::move(external_boundary), {});
+            }
+        }
+    });
+    BOOST_LOG_TRIVIAL(trace) << "AvoidCrossingPerimeters: precomputed the boundaries of " << to_compute.size() << " layers, " << m_precomputed_layers.size() << " layers held";
 }
 
 #if 0
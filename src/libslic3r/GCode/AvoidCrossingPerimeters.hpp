@@ -5,6 +5,10 @@
 #include "../ExPolygon.hpp"
 #include "../EdgeGrid.hpp"
 
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 namespace Slic3r {
 
 // Forward declarations.
@@ -24,7 +28,18 @@ public:
     bool        disabled_once() const   { return m_disabled_once; }
     void        reset_once_modifiers()  { m_use_external_mp_once = false; m_disabled_once = false; }
 
+    // Uses the boundaries precomputed by precompute_layers() if there are any for the layer.
     void        init_layer(const Layer &layer);
+    // BBS: compute the boundaries of the layers in parallel ahead of the G-code generation, so that the travels only query them.
+    // The boundaries precomputed before for other layers are released, thus the memory is bounded by the number of the layers passed.
+    // The boundary around the objects is only precomputed with external set, that is if there are travels between objects or instances,
+    // otherwise it is built on the first travel using it.
+    void        precompute_layers(const std::vector<const Layer*> &layers, bool include_supports_in_boundary, bool external);
+    void        clear_precomputed_layers() { m_precomputed_layers.clear(); }
+    // BBS: the travels planned around a boundary are cached for the travels with the same end points around the same boundary,
+    // that is for the instances of an object, as the travels inside an object are planned in its coordinates, and for the layers
+    // with the same geometry. The travels of at most geometries boundaries are held, 0 disables the cache.
+    void        set_travel_cache_size(size_t geometries) { m_travel_cache_size = geometries; m_travel_caches.clear(); }
 
     Polyline    travel_to(const GCode& gcodegen, const Point& point)
     {
@@ -34,6 +49,14 @@ public:
 
     Polyline    travel_to(const GCode& gcodegen, const Point& point, bool* could_be_wipe_disabled);
 
+    struct Stats {
+        size_t travels     { 0 };
+        size_t cache_hits  { 0 };
+        // Time spent planning the travels around the boundaries in seconds.
+        double planning_time { 0. };
+    };
+    const Stats& stats() const { return m_stats; }
+
     struct Boundary {
         // Collection of boundaries used for detection of crossing perimeters for travels
         Polygons                        boundaries;
@@ -51,7 +74,25 @@ public:
         }
     };
 
+    // Boundaries of a single layer, which depend on the layer only.
+    struct LayerBoundaries {
+        // Lslices offseted by half an external perimeter width. Used for detection if line or polyline is inside of any polygon.
+        ExPolygons               lslices_offset;
+        std::vector<BoundingBox> lslices_offset_bboxes;
+        // Used for detection of line or polyline is inside of any polygon.
+        EdgeGrid::Grid           grid_lslice;
+        // Boundaries for travels inside / outside object, null if not precomputed.
+        // Their grids cover the boundaries with a margin of the bounding box radius.
+        std::unique_ptr<Boundary> internal;
+        std::unique_ptr<Boundary> external;
+    };
+
 private:
+    struct TravelCache;
+    std::shared_ptr<TravelCache> travel_cache(const Polygons &boundaries, float perimeter_spacing);
+    // Plan the travel around the boundary, through the cache of the boundary, which is looked up on the first travel.
+    size_t         plan_travel(const Boundary &boundary, std::shared_ptr<TravelCache> &cache, const Point &start, const Point &end, const Layer &layer, Polyline &result_out);
+
     bool           m_use_external_mp { false };
     // just for the next travel move
     bool           m_use_external_mp_once { false };
@@ -59,15 +100,20 @@ private:
     // we enable it by default for the first travel move in print
     bool           m_disabled_once { true };
 
-    // Lslices offseted by half an external perimeter width. Used for detection if line or polyline is inside of any polygon.
-    ExPolygons               m_lslices_offset;
-    std::vector<BoundingBox> m_lslices_offset_bboxes;
-    // Used for detection of line or polyline is inside of any polygon.
-    EdgeGrid::Grid m_grid_lslice;
-    // Store all needed data for travels inside object
+    // Boundaries of the current layer.
+    std::shared_ptr<const LayerBoundaries> m_layer_boundaries { std::make_shared<LayerBoundaries>() };
+    std::unordered_map<const Layer*, std::shared_ptr<const LayerBoundaries>> m_precomputed_layers;
+    // Store all needed data for travels inside object, if the precomputed boundary does not cover the travel.
     Boundary m_internal;
-    // Store all needed data for travels outside object
+    // Store all needed data for travels outside object, if the precomputed boundary does not cover the travel.
     Boundary m_external;
+    // Travels around the boundaries of the current layer and of the recently used layer geometries.
+    std::shared_ptr<TravelCache>              m_internal_cache;
+    std::shared_ptr<TravelCache>              m_external_cache;
+    std::vector<std::shared_ptr<TravelCache>> m_travel_caches;
+    size_t                                    m_travel_cache_size { 32 };
+    size_t                                    m_travel_cache_clock { 0 };
+    Stats                                     m_stats;
 };
 
 } // namespace Slic3r
@@ -3,6 +3,7 @@
 #include <tbb/parallel_for.h>
 #include <tbb/concurrent_vector.h>
 
+#include <algorithm>
 #include <map>
 #include <functional>
 #include <atomic>
@@ -87,6 +88,82 @@ inline Grids line_rasterization(const Line &line, int64_t xdist = RasteXDistance
 
     return res;
 }
+
+// BBS: open addressing hash grid from the cells to the lines crossing them. The lines of a cell are chained through
+// a flat array in the order of insertion, thus there is no node allocated per cell nor per line.
+class LineGrid
+{
+public:
+    explicit LineGrid(size_t num_lines)
+    {
+        size_t capacity = 64;
+        while (capacity < num_lines * 4) capacity *= 2;
+        m_cells.assign(capacity, Cell());
+        m_entries.reserve(num_lines * 2);
+    }
+
+    // First entry of the cell, -1 if the cell is empty.
+    int first(const IndexPair &cell) const
+    {
+        const Cell &c = m_cells[this->slot(cell)];
+        return c.first;
+    }
+    int next(int entry) const { return m_entries[entry].next; }
+    int line(int entry) const { return m_entries[entry].line; }
+
+    void insert(const IndexPair &cell, int line)
+    {
+        if ((m_num_cells + 1) * 2 > m_cells.size())
+            this->grow();
+        Cell &c = m_cells[this->slot(cell)];
+        int entry = int(m_entries.size());
+        m_entries.push_back({ line, -1 });
+        if (c.first == -1) {
+            c.key   = cell;
+            c.first = entry;
+            ++ m_num_cells;
+        } else
+            m_entries[c.last].next = entry;
+        c.last = entry;
+    }
+
+private:
+    struct Cell
+    {
+        IndexPair key;
+        int       first { -1 };
+        int       last  { -1 };
+    };
+    struct Entry
+    {
+        int line;
+        int next;
+    };
+
+    // Slot holding the cell or the empty slot where it is to be inserted, linear probing.
+    size_t slot(const IndexPair &cell) const
+    {
+        uint64_t h = uint64_t(cell.first) * 0x9e3779b97f4a7c15ull ^ uint64_t(cell.second) * 0xc2b2ae3d27d4eb4full;
+        h ^= h >> 29;
+        const size_t mask = m_cells.size() - 1;
+        for (size_t i = size_t(h) & mask;; i = (i + 1) & mask)
+            if (m_cells[i].first == -1 || m_cells[i].key == cell)
+                return i;
+    }
+
+    void grow()
+    {
+        std::vector<Cell> cells(m_cells.size() * 2);
+        std::swap(cells, m_cells);
+        for (const Cell &c : cells)
+            if (c.first != -1)
+                m_cells[this->slot(c.key)] = c;
+    }
+
+    std::vector<Cell>  m_cells;
+    std::vector<Entry> m_entries;
+    size_t             m_num_cells { 0 };
+};
 } // namespace RasterizationImpl
 
 void LinesBucketQueue::emplace_back_bucket(ExtrusionLayers &&els, const void *objPtr, Point offset)
@@ -130,11 +207,32 @@ float LinesBucketQueue::getCurrBottomZ()
     return layerBottomZ;
 }
 
+size_t LinesBucketQueue::excludeIsolatedBuckets()
+{
+    std::vector<BoundingBox> bboxes(line_buckets.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, line_buckets.size()), [this, &bboxes](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++i) {
+            bboxes[i] = line_buckets[i].boundingBox();
+            // Intersections are computed with a tolerance.
+            if (bboxes[i].defined) bboxes[i].offset(SCALED_EPSILON);
+        }
+    });
+    std::vector<const void *> checked;
+    for (size_t i = 0; i < line_buckets.size(); ++i) {
+        bool touching = false;
+        for (size_t j = 0; j < line_buckets.size() && !touching; ++j)
+            touching = line_buckets[i]._id != line_buckets[j]._id && bboxes[i].defined && bboxes[j].defined && bboxes[i].overlap(bboxes[j]);
+        line_buckets[i]._checked = touching;
+        if (touching && std::find(checked.begin(), checked.end(), line_buckets[i]._id) == checked.end()) checked.push_back(line_buckets[i]._id);
+    }
+    return checked.size();
+}
+
 LineWithIDs LinesBucketQueue::getCurLines() const
 {
     LineWithIDs lines;
     for (const LinesBucket &bucket : line_buckets) {
-        if (bucket.valid()) {
+        if (bucket.valid() && bucket._checked) {
             LineWithIDs tmpLines = bucket.curLines();
             lines.insert(lines.end(), tmpLines.begin(), tmpLines.end());
         }
@@ -203,18 +301,60 @@ ObjectExtrusions getAllLayersExtrusionPathsFromObject(PrintObject *obj)
 ConflictComputeOpt ConflictChecker::find_inter_of_lines(const LineWithIDs &lines)
 {
     using namespace RasterizationImpl;
-    std::map<IndexPair, std::vector<int>> indexToLine;
 
-    for (int i = 0; i < lines.size(); ++i) {
+    // BBS: broad phase, a line may only conflict with the lines of another object if it touches their bounding box.
+    // The lines of an object mostly follow each other, the object of the previous line is looked at first.
+    struct ObjectBox
+    {
+        const void *             id;
+        BoundingBox              bbox;
+        std::vector<BoundingBox> others;
+    };
+    std::vector<ObjectBox> objects;
+    auto find_object = [&objects](size_t current, const void *id) {
+        return current < objects.size() && objects[current].id == id ?
+            current : size_t(std::find_if(objects.begin(), objects.end(), [id](const ObjectBox &o) { return o.id == id; }) - objects.begin());
+    };
+    size_t current = 0;
+    for (const LineWithID &l : lines) {
+        current = find_object(current, l._id);
+        if (current == objects.size()) objects.push_back({ l._id, BoundingBox(), {} });
+        objects[current].bbox.merge(l._line.a);
+        objects[current].bbox.merge(l._line.b);
+    }
+    if (objects.size() < 2) return {};
+    for (ObjectBox &o : objects) o.bbox.offset(SCALED_EPSILON);
+    for (ObjectBox &o : objects)
+        for (const ObjectBox &other : objects)
+            if (&other != &o && o.bbox.overlap(other.bbox)) o.others.push_back(other.bbox);
+
+    std::vector<int> candidates;
+    candidates.reserve(lines.size());
+    current = 0;
+    for (int i = 0; i < int(lines.size()); ++i) {
+        const LineWithID &l = lines[i];
+        current             = find_object(current, l._id);
+        BoundingBox line_bbox;
+        line_bbox.merge(l._line.a);
+        line_bbox.merge(l._line.b);
+        for (const BoundingBox &other : objects[current].others)
+            if (line_bbox.overlap(other)) {
+                candidates.push_back(i);
+                break;
+            }
+    }
+
+    // Narrow phase on the remaining lines, in their original order.
+    LineGrid grid(candidates.size());
+    for (int i : candidates) {
         const LineWithID &l1      = lines[i];
         auto              indexes = line_rasterization(l1._line);
         for (auto index : indexes) {
-            const auto &possibleIntersectIdxs = indexToLine[index];
-            for (auto possibleIntersectIdx : possibleIntersectIdxs) {
-                const LineWithID &l2 = lines[possibleIntersectIdx];
+            for (int entry = grid.first(index); entry != -1; entry = grid.next(entry)) {
+                const LineWithID &l2 = lines[grid.line(entry)];
                 if (auto interRes = line_intersect(l1, l2); interRes.has_value()) { return interRes; }
             }
-            indexToLine[index].push_back(i);
+            grid.insert(index, i);
         }
     }
     return {};
@@ -244,6 +384,8 @@ ConflictResultOpt ConflictChecker::find_inter_of_lines_in_diff_objs(PrintObjectP
         conflictQueue.emplace_back_bucket(std::move(layers.perimeters), obj, obj->instances().front().shift);
         conflictQueue.emplace_back_bucket(std::move(layers.support), obj, obj->instances().front().shift);
     }
+    // BBS: objects far from all the other objects are not rasterized at all.
+    if (conflictQueue.excludeIsolatedBuckets() < 2) { return {}; }
 
     std::vector<LineWithIDs> layersLines;
     std::vector<float>       bottomZs;
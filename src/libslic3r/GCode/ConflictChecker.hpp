@@ -60,6 +60,8 @@ public:
     ExtrusionLayers _piles;
     const void*     _id;
     Point           _offset;
+    // BBS: false if the object cannot touch any other object, then its lines are not checked.
+    bool            _checked = true;
 
 public:
     LinesBucket(ExtrusionLayers &&paths, const void* id, Point offset) : _piles(paths), _id(id), _offset(offset) {}
@@ -80,6 +82,17 @@ public:
         _curBottomZ = _curPileIdx == _piles.size() ? _piles.back().bottom_z : _piles[_curPileIdx].bottom_z;
     }
     float curBottomZ() const { return _curBottomZ; }
+    // Bounding box of the lines of all layers, shifted by _offset.
+    BoundingBox boundingBox() const
+    {
+        BoundingBox bbox;
+        for (const ExtrusionLayer &layer : _piles)
+            for (const ExtrusionPath &path : layer.paths)
+                if (path.is_force_no_extrusion() == false)
+                    for (const Point &pt : path.polyline.points) bbox.merge(pt);
+        if (bbox.defined) bbox.translate(_offset.x(), _offset.y());
+        return bbox;
+    }
     LineWithIDs curLines() const
     {
         auto [b, e] = curRange();
@@ -115,6 +128,9 @@ public:
 
 public:
     void        emplace_back_bucket(ExtrusionLayers &&els, const void *objPtr, Point offset);
+    // Disable the buckets whose bounding box does not overlap the bounding box of any other object,
+    // returns the number of objects left to be checked.
+    size_t      excludeIsolatedBuckets();
     bool        valid() const { return line_bucket_ptr_queue.empty() == false; }
     float       getCurrBottomZ();
     LineWithIDs getCurLines() const;
@@ -12,10 +12,15 @@
 #include <boost/nowide/cstdio.hpp>
 #include <boost/filesystem/path.hpp>
 
+#include <tbb/parallel_for.h>
+
 #include <fast_float/fast_float.h>
 
 #include <float.h>
 #include <assert.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <regex>
 
 #if __has_include(<charconv>)
@@ -317,7 +322,11 @@ void GCodeProcessor::TimeMachine::reset()
     curr.reset();
     prev.reset();
     gcode_time.reset();
-    blocks = std::vector<TimeBlock>();
+    // BBS: the planner queue is flushed every Planner::refresh_threshold blocks, keep its memory for the whole processing.
+    blocks.clear();
+    blocks.reserve(TimeProcessor::Planner::refresh_threshold + 1);
+    skippable_times.clear();
+    planning_time = 0.;
     g1_times_cache = std::vector<G1LinesCacheItem>();
     std::fill(moves_time.begin(), moves_time.end(), 0.0f);
     std::fill(roles_time.begin(), roles_time.end(), 0.0f);
@@ -326,14 +335,6 @@ void GCodeProcessor::TimeMachine::reset()
     m_additional_time_buffer.clear();
 }
 
-void GCodeProcessor::TimeMachine::simulate_st_synchronize(float additional_time, ExtrusionRole target_role, block_handler_t block_handler)
-{
-    if (!enabled)
-        return;
-
-    calculate_time(0, additional_time,target_role,block_handler);
-}
-
 static void planner_forward_pass_kernel(GCodeProcessor::TimeBlock& prev, GCodeProcessor::TimeBlock& curr)
 {
     // If the previous block is an acceleration block, but it is not long enough to complete the
@@ -407,8 +408,9 @@ static void recalculate_trapezoids(std::vector<GCodeProcessor::TimeBlock>& block
 
 void GCodeProcessor::TimeMachine::handle_time_block(const TimeBlock& block, float time, int activate_machine_idx, GCodeProcessorResult& result)
 {
+    // The machines may be planned concurrently, the skippable times are summed up by calculate_time_blocks().
     if (block.skippable_type != SkipType::stNone)
-        result.skippable_part_time[block.skippable_type] += block.time();
+        skippable_times.emplace_back(block.skippable_type, block.time());
     result.moves[block.move_id].time[activate_machine_idx] = time;
 }
 
@@ -1423,6 +1425,7 @@ void GCodeProcessorResult::reset() {
     lock();
 
     moves = std::vector<GCodeProcessorResult::MoveVertex>();
+    compacted_moves.clear();
     printable_area = Pointfs();
     //BBS: add bed exclude area
     bed_exclude_area = Pointfs();
@@ -1451,6 +1454,7 @@ void GCodeProcessorResult::reset() {
     lock();
 
     moves.clear();
+    compacted_moves.clear();
     lines_ends.clear();
     printable_area = Pointfs();
     //BBS: add bed exclude area
@@ -1486,6 +1490,179 @@ void GCodeProcessorResult::reset() {
 }
 #endif // ENABLE_GCODE_VIEWER_STATISTICS
 
+template<typename T>
+void GCodeProcessorResult::CompactMoves::RunColumn<T>::push_back(const T &value, size_t idx)
+{
+    // Bitwise comparison keeps the runs lossless, -0.f and NaN included.
+    if (values.empty() || std::memcmp(&values.back(), &value, sizeof(T)) != 0) {
+        values.emplace_back(value);
+        starts.emplace_back(uint32_t(idx));
+    }
+}
+
+template<typename T>
+size_t GCodeProcessorResult::CompactMoves::RunColumn<T>::run(size_t idx) const
+{
+    assert(! starts.empty() && starts.front() == 0);
+    return size_t(std::upper_bound(starts.begin(), starts.end(), uint32_t(idx)) - starts.begin()) - 1;
+}
+
+template<typename Self, typename Fn>
+void GCodeProcessorResult::CompactMoves::visit_runs(Self &self, Fn &&fn)
+{
+    fn(self.m_type,               &MoveVertex::type);
+    fn(self.m_extrusion_role,     &MoveVertex::extrusion_role);
+    fn(self.m_move_path_type,     &MoveVertex::move_path_type);
+    fn(self.m_extruder_id,        &MoveVertex::extruder_id);
+    fn(self.m_cp_color_id,        &MoveVertex::cp_color_id);
+    fn(self.m_feedrate,           &MoveVertex::feedrate);
+    fn(self.m_width,              &MoveVertex::width);
+    fn(self.m_height,             &MoveVertex::height);
+    fn(self.m_mm3_per_mm,         &MoveVertex::mm3_per_mm);
+    fn(self.m_fan_speed,          &MoveVertex::fan_speed);
+    fn(self.m_temperature,        &MoveVertex::temperature);
+    fn(self.m_layer_duration,     &MoveVertex::layer_duration);
+    fn(self.m_thermal_index_min,  &MoveVertex::thermal_index_min);
+    fn(self.m_thermal_index_max,  &MoveVertex::thermal_index_max);
+    fn(self.m_thermal_index_mean, &MoveVertex::thermal_index_mean);
+    fn(self.m_object_label_id,    &MoveVertex::object_label_id);
+    fn(self.m_print_z,            &MoveVertex::print_z);
+}
+
+void GCodeProcessorResult::CompactMoves::assign(const std::vector<MoveVertex> &moves)
+{
+    assert(moves.size() < size_t(std::numeric_limits<uint32_t>::max()));
+    this->clear();
+    m_gcode_id.reserve(moves.size());
+    m_delta_extruder.reserve(moves.size());
+    m_time.reserve(moves.size());
+    m_position.reserve(moves.size());
+    for (size_t idx = 0; idx < moves.size(); ++ idx) {
+        const MoveVertex &move = moves[idx];
+        visit_runs(*this, [&move, idx](auto &column, auto member) { column.push_back(move.*member, idx); });
+        m_gcode_id.emplace_back(move.gcode_id);
+        m_delta_extruder.emplace_back(move.delta_extruder);
+        m_time.emplace_back(move.time);
+        m_position.emplace_back(move.position);
+        if (move.arc_center_position != Vec3f::Zero() || ! move.interpolation_points.empty()) {
+            m_arc_moves.emplace_back(uint32_t(idx));
+            m_arc_center_position.emplace_back(move.arc_center_position);
+            m_interpolation_starts.emplace_back(uint32_t(m_interpolation_points.size()));
+            m_interpolation_points.insert(m_interpolation_points.end(), move.interpolation_points.begin(), move.interpolation_points.end());
+        }
+    }
+    m_interpolation_starts.emplace_back(uint32_t(m_interpolation_points.size()));
+    visit_runs(*this, [](auto &column, auto) { column.values.shrink_to_fit(); column.starts.shrink_to_fit(); });
+    m_arc_moves.shrink_to_fit();
+    m_arc_center_position.shrink_to_fit();
+    m_interpolation_starts.shrink_to_fit();
+    m_interpolation_points.shrink_to_fit();
+}
+
+void GCodeProcessorResult::CompactMoves::clear()
+{
+    visit_runs(*this, [](auto &column, auto) { column.clear(); });
+    m_gcode_id             = std::vector<unsigned int>();
+    m_delta_extruder       = std::vector<float>();
+    m_time                 = std::vector<std::array<float, 2>>();
+    m_position             = std::vector<Vec3f>();
+    m_arc_moves            = std::vector<uint32_t>();
+    m_arc_center_position  = std::vector<Vec3f>();
+    m_interpolation_starts = std::vector<uint32_t>();
+    m_interpolation_points = std::vector<Vec3f>();
+}
+
+GCodeProcessorResult::MoveVertex GCodeProcessorResult::CompactMoves::operator[](size_t idx) const
+{
+    assert(idx < this->size());
+    Cursor cursor(*this, idx);
+    return *cursor;
+}
+
+std::vector<GCodeProcessorResult::MoveVertex> GCodeProcessorResult::CompactMoves::to_vector() const
+{
+    std::vector<MoveVertex> moves;
+    moves.reserve(this->size());
+    for (Cursor cursor(*this, 0); cursor.valid(); cursor.next())
+        moves.emplace_back(*cursor);
+    return moves;
+}
+
+size_t GCodeProcessorResult::CompactMoves::memory_size() const
+{
+    size_t size = 0;
+    visit_runs(*this, [&size](const auto &column, auto) { size += column.memory_size(); });
+    return size + SLIC3R_STDVEC_MEMSIZE(m_gcode_id, unsigned int) + SLIC3R_STDVEC_MEMSIZE(m_delta_extruder, float) +
+        m_time.capacity() * sizeof(std::array<float, 2>) + SLIC3R_STDVEC_MEMSIZE(m_position, Vec3f) +
+        SLIC3R_STDVEC_MEMSIZE(m_arc_moves, uint32_t) + SLIC3R_STDVEC_MEMSIZE(m_arc_center_position, Vec3f) +
+        SLIC3R_STDVEC_MEMSIZE(m_interpolation_starts, uint32_t) + SLIC3R_STDVEC_MEMSIZE(m_interpolation_points, Vec3f);
+}
+
+GCodeProcessorResult::CompactMoves::Cursor::Cursor(const CompactMoves &moves, size_t idx) :
+    m_moves(moves), m_idx(idx)
+{
+    if (! this->valid())
+        return;
+    size_t column_idx = 0;
+    visit_runs(m_moves, [this, &column_idx](const auto &column, auto member) {
+        size_t run = column.run(m_idx);
+        m_runs[column_idx ++] = run;
+        m_move.*member = column.values[run];
+    });
+    m_arc = size_t(std::lower_bound(m_moves.m_arc_moves.begin(), m_moves.m_arc_moves.end(), uint32_t(m_idx)) - m_moves.m_arc_moves.begin());
+    this->load_per_move();
+}
+
+void GCodeProcessorResult::CompactMoves::Cursor::next()
+{
+    if (++ m_idx >= m_moves.size())
+        return;
+    size_t column_idx = 0;
+    visit_runs(m_moves, [this, &column_idx](const auto &column, auto member) {
+        size_t &run = m_runs[column_idx ++];
+        if (run + 1 < column.starts.size() && column.starts[run + 1] == m_idx)
+            m_move.*member = column.values[++ run];
+    });
+    this->load_per_move();
+}
+
+void GCodeProcessorResult::CompactMoves::Cursor::load_per_move()
+{
+    m_move.gcode_id       = m_moves.m_gcode_id[m_idx];
+    m_move.delta_extruder = m_moves.m_delta_extruder[m_idx];
+    m_move.time           = m_moves.m_time[m_idx];
+    m_move.position       = m_moves.m_position[m_idx];
+    if (m_arc < m_moves.m_arc_moves.size() && m_moves.m_arc_moves[m_arc] == m_idx) {
+        m_move.arc_center_position = m_moves.m_arc_center_position[m_arc];
+        m_move.interpolation_points.assign(m_moves.m_interpolation_points.begin() + m_moves.m_interpolation_starts[m_arc],
+                                           m_moves.m_interpolation_points.begin() + m_moves.m_interpolation_starts[m_arc + 1]);
+        ++ m_arc;
+    } else {
+        m_move.arc_center_position = Vec3f::Zero();
+        m_move.interpolation_points.clear();
+    }
+}
+
+void GCodeProcessorResult::compact_moves()
+{
+    std::lock_guard<std::mutex> lock(result_mutex);
+    if (moves.empty())
+        return;
+    size_t moves_size = SLIC3R_STDVEC_MEMSIZE(moves, MoveVertex);
+    compacted_moves.assign(moves);
+    moves = std::vector<MoveVertex>();
+    BOOST_LOG_TRIVIAL(info) << boost::format("compacted %1% moves from %2% to %3% bytes") % compacted_moves.size() % moves_size % compacted_moves.memory_size();
+}
+
+void GCodeProcessorResult::expand_moves()
+{
+    std::lock_guard<std::mutex> lock(result_mutex);
+    if (compacted_moves.empty())
+        return;
+    moves = compacted_moves.to_vector();
+    compacted_moves.clear();
+}
+
 const std::vector<std::pair<GCodeProcessor::EProducer, std::string>> GCodeProcessor::Producers = {
     //BBS: BambuStudio is also "bambu". Otherwise the time estimation didn't work.
     //FIXME: Workaround and should be handled when do removing-bambu
@@ -2469,7 +2646,7 @@ void GCodeProcessor::process_file(const std::string& filename, std::function<voi
     // 1st move must be a dummy move
     m_result.moves.emplace_back(GCodeProcessorResult::MoveVertex());
     size_t parse_line_callback_cntr = 10000;
-    m_parser.parse_file(filename, [this, cancel_callback, &parse_line_callback_cntr](GCodeReader& reader, const GCodeReader::GCodeLine& line) {
+    auto   parse_line_callback = [this, cancel_callback, &parse_line_callback_cntr](GCodeReader& reader, const GCodeReader::GCodeLine& line) {
         if (-- parse_line_callback_cntr == 0) {
             // Don't call the cancel_callback() too often, do it every at every 10000'th line.
             parse_line_callback_cntr = 10000;
@@ -2477,7 +2654,12 @@ void GCodeProcessor::process_file(const std::string& filename, std::function<voi
                 cancel_callback();
         }
         this->process_gcode_line(line, true);
-    }, m_result.lines_ends);
+    };
+    // The lines are tokenized in parallel, the machine state and the time estimation are processed in the order of the lines.
+    // If the file cannot be mapped into memory, no line was processed and the file is read sequentially.
+    if (! m_parser.parse_file_parallel(filename, parse_line_callback, m_result.lines_ends) &&
+        ! m_parser.parse_file(filename, parse_line_callback, m_result.lines_ends))
+        throw Slic3r::RuntimeError(std::string("Failed to read the G-code file ") + filename + '\n');
     m_result.update_imgui_flag = true;
     m_result.is_helio_gcode = m_is_helio_gcode;
     // Don't post-process the G-code to update time stamps.
@@ -2525,14 +2707,15 @@ void GCodeProcessor::finalize(bool post_process)
     }
 
     // process the time blocks
+    calculate_time_blocks(false);
     for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
         TimeMachine& machine = m_time_processor.machines[i];
         TimeMachine::CustomGCodeTime& gcode_time = machine.gcode_time;
-        machine.calculate_time(0, 0, ExtrusionRole::erNone, [&result=m_result, i,&machine](const TimeBlock& block, int time) {
-            machine.handle_time_block(block,time,i,result);
-        });
         if (gcode_time.needed && gcode_time.cache != 0.0f)
             gcode_time.times.push_back({ CustomGCode::ColorChange, gcode_time.cache });
+        if (machine.enabled)
+            BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << boost::format(": time estimate of the %1% mode planned in %2% s")
+                % (i == static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Normal) ? "normal" : "stealth") % machine.planning_time;
     }
 
     m_used_filaments.process_caches(this);
@@ -4125,14 +4308,10 @@ void GCodeProcessor::process_G1(const GCodeReader::GCodeLine& line)
         prev = curr;
 
         blocks.push_back(block);
-
-        if (blocks.size() > TimeProcessor::Planner::refresh_threshold) {
-            machine.calculate_time(TimeProcessor::Planner::queue_size, 0, erNone, [&result=m_result, i,&machine](const TimeBlock& block, int time) {
-                machine.handle_time_block(block,time,i,result);
-            });
-        }
     }
 
+    calculate_time_blocks(true);
+
     if (m_seams_detector.is_active()) {
         // check for seam starting vertex
         if (type == EMoveType::Extrude && m_extrusion_role == erExternalPerimeter && !m_seams_detector.has_first_vertex()) {
@@ -4566,14 +4745,10 @@ void GCodeProcessor::process_VG1(const GCodeReader::GCodeLine& line)
         prev = curr;
 
         blocks.push_back(block);
-
-        if (blocks.size() > TimeProcessor::Planner::refresh_threshold) {
-            machine.calculate_time(TimeProcessor::Planner::queue_size, 0, erNone, [&result=m_result, i,&machine](const TimeBlock& block, int time) {
-                machine.handle_time_block(block,time,i,result);
-            });
-        }
     }
 
+    calculate_time_blocks(true);
+
     // store move
     store_move_vertex(type);
 }
@@ -4916,14 +5091,10 @@ void  GCodeProcessor::process_G2_G3(const GCodeReader::GCodeLine& line)
         prev = curr;
 
         blocks.push_back(block);
-
-        if (blocks.size() > TimeProcessor::Planner::refresh_threshold) {
-            machine.calculate_time(TimeProcessor::Planner::queue_size, 0, erNone, [&result=m_result, i,&machine](const TimeBlock& block, int time) {
-                machine.handle_time_block(block,time,i,result);
-            });
-        }
     }
 
+    calculate_time_blocks(true);
+
     //BBS: seam detector
     Vec3f plate_offset = {(float) m_x_offset, (float) m_y_offset, 0.0f};
 
@@ -5970,6 +6141,9 @@ int GCodeProcessor::get_filament_vitrification_temperature(size_t extrude_id)
 
 void GCodeProcessor::process_custom_gcode_time(CustomGCode::Type code)
 {
+    //FIXME this simulates st_synchronize! is it correct?
+    // The estimated time may be longer than the real print time.
+    simulate_st_synchronize();
     for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
         TimeMachine& machine = m_time_processor.machines[i];
         if (!machine.enabled)
@@ -5977,11 +6151,6 @@ void GCodeProcessor::process_custom_gcode_time(CustomGCode::Type code)
 
         TimeMachine::CustomGCodeTime& gcode_time = machine.gcode_time;
         gcode_time.needed = true;
-        //FIXME this simulates st_synchronize! is it correct?
-        // The estimated time may be longer than the real print time.
-        machine.simulate_st_synchronize(0, erNone, [&result=m_result, i,&machine](const TimeBlock& block, int time) {
-            machine.handle_time_block(block,time,i,result);
-        });
         if (gcode_time.cache != 0.0f) {
             gcode_time.times.push_back({ code, gcode_time.cache });
             gcode_time.cache = 0.0f;
@@ -6006,14 +6175,42 @@ void GCodeProcessor::process_filaments(CustomGCode::Type code)
 
 void GCodeProcessor::simulate_st_synchronize(float additional_time, ExtrusionRole target_role)
 {
+    calculate_time_blocks(false, additional_time, target_role);
+}
+
+void GCodeProcessor::calculate_time_blocks(bool refresh, float additional_time, ExtrusionRole target_role)
+{
+    std::array<size_t, static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count)> modes;
+    size_t num_modes = 0;
     for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
-        TimeMachine& machine = m_time_processor.machines[i];
-        if (!machine.enabled)
-            continue;
+        const TimeMachine& machine = m_time_processor.machines[i];
+        if (machine.enabled && (! refresh || machine.blocks.size() > TimeProcessor::Planner::refresh_threshold))
+            modes[num_modes ++] = i;
+    }
 
-        machine.simulate_st_synchronize(additional_time, target_role, [&result=m_result, i,&machine](const TimeBlock& block, int time) {
+    // The machines share nothing but the time slots of the moves, which are indexed by the mode.
+    auto calculate = [this, refresh, additional_time, target_role](size_t i) {
+        TimeMachine& machine = m_time_processor.machines[i];
+        auto         start   = std::chrono::steady_clock::now();
+        machine.calculate_time(refresh ? TimeProcessor::Planner::queue_size : 0, additional_time, target_role, [&result=m_result, i,&machine](const TimeBlock& block, int time) {
             machine.handle_time_block(block,time,i,result);
         });
+        machine.planning_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    if (num_modes > 1)
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, num_modes, 1), [&modes, &calculate](const tbb::blocked_range<size_t>& range) {
+            for (size_t k = range.begin(); k < range.end(); ++ k)
+                calculate(modes[k]);
+        });
+    else if (num_modes == 1)
+        calculate(modes.front());
+
+    // Sum up the skippable times in the order of the modes, as if the modes were planned one after the other.
+    for (size_t k = 0; k < num_modes; ++ k) {
+        TimeMachine& machine = m_time_processor.machines[modes[k]];
+        for (const std::pair<SkipType, float>& skippable_time : machine.skippable_times)
+            m_result.skippable_part_time[skippable_time.first] += skippable_time.second;
+        machine.skippable_times.clear();
     }
 }
 
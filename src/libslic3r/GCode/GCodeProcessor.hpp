@@ -233,6 +233,105 @@ namespace Slic3r {
             }
         };
 
+        // BBS: lossless columnar copy of the moves for the results kept around but not rendered. The fields changing rarely
+        // from one move to the next (type, role, extruder, width, height, fan speed, temperature, ...) are run length encoded,
+        // the arc data is stored for the arc moves only. The moves are decoded one by one through a Cursor, which keeps
+        // a single MoveVertex, so the statistics may iterate the moves without expanding them.
+        class CompactMoves
+        {
+        public:
+            static constexpr size_t RUN_COLUMNS = 17;
+
+            class Cursor
+            {
+            public:
+                Cursor(const CompactMoves &moves, size_t idx);
+
+                bool              valid() const { return m_idx < m_moves.size(); }
+                size_t            index() const { return m_idx; }
+                const MoveVertex& operator*() const { return m_move; }
+                const MoveVertex* operator->() const { return &m_move; }
+                void              next();
+
+            private:
+                // Columns stored for each move and the sparse arc data.
+                void              load_per_move();
+
+                const CompactMoves         &m_moves;
+                size_t                      m_idx;
+                MoveVertex                  m_move;
+                // Index of the current run of each run length encoded column.
+                std::array<size_t, RUN_COLUMNS> m_runs;
+                // Index of the next move with arc data.
+                size_t                      m_arc { 0 };
+            };
+
+            void                    assign(const std::vector<MoveVertex> &moves);
+            void                    clear();
+            size_t                  size() const { return m_gcode_id.size(); }
+            bool                    empty() const { return m_gcode_id.empty(); }
+            // Random access, logarithmic in the number of runs. Use a Cursor or for_each() for sequential access.
+            MoveVertex              operator[](size_t idx) const;
+            // Calls fn(size_t idx, const MoveVertex &move) for the moves [begin, end).
+            template<typename Fn>
+            void                    for_each(size_t begin, size_t end, Fn &&fn) const {
+                for (Cursor cursor(*this, begin); cursor.valid() && cursor.index() < end; cursor.next())
+                    fn(cursor.index(), *cursor);
+            }
+            std::vector<MoveVertex> to_vector() const;
+            // Bytes allocated by the columns.
+            size_t                  memory_size() const;
+
+        private:
+            template<typename T>
+            struct RunColumn
+            {
+                std::vector<T>          values;
+                // Index of the first move of each run.
+                std::vector<uint32_t>   starts;
+
+                void push_back(const T &value, size_t idx);
+                // Run containing the move idx.
+                size_t run(size_t idx) const;
+                void clear() { values = std::vector<T>(); starts = std::vector<uint32_t>(); }
+                size_t memory_size() const { return values.capacity() * sizeof(T) + starts.capacity() * sizeof(uint32_t); }
+            };
+
+            // Calls fn(column, pointer to the MoveVertex member) for each run length encoded column.
+            template<typename Self, typename Fn>
+            static void             visit_runs(Self &self, Fn &&fn);
+
+            RunColumn<EMoveType>        m_type;
+            RunColumn<ExtrusionRole>    m_extrusion_role;
+            RunColumn<EMovePathType>    m_move_path_type;
+            RunColumn<unsigned char>    m_extruder_id;
+            RunColumn<unsigned char>    m_cp_color_id;
+            RunColumn<float>            m_feedrate;
+            RunColumn<float>            m_width;
+            RunColumn<float>            m_height;
+            RunColumn<float>            m_mm3_per_mm;
+            RunColumn<float>            m_fan_speed;
+            RunColumn<float>            m_temperature;
+            RunColumn<float>            m_layer_duration;
+            RunColumn<float>            m_thermal_index_min;
+            RunColumn<float>            m_thermal_index_max;
+            RunColumn<float>            m_thermal_index_mean;
+            RunColumn<int>              m_object_label_id;
+            RunColumn<float>            m_print_z;
+
+            std::vector<unsigned int>           m_gcode_id;
+            std::vector<float>                  m_delta_extruder;
+            std::vector<std::array<float, 2>>   m_time;
+            std::vector<Vec3f>                  m_position;
+
+            // Moves with a non zero arc center or with interpolation points, the points of the move m_arc_moves[i]
+            // are m_interpolation_points[m_interpolation_starts[i], m_interpolation_starts[i + 1]).
+            std::vector<uint32_t>               m_arc_moves;
+            std::vector<Vec3f>                  m_arc_center_position;
+            std::vector<uint32_t>               m_interpolation_starts;
+            std::vector<Vec3f>                  m_interpolation_points;
+        };
+
         struct SliceWarning {
             int         level;                  // 0: normal tips, 1: warning; 2: error
             std::string msg;                    // enum string
@@ -243,6 +342,8 @@ namespace Slic3r {
         std::string filename;
         unsigned int id;
         std::vector<MoveVertex> moves;
+        // BBS: the moves of a result not being rendered, see compact_moves().
+        CompactMoves compacted_moves;
         // Positions of ends of lines of the final G-code this->filename after TimeProcessor::post_process() finalizes the G-code.
         std::vector<size_t> lines_ends;
         Pointfs printable_area;
@@ -291,6 +392,11 @@ namespace Slic3r {
         int64_t time{ 0 };
 #endif // ENABLE_GCODE_VIEWER_STATISTICS
         void reset();
+        // BBS: move the moves into compacted_moves releasing the moves vector, expand_moves() restores it.
+        void compact_moves();
+        void expand_moves();
+        // BBS: the result holds moves, whether expanded or compacted.
+        bool has_moves() const { return ! moves.empty() || ! compacted_moves.empty(); }
 
         //BBS: add mutex for protection of gcode result
         mutable std::mutex result_mutex;
@@ -299,6 +405,7 @@ namespace Slic3r {
             filename = other.filename;
             id = other.id;
             moves = other.moves;
+            compacted_moves = other.compacted_moves;
             lines_ends = other.lines_ends;
             printable_area = other.printable_area;
             bed_exclude_area = other.bed_exclude_area;
@@ -636,6 +743,10 @@ namespace Slic3r {
             std::vector<float> layers_time;
             //BBS: prepare stage time before print model, including start gcode time and mostly same with start gcode time
             float prepare_time;
+            // Skippable times of the blocks planned by the last calculate_time(), see GCodeProcessor::calculate_time_blocks().
+            std::vector<std::pair<SkipType, float>> skippable_times;
+            // Wall clock time spent by the planner of this mode, in seconds.
+            double planning_time;
 
             // accept the time block and total time
             using block_handler_t = std::function<void(const TimeBlock&, const float)>;
@@ -647,18 +758,6 @@ namespace Slic3r {
 
             void reset();
 
-            /**
-             * @brief Simulates firmware st_synchronize() call
-             *
-             * Adding additional time to the specified extrusion role's time block.The provided block handler
-             * can process the block and the corresponding time (usually assigned to the move of the block).
-             *
-             * @param additional_time Addtional time to calculate
-             * @param target_role Target extrusion role for addtional time.Default is none,means any role is ok.
-             * @param block_handler Handler to set the processing logic for the block and its corresponding time.
-             */
-            void simulate_st_synchronize(float additional_time = 0.0f, ExtrusionRole target_role = ExtrusionRole::erNone, block_handler_t block_handler = block_handler_t());
-
             /**
              * @brief  Calculates the time for all blocks
              *
@@ -1413,6 +1512,9 @@ namespace Slic3r {
 
         // Simulates firmware st_synchronize() call
         void simulate_st_synchronize(float additional_time = 0.0f, ExtrusionRole target_role =ExtrusionRole::erNone);
+        // BBS: plans the time blocks of the enabled machines, each machine on its own worker if more of them have blocks to plan.
+        // If refresh, only the machines with more than Planner::refresh_threshold blocks are planned, keeping the last Planner::queue_size blocks.
+        void calculate_time_blocks(bool refresh, float additional_time = 0.0f, ExtrusionRole target_role = ExtrusionRole::erNone);
 
         void update_estimated_times_stats();
         //BBS:
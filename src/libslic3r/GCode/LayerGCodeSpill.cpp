@@ -0,0 +1,86 @@
+#include "LayerGCodeSpill.hpp"
+
+#include "../Exception.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace Slic3r {
+
+LayerGCodeSpill::LayerGCodeSpill(size_t num_layers, size_t memory_limit) :
+    m_slots(num_layers), m_memory_limit(memory_limit)
+{}
+
+LayerGCodeSpill::~LayerGCodeSpill()
+{
+    if (m_file) {
+        m_file->close();
+        boost::system::error_code ec;
+        fs::remove(m_path, ec);
+        if (ec)
+            BOOST_LOG_TRIVIAL(warning) << "Failed to remove the temporary G-code file " << m_path << ", reason = " << ec.message();
+    }
+}
+
+void LayerGCodeSpill::open_file()
+{
+    m_path = (fs::temp_directory_path() / fs::unique_path("bbs_layers_%%%%-%%%%-%%%%-%%%%.gcode.tmp")).string();
+    m_file = std::make_unique<boost::nowide::fstream>(m_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (! m_file->good())
+        throw Slic3r::FileIOError(std::string("Failed to create the temporary G-code file ") + m_path);
+    BOOST_LOG_TRIVIAL(info) << "Layer G-code exceeds the memory limit of " << m_memory_limit << " bytes, spilling to " << m_path;
+}
+
+void LayerGCodeSpill::store(size_t layer_idx, std::string &&gcode)
+{
+    assert(layer_idx < m_slots.size());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Slot &slot = m_slots[layer_idx];
+    slot.size  = gcode.size();
+    if (m_memory_limit == 0 || m_memory + gcode.size() <= m_memory_limit) {
+        m_memory           += gcode.size();
+        m_gcode_bytes_peak  = std::max(m_gcode_bytes_peak, m_memory);
+        slot.gcode          = std::move(gcode);
+        return;
+    }
+    if (! m_file)
+        this->open_file();
+    m_file->seekp(std::streamoff(m_file_size));
+    m_file->write(gcode.data(), std::streamsize(gcode.size()));
+    if (! m_file->good())
+        throw Slic3r::FileIOError(std::string("Failed to write the temporary G-code file ") + m_path);
+    slot.offset   = m_file_size;
+    slot.spilled  = true;
+    m_file_size  += gcode.size();
+    ++ m_spilled_layers;
+    gcode.clear();
+    gcode.shrink_to_fit();
+}
+
+std::string LayerGCodeSpill::take(size_t layer_idx)
+{
+    assert(layer_idx < m_slots.size());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Slot &slot = m_slots[layer_idx];
+    std::string out;
+    if (slot.spilled) {
+        out.resize(slot.size);
+        m_file->seekg(std::streamoff(slot.offset));
+        m_file->read(out.data(), std::streamsize(slot.size));
+        if (! m_file->good())
+            throw Slic3r::FileIOError(std::string("Failed to read the temporary G-code file ") + m_path);
+        slot.spilled = false;
+    } else {
+        out = std::move(slot.gcode);
+        m_memory -= out.size();
+    }
+    slot.size = 0;
+    return out;
+}
+
+} // namespace Slic3r
@@ -0,0 +1,62 @@
+#ifndef slic3r_LayerGCodeSpill_hpp_
+#define slic3r_LayerGCodeSpill_hpp_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/nowide/fstream.hpp>
+
+namespace Slic3r {
+
+// BBS: holds the G-code of the layers waiting for the z direction speed smoothing, which needs all layers parsed
+// before the first one is written out. Once the G-code held in memory would exceed the memory limit, further layers
+// are appended to a temporary file and read back when taken. Layers are stored and taken from parallel pipeline stages.
+class LayerGCodeSpill
+{
+public:
+    // memory_limit in bytes, 0 keeps all layers in memory.
+    LayerGCodeSpill(size_t num_layers, size_t memory_limit);
+    ~LayerGCodeSpill();
+
+    LayerGCodeSpill(const LayerGCodeSpill&) = delete;
+    LayerGCodeSpill& operator=(const LayerGCodeSpill&) = delete;
+
+    // Takes over the G-code of a layer, gcode is left empty. Throws Slic3r::FileIOError if the temporary file fails.
+    void        store(size_t layer_idx, std::string &&gcode);
+    // Returns the G-code of a layer and releases it.
+    std::string take(size_t layer_idx);
+
+    // Highest number of G-code bytes held in memory at once. Only the G-code strings are counted,
+    // the process memory is reported by log_memory_info().
+    size_t      gcode_bytes_peak() const { return m_gcode_bytes_peak; }
+    size_t      spilled_layers() const { return m_spilled_layers; }
+    uint64_t    spilled_bytes() const { return m_file_size; }
+
+private:
+    struct Slot
+    {
+        std::string gcode;
+        uint64_t    offset  { 0 };
+        size_t      size    { 0 };
+        bool        spilled { false };
+    };
+
+    void        open_file();
+
+    std::vector<Slot>                               m_slots;
+    size_t                                          m_memory_limit;
+    std::mutex                                      m_mutex;
+    size_t                                          m_memory { 0 };
+    size_t                                          m_gcode_bytes_peak { 0 };
+    size_t                                          m_spilled_layers { 0 };
+    std::string                                     m_path;
+    std::unique_ptr<boost::nowide::fstream>         m_file;
+    uint64_t                                        m_file_size { 0 };
+};
+
+} // namespace Slic3r
+
+#endif // slic3r_LayerGCodeSpill_hpp_
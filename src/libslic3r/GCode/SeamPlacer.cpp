@@ -7,6 +7,7 @@
 #include <random>
 #include <algorithm>
 #include <queue>
+#include <mutex>
 
 #include "libslic3r/AABBTreeLines.hpp"
 #include "libslic3r/KDTreeIndirect.hpp"
@@ -15,6 +16,7 @@
 #include "libslic3r/BoundingBox.hpp"
 #include "libslic3r/ClipperUtils.hpp"
 #include "libslic3r/Layer.hpp"
+#include "libslic3r/Fingerprint.hpp"
 
 #include "libslic3r/Geometry/Curves.hpp"
 #include "libslic3r/ShortEdgeCollapse.hpp"
@@ -278,14 +280,21 @@ struct CoordinateFunctor
     const float &operator()(size_t idx, size_t dim) const { return coordinates->operator[](idx)[dim]; }
 };
 
-// structure to store global information about the model - occlusion hits, enforcers, blockers
-struct GlobalModelInfo
+// BBS: visibility of the samples of an object mesh. It only depends on the geometry of the object, thus it is shared by the objects
+// of the same geometry and kept for the next G-code export, see SeamVisibilityCache.
+struct MeshVisibility
 {
     TriangleSetSamples                          mesh_samples;
     std::vector<float>                          mesh_samples_visibility;
     CoordinateFunctor                           mesh_samples_coordinate_functor;
     KDTreeIndirect<3, float, CoordinateFunctor> mesh_samples_tree{CoordinateFunctor{}};
     float                                       mesh_samples_radius;
+};
+
+// structure to store global information about the model - occlusion hits, enforcers, blockers
+struct GlobalModelInfo
+{
+    std::shared_ptr<const MeshVisibility> mesh_visibility;
 
     indexed_triangle_set             enforcers;
     indexed_triangle_set             blockers;
@@ -308,7 +317,10 @@ struct GlobalModelInfo
 
     float calculate_point_visibility(const Vec3f &position) const
     {
-        std::vector<size_t> points = find_nearby_points(mesh_samples_tree, position, mesh_samples_radius);
+        const TriangleSetSamples &mesh_samples            = mesh_visibility->mesh_samples;
+        const std::vector<float> &mesh_samples_visibility = mesh_visibility->mesh_samples_visibility;
+        const float               mesh_samples_radius     = mesh_visibility->mesh_samples_radius;
+        std::vector<size_t> points = find_nearby_points(mesh_visibility->mesh_samples_tree, position, mesh_samples_radius);
         if (points.empty()) { return 1.0f; }
 
         auto compute_dist_to_plane = [](const Vec3f &position, const Vec3f &plane_origin, const Vec3f &plane_normal) {
@@ -321,8 +333,8 @@ struct GlobalModelInfo
         for (size_t i = 0; i < points.size(); ++i) {
             size_t sample_idx = points[i];
 
-            Vec3f sample_point  = this->mesh_samples.positions[sample_idx];
-            Vec3f sample_normal = this->mesh_samples.normals[sample_idx];
+            Vec3f sample_point  = mesh_samples.positions[sample_idx];
+            Vec3f sample_normal = mesh_samples.normals[sample_idx];
 
             float weight = mesh_samples_radius - compute_dist_to_plane(position, sample_point, sample_normal);
             weight += (mesh_samples_radius - (position - sample_point).norm());
@@ -365,8 +377,9 @@ struct GlobalModelInfo
                 return;
             }
 
+            const TriangleSetSamples &mesh_samples = mesh_visibility->mesh_samples;
             for (size_t i = 0; i < mesh_samples.positions.size(); ++i) {
-                float visibility = mesh_samples_visibility[i];
+                float visibility = mesh_visibility->mesh_samples_visibility[i];
                 Vec3f color      = value_to_rgbf(0.0f, 1.0f, visibility);
                 fprintf(fp, "v %f %f %f  %f %f %f\n", mesh_samples.positions[i](0), mesh_samples.positions[i](1), mesh_samples.positions[i](2), color(0), color(1), color(2));
             }
@@ -577,10 +590,10 @@ std::pair<size_t, size_t> find_previous_and_next_perimeter_point(const std::vect
     return {size_t(prev), size_t(next)};
 }
 
-// Computes all global model info - transforms object, performs raycasting
-void compute_global_occlusion(GlobalModelInfo &result, const PrintObject *po, std::function<void(void)> throw_if_canceled,
-                              SeamPosition seam_position = spAligned)
+// Transforms object, performs raycasting
+std::shared_ptr<const MeshVisibility> compute_mesh_visibility(const PrintObject *po, std::function<void(void)> throw_if_canceled, SeamPosition seam_position)
 {
+    auto result = std::make_shared<MeshVisibility>();
     BOOST_LOG_TRIVIAL(debug) << "SeamPlacer: gather occlusion meshes: start";
     auto                 obj_transform = po->trafo_centered();
     indexed_triangle_set triangle_set;
@@ -614,9 +627,9 @@ void compute_global_occlusion(GlobalModelInfo &result, const PrintObject *po, st
 
     BOOST_LOG_TRIVIAL(debug) << "SeamPlacer: Compute visibility sample points: start";
 
-    result.mesh_samples                    = sample_its_uniform_parallel(SeamPlacer::raycasting_visibility_samples_count, triangle_set);
-    result.mesh_samples_coordinate_functor = CoordinateFunctor(&result.mesh_samples.positions);
-    result.mesh_samples_tree               = KDTreeIndirect<3, float, CoordinateFunctor>(result.mesh_samples_coordinate_functor, result.mesh_samples.positions.size());
+    result->mesh_samples                    = sample_its_uniform_parallel(SeamPlacer::raycasting_visibility_samples_count, triangle_set);
+    result->mesh_samples_coordinate_functor = CoordinateFunctor(&result->mesh_samples.positions);
+    result->mesh_samples_tree               = KDTreeIndirect<3, float, CoordinateFunctor>(result->mesh_samples_coordinate_functor, result->mesh_samples.positions.size());
 
     // The following code determines search area for random visibility samples on the mesh when calculating visibility of each perimeter point
     // number of random samples in the given radius (area) is approximately poisson distribution
@@ -624,29 +637,45 @@ void compute_global_occlusion(GlobalModelInfo &result, const PrintObject *po, st
     // parameters of exponential distribution to compute area that will have with probability="probability" more than given number of samples="samples"
     float probability = 0.9f;
     float samples     = 4;
-    float density     = SeamPlacer::raycasting_visibility_samples_count / result.mesh_samples.total_area;
+    float density     = SeamPlacer::raycasting_visibility_samples_count / result->mesh_samples.total_area;
     // exponential probability distrubtion function is : f(x) = P(X > x) = e^(l*x) where l is the rate parameter (computed as 1/u where u is mean value)
     // probability that sampled area A with S samples contains more than samples count:
     //  P(S > samples in A) = e^-(samples/(density*A));   express A:
     float search_area          = samples / (-logf(probability) * density);
     float search_radius        = sqrt(search_area / PI);
-    result.mesh_samples_radius = search_radius;
+    result->mesh_samples_radius = search_radius;
 
     BOOST_LOG_TRIVIAL(debug) << "SeamPlacer: Compute visiblity sample points: end";
     throw_if_canceled();
 
-    BOOST_LOG_TRIVIAL(debug) << "SeamPlacer: Mesh sample raidus: " << result.mesh_samples_radius;
+    BOOST_LOG_TRIVIAL(debug) << "SeamPlacer: Mesh sample raidus: " << result->mesh_samples_radius;
 
     BOOST_LOG_TRIVIAL(debug) << "SeamPlacer: build AABB tree: start";
     auto raycasting_tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(triangle_set.vertices, triangle_set.indices);
 
     throw_if_canceled();
     BOOST_LOG_TRIVIAL(debug) << "SeamPlacer: build AABB tree: end";
-    result.mesh_samples_visibility = raycast_visibility(raycasting_tree, triangle_set, result.mesh_samples, negative_volumes_start_index, seam_position);
+    result->mesh_samples_visibility = raycast_visibility(raycasting_tree, triangle_set, result->mesh_samples, negative_volumes_start_index, seam_position);
     throw_if_canceled();
 #ifdef DEBUG_FILES
-    result.debug_export(triangle_set);
+    GlobalModelInfo debug_info;
+    debug_info.mesh_visibility = result;
+    debug_info.debug_export(triangle_set);
 #endif
+    return result;
+}
+
+// Computes all global model info - the visibility is reused if it was computed for the same geometry by a former export
+void compute_global_occlusion(GlobalModelInfo &result, const PrintObject *po, SeamVisibilityCache &cache, size_t cache_capacity,
+                              std::function<void(void)> throw_if_canceled, SeamPosition seam_position = spAligned)
+{
+    result.mesh_visibility = cache.find(*po, seam_position);
+    if (result.mesh_visibility) {
+        BOOST_LOG_TRIVIAL(debug) << "SeamPlacer: reusing the visibility of " << result.mesh_visibility->mesh_samples.positions.size() << " samples";
+        return;
+    }
+    result.mesh_visibility = compute_mesh_visibility(po, throw_if_canceled, seam_position);
+    cache.insert(*po, seam_position, result.mesh_visibility, cache_capacity);
 }
 
 void gather_enforcers_blockers(GlobalModelInfo &result, const PrintObject *po)
@@ -1400,7 +1429,85 @@ void SeamPlacer::filter_scarf_seam_switch_by_angle(const float &angle, std::vect
     }
 }
 
-void SeamPlacer::init(const Print &print, std::function<void(void)> throw_if_canceled_func)
+struct SeamVisibilityCache::Key
+{
+    struct Volume
+    {
+        // Only to find out whether the mesh was released.
+        std::weak_ptr<const TriangleMesh> mesh;
+        Fingerprint128                    geometry;
+        ModelVolumeType                   type;
+        Transform3d                       matrix;
+
+        bool operator==(const Volume &rhs) const { return geometry == rhs.geometry && type == rhs.type && matrix.matrix() == rhs.matrix.matrix(); }
+    };
+    std::vector<Volume> volumes;
+    Transform3d         trafo;
+    // Only spAlignedBack changes the visibility, see raycast_visibility().
+    bool                aligned_back;
+
+    bool operator==(const Key &rhs) const { return volumes == rhs.volumes && trafo.matrix() == rhs.trafo.matrix() && aligned_back == rhs.aligned_back; }
+    bool expired() const { return std::any_of(volumes.begin(), volumes.end(), [](const Volume &v) { return v.mesh.expired(); }); }
+};
+
+struct SeamVisibilityCache::Entry
+{
+    Key                                                   key;
+    std::shared_ptr<const SeamPlacerImpl::MeshVisibility> visibility;
+};
+
+SeamVisibilityCache::SeamVisibilityCache() = default;
+SeamVisibilityCache::~SeamVisibilityCache() = default;
+
+SeamVisibilityCache::Key SeamVisibilityCache::make_key(const PrintObject &po, SeamPosition seam_position)
+{
+    Key key;
+    for (const ModelVolume *model_volume : po.model_object()->volumes)
+        if (model_volume->type() == ModelVolumeType::MODEL_PART || model_volume->type() == ModelVolumeType::NEGATIVE_VOLUME) {
+            const indexed_triangle_set &its = model_volume->mesh().its;
+            Fingerprint128Builder       geometry;
+            geometry.update(its.vertices).update(its.indices);
+            key.volumes.push_back({ model_volume->get_mesh_shared_ptr(), geometry.result(), model_volume->type(), model_volume->get_matrix() });
+        }
+    key.trafo        = po.trafo_centered();
+    key.aligned_back = seam_position == spAlignedBack;
+    return key;
+}
+
+std::shared_ptr<const SeamPlacerImpl::MeshVisibility> SeamVisibilityCache::find(const PrintObject &po, SeamPosition seam_position)
+{
+    Key key = make_key(po, seam_position);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [](const Entry &entry) { return entry.key.expired(); }), m_entries.end());
+    auto it = std::find_if(m_entries.begin(), m_entries.end(), [&key](const Entry &entry) { return entry.key == key; });
+    if (it == m_entries.end())
+        return nullptr;
+    std::rotate(it, it + 1, m_entries.end());
+    return m_entries.back().visibility;
+}
+
+void SeamVisibilityCache::insert(const PrintObject &po, SeamPosition seam_position, std::shared_ptr<const SeamPlacerImpl::MeshVisibility> visibility, size_t capacity)
+{
+    Key key = make_key(po, seam_position);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (! m_entries.empty() && m_entries.size() >= capacity)
+        m_entries.erase(m_entries.begin());
+    m_entries.push_back({ std::move(key), std::move(visibility) });
+}
+
+size_t SeamVisibilityCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+void SeamVisibilityCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+}
+
+void SeamPlacer::init(const Print &print, SeamVisibilityCache &visibility_cache, std::function<void(void)> throw_if_canceled_func)
 {
     using namespace SeamPlacerImpl;
     m_seam_per_object.clear();
@@ -1414,7 +1521,11 @@ void SeamPlacer::init(const Print &print, std::function<void(void)> throw_if_can
             GlobalModelInfo global_model_info{};
             gather_enforcers_blockers(global_model_info, po);
             throw_if_canceled_func();
-            if (configured_seam_preference == spAligned || configured_seam_preference == spAlignedBack || configured_seam_preference == spNearest) { compute_global_occlusion(global_model_info, po, throw_if_canceled_func, configured_seam_preference); }
+            if (configured_seam_preference == spAligned || configured_seam_preference == spAlignedBack || configured_seam_preference == spNearest) {
+                // Each entry holds about a megabyte of samples, keep at least the visibility of all the objects of the print.
+                compute_global_occlusion(global_model_info, po, visibility_cache, std::max<size_t>(16, print.objects().size()), throw_if_canceled_func,
+                                         configured_seam_preference);
+            }
             throw_if_canceled_func();
             BOOST_LOG_TRIVIAL(debug) << "SeamPlacer: gather_seam_candidates: start";
             gather_seam_candidates(po, global_model_info, configured_seam_preference);
@@ -5,6 +5,7 @@
 #include <vector>
 #include <memory>
 #include <atomic>
+#include <mutex>
 
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/ExtrusionEntity.hpp"
@@ -27,6 +28,8 @@ class Grid;
 
 namespace SeamPlacerImpl {
 
+struct MeshVisibility;
+
 // ************  FOR BACKPORT COMPATIBILITY ONLY ***************
 // Angle from v1 to v2, returning double atan2(y, x) normalized to <-PI, PI>.
 template<typename Derived, typename Derived2> inline double angle(const Eigen::MatrixBase<Derived> &v1, const Eigen::MatrixBase<Derived2> &v2)
@@ -125,6 +128,33 @@ struct PrintObjectSeamData
     void clear() { layers.clear(); }
 };
 
+// BBS: the visibility of the object meshes computed by the seam placer. The cache is owned by the Print and cleared by Print::clear(),
+// so that exporting the G-code again after a setting change does not cast the rays again. An entry is found by the geometry of
+// the object: the fingerprints of the meshes of the model parts and negative volumes, their transformations and the object
+// transformation. The entries are dropped once the meshes they were computed from are released, or when the least recently
+// used entries exceed the capacity.
+class SeamVisibilityCache
+{
+public:
+    SeamVisibilityCache();
+    ~SeamVisibilityCache();
+
+    // The visibility computed for the geometry of the object, nullptr if there is none.
+    std::shared_ptr<const SeamPlacerImpl::MeshVisibility> find(const PrintObject &po, SeamPosition seam_position);
+    void   insert(const PrintObject &po, SeamPosition seam_position, std::shared_ptr<const SeamPlacerImpl::MeshVisibility> visibility, size_t capacity);
+    size_t size() const;
+    void   clear();
+
+private:
+    struct Key;
+    struct Entry;
+    static Key make_key(const PrintObject &po, SeamPosition seam_position);
+
+    mutable std::mutex m_mutex;
+    // The most recently used entries are at the end.
+    std::vector<Entry> m_entries;
+};
+
 class SeamPlacer
 {
 public:
@@ -162,7 +192,7 @@ public:
     // The following data structures hold all perimeter points for all PrintObject.
     std::unordered_map<const PrintObject *, PrintObjectSeamData> m_seam_per_object;
 
-    void init(const Print &print, std::function<void(void)> throw_if_canceled_func);
+    void init(const Print &print, SeamVisibilityCache &visibility_cache, std::function<void(void)> throw_if_canceled_func);
 
     void place_seam(const Layer *layer, ExtrusionLoop &loop, bool external_first, const Point &last_pos, bool &satisfy_angle_threshold) const;
 
@@ -1245,6 +1245,9 @@ MultiNozzleUtils::MultiNozzleGroupResult ToolOrdering::get_recommended_filament_
         context.nozzle_info.nozzle_list = build_nozzle_list(nozzle_groups);
         context.nozzle_info.extruder_nozzle_list = build_extruder_nozzle_list(context.nozzle_info.nozzle_list);
 
+        context.solver_info.time_limit_ms = print->filament_group_time_limit();
+        context.solver_info.threads = print->filament_group_threads();
+
         if (has_multiple_nozzle) {
             if(mode == FilamentMapMode::fmmManual){
                 auto manual_filament_map = print_config.filament_map.values;
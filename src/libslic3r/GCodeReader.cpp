@@ -14,8 +14,97 @@
 #include <Shiny/Shiny.h>
 #include <fast_float/fast_float.h>
 
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+// Intel redesigned some TBB interface considerably when merging TBB with their oneAPI set of libraries, see GH #7332.
+// We are using quite an old TBB 2017 U7. Before we update our build servers, let's use the old API, which is deprecated in up to date TBB.
+#if ! defined(TBB_VERSION_MAJOR)
+    #include <tbb/version.h>
+#endif
+#if ! defined(TBB_VERSION_MAJOR)
+    static_assert(false, "TBB_VERSION_MAJOR not defined");
+#endif
+#if TBB_VERSION_MAJOR >= 2021
+    #include <tbb/parallel_pipeline.h>
+    using slic3r_tbb_filtermode = tbb::filter_mode;
+#else
+    #include <tbb/pipeline.h>
+    using slic3r_tbb_filtermode = tbb::filter;
+#endif
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define SLIC3R_GCODEREADER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SLIC3R_GCODEREADER_SSE2
+#endif
+#if defined(_MSC_VER) && (defined(SLIC3R_GCODEREADER_AVX2) || defined(SLIC3R_GCODEREADER_SSE2))
+    #include <intrin.h>
+#endif
+
 namespace Slic3r {
 
+#if defined(SLIC3R_GCODEREADER_AVX2) || defined(SLIC3R_GCODEREADER_SSE2)
+static inline unsigned int lowest_set_bit(uint32_t mask)
+{
+    assert(mask != 0);
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (unsigned int)idx;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+// BBS: first occurrence of any of the characters a, b, c in [ptr, end). The SIMD loops compare whole blocks and stop
+// at the first block containing a match, the tail shorter than a block is scanned one character at a time.
+static const char* find_first_of3(const char *ptr, const char *end, char a, char b, char c)
+{
+#ifdef SLIC3R_GCODEREADER_AVX2
+    {
+        const __m256i va = _mm256_set1_epi8(a);
+        const __m256i vb = _mm256_set1_epi8(b);
+        const __m256i vc = _mm256_set1_epi8(c);
+        for (; end - ptr >= 32; ptr += 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+            const __m256i hits  = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, va), _mm256_cmpeq_epi8(block, vb)), _mm256_cmpeq_epi8(block, vc));
+            if (uint32_t mask = uint32_t(_mm256_movemask_epi8(hits)); mask != 0)
+                return ptr + lowest_set_bit(mask);
+        }
+    }
+#endif
+#if defined(SLIC3R_GCODEREADER_AVX2) || defined(SLIC3R_GCODEREADER_SSE2)
+    {
+        const __m128i va = _mm_set1_epi8(a);
+        const __m128i vb = _mm_set1_epi8(b);
+        const __m128i vc = _mm_set1_epi8(c);
+        for (; end - ptr >= 16; ptr += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+            const __m128i hits  = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, va), _mm_cmpeq_epi8(block, vb)), _mm_cmpeq_epi8(block, vc));
+            if (uint32_t mask = uint32_t(_mm_movemask_epi8(hits)); mask != 0)
+                return ptr + lowest_set_bit(mask);
+        }
+    }
+#endif
+    for (; ptr != end && *ptr != a && *ptr != b && *ptr != c; ++ ptr)
+        ; // silence -Wempty-body
+    return ptr;
+}
+
+const char* GCodeReader::find_line_break(const char *c, const char *end)
+{
+    return find_first_of3(c, end, '\r', '\n', '\n');
+}
+
+const char* GCodeReader::find_end_of_line(const char *c, const char *end)
+{
+    return find_first_of3(c, end, '\r', '\n', 0);
+}
+
 void GCodeReader::apply_config(const GCodeConfig &config)
 {
     m_config = config;
@@ -26,7 +115,7 @@ void GCodeReader::apply_config(const DynamicPrintConfig &config)
     m_config.apply(config, true);
 }
 
-const char* GCodeReader::parse_line_internal(const char *ptr, const char *end, GCodeLine &gline, std::pair<const char*, const char*> &command)
+const char* GCodeReader::tokenize_line(const char *ptr, const char *end, float *axes, uint32_t &mask, std::pair<const char*, const char*> &command)
 {
     PROFILE_FUNC();
 
@@ -71,8 +160,8 @@ const char* GCodeReader::parse_line_internal(const char *ptr, const char *end, G
                 if (pend != c && is_end_of_word(*pend)) {
                     // The axis value has been parsed correctly.
                     if (axis != UNKNOWN_AXIS)
-	                    gline.m_axis[int(axis)] = float(v);
-                    gline.m_mask |= 1 << int(axis);
+	                    axes[int(axis)] = float(v);
+                    mask |= 1 << int(axis);
                     c = pend;
                 } else
                     // Skip the rest of the word.
@@ -82,12 +171,20 @@ const char* GCodeReader::parse_line_internal(const char *ptr, const char *end, G
                 c = skip_word(c);
         }
     }
-    
-    if (gline.has(E) && m_config.use_relative_e_distances)
-        m_position[E] = 0;
 
-    // Skip the rest of the line.
+    // Skip the rest of the line, usually a comment. The line may extend past end if not terminated inside [ptr, end).
+    if (c < end)
+        c = find_end_of_line(c, end);
     for (; ! is_end_of_line(*c); ++ c);
+    return c;
+}
+
+const char* GCodeReader::parse_line_internal(const char *ptr, const char *end, GCodeLine &gline, std::pair<const char*, const char*> &command)
+{
+    const char *c = tokenize_line(ptr, end, gline.m_axis, gline.m_mask, command);
+
+    if (gline.has(E) && m_config.use_relative_e_distances)
+        m_position[E] = 0;
 
     // Copy the raw string including the comment, without the trailing newlines.
     if (c > ptr) {
@@ -142,11 +239,9 @@ bool GCodeReader::parse_file_raw_internal(const std::string &filename, ParseLine
         auto it_bufend = buffer.begin() + cnt_read;
         while (it != it_bufend || (eof && ! gcode_line.empty())) {
             // Find end of line.
-            bool eol    = false;
-            auto it_end = it;
-            for (; it_end != it_bufend && ! (eol = *it_end == '\r' || *it_end == '\n'); ++ it_end)
-                if (*it_end == '\n')
-                    line_end_callback(file_pos + (it_end - buffer.begin()) + 1);
+            const char *line_begin = buffer.data() + (it - buffer.begin());
+            auto        it_end     = it + (find_line_break(line_begin, buffer.data() + cnt_read) - line_begin);
+            bool        eol        = it_end != it_bufend;
             // End of line is indicated also if end of file was reached.
             eol |= eof && it_end == it_bufend;
             if (eol) {
@@ -215,6 +310,121 @@ bool GCodeReader::parse_file(const std::string &file, callback_t callback, std::
     return ret;
 }
 
+// Line of a chunk tokenized by GCodeReader::tokenize_line(), the raw text stays in the memory mapped file.
+struct TokenizedGCodeLine
+{
+    // Offset of the raw line in the file, after the line number.
+    size_t      raw_begin;
+    uint32_t    raw_length;
+    uint32_t    mask;
+    float       axes[NUM_AXES];
+    // File position after the '\n' ending this line, 0 if the line is not ended by '\n'.
+    size_t      line_end;
+};
+
+bool GCodeReader::parse_file_parallel(const std::string &file, callback_t callback, std::vector<size_t> &lines_ends)
+{
+    lines_ends.clear();
+    BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << boost::format(":  before parse_file %1%") % file.c_str();
+
+    boost::iostreams::mapped_file_source mapped;
+    try {
+        if (boost::filesystem::file_size(file) == 0)
+            return true;
+        // The path is UTF-8, boost::filesystem is imbued with the UTF-8 locale by boost::nowide::nowide_filesystem().
+        mapped.open(boost::filesystem::path(file));
+    } catch (const std::exception &err) {
+        BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << boost::format(": failed to map %1%, reason = %2%") % file.c_str() % err.what();
+        return false;
+    }
+    const char  *data      = mapped.data();
+    const size_t data_size = mapped.size();
+
+    // Chunks of about 4MB ending with '\n' (or the end of the file), thus a chunk always starts at the beginning of a line.
+    static constexpr const size_t chunk_size = 4 << 20;
+    size_t chunk_begin = 0;
+    m_parsing = true;
+    const auto split = tbb::make_filter<void, std::pair<size_t, size_t>>(slic3r_tbb_filtermode::serial_in_order,
+        [this, data, data_size, &chunk_begin](tbb::flow_control &fc) -> std::pair<size_t, size_t> {
+            if (chunk_begin == data_size || ! m_parsing) {
+                fc.stop();
+                return {};
+            }
+            size_t      chunk_end = std::min(chunk_begin + chunk_size, data_size);
+            const char *eol       = static_cast<const char*>(memchr(data + chunk_end - 1, '\n', data_size - chunk_end + 1));
+            chunk_end = eol ? eol - data + 1 : data_size;
+            std::pair<size_t, size_t> chunk(chunk_begin, chunk_end);
+            chunk_begin = chunk_end;
+            return chunk;
+        });
+
+    const auto tokenize = tbb::make_filter<std::pair<size_t, size_t>, std::vector<TokenizedGCodeLine>>(slic3r_tbb_filtermode::parallel,
+        [data](const std::pair<size_t, size_t> &chunk) {
+            std::vector<TokenizedGCodeLine> lines;
+            std::pair<const char*, const char*> command;
+            // The tokenizer needs the line to be terminated, the last line of the file may not be.
+            std::string unterminated;
+            for (const char *it = data + chunk.first, *chunk_end = data + chunk.second; it != chunk_end;) {
+                const char *line_end = find_line_break(it, chunk_end);
+                const char *begin = it;
+                const char *end   = line_end;
+                if (line_end == chunk_end) {
+                    unterminated.assign(it, line_end);
+                    begin = unterminated.c_str();
+                    end   = begin + unterminated.size();
+                }
+                // Skip the line number.
+                const char *begin_new = skip_whitespaces(begin);
+                if (std::toupper(*begin_new) == 'N')
+                    begin_new = skip_word(begin_new);
+                begin_new = skip_whitespaces(begin_new);
+
+                TokenizedGCodeLine &line = lines.emplace_back();
+                line.mask = 0;
+                memset(line.axes, 0, sizeof(line.axes));
+                const char *raw_end = tokenize_line(begin_new, end, line.axes, line.mask, command);
+                line.raw_begin  = (it - data) + (begin_new - begin);
+                line.raw_length = uint32_t(raw_end - begin_new);
+                line.line_end   = 0;
+                // Skip the line end, "\r\n", "\r" or "\n".
+                it = line_end;
+                if (it != chunk_end && *it == '\r')
+                    ++ it;
+                if (it != chunk_end && *it == '\n')
+                    line.line_end = (++ it) - data;
+            }
+            return lines;
+        });
+
+    GCodeLine gline;
+    const auto process = tbb::make_filter<std::vector<TokenizedGCodeLine>, void>(slic3r_tbb_filtermode::serial_in_order,
+        [this, data, &callback, &lines_ends, &gline](const std::vector<TokenizedGCodeLine> &lines) {
+            for (const TokenizedGCodeLine &line : lines) {
+                if (! m_parsing)
+                    return;
+                gline.m_raw.assign(data + line.raw_begin, line.raw_length);
+                memcpy(gline.m_axis, line.axes, sizeof(gline.m_axis));
+                gline.m_mask = line.mask;
+                if (gline.has(E) && m_config.use_relative_e_distances)
+                    m_position[E] = 0;
+                if (m_verbose)
+                    std::cout << gline.m_raw << std::endl;
+                std::pair<const char*, const char*> command;
+                command.first  = skip_whitespaces(gline.m_raw.c_str());
+                command.second = skip_word(command.first);
+                callback(*this, gline);
+                this->update_coordinates(gline, command);
+                if (line.line_end)
+                    lines_ends.emplace_back(line.line_end);
+            }
+        });
+
+    tbb::parallel_pipeline(16, split & tokenize & process);
+
+    BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << boost::format(":  finished parse_file %1%") % file.c_str();
+    return true;
+}
+
 bool GCodeReader::parse_file_raw(const std::string &filename, raw_line_callback_t line_callback)
 {
     return this->parse_file_raw_internal(filename,
@@ -260,10 +470,13 @@ bool GCodeReader::GCodeLine::has_value(char axis, float &value) const
             break;
         // Check the name of the axis.
         if (*c == axis) {
-            // Try to parse the numeric value.
-            char   *pend = nullptr;
-            double  v = strtod(++ c, &pend);
-            if (pend != nullptr && is_end_of_word(*pend)) {
+            // Try to parse the numeric value. Accept the whitespaces and the '+' sign before the number, as strtod() does.
+            c = skip_whitespaces(++ c);
+            if (*c == '+' && c[1] != '+' && c[1] != '-')
+                ++ c;
+            double v;
+            auto [pend, ec] = fast_float::from_chars(c, m_raw.data() + m_raw.size(), v);
+            if (pend != c && is_end_of_word(*pend)) {
                 // The axis value has been parsed correctly.
                 value = float(v);
                 return true;
@@ -134,6 +134,10 @@ public:
     // Collect positions of line ends in the binary G-code to be used by the G-code viewer when memory mapping and displaying section of G-code
     // as an overlay in the 3D scene.
     bool parse_file(const std::string &file, callback_t callback, std::vector<size_t> &lines_ends);
+    // Same result as parse_file() above. The file is memory mapped and split into chunks at line ends, the chunks are tokenized
+    // in parallel. The callback and the update of the coordinates run serially in the order of the lines, not necessarily
+    // on the calling thread.
+    bool parse_file_parallel(const std::string &file, callback_t callback, std::vector<size_t> &lines_ends);
     // Just read the G-code file line by line, calls callback (const char *begin, const char *end). Returns false if reading the file failed.
     bool parse_file_raw(const std::string &file, raw_line_callback_t callback);
 
@@ -170,6 +174,10 @@ public:
             ; // silence -Wempty-body
         return c;
     }
+    // BBS: first '\r' or '\n' in [c, end), or end. Scans 32 or 16 bytes at once where AVX2 or SSE2 is available.
+    static const char*  find_line_break(const char *c, const char *end);
+    // BBS: first is_end_of_line() character in [c, end), or end. Vectorized the same way as find_line_break().
+    static const char*  find_end_of_line(const char *c, const char *end);
 
     GCodeConfig get_config() const
     { 
@@ -181,6 +189,9 @@ private:
     template<typename ParseLineCallback, typename LineEndCallback>
     bool        parse_file_internal(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback);
 
+    // Parses the command and the axes of a single line, returns the end of the line (start of the line end characters).
+    // Does not depend on the reader state, thus it may run concurrently.
+    static const char* tokenize_line(const char *ptr, const char *end, float *axes, uint32_t &mask, std::pair<const char*, const char*> &command);
     const char* parse_line_internal(const char *ptr, const char *end, GCodeLine &gline, std::pair<const char*, const char*> &command);
     void        update_coordinates(GCodeLine &gline, std::pair<const char*, const char*> &command);
 
@@ -1,6 +1,7 @@
 #include "GCodeWriter.hpp"
 #include "CustomGCode.hpp"
 #include <algorithm>
+#include <cstdio>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -45,7 +46,8 @@ void GCodeWriter::set_extruders(std::vector<unsigned int> extruder_ids)
 
 std::string GCodeWriter::preamble()
 {
-    std::ostringstream gcode;
+    std::string out;
+    GCodeEmitter gcode(out);
 
     if (FLAVOR_IS_NOT(gcfMakerWare)) {
         gcode << "G90\n";
@@ -68,15 +70,16 @@ std::string GCodeWriter::preamble()
         gcode << this->reset_e(true);
     }
 
-    return gcode.str();
+    return out;
 }
 
 std::string GCodeWriter::postamble() const
 {
-    std::ostringstream gcode;
+    std::string out;
+    GCodeEmitter gcode(out);
     if (FLAVOR_IS(gcfMachinekit))
           gcode << "M2 ; end of program\n";
-    return gcode.str();
+    return out;
 }
 
 std::string GCodeWriter::set_temperature(unsigned int temperature, bool wait, int tool) const
@@ -97,7 +100,8 @@ std::string GCodeWriter::set_temperature(unsigned int temperature, bool wait, in
         comment = "set nozzle temperature";
     }
 
-    std::ostringstream gcode;
+    std::string out;
+    GCodeEmitter gcode(out);
     gcode << code << " ";
     if (FLAVOR_IS(gcfMach3) || FLAVOR_IS(gcfMachinekit)) {
         gcode << "P";
@@ -118,7 +122,7 @@ std::string GCodeWriter::set_temperature(unsigned int temperature, bool wait, in
     if ((FLAVOR_IS(gcfTeacup) || FLAVOR_IS(gcfRepRapFirmware)) && wait)
         gcode << "M116 ; wait for temperature to be reached\n";
 
-    return gcode.str();
+    return out;
 }
 
 // BBS
@@ -131,7 +135,8 @@ std::string GCodeWriter::set_bed_temperature(int temperature, bool wait)
     m_last_bed_temperature_reached = wait;
 
     std::string code, comment;
-    std::ostringstream gcode;
+    std::string out;
+    GCodeEmitter gcode(out);
 
     if (wait) {
         code = "M190";
@@ -143,18 +148,19 @@ std::string GCodeWriter::set_bed_temperature(int temperature, bool wait)
     }
 
     gcode << code << " S" << temperature << " ; " << comment << "\n";
-    return gcode.str();
+    return out;
 }
 
 std::string GCodeWriter::set_chamber_temperature(int temperature, bool wait)
 {
     std::string code, comment;
-    std::ostringstream gcode;
+    std::string out;
+    GCodeEmitter gcode(out);
 
     if (wait)
     {
         gcode<<"M106 P2 S255 \n";
-        gcode<<"M191 S"<<std::to_string(temperature)<<" ;"<<"set chamber_temperature and wait for it to be reached\n";
+        gcode<<"M191 S"<<temperature<<" ;"<<"set chamber_temperature and wait for it to be reached\n";
         gcode<<"M106 P2 S0 \n";
     }
     else {
@@ -162,7 +168,7 @@ std::string GCodeWriter::set_chamber_temperature(int temperature, bool wait)
         comment = "set chamber_temperature";
         gcode << code << " S" << temperature << ";" << comment << "\n";
     }
-    return gcode.str();
+    return out;
 }
 
 void GCodeWriter::set_acceleration(unsigned int acceleration)
@@ -219,7 +225,8 @@ std::string GCodeWriter::set_acceleration_impl(unsigned int acceleration)
 
     m_last_acceleration = acceleration;
 
-    std::ostringstream gcode;
+    std::string out;
+    GCodeEmitter gcode(out);
     if (FLAVOR_IS(gcfRepetier)) {
         // M201: Set max printing acceleration
         gcode << "M201 X" << acceleration << " Y" << acceleration;
@@ -248,25 +255,26 @@ std::string GCodeWriter::set_acceleration_impl(unsigned int acceleration)
     if (GCodeWriter::full_gcode_comment) gcode << " ; adjust acceleration";
     gcode << "\n";
 
-    return gcode.str();
+    return out;
 }
 
 std::string GCodeWriter::set_pressure_advance(double pa) const
 {
-    std::ostringstream gcode;
-    if (pa < 0) return gcode.str();
+    std::string out;
+    GCodeEmitter gcode(out);
+    if (pa < 0) return out;
     if (false) { // todo: bbl printer
         // OrcaSlicer: set L1000 to use linear model
-        gcode << "M400\n M900 K" << std::setprecision(4) << pa << " L1000 M10 ; Override pressure advance value\n";
+        gcode << "M400\n M900 K" << GCodeEmitter::General{ pa, 4 } << " L1000 M10 ; Override pressure advance value\n";
     } else {
         if (this->config.gcode_flavor == gcfKlipper)
-            gcode << "SET_PRESSURE_ADVANCE ADVANCE=" << std::setprecision(4) << pa << "; Override pressure advance value\n";
+            gcode << "SET_PRESSURE_ADVANCE ADVANCE=" << GCodeEmitter::General{ pa, 4 } << "; Override pressure advance value\n";
         else if (this->config.gcode_flavor == gcfRepRapFirmware)
-            gcode << ("M572 D0 S") << std::setprecision(4) << pa << "; Override pressure advance value\n";
+            gcode << ("M572 D0 S") << GCodeEmitter::General{ pa, 4 } << "; Override pressure advance value\n";
         else
-            gcode << "M400\n M900 K" << std::setprecision(4) << pa << "; Override pressure advance value\n";
+            gcode << "M400\n M900 K" << GCodeEmitter::General{ pa, 4 } << "; Override pressure advance value\n";
     }
-    return gcode.str();
+    return out;
 }
 
 std::string GCodeWriter::set_jerk_xy(double jerk)
@@ -278,7 +286,8 @@ std::string GCodeWriter::set_jerk_xy(double jerk)
 
     m_last_jerk = jerk;
 
-    std::ostringstream gcode;
+    std::string out;
+    GCodeEmitter gcode(out);
     if (FLAVOR_IS(gcfKlipper))
         gcode << "SET_VELOCITY_LIMIT SQUARE_CORNER_VELOCITY=" << jerk;
     else
@@ -287,7 +296,7 @@ std::string GCodeWriter::set_jerk_xy(double jerk)
     if (GCodeWriter::full_gcode_comment) gcode << " ; adjust jerk";
     gcode << "\n";
 
-    return gcode.str();
+    return out;
 }
 
 std::string GCodeWriter::reset_e(bool force)
@@ -304,12 +313,13 @@ std::string GCodeWriter::reset_e(bool force)
     }
 
     if (!this->config.use_relative_e_distances) {
-        std::ostringstream gcode;
+        std::string out;
+        GCodeEmitter gcode(out);
         gcode << "G92 E0";
         //BBS
         if (GCodeWriter::full_gcode_comment) gcode << " ; reset extrusion distance";
         gcode << "\n";
-        return gcode.str();
+        return out;
     } else {
         return "";
     }
@@ -323,12 +333,13 @@ std::string GCodeWriter::update_progress(unsigned int num, unsigned int tot, boo
     unsigned int percent = (unsigned int)floor(100.0 * num / tot + 0.5);
     if (!allow_100) percent = std::min(percent, (unsigned int)99);
 
-    std::ostringstream gcode;
+    std::string out;
+    GCodeEmitter gcode(out);
     gcode << "M73 P" << percent;
     //BBS
     if (GCodeWriter::full_gcode_comment) gcode << " ; update progress";
     gcode << "\n";
-    return gcode.str();
+    return out;
 }
 
 std::string GCodeWriter::toolchange_prefix() const
@@ -347,7 +358,8 @@ std::string GCodeWriter::toolchange(unsigned int filament_id)
 
     // return the toolchange command
     // if we are running a single-extruder setup, just set the extruder and return nothing
-    std::ostringstream gcode;
+    std::string out;
+    GCodeEmitter gcode(out);
     if (this->multiple_extruders) {
         // BBS
         if (this->m_is_bbl_printer)
@@ -360,7 +372,7 @@ std::string GCodeWriter::toolchange(unsigned int filament_id)
         gcode << "\n";
         gcode << this->reset_e(true);
     }
-    return gcode.str();
+    return out;
 }
 
 std::string GCodeWriter::set_speed(double F, const std::string &comment, const std::string &cooling_marker)
@@ -830,7 +842,8 @@ std::string GCodeWriter::unlift()
 
 std::string GCodeWriter::set_fan(const GCodeFlavor gcode_flavor, unsigned int speed)
 {
-    std::ostringstream gcode;
+    std::string out;
+    GCodeEmitter gcode(out);
     if (speed == 0) {
         switch (gcode_flavor) {
         case gcfTeacup:
@@ -859,7 +872,7 @@ std::string GCodeWriter::set_fan(const GCodeFlavor gcode_flavor, unsigned int sp
             gcode << " ; enable fan";
         gcode << "\n";
     }
-    return gcode.str();
+    return out;
 }
 
 std::string GCodeWriter::set_fan(unsigned int speed) const
@@ -871,7 +884,8 @@ std::string GCodeWriter::set_fan(unsigned int speed) const
 //BBS: set additional fan speed for BBS machine only
 std::string GCodeWriter::set_additional_fan(unsigned int speed)
 {
-    std::ostringstream gcode;
+    std::string out;
+    GCodeEmitter gcode(out);
 
     gcode << "M106 " << "P2 " << "S" << (int)(255.0 * speed / 100.0);
     if (GCodeWriter::full_gcode_comment) {
@@ -881,17 +895,18 @@ std::string GCodeWriter::set_additional_fan(unsigned int speed)
             gcode << " ; enable additional fan ";
     }
     gcode << "\n";
-    return gcode.str();
+    return out;
 }
 
 std::string GCodeWriter::set_exhaust_fan( int speed,bool add_eol)
 {
-    std::ostringstream gcode;
+    std::string out;
+    GCodeEmitter gcode(out);
     gcode << "M106" << " P3" << " S" << (int)(speed / 100.0 * 255);
 
     if(add_eol)
         gcode << "\n";
-    return gcode.str();
+    return out;
 }
 
 void GCodeWriter::add_object_start_labels(std::string& gcode)
@@ -940,53 +955,103 @@ bool GCodeWriter::need_toolchange(unsigned int filament_id)const
     return filament()==nullptr || filament()->id()!=filament_id;
 }
 
+GCodeEmitter& GCodeEmitter::emit_int(int64_t v) {
+    char buf[24];
+    char *end = buf;
+#ifdef __APPLE__
+    boost::spirit::karma::generate(end, boost::spirit::karma::int_generator<int64_t>(), v);
+#else
+    end = std::to_chars(buf, buf + sizeof(buf), v).ptr;
+#endif
+    m_out.append(buf, end - buf);
+    return *this;
+}
+
+GCodeEmitter& GCodeEmitter::emit_uint(uint64_t v) {
+    char buf[24];
+    char *end = buf;
+#ifdef __APPLE__
+    boost::spirit::karma::generate(end, boost::spirit::karma::uint_generator<uint64_t>(), v);
+#else
+    end = std::to_chars(buf, buf + sizeof(buf), v).ptr;
+#endif
+    m_out.append(buf, end - buf);
+    return *this;
+}
+
+GCodeEmitter& GCodeEmitter::emit_general(double v, int precision) {
+    char buf[64];
+#ifdef __cpp_lib_to_chars
+    char *end = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::general, precision).ptr;
+    m_out.append(buf, end - buf);
+#else
+    // The floating point std::to_chars is not available in older stdlibs.
+    int len = snprintf(buf, sizeof(buf), "%.*g", precision, v);
+    m_out.append(buf, std::min<size_t>(std::max(len, 0), sizeof(buf) - 1));
+#endif
+    return *this;
+}
+
+GCodeEmitter& GCodeEmitter::emit_fixed(double v, size_t digits) {
+    char buf[32];
+    m_out.append(buf, GCodeFormatter::format_fixed(buf, buf + sizeof(buf), v, digits) - buf);
+    return *this;
+}
+
 void GCodeFormatter::emit_axis(const char axis, const double v, size_t digits) {
+    *ptr_err.ptr++ = ' '; *ptr_err.ptr++ = axis;
+    this->ptr_err.ptr = GCodeFormatter::format_fixed(this->ptr_err.ptr, this->buf_end, v, digits);
+}
+
+char* GCodeFormatter::format_fixed(char *ptr, char *end, const double v, size_t digits) {
     assert(digits <= 9);
     static constexpr const std::array<int, 10> pow_10{1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
-    *ptr_err.ptr++ = ' '; *ptr_err.ptr++ = axis;
+    std::to_chars_result ptr_err;
+    ptr_err.ptr = ptr;
+    char *buf_end = end;
 
-    char *base_ptr = this->ptr_err.ptr;
+    char *base_ptr = ptr_err.ptr;
     auto  v_int    = int64_t(std::round(v * pow_10[digits]));
     // Older stdlib on macOS doesn't support std::from_chars at all, so it is used boost::spirit::karma::generate instead of it.
     // That is a little bit slower than std::to_chars but not much.
 #ifdef __APPLE__
-    boost::spirit::karma::generate(this->ptr_err.ptr, boost::spirit::karma::int_generator<int64_t>(), v_int);
+    boost::spirit::karma::generate(ptr_err.ptr, boost::spirit::karma::int_generator<int64_t>(), v_int);
 #else
-    // this->buf_end minus 1 because we need space for adding the extra decimal point.
-    this->ptr_err = std::to_chars(this->ptr_err.ptr, this->buf_end - 1, v_int);
+    // buf_end minus 1 because we need space for adding the extra decimal point.
+    ptr_err = std::to_chars(ptr_err.ptr, buf_end - 1, v_int);
 #endif
-    size_t writen_digits = (this->ptr_err.ptr - base_ptr) - (v_int < 0 ? 1 : 0);
+    size_t writen_digits = (ptr_err.ptr - base_ptr) - (v_int < 0 ? 1 : 0);
     if (writen_digits < digits) {
         // Number is smaller than 10^digits, so that we will pad it with zeros.
         size_t remaining_digits = digits - writen_digits;
         // Move all newly inserted chars by remaining_digits to allocate space for padding with zeros.
-        for (char *from_ptr = this->ptr_err.ptr - 1, *to_ptr = from_ptr + remaining_digits; from_ptr >= this->ptr_err.ptr - writen_digits; --to_ptr, --from_ptr)
+        for (char *from_ptr = ptr_err.ptr - 1, *to_ptr = from_ptr + remaining_digits; from_ptr >= ptr_err.ptr - writen_digits; --to_ptr, --from_ptr)
             *to_ptr = *from_ptr;
 
-        memset(this->ptr_err.ptr - writen_digits, '0', remaining_digits);
-        this->ptr_err.ptr += remaining_digits;
+        memset(ptr_err.ptr - writen_digits, '0', remaining_digits);
+        ptr_err.ptr += remaining_digits;
     }
 
     // Move all newly inserted chars by one to allocate space for a decimal point.
-    for (char *to_ptr = this->ptr_err.ptr, *from_ptr = to_ptr - 1; from_ptr >= this->ptr_err.ptr - digits; --to_ptr, --from_ptr)
+    for (char *to_ptr = ptr_err.ptr, *from_ptr = to_ptr - 1; from_ptr >= ptr_err.ptr - digits; --to_ptr, --from_ptr)
         *to_ptr = *from_ptr;
 
-    *(this->ptr_err.ptr - digits) = '.';
+    *(ptr_err.ptr - digits) = '.';
     for (size_t i = 0; i < digits; ++i) {
-        if (*this->ptr_err.ptr != '0')
+        if (*ptr_err.ptr != '0')
             break;
-        this->ptr_err.ptr--;
+        ptr_err.ptr--;
     }
-    if (*this->ptr_err.ptr == '.')
-        this->ptr_err.ptr--;
-    if ((this->ptr_err.ptr + 1) == base_ptr || *this->ptr_err.ptr == '-')
-        *(++this->ptr_err.ptr) = '0';
-    this->ptr_err.ptr++;
+    if (*ptr_err.ptr == '.')
+        ptr_err.ptr--;
+    if ((ptr_err.ptr + 1) == base_ptr || *ptr_err.ptr == '-')
+        *(++ptr_err.ptr) = '0';
+    ptr_err.ptr++;
 
 #if 0 // #ifndef NDEBUG
     {
         // Verify that the optimized formatter produces the same result as the standard sprintf().
-        double v1 = atof(std::string(base_ptr, this->ptr_err.ptr).c_str());
+        double v1 = atof(std::string(base_ptr, ptr_err.ptr).c_str());
         char buf[2048];
         sprintf(buf, "%.*lf", int(digits), v);
         double v2 = atof(buf);
@@ -997,6 +1062,7 @@ void GCodeFormatter::emit_axis(const char axis, const double v, size_t digits) {
         assert(std::abs(v2 - v) * pow_10[digits] < 0.50001);
     }
 #endif // NDEBUG
+    return ptr_err.ptr;
 }
 
 } // namespace Slic3r
@@ -4,6 +4,8 @@
 #include "libslic3r.h"
 #include <string>
 #include <charconv>
+#include <cstdint>
+#include <type_traits>
 #include "Extruder.hpp"
 #include "Point.hpp"
 #include "PrintConfig.hpp"
@@ -173,6 +175,44 @@ private:
     std::string _retract(double length, double restart_extra, const std::string &comment);
 };
 
+// BBS: append-only G-code emitter, used instead of std::ostringstream for the commands not handled by GCodeFormatter.
+// It appends directly to the string the command is returned in, thus no stream buffer, locale lookup
+// or copy of the stream content into the returned string is involved.
+class GCodeEmitter {
+public:
+    // Replaces std::setprecision(precision) << v.
+    struct General { double v; int precision; };
+
+    explicit GCodeEmitter(std::string &out) : m_out(out) {}
+
+    GCodeEmitter(const GCodeEmitter&) = delete;
+    GCodeEmitter& operator=(const GCodeEmitter&) = delete;
+
+    GCodeEmitter& operator<<(char c)                { m_out.push_back(c); return *this; }
+    GCodeEmitter& operator<<(const char *s)         { m_out.append(s); return *this; }
+    GCodeEmitter& operator<<(const std::string &s)  { m_out.append(s); return *this; }
+    // Any integer type but bool and the character types, so that size_t, long and the like are not ambiguous.
+    template<typename T, std::enable_if_t<std::is_integral<T>::value && ! std::is_same<T, bool>::value && ! std::is_same<T, char>::value &&
+                                          ! std::is_same<T, signed char>::value && ! std::is_same<T, unsigned char>::value, int> = 0>
+    GCodeEmitter& operator<<(T v)                   { return std::is_signed<T>::value ? this->emit_int(int64_t(v)) : this->emit_uint(uint64_t(v)); }
+    // Same output as std::ostream with its default precision of 6 significant digits.
+    GCodeEmitter& operator<<(double v)              { return this->emit_general(v, 6); }
+    GCodeEmitter& operator<<(const General &g)      { return this->emit_general(g.v, g.precision); }
+
+    GCodeEmitter& emit_int(int64_t v);
+    GCodeEmitter& emit_uint(uint64_t v);
+    // Shortest of the fixed and the scientific notation with the given number of significant digits,
+    // same as std::ostream << std::setprecision(precision) << v.
+    GCodeEmitter& emit_general(double v, int precision);
+    // Given number of decimal digits with the trailing zeros removed, same as GCodeFormatter::emit_axis().
+    GCodeEmitter& emit_fixed(double v, size_t digits);
+
+    std::string& string() { return m_out; }
+
+private:
+    std::string &m_out;
+};
+
 class GCodeFormatter {
 public:
     GCodeFormatter() {
@@ -201,6 +241,9 @@ public:
 #endif
 
     void emit_axis(const char axis, const double v, size_t digits);
+    // Writes v with the given number of decimal digits, trailing zeros removed. Returns the end of the written number.
+    // The buffer has to provide space for digits + 21 characters.
+    static char* format_fixed(char *ptr, char *end, const double v, size_t digits);
 
     void emit_xy(const Vec2d &point) {
         this->emit_axis('X', point.x(), XYZF_EXPORT_DIGITS);
@@ -23,6 +23,7 @@
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/nowide/iostream.hpp>
@@ -3165,6 +3166,7 @@ void ModelVolume::center_geometry_after_creation(bool update_source_offset)
         if (m_mesh) {
             const_cast<TriangleMesh*>(m_mesh.get())->translate(-(float)shift(0), -(float)shift(1), -(float)shift(2));
             const_cast<TriangleMesh*>(m_mesh.get())->set_init_shift(shift);
+            m_mesh_fingerprint = {};
         }
         if (m_convex_hull)
 			const_cast<TriangleMesh*>(m_convex_hull.get())->translate(-(float)shift(0), -(float)shift(1), -(float)shift(2));
@@ -3175,6 +3177,17 @@ void ModelVolume::center_geometry_after_creation(bool update_source_offset)
         source.mesh_offset = shift;
 }
 
+const Fingerprint128& ModelVolume::mesh_fingerprint() const
+{
+    if (! m_mesh_fingerprint.valid()) {
+        Fingerprint128Builder builder;
+        builder.update(m_mesh->its.vertices);
+        builder.update(m_mesh->its.indices);
+        m_mesh_fingerprint = builder.result();
+    }
+    return m_mesh_fingerprint;
+}
+
 void ModelVolume::calculate_convex_hull()
 {
     m_convex_hull = std::make_shared<TriangleMesh>(this->mesh().convex_hull_3d());
@@ -3478,6 +3491,7 @@ void ModelVolume::mirror(Axis axis)
 void ModelVolume::scale_geometry_after_creation(const Vec3f& versor)
 {
 	const_cast<TriangleMesh*>(m_mesh.get())->scale(versor);
+    m_mesh_fingerprint = {};
     if (m_convex_hull->empty())
         //BBS: recompute the convex hull if it is null for previous too small
         this->calculate_convex_hull();
@@ -4225,7 +4239,7 @@ bool FacetsAnnotation::has_facets(const ModelVolume& mv, EnforcerBlockerType typ
 
 bool FacetsAnnotation::set(const TriangleSelector& selector)
 {
-    std::pair<std::vector<std::pair<int, int>>, std::vector<bool>> sel_map = selector.serialize();
+    TriangleSplittingData sel_map = selector.serialize();
     if (sel_map != m_data) {
         m_data = std::move(sel_map);
         this->touch();
@@ -4236,8 +4250,7 @@ bool FacetsAnnotation::set(const TriangleSelector& selector)
 
 void FacetsAnnotation::reset()
 {
-    m_data.first.clear();
-    m_data.second.clear();
+    m_data.clear();
     this->touch();
 }
 
@@ -4248,21 +4261,17 @@ std::string FacetsAnnotation::get_triangle_as_string(int triangle_idx) const
 {
     std::string out;
 
-    auto triangle_it = std::lower_bound(m_data.first.begin(), m_data.first.end(), triangle_idx, [](const std::pair<int, int> &l, const int r) { return l.first < r; });
-    if (triangle_it != m_data.first.end() && triangle_it->first == triangle_idx) {
+    const std::vector<std::pair<int, int>> &triangles = m_data.triangles();
+    auto triangle_it = std::lower_bound(triangles.begin(), triangles.end(), triangle_idx, [](const std::pair<int, int> &l, const int r) { return l.first < r; });
+    if (triangle_it != triangles.end() && triangle_it->first == triangle_idx) {
         int offset = triangle_it->second;
-        int end    = ++ triangle_it == m_data.first.end() ? int(m_data.second.size()) : triangle_it->second;
-        while (offset < end) {
-            int next_code = 0;
-            for (int i=3; i>=0; --i) {
-                next_code = next_code << 1;
-                next_code |= int(m_data.second[offset + i]);
-            }
-            offset += 4;
-
+        int end    = ++ triangle_it == triangles.end() ? int(m_data.num_bits()) : triangle_it->second;
+        // The first nibble is the last digit.
+        out.resize((end - offset) / 4);
+        for (auto it = out.rbegin(); offset < end; ++ it, offset += 4) {
+            int next_code = int(m_data.get_bits(offset, 4));
             assert(next_code >=0 && next_code <= 15);
-            char digit = next_code < 10 ? next_code + '0' : (next_code-10)+'A';
-            out.insert(out.begin(), digit);
+            *it = next_code < 10 ? next_code + '0' : (next_code-10)+'A';
         }
     }
     return out;
@@ -4273,8 +4282,7 @@ std::string FacetsAnnotation::get_triangle_as_string(int triangle_idx) const
 void FacetsAnnotation::set_triangle_from_string(int triangle_id, const std::string& str)
 {
     assert(! str.empty());
-    assert(m_data.first.empty() || m_data.first.back().first < triangle_id);
-    m_data.first.emplace_back(triangle_id, int(m_data.second.size()));
+    m_data.begin_triangle(triangle_id);
 
     for (auto it = str.crbegin(); it != str.crend(); ++it) {
         const char ch = *it;
@@ -4286,16 +4294,43 @@ void FacetsAnnotation::set_triangle_from_string(int triangle_id, const std::stri
         else
             assert(false);
 
-        // Convert to binary and append into code.
-        for (int i=0; i<4; ++i)
-            m_data.second.insert(m_data.second.end(), bool(dec & (1 << i)));
+        // Append the nibble into code, lowest bit first.
+        m_data.append_bits(uint64_t(dec), 4);
     }
 }
 
 bool FacetsAnnotation::equals(const FacetsAnnotation &other) const
 {
-    const std::pair<std::vector<std::pair<int, int>>, std::vector<bool>>& data = other.get_data();
-    return (m_data == data);
+    return m_data == other.get_data();
+}
+
+void TriangleSplittingData::clear()
+{
+    m_triangles.clear();
+    m_bits.clear();
+    m_num_bits = 0;
+    this->update_hash();
+}
+
+void TriangleSplittingData::update_hash()
+{
+    size_t seed = 0;
+    boost::hash_combine(seed, m_num_bits);
+    for (const std::pair<int, int> &triangle : m_triangles) {
+        boost::hash_combine(seed, triangle.first);
+        boost::hash_combine(seed, triangle.second);
+    }
+    for (uint64_t word : m_bits)
+        boost::hash_combine(seed, word);
+    m_hash       = uint64_t(seed);
+    m_hash_valid = true;
+}
+
+bool TriangleSplittingData::operator==(const TriangleSplittingData &rhs) const
+{
+    if (m_hash_valid && rhs.m_hash_valid && m_hash != rhs.m_hash)
+        return false;
+    return m_num_bits == rhs.m_num_bits && m_triangles == rhs.m_triangles && m_bits == rhs.m_bits;
 }
 
 // Test whether the two models contain the same number of ModelObjects with the same set of IDs
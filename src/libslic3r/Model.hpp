@@ -17,6 +17,7 @@
 #include "enum_bitmask.hpp"
 #include "TextConfiguration.hpp"
 #include "EmbossShape.hpp"
+#include "Fingerprint.hpp"
 //BBS: add bbs 3mf
 #include "Format/bbs_3mf.hpp"
 //BBS: add step
@@ -764,12 +765,82 @@ enum class En3mfType : int {
     From_Other
 };
 
+// BBS: division trees of the painted triangles of a mesh, as stored by TriangleSelector::serialize(). The bit stream is packed
+// 64 bits per word and its content is hashed, thus the data is cheap to copy, to compare and to write into an archive.
+class TriangleSplittingData
+{
+public:
+    // Pairs of (triangle index, index of the first bit of its division tree), sorted by the triangle index.
+    const std::vector<std::pair<int, int>>& triangles() const { return m_triangles; }
+    size_t   num_bits() const { return m_num_bits; }
+    // The bit stream packed into words, the bits above num_bits() are zero.
+    const std::vector<uint64_t>& words() const { return m_bits; }
+    bool     empty() const { return m_triangles.empty(); }
+
+    // count bits (at most 57) starting with bit idx, bit idx being the lowest one.
+    uint64_t get_bits(size_t idx, int count) const {
+        assert(count > 0 && count <= 57 && idx + count <= m_num_bits);
+        const size_t word  = idx >> 6;
+        const size_t shift = idx & 63;
+        uint64_t     out   = m_bits[word] >> shift;
+        if (shift + count > 64)
+            out |= m_bits[word + 1] << (64 - shift);
+        return out & ((uint64_t(1) << count) - 1);
+    }
+    // Start the division tree of the next triangle, triangle indices have to be strictly increasing.
+    void     begin_triangle(int triangle_idx) {
+        assert(m_triangles.empty() || m_triangles.back().first < triangle_idx);
+        m_triangles.emplace_back(triangle_idx, int(m_num_bits));
+        m_hash_valid = false;
+    }
+    // Append count lowest bits (at most 57) of bits.
+    void     append_bits(uint64_t bits, int count) {
+        assert(count > 0 && count <= 57);
+        bits &= (uint64_t(1) << count) - 1;
+        const size_t shift = m_num_bits & 63;
+        if (shift == 0)
+            m_bits.emplace_back(bits);
+        else {
+            m_bits.back() |= bits << shift;
+            if (shift + count > 64)
+                m_bits.emplace_back(bits >> (64 - shift));
+        }
+        m_num_bits  += count;
+        m_hash_valid = false;
+    }
+    void     reserve(size_t num_triangles) { m_triangles.reserve(num_triangles); }
+    void     shrink_to_fit() { m_triangles.shrink_to_fit(); m_bits.shrink_to_fit(); }
+    void     clear();
+
+    // To be called once the data is complete, the hash makes comparison of differing data cheap.
+    void     update_hash();
+    bool     operator==(const TriangleSplittingData &rhs) const;
+    bool     operator!=(const TriangleSplittingData &rhs) const { return ! (*this == rhs); }
+
+private:
+    std::vector<std::pair<int, int>>    m_triangles;
+    // Bit i is stored in m_bits[i / 64] at bit i % 64.
+    std::vector<uint64_t>               m_bits;
+    size_t                              m_num_bits { 0 };
+    uint64_t                            m_hash { 0 };
+    bool                                m_hash_valid { false };
+
+    friend class cereal::access;
+    template<class Archive> void save(Archive &ar) const { ar(m_triangles, m_bits, uint64_t(m_num_bits)); }
+    template<class Archive> void load(Archive &ar) {
+        uint64_t num_bits;
+        ar(m_triangles, m_bits, num_bits);
+        m_num_bits = size_t(num_bits);
+        this->update_hash();
+    }
+};
+
 class FacetsAnnotation final : public ObjectWithTimestamp {
 public:
     // Assign the content if the timestamp differs, don't assign an ObjectID.
     void assign(const FacetsAnnotation& rhs) { if (! this->timestamp_matches(rhs)) { m_data = rhs.m_data; this->copy_timestamp(rhs); } }
     void assign(FacetsAnnotation&& rhs) { if (! this->timestamp_matches(rhs)) { m_data = std::move(rhs.m_data); this->copy_timestamp(rhs); } }
-    const std::pair<std::vector<std::pair<int, int>>, std::vector<bool>>& get_data() const throw() { return m_data; }
+    const TriangleSplittingData& get_data() const throw() { return m_data; }
     bool set(const TriangleSelector& selector);
     indexed_triangle_set get_facets(const ModelVolume& mv, EnforcerBlockerType type) const;
     // BBS
@@ -780,7 +851,7 @@ public:
                                                        EnforcerBlockerType replace_filament = EnforcerBlockerType::NONE);
     indexed_triangle_set get_facets_strict(const ModelVolume& mv, EnforcerBlockerType type) const;
     bool has_facets(const ModelVolume& mv, EnforcerBlockerType type) const;
-    bool empty() const { return m_data.first.empty(); }
+    bool empty() const { return m_data.empty(); }
 
     // Following method clears the config and increases its timestamp, so the deleted
     // state is considered changed from perspective of the undo/redo stack.
@@ -790,11 +861,11 @@ public:
     std::string get_triangle_as_string(int i) const;
 
     // Before deserialization, reserve space for n_triangles.
-    void reserve(int n_triangles) { m_data.first.reserve(n_triangles); }
+    void reserve(int n_triangles) { m_data.reserve(n_triangles); }
     // Deserialize triangles one by one, with strictly increasing triangle_id.
     void set_triangle_from_string(int triangle_id, const std::string& str);
     // After deserializing the last triangle, shrink data to fit.
-    void shrink_to_fit() { m_data.first.shrink_to_fit(); m_data.second.shrink_to_fit(); }
+    void shrink_to_fit() { m_data.shrink_to_fit(); m_data.update_hash(); }
     bool equals(const FacetsAnnotation &other) const;
 
 private:
@@ -821,7 +892,7 @@ private:
         ar(cereal::base_class<ObjectWithTimestamp>(this), m_data);
     }
 
-    std::pair<std::vector<std::pair<int, int>>, std::vector<bool>> m_data;
+    TriangleSplittingData m_data;
 
     // To access set_new_unique_id() when copy / pasting a ModelVolume.
     friend class ModelVolume;
@@ -929,14 +1000,17 @@ public:
     // The triangular model.
     const TriangleMesh& mesh() const { return *m_mesh.get(); }
     const TriangleMesh* mesh_ptr() const { return m_mesh.get(); }
-    void                set_mesh(const TriangleMesh &mesh) { m_mesh = std::make_shared<const TriangleMesh>(mesh); }
-    void                set_mesh(TriangleMesh &&mesh) { m_mesh = std::make_shared<const TriangleMesh>(std::move(mesh)); }
-    void                set_mesh(const indexed_triangle_set &mesh) { m_mesh = std::make_shared<const TriangleMesh>(mesh); }
-    void                set_mesh(indexed_triangle_set &&mesh) { m_mesh = std::make_shared<const TriangleMesh>(std::move(mesh)); }
-    void                set_mesh(std::shared_ptr<const TriangleMesh> &mesh) { m_mesh = mesh; }
-    void                set_mesh(std::unique_ptr<const TriangleMesh> &&mesh) { m_mesh = std::move(mesh); }
-	void				reset_mesh() { m_mesh = std::make_shared<const TriangleMesh>(); }
+    void                set_mesh(const TriangleMesh &mesh) { m_mesh = std::make_shared<const TriangleMesh>(mesh); m_mesh_fingerprint = {}; }
+    void                set_mesh(TriangleMesh &&mesh) { m_mesh = std::make_shared<const TriangleMesh>(std::move(mesh)); m_mesh_fingerprint = {}; }
+    void                set_mesh(const indexed_triangle_set &mesh) { m_mesh = std::make_shared<const TriangleMesh>(mesh); m_mesh_fingerprint = {}; }
+    void                set_mesh(indexed_triangle_set &&mesh) { m_mesh = std::make_shared<const TriangleMesh>(std::move(mesh)); m_mesh_fingerprint = {}; }
+    void                set_mesh(std::shared_ptr<const TriangleMesh> &mesh) { m_mesh = mesh; m_mesh_fingerprint = {}; }
+    void                set_mesh(std::unique_ptr<const TriangleMesh> &&mesh) { m_mesh = std::move(mesh); m_mesh_fingerprint = {}; }
+	void				reset_mesh() { m_mesh = std::make_shared<const TriangleMesh>(); m_mesh_fingerprint = {}; }
     const std::shared_ptr<const TriangleMesh> &get_mesh_shared_ptr() const { return m_mesh; }
+    // BBS: content fingerprint of the mesh, calculated on the first call and kept until the mesh is replaced or modified.
+    // Not thread safe, called by the background processing on the Print's copy of the model.
+    const Fingerprint128& mesh_fingerprint() const;
     // Configuration parameters specific to an object model geometry or a modifier volume,
     // overriding the global Slic3r settings and the ModelObject settings.
     ModelConfigObject	config;
@@ -1102,6 +1176,8 @@ private:
     ModelObject*                    	object;
     // The triangular model.
     std::shared_ptr<const TriangleMesh> m_mesh;
+    // BBS: fingerprint of m_mesh returned by mesh_fingerprint(), invalid until calculated.
+    mutable Fingerprint128              m_mesh_fingerprint;
     // Is it an object to be printed, or a modifier volume?
     ModelVolumeType                 	m_type;
     t_model_material_id             	m_material_id;
@@ -1174,7 +1250,7 @@ private:
     // Copying an existing volume, therefore this volume will get a copy of the ID assigned.
     ModelVolume(ModelObject *object, const ModelVolume &other) :
         ObjectBase(other),
-        name(other.name), source(other.source), m_mesh(other.m_mesh), m_convex_hull(other.m_convex_hull),
+        name(other.name), source(other.source), m_mesh(other.m_mesh), m_mesh_fingerprint(other.m_mesh_fingerprint), m_convex_hull(other.m_convex_hull),
         config(other.config), m_type(other.m_type), object(object), m_transformation(other.m_transformation)
         , supported_facets(other.supported_facets)
         , fuzzy_skin_facets(other.fuzzy_skin_facets)
@@ -1256,6 +1332,7 @@ private:
         bool mesh_changed = false;
         auto tr = m_transformation;
         ar(name, source, m_mesh, m_type, m_material_id, m_transformation, m_is_splittable, has_convex_hull, m_text_info, cut_info);
+        m_mesh_fingerprint = {};
         mesh_changed |= !(tr == m_transformation);
         auto t = supported_facets.timestamp();
         cereal::load_by_value(ar, supported_facets);
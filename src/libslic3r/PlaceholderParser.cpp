@@ -6,6 +6,9 @@
 #include <iomanip>
 #include <sstream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #ifdef _MSC_VER
     #include <stdlib.h>  // provides **_environ
 #else
@@ -1531,14 +1534,363 @@ static std::string process_macro(const std::string &templ, client::MyContext &co
     return output;
 }
 
+// BBS: G-code templates are processed for each layer and filament change. The template is split once into a sequence of operations,
+// which is cached by the template text. The free-form text is copied, simple variable references are resolved directly,
+// the {if}{elsif}{else}{endif} blocks are evaluated by the operations, only the other expressions are parsed by the macro processor.
+// The operations follow the macro processor: leading white space is skipped, all conditions and all branches of an {if} block
+// are evaluated, thus the same errors are thrown and the same side effects (random(), filament_change()) happen.
+// If an operation fails, the whole template is processed again by the macro processor to report the error at its position.
+struct CompiledMacro
+{
+    struct Op {
+        enum Type {
+            // Free-form ASCII text, copied to the output.
+            TEXT,
+            // {variable}
+            SCALAR_VARIABLE,
+            // {variable[index]} with a constant index
+            VECTOR_VARIABLE,
+            // [variable]
+            LEGACY_VARIABLE,
+            // {if}{elsif}{else}{endif} block
+            IF,
+            // Any other macro, or a text with non-ASCII characters, processed by the macro processor.
+            MACRO,
+        };
+        Type                            type;
+        // Text, variable name or macro source.
+        std::string                     text;
+        int                             index { 0 };
+        // IF: conditions of the {if} and {elsif}, followed by the {else} branch if branches.size() > conditions.size().
+        std::vector<std::string>        conditions;
+        std::vector<std::vector<Op>>    branches;
+    };
+    std::vector<Op> ops;
+};
+
+namespace compiled_macro {
+    enum class BlockEnd { Eof, Elsif, Else, Endif };
+
+    // White space of the skipper of the macro processor, limited to ASCII.
+    static inline bool is_space(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+    static inline bool is_ascii(const std::string &str, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++ i)
+            if (static_cast<unsigned char>(str[i]) >= 0x80)
+                return false;
+        return true;
+    }
+
+    static std::string trim(const std::string &str, size_t begin, size_t end)
+    {
+        while (begin < end && is_space(str[begin]))
+            ++ begin;
+        while (end > begin && is_space(str[end - 1]))
+            -- end;
+        return str.substr(begin, end - begin);
+    }
+
+    // Leading identifier of a macro, empty if there is none.
+    static std::string leading_identifier(const std::string &str, size_t begin, size_t end, size_t &identifier_end)
+    {
+        while (begin < end && is_space(str[begin]))
+            ++ begin;
+        identifier_end = begin;
+        if (begin == end || ! (std::isalpha(static_cast<unsigned char>(str[begin])) || str[begin] == '_'))
+            return {};
+        while (identifier_end < end && (std::isalnum(static_cast<unsigned char>(str[identifier_end])) || str[identifier_end] == '_'))
+            ++ identifier_end;
+        return str.substr(begin, identifier_end - begin);
+    }
+
+    static bool is_keyword(const std::string &name)
+    {
+        static const char *keywords[] = { "and", "digits", "zdigits", "if", "int", "else", "elsif", "endif", "false", "min", "max", "random",
+                                          "filament_change", "round", "floor", "ceil", "not", "or", "true" };
+        for (const char *keyword : keywords)
+            if (name == keyword)
+                return true;
+        return false;
+    }
+
+    // ASCII identifier, which the macro processor will resolve as a variable.
+    static bool is_variable_name(const std::string &name)
+    {
+        if (name.empty() || ! is_ascii(name, 0, name.size()) || ! (std::isalpha(static_cast<unsigned char>(name.front())) || name.front() == '_'))
+            return false;
+        for (char c : name)
+            if (! (std::isalnum(static_cast<unsigned char>(c)) || c == '_'))
+                return false;
+        return ! is_keyword(name);
+    }
+
+    // Skip a string literal or a regular expression starting at pos, return the position of its closing delimiter.
+    static size_t skip_quoted(const std::string &str, size_t pos, char delimiter)
+    {
+        for (++ pos; pos < str.size(); ++ pos)
+            if (str[pos] == '\\')
+                ++ pos;
+            else if (str[pos] == delimiter)
+                return pos;
+        return std::string::npos;
+    }
+
+    // Position of the '}' closing a macro starting at pos, npos if not found or if the macro is not understood.
+    static size_t find_macro_end(const std::string &str, size_t pos)
+    {
+        for (; pos < str.size(); ++ pos) {
+            char c = str[pos];
+            if (c == '}')
+                return pos;
+            if (c == '{')
+                return std::string::npos;
+            if (c == '"') {
+                if ((pos = skip_quoted(str, pos, '"')) == std::string::npos)
+                    return pos;
+            } else if ((c == '=' || c == '!') && pos + 1 < str.size() && str[pos + 1] == '~') {
+                // A regular expression follows a regex match operator.
+                for (pos += 2; pos < str.size() && is_space(str[pos]); ++ pos) ;
+                if (pos < str.size() && str[pos] == '/' && (pos = skip_quoted(str, pos, '/')) == std::string::npos)
+                    return pos;
+                -- pos;
+            }
+        }
+        return std::string::npos;
+    }
+
+    // Position of the ']' closing a legacy variable expansion starting at pos.
+    static size_t find_legacy_end(const std::string &str, size_t pos)
+    {
+        for (int depth = 1; pos < str.size(); ++ pos) {
+            if (str[pos] == '[')
+                ++ depth;
+            else if (str[pos] == ']' && -- depth == 0)
+                return pos;
+            else if (str[pos] == '{')
+                break;
+        }
+        return std::string::npos;
+    }
+
+    // Compile a text block up to {elsif}, {else}, {endif} or the end of the template.
+    // Returns false if the template shall be processed by the macro processor as a whole.
+    static bool compile_text_block(const std::string &templ, size_t &pos, std::vector<CompiledMacro::Op> &ops, BlockEnd &block_end, std::string &elsif_condition)
+    {
+        using Op = CompiledMacro::Op;
+        while (pos < templ.size()) {
+            if (templ[pos] == '{') {
+                size_t end = find_macro_end(templ, pos + 1);
+                if (end == std::string::npos)
+                    return false;
+                size_t      identifier_end;
+                std::string identifier = leading_identifier(templ, pos + 1, end, identifier_end);
+                if (identifier == "elsif" || identifier == "else" || identifier == "endif") {
+                    if (identifier == "elsif") {
+                        block_end       = BlockEnd::Elsif;
+                        elsif_condition = templ.substr(identifier_end, end - identifier_end);
+                    } else {
+                        // The macro processor expects the closing brace right after the keyword.
+                        if (! trim(templ, identifier_end, end).empty())
+                            return false;
+                        block_end = identifier == "else" ? BlockEnd::Else : BlockEnd::Endif;
+                    }
+                    pos = end + 1;
+                    return true;
+                }
+                if (identifier == "if") {
+                    Op op;
+                    op.type = Op::IF;
+                    op.conditions.emplace_back(templ.substr(identifier_end, end - identifier_end));
+                    pos = end + 1;
+                    for (bool has_else = false;;) {
+                        BlockEnd    branch_end = BlockEnd::Eof;
+                        std::string condition;
+                        op.branches.emplace_back();
+                        if (! compile_text_block(templ, pos, op.branches.back(), branch_end, condition) || branch_end == BlockEnd::Eof)
+                            return false;
+                        if (branch_end == BlockEnd::Endif)
+                            break;
+                        if (has_else)
+                            return false;
+                        if (branch_end == BlockEnd::Elsif)
+                            op.conditions.emplace_back(std::move(condition));
+                        else
+                            has_else = true;
+                    }
+                    ops.emplace_back(std::move(op));
+                    continue;
+                }
+                Op op;
+                std::string macro = trim(templ, pos + 1, end);
+                size_t      bracket = macro.find('[');
+                if (is_variable_name(macro)) {
+                    op.type = Op::SCALAR_VARIABLE;
+                    op.text = std::move(macro);
+                } else if (bracket != std::string::npos && macro.back() == ']' && is_variable_name(trim(macro, 0, bracket)) &&
+                           macro.size() - bracket - 2 <= 9 && trim(macro, bracket + 1, macro.size() - 1).find_first_not_of("0123456789") == std::string::npos &&
+                           ! trim(macro, bracket + 1, macro.size() - 1).empty()) {
+                    op.type  = Op::VECTOR_VARIABLE;
+                    op.index = std::stoi(trim(macro, bracket + 1, macro.size() - 1));
+                    op.text  = trim(macro, 0, bracket);
+                } else {
+                    op.type = Op::MACRO;
+                    op.text = templ.substr(pos, end + 1 - pos);
+                }
+                ops.emplace_back(std::move(op));
+                pos = end + 1;
+            } else if (templ[pos] == '[') {
+                size_t end = find_legacy_end(templ, pos + 1);
+                if (end == std::string::npos)
+                    return false;
+                Op op;
+                std::string name = trim(templ, pos + 1, end);
+                if (is_variable_name(name)) {
+                    op.type = Op::LEGACY_VARIABLE;
+                    op.text = std::move(name);
+                } else {
+                    op.type = Op::MACRO;
+                    op.text = templ.substr(pos, end + 1 - pos);
+                }
+                ops.emplace_back(std::move(op));
+                pos = end + 1;
+            } else {
+                size_t end = std::min(templ.find_first_of("[{", pos), templ.size());
+                Op op;
+                // The macro processor validates the UTF-8 sequences. It would skip the leading white space of a separate text.
+                op.type = is_ascii(templ, pos, end) ? Op::TEXT : Op::MACRO;
+                if (op.type == Op::MACRO && is_space(templ[pos]))
+                    return false;
+                op.text = templ.substr(pos, end - pos);
+                ops.emplace_back(std::move(op));
+                pos = end;
+            }
+        }
+        block_end = BlockEnd::Eof;
+        return true;
+    }
+
+    static std::shared_ptr<const CompiledMacro> compile(const std::string &templ)
+    {
+        // The macro processor skips the leading white space.
+        size_t pos = 0;
+        while (pos < templ.size() && is_space(templ[pos]))
+            ++ pos;
+        if (pos < templ.size() && static_cast<unsigned char>(templ[pos]) >= 0x80)
+            return nullptr;
+        auto        compiled = std::make_shared<CompiledMacro>();
+        BlockEnd    block_end;
+        std::string condition;
+        if (! compile_text_block(templ, pos, compiled->ops, block_end, condition) || block_end != BlockEnd::Eof)
+            return nullptr;
+        return compiled;
+    }
+
+    // Compiled templates by their text, nullptr if the template is processed by the macro processor as a whole.
+    static std::shared_ptr<const CompiledMacro> find_or_compile(const std::string &templ)
+    {
+        static std::mutex                                                             mutex;
+        static std::unordered_map<std::string, std::shared_ptr<const CompiledMacro>> cache;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (auto it = cache.find(templ); it != cache.end())
+                return it->second;
+        }
+        std::shared_ptr<const CompiledMacro> compiled = compile(templ);
+        std::lock_guard<std::mutex> lock(mutex);
+        // The templates come from the configuration, a few dozens of them are expected.
+        if (cache.size() >= 1024)
+            cache.clear();
+        cache.emplace(templ, compiled);
+        return compiled;
+    }
+
+    // Output is nullptr for a branch not taken, which is evaluated for the errors and side effects only.
+    static void evaluate(const std::vector<CompiledMacro::Op> &ops, client::MyContext &context, std::string *output)
+    {
+        typedef std::string::const_iterator iterator_type;
+        using Op = CompiledMacro::Op;
+        for (const Op &op : ops) {
+            switch (op.type) {
+            case Op::TEXT:
+                if (output)
+                    *output += op.text;
+                break;
+            case Op::SCALAR_VARIABLE:
+            case Op::VECTOR_VARIABLE:
+            {
+                boost::iterator_range<iterator_type> opt_key(op.text.begin(), op.text.end());
+                client::OptWithPos<iterator_type>    opt;
+                client::expr<iterator_type>          value;
+                client::MyContext::resolve_variable(&context, opt_key, opt);
+                if (op.type == Op::SCALAR_VARIABLE)
+                    client::MyContext::scalar_variable_reference(&context, opt, value);
+                else {
+                    int index = op.index;
+                    client::MyContext::vector_variable_reference(&context, opt, index, op.text.end(), value);
+                }
+                if (output)
+                    *output += value.to_string();
+                break;
+            }
+            case Op::LEGACY_VARIABLE:
+            {
+                boost::iterator_range<iterator_type> opt_key(op.text.begin(), op.text.end());
+                std::string                          value;
+                client::MyContext::legacy_variable_expansion(&context, opt_key, value);
+                if (output)
+                    *output += value;
+                break;
+            }
+            case Op::IF:
+            {
+                bool taken = false;
+                for (size_t i = 0; i < op.branches.size(); ++ i) {
+                    bool condition = true;
+                    if (i < op.conditions.size()) {
+                        context.just_boolean_expression = true;
+                        condition = process_macro(op.conditions[i], context) == "true";
+                        context.just_boolean_expression = false;
+                    }
+                    bool take = condition && ! taken;
+                    evaluate(op.branches[i], context, take ? output : nullptr);
+                    taken |= take;
+                }
+                break;
+            }
+            case Op::MACRO:
+            {
+                std::string value = process_macro(op.text, context);
+                if (output)
+                    *output += value;
+                break;
+            }
+            }
+        }
+    }
+} // namespace compiled_macro
+
 std::string PlaceholderParser::process(const std::string &templ, unsigned int current_extruder_id, const DynamicConfig *config_override, ContextData *context_data) const
 {
-    client::MyContext context;
-    context.external_config 	= this->external_config();
-    context.config              = &this->config();
-    context.config_override     = config_override;
-    context.current_extruder_id = current_extruder_id;
-    context.context_data        = context_data;
+    auto make_context = [&]() {
+        client::MyContext context;
+        context.external_config 	= this->external_config();
+        context.config              = &this->config();
+        context.config_override     = config_override;
+        context.current_extruder_id = current_extruder_id;
+        context.context_data        = context_data;
+        return context;
+    };
+    if (std::shared_ptr<const CompiledMacro> compiled = compiled_macro::find_or_compile(templ); compiled) {
+        client::MyContext context = make_context();
+        std::string       output;
+        try {
+            compiled_macro::evaluate(compiled->ops, context, &output);
+            return output;
+        } catch (const std::exception &) {
+            // Let the macro processor report the error.
+        }
+    }
+    client::MyContext context = make_context();
     return process_macro(templ, context);
 }
 
@@ -16,9 +16,12 @@
 #include "Utils.hpp"
 #include "PrintConfig.hpp"
 #include "Model.hpp"
+#include "Format/SliceCache.hpp"
+#include "SliceResultCache.hpp"
 #include <float.h>
 
 #include <algorithm>
+#include <exception>
 #include <limits>
 #include <unordered_set>
 #include <boost/filesystem/path.hpp>
@@ -28,6 +31,7 @@
 
 #include <tbb/blocked_range.h>
 #include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
 
 #include "format.hpp"
 
@@ -67,6 +71,14 @@ void Print::clear()
     m_model.clear_objects();
     m_statistics_by_extruder_count.clear();
     m_nozzle_group_result.reset();
+    m_seam_visibility_cache.reset();
+}
+
+SeamVisibilityCache& Print::seam_visibility_cache()
+{
+    if (! m_seam_visibility_cache)
+        m_seam_visibility_cache = std::make_shared<SeamVisibilityCache>();
+    return *m_seam_visibility_cache;
 }
 
 bool Print::has_tpu_filament() const
@@ -1698,6 +1710,9 @@ void  PrintObject::copy_layers_from_shared_object()
         BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << boost::format(": this=%1%, copied layers from object %2%")%this%m_shared_object;
         m_layers = m_shared_object->layers();
         m_support_layers = m_shared_object->support_layers();
+        m_perimeters_to_regenerate.set_all();
+        m_infill_to_regenerate.set_all();
+        m_fill_surfaces_hashes.clear();
 
         firstLayerObjSliceByVolume = m_shared_object->firstLayerObjSlice();
         firstLayerObjSliceByGroups = m_shared_object->firstLayerObjGroups();
@@ -1717,6 +1732,58 @@ void  PrintObject::copy_layers_overhang_from_shared_object()
     }
 }
 
+static void fingerprint_config(Fingerprint128Builder &builder, const DynamicPrintConfig &config)
+{
+    // Keys are sorted, thus the fingerprint does not depend on the order the options were set in.
+    t_config_option_keys keys = config.keys();
+    builder.update(uint64_t(keys.size()));
+    for (const std::string &key : keys) {
+        builder.update(key);
+        builder.update(uint64_t(config.option(key)->hash()));
+    }
+}
+
+static void fingerprint_facets(Fingerprint128Builder &builder, const FacetsAnnotation &facets)
+{
+    const TriangleSplittingData &data = facets.get_data();
+    builder.update(data.triangles());
+    builder.update(uint64_t(data.num_bits()));
+    builder.update(data.words());
+}
+
+void  PrintObject::update_fingerprint()
+{
+    Fingerprint128Builder builder;
+    builder.update(this->trafo().matrix().data(), sizeof(double) * 16);
+
+    const ModelObject *model_obj = this->model_object();
+    builder.update(uint64_t(model_obj->volumes.size()));
+    for (const ModelVolume *model_volume : model_obj->volumes) {
+        builder.update(uint64_t(model_volume->type()));
+
+        builder.update(model_volume->mesh_fingerprint());
+
+        builder.update(model_volume->get_transformation().get_matrix().data(), sizeof(double) * 16);
+        fingerprint_facets(builder, model_volume->supported_facets);
+        fingerprint_facets(builder, model_volume->fuzzy_skin_facets);
+        fingerprint_facets(builder, model_volume->seam_facets);
+        fingerprint_facets(builder, model_volume->mmu_segmentation_facets);
+        fingerprint_config(builder, model_volume->config.get());
+    }
+
+    builder.update(model_obj->layer_height_profile.get());
+    fingerprint_config(builder, model_obj->config.get());
+    // The bounds of the layer ranges as well, the region configs only tell which configs are used, not which layers they cover.
+    builder.update(uint64_t(model_obj->layer_config_ranges.size()));
+    for (const auto &[range, range_config] : model_obj->layer_config_ranges) {
+        builder.update(double(range.first));
+        builder.update(double(range.second));
+        fingerprint_config(builder, range_config.get());
+    }
+
+    m_fingerprint = builder.result();
+}
+
 
 // BBS
 BoundingBox PrintObject::get_first_layer_bbox(float& a, float& layer_height, std::string& name)
@@ -1767,6 +1834,8 @@ std::map<ObjectID, unsigned int> getObjectExtruderMap(const Print& print) {
     return objectExtruderMap;
 }
 
+static int load_object_from_slice_cache(PrintObject* obj, const std::string& file_name);
+
 // Slicing process, running at a background thread.
 void Print::process(std::unordered_map<std::string, long long>* slice_time, bool use_cache)
 {
@@ -1789,68 +1858,22 @@ void Print::process(std::unordered_map<std::string, long long>* slice_time, bool
     for (PrintObject *obj : m_objects)
         obj->clear_shared_object();
 
-    //add the print_object share check logic
-    auto is_print_object_the_same = [this](const PrintObject* object1, const PrintObject* object2) -> bool{
-        if (object1->trafo().matrix() != object2->trafo().matrix())
-            return false;
-        const ModelObject* model_obj1 = object1->model_object();
-        const ModelObject* model_obj2 = object2->model_object();
-        if (model_obj1->volumes.size() != model_obj2->volumes.size())
-            return false;
-        bool has_extruder1 = model_obj1->config.has("extruder");
-        bool has_extruder2 = model_obj2->config.has("extruder");
-        if ((has_extruder1 != has_extruder2)
-            || (has_extruder1 && model_obj1->config.extruder() != model_obj2->config.extruder()))
-            return false;
-        for (int index = 0; index < model_obj1->volumes.size(); index++) {
-            const ModelVolume &model_volume1 = *model_obj1->volumes[index];
-            const ModelVolume &model_volume2 = *model_obj2->volumes[index];
-            if (model_volume1.type() != model_volume2.type())
-                return false;
-            if (model_volume1.mesh_ptr() != model_volume2.mesh_ptr())
-                return false;
-            if (!(model_volume1.get_transformation() == model_volume2.get_transformation()))
-                return false;
-            has_extruder1 = model_volume1.config.has("extruder");
-            has_extruder2 = model_volume2.config.has("extruder");
-            if ((has_extruder1 != has_extruder2)
-                || (has_extruder1 && model_volume1.config.extruder() != model_volume2.config.extruder()))
-                return false;
-            if (!model_volume1.supported_facets.equals(model_volume2.supported_facets))
-                return false;
-            if (!model_volume1.fuzzy_skin_facets.equals(model_volume2.fuzzy_skin_facets))
-                return false;
-            if (!model_volume1.seam_facets.equals(model_volume2.seam_facets))
-                return false;
-            if (!model_volume1.mmu_segmentation_facets.equals(model_volume2.mmu_segmentation_facets))
-                return false;
-            if (model_volume1.config.get() != model_volume2.config.get())
-                return false;
-        }
-        //if (!object1->config().equals(object2->config()))
-        //    return false;
-        if (model_obj1->layer_height_profile.get() != model_obj2->layer_height_profile.get())
-            return false;
-        if (model_obj1->config.get() != model_obj2->config.get())
-            return false;
-        return true;
-    };
+    //add the print_object share check logic, objects with the same content fingerprint share the slicing result
+    for (PrintObject *obj : m_objects)
+        obj->update_fingerprint();
     int object_count = m_objects.size();
     std::set<PrintObject*> need_slicing_objects;
     //std::set<PrintObject*> re_slicing_objects;
     m_reslicing_objects.clear();
+    std::unordered_map<Fingerprint128, PrintObject*, Fingerprint128::Hash> slicing_objects_by_fingerprint;
     if (!use_cache) {
         for (int index = 0; index < object_count; index++)
         {
             PrintObject *obj =  m_objects[index];
-            for (PrintObject *slicing_obj : need_slicing_objects)
-            {
-                if (is_print_object_the_same(obj, slicing_obj)) {
-                    obj->set_shared_object(slicing_obj);
-                    break;
-                }
-            }
-            if (!obj->get_shared_object()) {
+            auto [it, inserted] = slicing_objects_by_fingerprint.emplace(obj->fingerprint(), obj);
+            if (!inserted)
+                obj->set_shared_object(it->second);
+            else {
                 need_slicing_objects.insert(obj);
                 m_reslicing_objects.insert(obj);
             }
@@ -1860,21 +1883,20 @@ void Print::process(std::unordered_map<std::string, long long>* slice_time, bool
         for (int index = 0; index < object_count; index++)
         {
             PrintObject *obj =  m_objects[index];
-            if (obj->layer_count() > 0)
+            if (obj->layer_count() > 0) {
                 need_slicing_objects.insert(obj);
+                slicing_objects_by_fingerprint.emplace(obj->fingerprint(), obj);
+            }
         }
         for (int index = 0; index < object_count; index++)
         {
             PrintObject *obj =  m_objects[index];
             bool found_shared = false;
             if (need_slicing_objects.find(obj) == need_slicing_objects.end()) {
-                for (PrintObject *slicing_obj : need_slicing_objects)
-                {
-                    if (is_print_object_the_same(obj, slicing_obj)) {
-                        obj->set_shared_object(slicing_obj);
-                        found_shared = true;
-                        break;
-                    }
+                auto it = slicing_objects_by_fingerprint.find(obj->fingerprint());
+                if (it != slicing_objects_by_fingerprint.end()) {
+                    obj->set_shared_object(it->second);
+                    found_shared = true;
                 }
                 if (!found_shared) {
                     BOOST_LOG_TRIVIAL(warning) << boost::format("Also can not find the shared object, identify_id %1%, maybe shared object is skipped")%obj->model_object()->instances[0]->loaded_id;
@@ -1891,121 +1913,103 @@ void Print::process(std::unordered_map<std::string, long long>* slice_time, bool
     BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << boost::format(": total object counts %1% in current print, need to slice %2%")%m_objects.size()%need_slicing_objects.size();
     BOOST_LOG_TRIVIAL(info) << "Starting the slicing process." << log_memory_info();
 
-    const AutoContourHolesCompensationParams &auto_contour_holes_compensation_params = AutoContourHolesCompensationParams(m_config);
-    if (!use_cache) {
-
-        if (slice_time) {
-            start_time = (long long)Slic3r::Utils::get_current_milliseconds_time_utc();
-        }
-
-
-        for (PrintObject* obj : m_objects) {
-            if (need_slicing_objects.count(obj) != 0) {
-                obj->set_auto_circle_compenstaion_params(auto_contour_holes_compensation_params);
-                obj->make_perimeters();
-            }
-            else {
-                if (obj->set_started(posSlice))
-                    obj->set_done(posSlice);
-                if (obj->set_started(posPerimeters))
-                    obj->set_done(posPerimeters);
-            }
-        }
-
-        if (slice_time) {
-            end_time = (long long)Slic3r::Utils::get_current_milliseconds_time_utc();
-            (*slice_time)[TIME_MAKE_PERIMETERS] = (*slice_time)[TIME_MAKE_PERIMETERS] + end_time - start_time;
-            start_time = (long long)Slic3r::Utils::get_current_milliseconds_time_utc();
-        }
-
+    // BBS: the objects found in the persistent slice result cache are loaded instead of being processed.
+    // Only objects processed from scratch are considered, as re-processing a few invalidated steps is cheap.
+    std::set<PrintObject*> cached_result_objects;
+    std::vector<std::pair<PrintObject*, Fingerprint128>> result_cache_keys;
+    if (m_slice_result_cache && !use_cache) {
         for (PrintObject *obj : m_objects) {
-            if (need_slicing_objects.count(obj) != 0) {
-                obj->infill();
-            }
-            else {
-                if (obj->set_started(posPrepareInfill))
-                    obj->set_done(posPrepareInfill);
-                if (obj->set_started(posInfill))
-                    obj->set_done(posInfill);
+            if (need_slicing_objects.count(obj) == 0 || obj->is_step_done(posSlice))
+                continue;
+            Fingerprint128 key = SliceResultCache::key(*obj);
+            std::string file_name = m_slice_result_cache->lookup(key);
+            if (!file_name.empty()) {
+                obj->clear_layers();
+                obj->clear_support_layers();
+                obj->firstLayerObjGroupsMod().clear();
+                if (load_object_from_slice_cache(obj, file_name) == 0) {
+                    cached_result_objects.insert(obj);
+                    continue;
+                }
+                BOOST_LOG_TRIVIAL(warning) << boost::format("slice result cache: failed to load %1% for object %2%, process it again")%file_name %obj->model_object()->name;
+                m_slice_result_cache->invalidate(key);
+                obj->clear_layers();
+                obj->clear_support_layers();
+                obj->firstLayerObjGroupsMod().clear();
             }
+            result_cache_keys.emplace_back(obj, key);
         }
+    }
 
-        if (slice_time) {
-            end_time = (long long)Slic3r::Utils::get_current_milliseconds_time_utc();
-            (*slice_time)[TIME_INFILL] = (*slice_time)[TIME_INFILL] + end_time - start_time;
-        }
-
-        for (PrintObject *obj : m_objects) {
-            if (need_slicing_objects.count(obj) != 0) {
-                obj->ironing();
-            }
-            else {
-                if (obj->set_started(posIroning))
-                    obj->set_done(posIroning);
-            }
+    const AutoContourHolesCompensationParams &auto_contour_holes_compensation_params = AutoContourHolesCompensationParams(m_config);
+    // BBS: each object runs its own posSlice -> posPerimeters -> posPrepareInfill -> posInfill -> posIroning -> posSupportMaterial
+    // -> posDetectOverhangsForLift chain, the chains of independent objects are processed concurrently. The steps themselves
+    // are still parallelized over layers, TBB balances both levels, so plates with many small objects keep all cores busy.
+    // Cancellation is reported by the steps through exceptions, every chain checks the cancel flag on its own.
+    // With slice_time the per step durations are summed over the objects.
+    std::atomic<long long> perimeters_time(0), infill_time(0), support_time(0);
+    auto run_timed = [slice_time](std::atomic<long long> &total_time, auto &&step) {
+        long long step_start_time = slice_time ? (long long)Slic3r::Utils::get_current_milliseconds_time_utc() : 0;
+        step();
+        if (slice_time)
+            total_time += (long long)Slic3r::Utils::get_current_milliseconds_time_utc() - step_start_time;
+    };
+    auto process_object = [&](PrintObject *obj) {
+        bool need_processing = use_cache ? (m_reslicing_objects.count(obj) != 0) :
+            (need_slicing_objects.count(obj) != 0 && cached_result_objects.count(obj) == 0);
+        if (need_processing) {
+            run_timed(perimeters_time, [obj, &auto_contour_holes_compensation_params]() {
+                obj->set_auto_circle_compenstaion_params(auto_contour_holes_compensation_params);
+                obj->make_perimeters();
+            });
+            run_timed(infill_time, [obj]() { obj->infill(); });
+            obj->ironing();
+            run_timed(support_time, [obj]() { obj->generate_support_material(); });
+            obj->detect_overhangs_for_lift();
         }
-
-        if (slice_time) {
-            start_time = (long long)Slic3r::Utils::get_current_milliseconds_time_utc();
+        else {
+            for (PrintObjectStep step : { posSlice, posPerimeters, posPrepareInfill, posInfill, posIroning, posSupportMaterial, posDetectOverhangsForLift })
+                if (obj->set_started(step))
+                    obj->set_done(step);
         }
-
-        tbb::parallel_for(tbb::blocked_range<int>(0, int(m_objects.size())),
-            [this, need_slicing_objects](const tbb::blocked_range<int>& range) {
-                for (int i = range.begin(); i < range.end(); i++) {
-                    PrintObject* obj = m_objects[i];
-                    if (need_slicing_objects.count(obj) != 0) {
-                        obj->generate_support_material();
-                    }
-                    else {
-                        if (obj->set_started(posSupportMaterial))
-                            obj->set_done(posSupportMaterial);
-                    }
+    };
+    // Each chain runs under its own isolated context, so an exception thrown by one object does not cancel the nested loops
+    // of the other objects, which would otherwise return early and mark their steps done on partial layers.
+    // The first exception is rethrown once all the chains have finished.
+    std::exception_ptr first_exception;
+    std::mutex         exception_mutex;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, m_objects.size(), 1),
+        [this, &process_object, &first_exception, &exception_mutex](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = range.begin(); i < range.end(); i++) {
+                tbb::task_group_context object_context(tbb::task_group_context::isolated);
+                tbb::task_group         object_group(object_context);
+                try {
+                    object_group.run_and_wait([&process_object, obj = m_objects[i]]() { process_object(obj); });
+                } catch (...) {
+                    std::scoped_lock<std::mutex> lock(exception_mutex);
+                    if (! first_exception)
+                        first_exception = std::current_exception();
                 }
             }
-        );
-
-        if (slice_time) {
-            end_time = (long long)Slic3r::Utils::get_current_milliseconds_time_utc();
-            (*slice_time)[TIME_GENERATE_SUPPORT] = (*slice_time)[TIME_GENERATE_SUPPORT] + end_time - start_time;
         }
+    );
+    if (first_exception)
+        std::rethrow_exception(first_exception);
 
-        for (PrintObject* obj : m_objects) {
-            if (need_slicing_objects.count(obj) != 0) {
-                obj->detect_overhangs_for_lift();
-            }
-            else {
-                if (obj->set_started(posDetectOverhangsForLift))
-                    obj->set_done(posDetectOverhangsForLift);
-            }
-        }
+    if (slice_time) {
+        (*slice_time)[TIME_MAKE_PERIMETERS] = (*slice_time)[TIME_MAKE_PERIMETERS] + perimeters_time.load();
+        (*slice_time)[TIME_INFILL] = (*slice_time)[TIME_INFILL] + infill_time.load();
+        (*slice_time)[TIME_GENERATE_SUPPORT] = (*slice_time)[TIME_GENERATE_SUPPORT] + support_time.load();
     }
-    else {
-        for (PrintObject *obj : m_objects) {
-            if (m_reslicing_objects.count(obj) == 0) {
-                if (obj->set_started(posSlice))
-                    obj->set_done(posSlice);
-                if (obj->set_started(posPerimeters))
-                    obj->set_done(posPerimeters);
-                if (obj->set_started(posPrepareInfill))
-                    obj->set_done(posPrepareInfill);
-                if (obj->set_started(posInfill))
-                    obj->set_done(posInfill);
-                if (obj->set_started(posIroning))
-                    obj->set_done(posIroning);
-                if (obj->set_started(posSupportMaterial))
-                    obj->set_done(posSupportMaterial);
-                if (obj->set_started(posDetectOverhangsForLift))
-                    obj->set_done(posDetectOverhangsForLift);
-            }
-            else {
-                obj->set_auto_circle_compenstaion_params(auto_contour_holes_compensation_params);
-                obj->make_perimeters();
-                obj->infill();
-                obj->ironing();
-                obj->generate_support_material();
-                obj->detect_overhangs_for_lift();
+
+    if (m_slice_result_cache && !use_cache) {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, result_cache_keys.size(), 1),
+            [this, &result_cache_keys](const tbb::blocked_range<size_t>& range) {
+                for (size_t i = range.begin(); i < range.end(); i++)
+                    m_slice_result_cache->store(result_cache_keys[i].second, *result_cache_keys[i].first);
             }
-        }
+        );
+        m_slice_result_cache->log_statistics();
     }
 
     for (PrintObject *obj : m_objects)
@@ -2275,6 +2279,9 @@ std::string Print::export_gcode(const std::string& path_template, GCodeProcessor
     //BBS: compute plate offset for gcode-generator
     const Vec3d origin = this->get_plate_origin();
     gcode.set_gcode_offset(origin(0), origin(1));
+    gcode.set_layer_gcode_memory_limit(m_gcode_memory_limit);
+    gcode.set_travel_boundaries_lookahead(m_travel_boundaries_lookahead);
+    gcode.set_travel_cache_size(m_travel_cache_size);
     gcode.do_export(this, path.c_str(), result, thumbnail_cb);
     gcode.export_layer_filaments(result);
     //BBS
@@ -4033,6 +4040,12 @@ int Print::export_cached_data(const std::string& directory, int& obj_cnt_exporte
     int count = 0;
     std::vector<std::string> filename_vector;
     std::vector<json> json_vector;
+    struct BinaryObject {
+        std::string         file_name;
+        const PrintObject*  object;
+        size_t              identify_id;
+    };
+    std::vector<BinaryObject> binary_objects;
     size_t region_cnt = this->num_print_regions();
     size_t hash_values = 0;
     for (size_t region_idx = 0; region_idx < region_cnt; region_idx++)
@@ -4054,10 +4067,23 @@ int Print::export_cached_data(const std::string& directory, int& obj_cnt_exporte
         const PrintInstance &print_instance = obj->instances()[0];
         const ModelInstance *model_instance = print_instance.model_instance;
         size_t identify_id = (model_instance->loaded_id > 0)?model_instance->loaded_id: model_instance->id().id;
-        std::string file_name = directory + "/obj_" + std::to_string(identify_id) + "_" + std::to_string(region_cnt) + "_" + std::to_string(hash_values) + ".json";
+        std::string file_stem = directory + "/obj_" + std::to_string(identify_id) + "_" + std::to_string(region_cnt) + "_" + std::to_string(hash_values);
+        //BBS: the json format is only written when a human readable output is requested
+        std::string file_name = file_stem + (with_space ? ".json" : SliceCache::FILE_EXTENSION);
+        //BBS: remove the other format of the same object, the loader prefers the binary one and would pick up a stale file
+        std::string stale_file_name = file_stem + (with_space ? SliceCache::FILE_EXTENSION : ".json");
+        boost::system::error_code remove_ec;
+        if (fs::exists(stale_file_name) && !fs::remove(stale_file_name, remove_ec))
+            BOOST_LOG_TRIVIAL(warning) << boost::format("failed to remove the stale cache file %1%, reason = %2%")%stale_file_name %remove_ec.message();
 
         BOOST_LOG_TRIVIAL(warning) << boost::format("begin to dump object %1%, identify_id %2%, hash %3% to %4%, region count %5%")%model_obj->name %identify_id %hash_values %file_name %region_cnt;
 
+        if (!with_space) {
+            binary_objects.push_back({file_name, obj, identify_id});
+            count ++;
+            continue;
+        }
+
         try {
             json root_json, layers_json = json::array(), support_layers_json = json::array(), first_layer_groups = json::array();
 
@@ -4167,29 +4193,7 @@ int Print::export_cached_data(const std::string& directory, int& obj_cnt_exporte
             } // for each layer*/
             root_json[JSON_SUPPORT_LAYERS] = std::move(support_layers_json);
 
-            const std::vector<groupedVolumeSlices> &first_layer_obj_groups =  obj->firstLayerObjGroups();
-            for (size_t s_group_index = 0; s_group_index < first_layer_obj_groups.size(); ++ s_group_index) {
-                groupedVolumeSlices group = first_layer_obj_groups[s_group_index];
-
-                //convert the id
-                for (ObjectID& obj_id : group.volume_ids)
-                {
-                    const ModelVolume* currentModelVolumePtr = nullptr;
-                    //BBS: support shared object logic
-                    const PrintObject* shared_object = obj->get_shared_object();
-                    if (!shared_object)
-                        shared_object = obj;
-                    const ModelVolumePtrs& volumes_ptr = shared_object->model_object()->volumes;
-                    size_t volume_count = volumes_ptr.size();
-                    for (size_t index = 0; index < volume_count; index ++) {
-                        currentModelVolumePtr = volumes_ptr[index];
-                        if (currentModelVolumePtr->id() == obj_id) {
-                            obj_id.id = index;
-                            break;
-                        }
-                    }
-                }
-
+            for (const groupedVolumeSlices &group : SliceCache::first_layer_groups_with_volume_indices(*obj)) {
                 json first_layer_group_json;
 
                 first_layer_group_json = group;
@@ -4216,6 +4220,24 @@ int Print::export_cached_data(const std::string& directory, int& obj_cnt_exporte
     }
 
     boost::mutex mutex;
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, binary_objects.size()),
+        [&binary_objects, &ret, &mutex](const tbb::blocked_range<size_t>& output_range) {
+            for (size_t object_index = output_range.begin(); object_index < output_range.end(); ++ object_index) {
+                const BinaryObject& binary_object = binary_objects[object_index];
+                try {
+                    SliceCache::save_object(binary_object.file_name, *binary_object.object, binary_object.object->model_object()->name, binary_object.identify_id,
+                        SliceCache::first_layer_groups_with_volume_indices(*binary_object.object));
+                }
+                catch(std::exception &err) {
+                    BOOST_LOG_TRIVIAL(error) << __FUNCTION__<< ": save to "<<binary_object.file_name<<" got a generic exception, reason = " << err.what();
+                    boost::unique_lock l(mutex);
+                    ret = CLI_EXPORT_CACHE_WRITE_FAILED;
+                }
+            }
+        }
+    );
+
     tbb::parallel_for(
         tbb::blocked_range<size_t>(0, filename_vector.size()),
         [filename_vector, &json_vector, with_space, &ret, &mutex](const tbb::blocked_range<size_t>& output_range) {
@@ -4243,6 +4265,114 @@ int Print::export_cached_data(const std::string& directory, int& obj_cnt_exporte
 }
 
 
+static const PrintRegion* find_print_region(const PrintObject* object, size_t config_hash)
+{
+    int regions_count = object->num_printing_regions();
+    for (int index = 0; index < regions_count; index++ )
+    {
+        const PrintRegion&  print_region = object->printing_region(index);
+        if (print_region.config_hash() == config_hash ) {
+            return &print_region;
+        }
+    }
+    return NULL;
+}
+
+// Load an object stored in the SliceCache binary format, the layers of the object have to be cleared before.
+static int load_object_from_slice_cache(PrintObject* obj, const std::string& file_name)
+{
+    try {
+        SliceCache::Reader reader(file_name);
+
+        BOOST_LOG_TRIVIAL(info) << __FUNCTION__<<boost::format(":will load %1%, identify_id %2%, layer_count %3%, support_layer_count %4%, firstlayer_group_count %5%")
+            %reader.object_name() %reader.identify_id() %reader.layers().size() %reader.support_layers().size() %reader.first_layer_groups().size();
+
+        //create layer and layer regions
+        Layer* previous_layer = NULL;
+        for (const SliceCache::LayerEntry& entry : reader.layers())
+        {
+            Layer* new_layer = obj->add_layer(entry.id, entry.height, entry.print_z, entry.slice_z);
+            if (!new_layer) {
+                BOOST_LOG_TRIVIAL(error) <<__FUNCTION__<< boost::format(":create_layer failed, out of memory");
+                return CLI_OUT_OF_MEMORY;
+            }
+            if (previous_layer) {
+                previous_layer->upper_layer = new_layer;
+                new_layer->lower_layer = previous_layer;
+            }
+            previous_layer = new_layer;
+
+            for (size_t config_hash : entry.region_config_hashes)
+            {
+                const PrintRegion *print_region = find_print_region(obj, config_hash);
+                if (!print_region){
+                    BOOST_LOG_TRIVIAL(error) <<__FUNCTION__<< boost::format(":can not find print region of object %1%, layer %2%, print_z %3%")
+                        %reader.object_name() %entry.id %new_layer->print_z;
+                    return CLI_IMPORT_CACHE_DATA_CAN_NOT_USE;
+                }
+                new_layer->add_region(print_region);
+            }
+        }
+
+        //create support_layers
+        Layer* previous_support_layer = NULL;
+        for (const SliceCache::LayerEntry& entry : reader.support_layers())
+        {
+            SupportLayer* new_support_layer = obj->add_support_layer(entry.id, entry.interface_id, entry.height, entry.print_z);
+            if (!new_support_layer) {
+                BOOST_LOG_TRIVIAL(error) <<__FUNCTION__<< boost::format(":add_support_layer failed, out of memory");
+                return CLI_OUT_OF_MEMORY;
+            }
+            if (previous_support_layer) {
+                previous_support_layer->upper_layer = new_support_layer;
+                new_support_layer->lower_layer = previous_support_layer;
+            }
+            previous_support_layer = new_support_layer;
+        }
+
+        //decode the layer blobs straight from the mapped file in parallel
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, obj->layer_count()),
+            [&reader, obj](const tbb::blocked_range<size_t>& layer_range) {
+                for (size_t layer_index = layer_range.begin(); layer_index < layer_range.end(); ++ layer_index)
+                    reader.decode_layer(layer_index, *obj->get_layer(layer_index));
+            }
+        );
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, obj->support_layer_count()),
+            [&reader, obj](const tbb::blocked_range<size_t>& support_layer_range) {
+                for (size_t layer_index = support_layer_range.begin(); layer_index < support_layer_range.end(); ++ layer_index)
+                    reader.decode_support_layer(layer_index, *obj->get_support_layer(layer_index));
+            }
+        );
+
+        //load first group volumes
+        std::vector<groupedVolumeSlices>& firstlayer_objgroups = obj->firstLayerObjGroupsMod();
+        ModelVolumePtrs& volumes_ptr = obj->model_object()->volumes;
+        for (groupedVolumeSlices firstlayer_group : reader.first_layer_groups())
+        {
+            //convert the id
+            for (ObjectID& obj_id : firstlayer_group.volume_ids)
+            {
+                if (obj_id.id >= volumes_ptr.size()) {
+                    BOOST_LOG_TRIVIAL(error) << __FUNCTION__<< boost::format(": can not find volume_id %1% from object file %2% in firstlayer groups, volume_count %3%!")
+                        %obj_id.id %file_name %volumes_ptr.size();
+                    return CLI_IMPORT_CACHE_LOAD_FAILED;
+                }
+                obj_id = volumes_ptr[obj_id.id]->id();
+            }
+            firstlayer_objgroups.push_back(std::move(firstlayer_group));
+        }
+
+        BOOST_LOG_TRIVIAL(info) << __FUNCTION__<< boost::format(": load object %1% from %2% successfully.")%reader.object_name()%file_name;
+    }
+    catch(std::exception &err) {
+        BOOST_LOG_TRIVIAL(error) << __FUNCTION__<< ": load from "<<file_name<<" got a generic exception, reason = " << err.what();
+        return CLI_IMPORT_CACHE_LOAD_FAILED;
+    }
+    return 0;
+}
+
 int Print::load_cached_data(const std::string& directory)
 {
     int ret = 0;
@@ -4253,20 +4383,9 @@ int Print::load_cached_data(const std::string& directory)
         return CLI_IMPORT_CACHE_NOT_FOUND;
     }
 
-    auto find_region = [this](PrintObject* object, size_t config_hash) -> const PrintRegion* {
-        int regions_count = object->num_printing_regions();
-        for (int index = 0; index < regions_count; index++ )
-        {
-            const PrintRegion&  print_region = object->printing_region(index);
-            if (print_region.config_hash() == config_hash ) {
-                return &print_region;
-            }
-        }
-        return NULL;
-    };
-
     int count = 0;
     std::vector<std::pair<std::string, PrintObject*>> object_filenames;
+    std::vector<std::pair<std::string, PrintObject*>> binary_filenames;
     size_t region_cnt = this->num_print_regions();
     size_t hash_values = 0;
     for (size_t region_idx = 0; region_idx < region_cnt; region_idx++)
@@ -4288,8 +4407,15 @@ int Print::load_cached_data(const std::string& directory)
             BOOST_LOG_TRIVIAL(info) << __FUNCTION__<< boost::format(": object %1%'s loaded_id is 0, need to use the instance_id %2%")%model_obj->name %identify_id;
             //continue;
         }
-        std::string file_name = directory + "/obj_" + std::to_string(identify_id) + "_" + std::to_string(region_cnt) + "_" + std::to_string(hash_values) + ".json";
+        std::string file_stem = directory + "/obj_" + std::to_string(identify_id) + "_" + std::to_string(region_cnt) + "_" + std::to_string(hash_values);
+        std::string file_name = file_stem + SliceCache::FILE_EXTENSION;
+        if (fs::exists(file_name)) {
+            binary_filenames.push_back({file_name, obj});
+            continue;
+        }
 
+        //fallback to the json format
+        file_name = file_stem + ".json";
         if (!fs::exists(file_name)) {
             BOOST_LOG_TRIVIAL(warning) << __FUNCTION__<<boost::format(": file %1% not exist, maybe a shared object or not generated before, skip it")%file_name;
             continue;
@@ -4297,6 +4423,14 @@ int Print::load_cached_data(const std::string& directory)
         object_filenames.push_back({file_name, obj});
     }
 
+    for (const std::pair<std::string, PrintObject*>& binary_filename : binary_filenames) {
+        ret = load_object_from_slice_cache(binary_filename.second, binary_filename.first);
+        if (ret)
+            return ret;
+        count ++;
+    }
+    binary_filenames.clear();
+
     boost::mutex mutex;
     std::vector<json> object_jsons(object_filenames.size());
     tbb::parallel_for(
@@ -4364,7 +4498,7 @@ int Print::load_cached_data(const std::string& directory)
                 {
                     json& region_json = layer_json[JSON_LAYER_REGIONS][region_index];
                     size_t config_hash = region_json[JSON_LAYER_REGION_CONFIG_HASH];
-                    const PrintRegion *print_region = find_region(obj, config_hash);
+                    const PrintRegion *print_region = find_print_region(obj, config_hash);
 
                     if (!print_region){
                         BOOST_LOG_TRIVIAL(error) <<__FUNCTION__<< boost::format(":can not find print region of object %1%, layer %2%, print_z %3%, layer_region %4%")
@@ -18,6 +18,7 @@
 #include "MultiMaterialSegmentation.hpp"
 #include <libslic3r/SurfaceCollection.hpp>
 #include "MultiNozzleUtils.hpp"
+#include "Fingerprint.hpp"
 
 #include "libslic3r.h"
 
@@ -25,6 +26,7 @@
 
 #include <functional>
 #include <set>
+#include <unordered_map>
 #include "Calib.hpp"
 
 namespace Slic3r {
@@ -39,6 +41,8 @@ class SupportLayer;
 class TreeSupportData;
 class TreeSupport;
 class ExtrusionLayers;
+class SliceResultCache;
+class SeamVisibilityCache;
 
 #define MARGIN_HEIGHT   1.5
 #define MAX_OUTER_NOZZLE_RADIUS   4
@@ -504,6 +508,11 @@ public:
     void         clear_shared_object();
     void         copy_layers_from_shared_object();
     void         copy_layers_overhang_from_shared_object();
+    // BBS: fingerprint of the meshes, transformations, painted facets, layer height profile, layer ranges and the object / volume configs,
+    // objects with the same fingerprint share their slicing result. Updated by Print::process().
+    const Fingerprint128& fingerprint() const { return m_fingerprint; }
+    // The mesh fingerprints are cached by the ModelVolumes, only the meshes replaced since the last call are hashed again.
+    void         update_fingerprint();
 
     // BBS: Boundingbox of the first layer
     BoundingBox                 firstLayerObjectBrimBoundingBox;
@@ -535,8 +544,11 @@ private:
     bool                    invalidate_all_steps();
     // Invalidate steps based on a set of parameters changed.
     // It may be called for both the PrintObjectConfig and PrintRegionConfig.
+    // BBS: z_ranges are the layer ranges using a modified PrintRegion. If only the walls and infill are invalidated,
+    // the layers outside of z_ranges keep their walls and infill, see LayersToRegenerate.
     bool                    invalidate_state_by_config_options(
-        const ConfigOptionResolver &old_config, const ConfigOptionResolver &new_config, const std::vector<t_config_option_key> &opt_keys);
+        const ConfigOptionResolver &old_config, const ConfigOptionResolver &new_config, const std::vector<t_config_option_key> &opt_keys,
+        const std::vector<t_layer_height_range> *z_ranges = nullptr);
     // If ! m_slicing_params.valid, recalculate.
     void                    update_slicing_parameters();
 
@@ -586,6 +598,31 @@ private:
         const std::vector<std::pair<const Surface*, float>>& surfaces_w_bottom_z) const;
     FillLightning::GeneratorPtr prepare_lightning_infill_data();
 
+    // BBS: layers whose results of a per layer step have to be regenerated. After a change of the regions of some layer ranges,
+    // the other layers keep the walls and infill of the previous run.
+    struct LayersToRegenerate
+    {
+        // The results of the previous run are not valid for any layer.
+        bool              all { true };
+        // Layers to regenerate if not all.
+        std::vector<bool> layers;
+
+        void set_all()  { all = true; layers.clear(); }
+        void set_none() { all = false; layers.clear(); }
+        void mark(size_t layer_idx, size_t num_layers) {
+            if (! all) {
+                if (layers.size() < num_layers)
+                    layers.resize(num_layers, false);
+                layers[layer_idx] = true;
+            }
+        }
+        bool contains(size_t layer_idx) const { return all || (layer_idx < layers.size() && layers[layer_idx]); }
+    };
+    // Marks the layers sliced inside the z_ranges.
+    void                 mark_layers_to_regenerate(LayersToRegenerate &to_regenerate, const std::vector<t_layer_height_range> &z_ranges) const;
+    // Indices of the layers to regenerate.
+    std::vector<size_t>  layers_to_regenerate(const LayersToRegenerate &to_regenerate) const;
+
     // BBS
     SupportNecessaryType is_support_necessary();
     void                 merge_layer_node(const size_t layer_id, int &max_merged_id, std::map<int, std::vector<std::pair<int, int>>> &node_record);
@@ -619,6 +656,14 @@ private:
     std::pair<FillAdaptive::OctreePtr, FillAdaptive::OctreePtr> m_adaptive_fill_octrees;
     FillLightning::GeneratorPtr m_lightning_generator;
 
+    // BBS: walls regenerated by posPerimeters and simplified by posSimplifyWall.
+    LayersToRegenerate                      m_perimeters_to_regenerate;
+    // BBS: infill regenerated by posInfill, ironed by posIroning and simplified by posSimplifyInfill.
+    LayersToRegenerate                      m_infill_to_regenerate;
+    // BBS: hash of the fill surfaces and regions of each layer produced by the last posPrepareInfill, the layers whose
+    // hash changes regenerate their infill.
+    std::vector<size_t>                     m_fill_surfaces_hashes;
+
     std::vector < VolumeSlices >            firstLayerObjSliceByVolume;
     std::vector<groupedVolumeSlices>        firstLayerObjSliceByGroups;
 
@@ -626,6 +671,7 @@ private:
     ExtrusionEntityCollection               m_skirt;
 
     PrintObject*                            m_shared_object{ nullptr };
+    Fingerprint128                          m_fingerprint;
 
     // OrcaSlicer
     //
@@ -851,6 +897,20 @@ public:
     //return 0 means successful
     int                 export_cached_data(const std::string& dir_path, int& obj_cnt_exported, bool with_space=false);
     int                 load_cached_data(const std::string& directory);
+    // BBS: persistent cache of the per object slicing results, consulted by process() before processing an object.
+    void                set_slice_result_cache(std::shared_ptr<SliceResultCache> cache) { m_slice_result_cache = std::move(cache); }
+    // BBS: visibility of the object meshes computed by the seam placer, kept for the next G-code export until clear().
+    SeamVisibilityCache& seam_visibility_cache();
+    // BBS: limit of the layer G-code held in memory by export_gcode() for the z direction speed smoothing in bytes, 0 means no limit.
+    void                set_gcode_memory_limit(size_t bytes) { m_gcode_memory_limit = bytes; }
+    // BBS: number of the layers whose travel boundaries are precomputed in parallel by export_gcode(), 0 computes them on demand.
+    void                set_travel_boundaries_lookahead(size_t layers) { m_travel_boundaries_lookahead = layers; }
+    // BBS: number of the boundary geometries whose planned travels are cached by export_gcode(), 0 disables the cache.
+    void                set_travel_cache_size(size_t geometries) { m_travel_cache_size = geometries; }
+    // BBS: time limit in ms and threads of the filament grouping solvers, 0 uses their defaults.
+    void                set_filament_group_solver(int time_limit_ms, int threads) { m_filament_group_time_limit = time_limit_ms; m_filament_group_threads = threads; }
+    int                 filament_group_time_limit() const { return m_filament_group_time_limit; }
+    int                 filament_group_threads() const { return m_filament_group_threads; }
 
     // methods for handling state
     bool                is_step_done(PrintStep step) const { return Inherited::is_step_done(step); }
@@ -1106,6 +1166,13 @@ private:
     bool              m_has_auto_filament_map_result{false};
 
     std::set<PrintObject*> m_reslicing_objects;
+    std::shared_ptr<SliceResultCache> m_slice_result_cache;
+    std::shared_ptr<SeamVisibilityCache> m_seam_visibility_cache;
+    size_t            m_gcode_memory_limit { size_t(1024) << 20 };
+    size_t            m_travel_boundaries_lookahead { 16 };
+    size_t            m_travel_cache_size { 32 };
+    int               m_filament_group_time_limit { 0 };
+    int               m_filament_group_threads { 0 };
 
     std::vector<std::set<int>> m_geometric_unprintable_filaments;
     std::unordered_map<int, std::unordered_map<int, double>> m_filament_print_time;
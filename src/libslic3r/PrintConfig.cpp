@@ -8760,6 +8760,29 @@ CLITransformConfigDef::CLITransformConfigDef()
     //def->cli = "arrange|a";
     def->set_default_value(new ConfigOptionInt(0));
 
+    def = this->add("arrange_attempts", coInt);
+    def->label = "Arrange attempts";
+    def->tooltip = "Number of arrangements tried in parallel with different item orders and rotations, the best one is kept. "
+                   "1 runs the single greedy arrangement. Not used for the by object print sequence";
+    def->cli_params = "count";
+    def->min = 1;
+    def->set_default_value(new ConfigOptionInt(1));
+
+    def = this->add("arrange_time_limit", coFloat);
+    def->label = "Arrange time limit";
+    def->tooltip = "Time limit in seconds for the additional arrangement attempts, the first attempt always finishes. 0 means no limit";
+    def->cli_params = "seconds";
+    def->min = 0;
+    def->set_default_value(new ConfigOptionFloat(0.));
+
+    def = this->add("arrange_raster_threshold", coInt);
+    def->label = "Arrange raster threshold";
+    def->tooltip = "Arrange on a raster of the bed once there are more objects than this, which is much faster for hundreds of objects "
+                   "but loses up to a pixel of 0.5mm of spacing. 0 always arranges with the no fit polygons";
+    def->cli_params = "count";
+    def->min = 0;
+    def->set_default_value(new ConfigOptionInt(0));
+
     def = this->add("repetitions", coInt);
     def->label = "Repetition count";
     def->tooltip = "Repetition count of the whole model";
@@ -9035,6 +9058,42 @@ CLIMiscConfigDef::CLIMiscConfigDef()
     def->tooltip = "Camera view angle for exporting png: 0-Iso, 1-Top_Front, 2-Left, 3-Right, 10-Iso_1, 11-Iso_2, 12-Iso_3";
     def->cli_params = "angle";
     def->set_default_value(new ConfigOptionInt(0));
+
+    def = this->add("slice_cache", coString);
+    def->label = "Slice result cache directory";
+    def->tooltip = "Reuse the slicing results of objects with the same geometry and settings from previous runs, stored in this directory";
+    def->cli_params = "slice_cache_directory";
+    def->set_default_value(new ConfigOptionString());
+
+    def = this->add("slice_cache_size", coInt);
+    def->label = "Slice result cache size";
+    def->tooltip = "Size limit of the slice result cache in MB, the least recently used results are removed when exceeded. 0 means no limit";
+    def->cli_params = "size";
+    def->min = 0;
+    def->set_default_value(new ConfigOptionInt(4096));
+
+    def = this->add("gcode_memory_limit", coInt);
+    def->label = "G-code memory limit";
+    def->tooltip = "Memory limit in MB for the G-code of the layers held while smoothing the outer wall speed in z direction. "
+                   "The layers above the limit are stored in a temporary file. 0 means no limit";
+    def->cli_params = "size";
+    def->min = 0;
+    def->set_default_value(new ConfigOptionInt(1024));
+
+    def = this->add("filament_group_time_limit", coInt);
+    def->label = "Filament grouping time limit";
+    def->tooltip = "Time limit in ms of the automatic filament grouping, the best grouping found so far is used when it runs out. "
+                   "0 uses the default limit of the grouping method";
+    def->cli_params = "ms";
+    def->min = 0;
+    def->set_default_value(new ConfigOptionInt(0));
+
+    def = this->add("filament_group_threads", coInt);
+    def->label = "Filament grouping threads";
+    def->tooltip = "Number of threads running the restarts of the automatic filament grouping. 0 uses all the cores";
+    def->cli_params = "count";
+    def->min = 0;
+    def->set_default_value(new ConfigOptionInt(0));
 }
 
 const CLIActionsConfigDef    cli_actions_config_def;
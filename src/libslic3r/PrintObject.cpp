@@ -25,6 +25,7 @@
 #include <string_view>
 #include <utility>
 
+#include <boost/functional/hash.hpp>
 #include <boost/log/trivial.hpp>
 
 #include <tbb/parallel_for.h>
@@ -482,14 +483,21 @@ void PrintObject::make_perimeters()
     }
 #endif
 
+    // BBS: the perimeter continuity is calculated over all layers from scratch.
+    if (this->m_print->m_config.z_direction_outwall_speed_continuous)
+        m_perimeters_to_regenerate.set_all();
+    std::vector<size_t> layers_to_regenerate = this->layers_to_regenerate(m_perimeters_to_regenerate);
+    if (layers_to_regenerate.size() < m_layers.size())
+        BOOST_LOG_TRIVIAL(info) << "Regenerating walls of " << layers_to_regenerate.size() << " of " << m_layers.size() << " layers";
+
     BOOST_LOG_TRIVIAL(debug) << "Generating perimeters in parallel - start";
 #if 1
     tbb::parallel_for(
-        tbb::blocked_range<size_t>(0, m_layers.size()),
-        [this](const tbb::blocked_range<size_t>& range) {
-            for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+        tbb::blocked_range<size_t>(0, layers_to_regenerate.size()),
+        [this, &layers_to_regenerate](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
                 m_print->throw_if_canceled();
-                m_layers[layer_idx]->make_perimeters();
+                m_layers[layers_to_regenerate[i]]->make_perimeters();
             }
         }
     );
@@ -548,6 +556,34 @@ void PrintObject::make_perimeters()
     this->set_done(posPerimeters);
 }
 
+// BBS: everything of a layer the infill generation depends on, which is produced by posPrepareInfill.
+static size_t layer_fill_surfaces_hash(const Layer &layer)
+{
+    size_t seed = 0;
+    auto hash_surfaces = [&seed](const SurfaceCollection &surfaces) {
+        for (const Surface &surface : surfaces.surfaces) {
+            boost::hash_combine(seed, int(surface.surface_type));
+            boost::hash_combine(seed, surface.thickness);
+            boost::hash_combine(seed, surface.thickness_layers);
+            boost::hash_combine(seed, surface.bridge_angle);
+            boost::hash_combine(seed, surface.extra_perimeters);
+            for (const Polygon &polygon : to_polygons(surface.expolygon)) {
+                boost::hash_combine(seed, polygon.points.size());
+                for (const Point &pt : polygon.points) {
+                    boost::hash_combine(seed, pt.x());
+                    boost::hash_combine(seed, pt.y());
+                }
+            }
+        }
+    };
+    for (const LayerRegion *layerm : layer.regions()) {
+        boost::hash_combine(seed, layerm->region().config_hash());
+        hash_surfaces(layerm->slices);
+        hash_surfaces(layerm->fill_surfaces);
+    }
+    return seed;
+}
+
 void PrintObject::prepare_infill()
 {
     if (! this->set_started(posPrepareInfill))
@@ -673,6 +709,20 @@ void PrintObject::prepare_infill()
     } // for each layer
 #endif /* SLIC3R_DEBUG_SLICE_PROCESSING */
 
+    // BBS: the infill of a layer is regenerated if its fill surfaces or regions changed or if its walls were regenerated.
+    std::vector<size_t> fill_surfaces_hashes(m_layers.size(), 0);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, m_layers.size()), [this, &fill_surfaces_hashes](const tbb::blocked_range<size_t> &range) {
+        for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx)
+            fill_surfaces_hashes[layer_idx] = layer_fill_surfaces_hash(*m_layers[layer_idx]);
+    });
+    if (m_perimeters_to_regenerate.all || m_fill_surfaces_hashes.size() != m_layers.size())
+        m_infill_to_regenerate.set_all();
+    else
+        for (size_t layer_idx = 0; layer_idx < m_layers.size(); ++ layer_idx)
+            if (m_perimeters_to_regenerate.contains(layer_idx) || fill_surfaces_hashes[layer_idx] != m_fill_surfaces_hashes[layer_idx])
+                m_infill_to_regenerate.mark(layer_idx, m_layers.size());
+    m_fill_surfaces_hashes = std::move(fill_surfaces_hashes);
+
     this->set_done(posPrepareInfill);
 }
 
@@ -687,13 +737,28 @@ void PrintObject::infill()
         const auto& adaptive_fill_octree = this->m_adaptive_fill_octrees.first;
         const auto& support_fill_octree = this->m_adaptive_fill_octrees.second;
 
+        // BBS: the adaptive and lightning infill are generated for the whole object at once, the locked zag infill
+        // modifies the fill surfaces read by the layer above.
+        if (adaptive_fill_octree || support_fill_octree || m_lightning_generator ||
+            std::any_of(m_shared_regions->all_regions.begin(), m_shared_regions->all_regions.end(),
+                [](const std::unique_ptr<PrintRegion> &region) { return region->config().sparse_infill_pattern == ipLockedZag; }))
+            m_infill_to_regenerate.set_all();
+        // The infill of a layer is anchored to the infill of the layer below.
+        if (! m_infill_to_regenerate.all)
+            for (size_t layer_idx = m_layers.size() - 1; layer_idx > 0; -- layer_idx)
+                if (m_infill_to_regenerate.contains(layer_idx - 1))
+                    m_infill_to_regenerate.mark(layer_idx, m_layers.size());
+        std::vector<size_t> layers_to_regenerate = this->layers_to_regenerate(m_infill_to_regenerate);
+        if (layers_to_regenerate.size() < m_layers.size())
+            BOOST_LOG_TRIVIAL(info) << "Regenerating infill of " << layers_to_regenerate.size() << " of " << m_layers.size() << " layers";
+
         //BOOST_LOG_TRIVIAL(debug) << "Filling layers in parallel - start";
         tbb::parallel_for(
-           tbb::blocked_range<size_t>(0, m_layers.size()),
-           [this, &adaptive_fill_octree = adaptive_fill_octree, &support_fill_octree = support_fill_octree](const tbb::blocked_range<size_t>& range) {
-               for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+           tbb::blocked_range<size_t>(0, layers_to_regenerate.size()),
+           [this, &layers_to_regenerate, &adaptive_fill_octree = adaptive_fill_octree, &support_fill_octree = support_fill_octree](const tbb::blocked_range<size_t>& range) {
+               for (size_t i = range.begin(); i < range.end(); ++ i) {
                    m_print->throw_if_canceled();
-                   m_layers[layer_idx]->make_fills(adaptive_fill_octree.get(), support_fill_octree.get(), this->m_lightning_generator.get());
+                   m_layers[layers_to_regenerate[i]]->make_fills(adaptive_fill_octree.get(), support_fill_octree.get(), this->m_lightning_generator.get());
                 }
            }
         );
@@ -709,14 +774,16 @@ void PrintObject::infill()
 void PrintObject::ironing()
 {
     if (this->set_started(posIroning)) {
+        // BBS: the ironing is appended to the infill, thus only the layers with regenerated infill are ironed.
+        std::vector<size_t> layers_to_regenerate = this->layers_to_regenerate(m_infill_to_regenerate);
         BOOST_LOG_TRIVIAL(debug) << "Ironing in parallel - start";
         tbb::parallel_for(
             // Ironing starting with layer 0 to support ironing all surfaces.
-            tbb::blocked_range<size_t>(0, m_layers.size()),
-            [this](const tbb::blocked_range<size_t>& range) {
-                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+            tbb::blocked_range<size_t>(0, layers_to_regenerate.size()),
+            [this, &layers_to_regenerate](const tbb::blocked_range<size_t>& range) {
+                for (size_t i = range.begin(); i < range.end(); ++ i) {
                     m_print->throw_if_canceled();
-                    m_layers[layer_idx]->make_ironing();
+                    m_layers[layers_to_regenerate[i]]->make_ironing();
                 }
             }
         );
@@ -832,37 +899,41 @@ void PrintObject::simplify_extrusion_path()
     if (this->set_started(posSimplifyWall)) {
         m_print->set_status(75, L("Optimizing toolpath"));
         BOOST_LOG_TRIVIAL(debug) << "Simplify wall extrusion path of object in parallel - start";
-        //BBS: walls
+        //BBS: walls, the walls kept from the previous run are simplified already
+        std::vector<size_t> layers_to_regenerate = this->layers_to_regenerate(m_perimeters_to_regenerate);
         tbb::parallel_for(
-            tbb::blocked_range<size_t>(0, m_layers.size()),
-            [this](const tbb::blocked_range<size_t>& range) {
-                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+            tbb::blocked_range<size_t>(0, layers_to_regenerate.size()),
+            [this, &layers_to_regenerate](const tbb::blocked_range<size_t>& range) {
+                for (size_t i = range.begin(); i < range.end(); ++ i) {
                     m_print->throw_if_canceled();
-                    m_layers[layer_idx]->simplify_wall_extrusion_path();
+                    m_layers[layers_to_regenerate[i]]->simplify_wall_extrusion_path();
                 }
             }
         );
         m_print->throw_if_canceled();
         BOOST_LOG_TRIVIAL(debug) << "Simplify wall extrusion path of object in parallel - end";
         this->set_done(posSimplifyWall);
+        m_perimeters_to_regenerate.set_none();
     }
 
     if (this->set_started(posSimplifyInfill)) {
         m_print->set_status(75, L("Optimizing toolpath"));
         BOOST_LOG_TRIVIAL(debug) << "Simplify infill extrusion path of object in parallel - start";
         //BBS: infills
+        std::vector<size_t> layers_to_regenerate = this->layers_to_regenerate(m_infill_to_regenerate);
         tbb::parallel_for(
-            tbb::blocked_range<size_t>(0, m_layers.size()),
-            [this](const tbb::blocked_range<size_t>& range) {
-                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++layer_idx) {
+            tbb::blocked_range<size_t>(0, layers_to_regenerate.size()),
+            [this, &layers_to_regenerate](const tbb::blocked_range<size_t>& range) {
+                for (size_t i = range.begin(); i < range.end(); ++i) {
                     m_print->throw_if_canceled();
-                    m_layers[layer_idx]->simplify_infill_extrusion_path();
+                    m_layers[layers_to_regenerate[i]]->simplify_infill_extrusion_path();
                 }
             }
         );
         m_print->throw_if_canceled();
         BOOST_LOG_TRIVIAL(debug) << "Simplify infill extrusion path of object in parallel - end";
         this->set_done(posSimplifyInfill);
+        m_infill_to_regenerate.set_none();
     }
 
     if (this->set_started(posSimplifySupportPath)) {
@@ -939,6 +1010,10 @@ void PrintObject::clear_layers()
             delete l;
         m_layers.clear();
     }
+    // BBS: the new layers keep no results of a previous run.
+    m_perimeters_to_regenerate.set_all();
+    m_infill_to_regenerate.set_all();
+    m_fill_surfaces_hashes.clear();
 }
 
 Layer* PrintObject::add_layer(int id, coordf_t height, coordf_t print_z, coordf_t slice_z)
@@ -1003,13 +1078,15 @@ SupportLayerPtrs::iterator PrintObject::insert_support_layer(SupportLayerPtrs::i
 // Called by Print::apply().
 // This method only accepts PrintObjectConfig and PrintRegionConfig option keys.
 bool PrintObject::invalidate_state_by_config_options(
-    const ConfigOptionResolver &old_config, const ConfigOptionResolver &new_config, const std::vector<t_config_option_key> &opt_keys)
+    const ConfigOptionResolver &old_config, const ConfigOptionResolver &new_config, const std::vector<t_config_option_key> &opt_keys,
+    const std::vector<t_layer_height_range> *z_ranges)
 {
     if (opt_keys.empty())
         return false;
 
     std::vector<PrintObjectStep> steps;
     bool invalidated = false;
+    bool invalidated_all = false;
     for (const t_config_option_key &opt_key : opt_keys) {
         if (   opt_key == "brim_width"
             || opt_key == "brim_object_gap"
@@ -1285,19 +1362,62 @@ bool PrintObject::invalidate_state_by_config_options(
             // for legacy, if we can't handle this option let's invalidate all steps
             this->invalidate_all_steps();
             invalidated = true;
+            invalidated_all = true;
         }
     }
 
     sort_remove_duplicates(steps);
+    // BBS: if only the walls and infill are invalidated, the layers outside of z_ranges keep the walls and infill they have,
+    // unless these were invalidated for all layers already.
+    bool regenerate_z_ranges = z_ranges != nullptr && ! invalidated_all &&
+        std::all_of(steps.begin(), steps.end(), [](PrintObjectStep step) {
+            return step == posPerimeters || step == posPrepareInfill || step == posInfill || step == posSupportMaterial; }) &&
+        std::any_of(steps.begin(), steps.end(), [](PrintObjectStep step) { return step != posSupportMaterial; });
+    LayersToRegenerate perimeters_to_regenerate = m_perimeters_to_regenerate;
+    LayersToRegenerate infill_to_regenerate     = m_infill_to_regenerate;
     for (PrintObjectStep step : steps)
         invalidated |= this->invalidate_step(step);
+    if (regenerate_z_ranges) {
+        if (std::binary_search(steps.begin(), steps.end(), posPerimeters))
+            this->mark_layers_to_regenerate(perimeters_to_regenerate, *z_ranges);
+        this->mark_layers_to_regenerate(infill_to_regenerate, *z_ranges);
+        m_perimeters_to_regenerate = std::move(perimeters_to_regenerate);
+        m_infill_to_regenerate     = std::move(infill_to_regenerate);
+    }
     return invalidated;
 }
 
+void PrintObject::mark_layers_to_regenerate(LayersToRegenerate &to_regenerate, const std::vector<t_layer_height_range> &z_ranges) const
+{
+    // The layers are assigned to the layer ranges by their slice_z, see slices_to_regions().
+    for (size_t layer_idx = 0; layer_idx < m_layers.size(); ++ layer_idx) {
+        const coordf_t slice_z = m_layers[layer_idx]->slice_z;
+        if (std::any_of(z_ranges.begin(), z_ranges.end(), [slice_z](const t_layer_height_range &range) {
+                return range.first - EPSILON <= slice_z && slice_z <= range.second + EPSILON; }))
+            to_regenerate.mark(layer_idx, m_layers.size());
+    }
+}
+
+std::vector<size_t> PrintObject::layers_to_regenerate(const LayersToRegenerate &to_regenerate) const
+{
+    std::vector<size_t> out;
+    out.reserve(m_layers.size());
+    for (size_t layer_idx = 0; layer_idx < m_layers.size(); ++ layer_idx)
+        if (to_regenerate.contains(layer_idx))
+            out.emplace_back(layer_idx);
+    return out;
+}
+
 bool PrintObject::invalidate_step(PrintObjectStep step)
 {
 	bool invalidated = Inherited::invalidate_step(step);
 
+    // BBS: the results of all layers are invalid, posPrepareInfill invalidates posSimplifyWall.
+    if (step == posSlice || step == posPerimeters || step == posPrepareInfill || step == posSimplifyWall)
+        m_perimeters_to_regenerate.set_all();
+    if (step == posSlice || step == posPerimeters || step == posPrepareInfill || step == posInfill || step == posIroning || step == posSimplifyInfill)
+        m_infill_to_regenerate.set_all();
+
     // propagate to dependent steps
     if (step == posPerimeters) {
 		invalidated |= this->invalidate_steps({ posPrepareInfill, posInfill, posIroning, posSimplifyWall, posSimplifyInfill });
@@ -1332,6 +1452,8 @@ bool PrintObject::invalidate_all_steps()
     bool result = Inherited::invalidate_all_steps() | m_print->invalidate_all_steps();
 	// Then reset some of the depending values.
 	m_slicing_params.valid = false;
+    m_perimeters_to_regenerate.set_all();
+    m_infill_to_regenerate.set_all();
 	return result;
 }
 
@@ -0,0 +1,182 @@
+#include "SliceResultCache.hpp"
+
+#include "libslic3r.h"
+#include "libslic3r_version.h"
+#include "Exception.hpp"
+#include "Print.hpp"
+#include "Format/SliceCache.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/log/trivial.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace Slic3r {
+
+SliceResultCache::SliceResultCache(const std::string &directory, uint64_t max_size) :
+    m_directory(directory), m_max_size(max_size)
+{
+    try {
+        if (! fs::exists(m_directory))
+            fs::create_directories(m_directory);
+        // Pick up the entries of the previous sessions, their modification time is their last use.
+        for (const fs::directory_entry &dir_entry : fs::directory_iterator(m_directory)) {
+            const fs::path &file = dir_entry.path();
+            if (! fs::is_regular_file(file) || file.extension() != SliceCache::FILE_EXTENSION)
+                continue;
+            Entry entry;
+            entry.size      = fs::file_size(file);
+            entry.last_used = fs::last_write_time(file);
+            m_stats.size += entry.size;
+            m_entries.emplace(file.stem().string(), entry);
+        }
+    } catch (const std::exception &err) {
+        throw Slic3r::FileIOError("Slice result cache: failed to open " + m_directory + ": " + err.what());
+    }
+    m_stats.entries = m_entries.size();
+    BOOST_LOG_TRIVIAL(info) << boost::format("slice result cache %1%: %2% entries, %3% bytes, limit %4% bytes") % m_directory % m_stats.entries % m_stats.size % m_max_size;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    this->evict();
+}
+
+Fingerprint128 SliceResultCache::key(const PrintObject &object)
+{
+    Fingerprint128Builder builder;
+    builder.update(std::string(SLIC3R_VERSION));
+    builder.update(uint64_t(SliceCache::FORMAT_VERSION));
+    builder.update(object.fingerprint());
+    builder.update(uint64_t(object.config().hash()));
+    builder.update(uint64_t(object.num_printing_regions()));
+    for (size_t region_id = 0; region_id < object.num_printing_regions(); ++ region_id)
+        builder.update(uint64_t(object.printing_region(region_id).config_hash()));
+    // The whole print config is included, as supports, rafts and the first layer depend on some of its options.
+    // Changing just the G-code related options thus misses the cache, which is safe.
+    builder.update(uint64_t(object.print()->config().hash()));
+    return builder.result();
+}
+
+std::string SliceResultCache::path(const std::string &name) const
+{
+    return (fs::path(m_directory) / (name + SliceCache::FILE_EXTENSION)).string();
+}
+
+std::string SliceResultCache::lookup(const Fingerprint128 &key)
+{
+    std::string name = key.to_string();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(name);
+    if (it == m_entries.end() || ! fs::exists(this->path(name))) {
+        if (it != m_entries.end()) {
+            // Removed by another process.
+            m_stats.size -= it->second.size;
+            m_entries.erase(it);
+            m_stats.entries = m_entries.size();
+        }
+        ++ m_stats.misses;
+        return {};
+    }
+    ++ m_stats.hits;
+    it->second.last_used = time(nullptr);
+    it->second.sequence  = ++ m_sequence;
+    try {
+        // Keep the LRU order for the next sessions.
+        fs::last_write_time(this->path(name), it->second.last_used);
+    } catch (const std::exception &err) {
+        BOOST_LOG_TRIVIAL(warning) << "slice result cache: failed to touch " << this->path(name) << ", reason = " << err.what();
+    }
+    return this->path(name);
+}
+
+void SliceResultCache::invalidate(const Fingerprint128 &key)
+{
+    std::string name = key.to_string();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(name);
+    if (it == m_entries.end())
+        return;
+    boost::system::error_code ec;
+    fs::remove(this->path(name), ec);
+    m_stats.size -= it->second.size;
+    m_entries.erase(it);
+    m_stats.entries = m_entries.size();
+    // The lookup was counted as a hit.
+    -- m_stats.hits;
+    ++ m_stats.misses;
+}
+
+void SliceResultCache::store(const Fingerprint128 &key, const PrintObject &object)
+{
+    std::string name      = key.to_string();
+    std::string file_path = this->path(name);
+    // Write into a temporary file first, so that other processes sharing the cache never see a partially written entry.
+    std::string tmp_path  = file_path + "." + fs::unique_path().string() + ".tmp";
+    Entry       entry;
+    try {
+        SliceCache::save_object(tmp_path, object, object.model_object()->name, 0, SliceCache::first_layer_groups_with_volume_indices(object));
+        fs::rename(tmp_path, file_path);
+        entry.size = fs::file_size(file_path);
+    } catch (const std::exception &err) {
+        BOOST_LOG_TRIVIAL(error) << "slice result cache: failed to store " << file_path << ", reason = " << err.what();
+        boost::system::error_code ec;
+        fs::remove(tmp_path, ec);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    entry.last_used = time(nullptr);
+    entry.sequence  = ++ m_sequence;
+    auto [it, inserted] = m_entries.emplace(name, entry);
+    if (! inserted) {
+        m_stats.size -= it->second.size;
+        it->second = entry;
+    }
+    m_stats.size += entry.size;
+    m_stats.entries = m_entries.size();
+    ++ m_stats.stored;
+    this->evict();
+}
+
+void SliceResultCache::evict()
+{
+    if (m_max_size == 0 || m_stats.size <= m_max_size)
+        return;
+    std::vector<std::map<std::string, Entry>::iterator> lru;
+    lru.reserve(m_entries.size());
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++ it)
+        lru.emplace_back(it);
+    std::sort(lru.begin(), lru.end(), [](auto l, auto r) {
+        return l->second.last_used < r->second.last_used || (l->second.last_used == r->second.last_used && l->second.sequence < r->second.sequence);
+    });
+    for (auto it : lru) {
+        if (m_stats.size <= m_max_size)
+            break;
+        boost::system::error_code ec;
+        fs::remove(this->path(it->first), ec);
+        if (ec)
+            BOOST_LOG_TRIVIAL(warning) << "slice result cache: failed to remove " << this->path(it->first) << ", reason = " << ec.message();
+        m_stats.size -= it->second.size;
+        ++ m_stats.evicted;
+        m_entries.erase(it);
+    }
+    m_stats.entries = m_entries.size();
+}
+
+SliceResultCache::Statistics SliceResultCache::statistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void SliceResultCache::log_statistics() const
+{
+    Statistics stats = this->statistics();
+    BOOST_LOG_TRIVIAL(info) << boost::format("slice result cache %1%: hits %2%, misses %3%, stored %4%, evicted %5%, %6% entries, %7% bytes")
+        % m_directory % stats.hits % stats.misses % stats.stored % stats.evicted % stats.entries % stats.size;
+}
+
+} // namespace Slic3r
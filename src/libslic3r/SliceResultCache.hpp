@@ -0,0 +1,74 @@
+#ifndef slic3r_SliceResultCache_hpp_
+#define slic3r_SliceResultCache_hpp_
+
+#include "Fingerprint.hpp"
+
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace Slic3r {
+
+class PrintObject;
+
+// BBS: persistent, content addressed cache of the per object slicing results (layers, extrusions, support layers),
+// shared by the slicing sessions using the same cache directory. The entries are stored in the SliceCache binary
+// format, named by the key of the object. When the total size exceeds the limit, the least recently used entries
+// are removed. The cache may be shared by several threads of one process.
+class SliceResultCache
+{
+public:
+    struct Statistics
+    {
+        size_t      hits    { 0 };
+        size_t      misses  { 0 };
+        size_t      stored  { 0 };
+        size_t      evicted { 0 };
+        size_t      entries { 0 };
+        uint64_t    size    { 0 };
+    };
+
+    // max_size in bytes, 0 means no limit. Creates the directory if it does not exist, throws Slic3r::FileIOError on failure.
+    SliceResultCache(const std::string &directory, uint64_t max_size);
+
+    // Key of the slicing result of an object: the content fingerprint of the object combined with the configs of the object,
+    // of its regions and of the print, the format version and the application version.
+    static Fingerprint128   key(const PrintObject &object);
+
+    // Returns the path of the cached result or an empty string, updates the statistics.
+    std::string             lookup(const Fingerprint128 &key);
+    // Called after the cached result failed to load, the entry is dropped.
+    void                    invalidate(const Fingerprint128 &key);
+    // Save the slicing result of an object, which has to be processed up to posDetectOverhangsForLift.
+    // Errors are logged, the result is just not cached then.
+    void                    store(const Fingerprint128 &key, const PrintObject &object);
+
+    Statistics              statistics() const;
+    void                    log_statistics() const;
+
+private:
+    struct Entry
+    {
+        uint64_t    size      { 0 };
+        time_t      last_used { 0 };
+        // Orders entries used within the same second.
+        uint64_t    sequence  { 0 };
+    };
+
+    std::string             path(const std::string &name) const;
+    // Remove least recently used entries until the size limit is met. Called with m_mutex locked.
+    void                    evict();
+
+    std::string                     m_directory;
+    uint64_t                        m_max_size;
+    mutable std::mutex              m_mutex;
+    std::map<std::string, Entry>    m_entries;
+    uint64_t                        m_sequence { 0 };
+    Statistics                      m_stats;
+};
+
+} // namespace Slic3r
+
+#endif /* slic3r_SliceResultCache_hpp_ */
@@ -1,4 +1,5 @@
 #include <chrono>
+#include <new>
 #include <math.h>
 
 #include "format.hpp"
@@ -25,6 +26,7 @@
 #include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
 
+#include <boost/format.hpp>
 #include <boost/log/trivial.hpp>
 // #include <boost/log/core.hpp>
 // #include <boost/log/expressions.hpp>
@@ -2837,20 +2839,18 @@ void TreeSupport::drop_nodes()
             }
         }
         // parallel pre-compute avoidance
-        tbb::parallel_for(tbb::blocked_range<size_t>(0, contact_nodes.size() - 1), [&](const tbb::blocked_range<size_t> &range) {
-            for (size_t layer_nr = range.begin(); layer_nr < range.end(); layer_nr++) {
-            for (auto node_radius : all_layer_radius[layer_nr]) {
-                size_t obj_layer_nr= layer_heights[layer_nr].obj_layer_nr;
-                m_ts_data->get_avoidance(node_radius, obj_layer_nr);
-                get_collision(0, obj_layer_nr);
-                get_collision(node_radius, obj_layer_nr);
-            }
+        std::vector<std::set<coordf_t>> obj_layer_radius(m_object->layers().size());
+        for (size_t layer_nr = 0; layer_nr < contact_nodes.size() - 1; layer_nr++) {
+            size_t obj_layer_nr = layer_heights[layer_nr].obj_layer_nr;
+            if (obj_layer_nr < obj_layer_radius.size())
+                obj_layer_radius[obj_layer_nr].insert(all_layer_radius[layer_nr].begin(), all_layer_radius[layer_nr].end());
         }
-        });
+        m_ts_data->precompute_radius_ladder(obj_layer_radius);
 
         double duration{ std::chrono::duration_cast<second_>(clock_::now() - t0).count() };
-        BOOST_LOG_TRIVIAL(debug) << "finish pre calculate_avoidance. before m_avoidance_cache.size()=" << m_ts_data->m_avoidance_cache.size()
-            << ", takes " << duration << " secs.";
+        TreeSupportData::CacheStats stats = m_ts_data->cache_stats();
+        BOOST_LOG_TRIVIAL(debug) << "finish pre calculate_avoidance. avoidance cache size=" << stats.avoidance_entries
+            << ", collision cache size=" << stats.collision_entries << ", takes " << duration << " secs.";
     }
 
     m_spanning_trees.resize(contact_nodes.size());
@@ -3441,7 +3441,11 @@ void TreeSupport::drop_nodes()
         }
     }
 
-    BOOST_LOG_TRIVIAL(debug) << "after m_avoidance_cache.size()=" << m_ts_data->m_avoidance_cache.size();
+    TreeSupportData::CacheStats stats = m_ts_data->cache_stats();
+    BOOST_LOG_TRIVIAL(debug) << boost::format("drop_nodes: avoidance cache size=%1%, collision cache size=%2%, hits %3%, misses %4%, waits %5%, lock wait %6% ms, hit rate %7%")
+        % stats.avoidance_entries % stats.collision_entries % stats.hits % stats.misses % stats.waits % stats.lock_wait_ms
+        % (stats.hits + stats.misses + stats.waits > 0 ? double(stats.hits + stats.waits) / double(stats.hits + stats.misses + stats.waits) : 0.);
+    BOOST_LOG_TRIVIAL(debug) << "drop_nodes: " << m_ts_data->node_arena.size() << " nodes in " << m_ts_data->node_arena.memory() << " bytes";
 }
 
 void TreeSupport::smooth_nodes()
@@ -4059,6 +4063,8 @@ TreeSupportData::TreeSupportData(const PrintObject &object, coordf_t xy_distance
     clear_nodes();
     m_max_move_distances.resize(object.layers().size(), 0);
     m_layer_outlines.resize(object.layers().size());
+    m_num_layer_caches = object.layers().size();
+    m_layer_caches     = std::make_unique<LayerCache[]>(m_num_layer_caches);
     m_layer_outlines_below.resize(object.layer_count());
     ExPolygons machine_border;
     ExPolygon  m_machine_border;
@@ -4095,13 +4101,57 @@ TreeSupportData::TreeSupportData(const PrintObject &object, coordf_t xy_distance
     }
 }
 
+template<class ComputeFn>
+const ExPolygons& TreeSupportData::get_cached(CacheMap LayerCache::*cache, coordf_t radius, size_t layer_nr, ComputeFn &&compute) const
+{
+    assert(layer_nr < m_num_layer_caches);
+    LayerCache &layer_cache = m_layer_caches[layer_nr];
+    CacheEntry *entry;
+    {
+        tbb::spin_mutex::scoped_lock lock;
+        if (! lock.try_acquire(layer_cache.mutex)) {
+            auto t0 = std::chrono::steady_clock::now();
+            lock.acquire(layer_cache.mutex);
+            m_cache_lock_wait_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+        }
+        std::unique_ptr<CacheEntry> &slot = (layer_cache.*cache)[radius];
+        if (! slot)
+            slot = std::make_unique<CacheEntry>();
+        entry = slot.get();
+    }
+    if (entry->ready.load(std::memory_order_acquire)) {
+        ++ m_cache_hits;
+        return entry->areas;
+    }
+    bool computed = false;
+    std::call_once(entry->computed, [&]() {
+        entry->areas = compute();
+        entry->ready.store(true, std::memory_order_release);
+        computed = true;
+    });
+    if (computed)
+        ++ m_cache_misses;
+    else
+        ++ m_cache_waits;
+    return entry->areas;
+}
+
+bool TreeSupportData::is_cached(CacheMap LayerCache::*cache, coordf_t radius, size_t layer_nr) const
+{
+    assert(layer_nr < m_num_layer_caches);
+    LayerCache &layer_cache = m_layer_caches[layer_nr];
+    tbb::spin_mutex::scoped_lock lock(layer_cache.mutex);
+    const CacheMap &map = layer_cache.*cache;
+    auto it = map.find(radius);
+    return it != map.end() && it->second->ready.load(std::memory_order_acquire);
+}
+
 const ExPolygons& TreeSupportData::get_collision(coordf_t radius, size_t layer_nr) const
 {
     profiler.tic();
     radius = ceil_radius(radius);
     RadiusLayerPair key{radius, layer_nr};
-    const auto it = m_collision_cache.find(key);
-    const ExPolygons& collision = it != m_collision_cache.end() ? it->second : calculate_collision(key);
+    const ExPolygons& collision = get_cached(&LayerCache::collision, radius, layer_nr, [this, &key]() { return calculate_collision(key); });
     profiler.stage_add(STAGE_get_collision);
     return collision;
 }
@@ -4111,13 +4161,59 @@ const ExPolygons& TreeSupportData::get_avoidance(coordf_t radius, size_t layer_n
     profiler.tic();
     radius = ceil_radius(radius);
     RadiusLayerPair key{radius, layer_nr, recursions };
-    const auto it = m_avoidance_cache.find(key);
-    const ExPolygons& avoidance = it != m_avoidance_cache.end() ? it->second : calculate_avoidance(key);
+    const ExPolygons& avoidance = get_cached(&LayerCache::avoidance, radius, layer_nr, [this, &key]() { return calculate_avoidance(key); });
 
     profiler.stage_add(STAGE_GET_AVOIDANCE);
     return avoidance;
 }
 
+void TreeSupportData::precompute_radius_ladder(const std::vector<std::set<coordf_t>>& layer_radii) const
+{
+    // highest layer using each radius, the avoidance of a radius is needed at all layers below
+    std::map<coordf_t, size_t> radius_top_layer;
+    for (size_t layer_nr = 0; layer_nr < layer_radii.size() && layer_nr < m_num_layer_caches; ++ layer_nr)
+        for (coordf_t radius : layer_radii[layer_nr]) {
+            size_t &top = radius_top_layer[ceil_radius(radius)];
+            top = std::max(top, layer_nr);
+        }
+    if (radius_top_layer.empty())
+        return;
+
+    std::vector<std::pair<coordf_t, size_t>> collisions;
+    for (size_t layer_nr = 0; layer_nr < layer_radii.size() && layer_nr < m_num_layer_caches; ++ layer_nr)
+        if (! layer_radii[layer_nr].empty())
+            collisions.emplace_back(0., layer_nr);
+    for (const auto &[radius, top] : radius_top_layer)
+        for (size_t layer_nr = 0; layer_nr <= top; ++ layer_nr)
+            collisions.emplace_back(radius, layer_nr);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, collisions.size()), [this, &collisions](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i)
+            get_collision(collisions[i].first, collisions[i].second);
+    });
+
+    std::vector<std::pair<coordf_t, size_t>> ladders(radius_top_layer.begin(), radius_top_layer.end());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, ladders.size(), 1), [this, &ladders](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i)
+            for (size_t layer_nr = 0; layer_nr <= ladders[i].second; ++ layer_nr)
+                get_avoidance(ladders[i].first, layer_nr);
+    });
+}
+
+TreeSupportData::CacheStats TreeSupportData::cache_stats() const
+{
+    CacheStats stats;
+    stats.hits         = m_cache_hits;
+    stats.misses       = m_cache_misses;
+    stats.waits        = m_cache_waits;
+    stats.lock_wait_ms = double(m_cache_lock_wait_ns) * 1e-6;
+    for (size_t layer_nr = 0; layer_nr < m_num_layer_caches; ++ layer_nr) {
+        tbb::spin_mutex::scoped_lock lock(m_layer_caches[layer_nr].mutex);
+        stats.collision_entries += m_layer_caches[layer_nr].collision.size();
+        stats.avoidance_entries += m_layer_caches[layer_nr].avoidance.size();
+    }
+    return stats;
+}
+
 Polygons TreeSupportData::get_contours(size_t layer_nr) const
 {
     Polygons contours;
@@ -4140,12 +4236,14 @@ Polygons TreeSupportData::get_contours_with_holes(size_t layer_nr) const
 
 SupportNode* TreeSupportData::create_node(const Point position, const int distance_to_top, const int obj_layer_nr, const int support_roof_layers_below, const bool to_buildplate, SupportNode* parent, coordf_t print_z_, coordf_t height_, coordf_t dist_mm_to_top_, coordf_t radius_)
 {
-    // this function may be called from multiple threads, need to lock
-    m_mutex.lock();
-    std::unique_ptr<SupportNode> node = std::make_unique<SupportNode>(position, distance_to_top, obj_layer_nr, support_roof_layers_below, to_buildplate, parent, print_z_, height_, dist_mm_to_top_, radius_);
-    SupportNode* raw_ptr = node.get();
-    contact_nodes.emplace_back(std::move(node));
-    m_mutex.unlock();
+    // this function may be called from multiple threads. The arena allocates from the chunks of the calling thread without a lock,
+    // the lock serializes the constructor setting the child of the parent and of its merged neighbours.
+    SupportNode* raw_ptr;
+    if (parent) {
+        tbb::spin_mutex::scoped_lock guard(m_mutex);
+        raw_ptr = node_arena.create(position, distance_to_top, obj_layer_nr, support_roof_layers_below, to_buildplate, parent, print_z_, height_, dist_mm_to_top_, radius_);
+    } else
+        raw_ptr = node_arena.create(position, distance_to_top, obj_layer_nr, support_roof_layers_below, to_buildplate, parent, print_z_, height_, dist_mm_to_top_, radius_);
     if (parent)
         raw_ptr->movement = position - parent->position;
     return raw_ptr;
@@ -4154,7 +4252,28 @@ SupportNode* TreeSupportData::create_node(const Point position, const int distan
 void TreeSupportData::clear_nodes()
 {
     tbb::spin_mutex::scoped_lock guard(m_mutex);
-    contact_nodes.clear();
+    node_arena.clear();
+}
+
+void SupportNodeArena::clear()
+{
+    for (ThreadChunks &local : m_chunks) {
+        for (size_t i = 0; i < local.chunks.size(); ++ i) {
+            size_t num_nodes = i + 1 == local.chunks.size() ? local.used : CHUNK_SIZE;
+            for (size_t j = 0; j < num_nodes; ++ j)
+                std::launder(reinterpret_cast<SupportNode*>(&local.chunks[i][j]))->~SupportNode();
+        }
+    }
+    m_chunks.clear();
+    m_size = 0;
+}
+
+size_t SupportNodeArena::memory() const
+{
+    size_t num_chunks = 0;
+    for (const ThreadChunks &local : m_chunks)
+        num_chunks += local.chunks.size();
+    return num_chunks * CHUNK_SIZE * sizeof(Storage);
 }
 
 coordf_t TreeSupportData::ceil_radius(coordf_t radius) const
@@ -4169,18 +4288,17 @@ coordf_t TreeSupportData::ceil_radius(coordf_t radius) const
     }
 }
 
-const ExPolygons& TreeSupportData::calculate_collision(const RadiusLayerPair& key) const
+ExPolygons TreeSupportData::calculate_collision(const RadiusLayerPair& key) const
 {
     assert(key.layer_nr < m_layer_outlines.size());
 
     ExPolygons collision_areas = std::move(offset_ex(m_layer_outlines[key.layer_nr], scale_(key.radius+m_xy_distance)));
     collision_areas = expolygons_simplify(collision_areas, scale_(m_radius_sample_resolution));
     // collision_areas.emplace_back(m_machine_border);
-    const auto ret = m_collision_cache.insert({ key, std::move(collision_areas) });
-    return ret.first->second;
+    return collision_areas;
 }
 
-const ExPolygons& TreeSupportData::calculate_avoidance(const RadiusLayerPair& key) const
+ExPolygons TreeSupportData::calculate_avoidance(const RadiusLayerPair& key) const
 {
     const auto &radius = key.radius;
     const auto &layer_nr = key.layer_nr;
@@ -4193,7 +4311,7 @@ const ExPolygons& TreeSupportData::calculate_avoidance(const RadiusLayerPair& ke
         // below our current one.
         constexpr auto max_recursion_depth = 100;
         // Check if we would exceed the recursion limit by trying to process this layer
-        if (layer_nr >= max_recursion_depth && m_avoidance_cache.find({radius, layer_nr - max_recursion_depth}) == m_avoidance_cache.end()) {
+        if (layer_nr >= max_recursion_depth && ! is_cached(&LayerCache::avoidance, radius, layer_nr - max_recursion_depth)) {
             // Force the calculation of the layer `max_recursion_depth` below our current one, ignoring the result.
             get_avoidance(radius, layer_nr - max_recursion_depth);
         }
@@ -4203,13 +4321,11 @@ const ExPolygons& TreeSupportData::calculate_avoidance(const RadiusLayerPair& ke
     const ExPolygons &collision       = get_collision(radius, layer_nr);
     avoidance_areas.insert(avoidance_areas.end(), collision.begin(), collision.end());
     avoidance_areas = std::move(union_ex(avoidance_areas));
-    auto ret = m_avoidance_cache.insert({key, std::move(avoidance_areas)});
-    //assert(ret.second);
     // BOOST_LOG_TRIVIAL(debug) << format("calculate_avoidance: radius=%.2f, layer_nr=%d, recursions=%d, avoidance_areas=%d", radius, layer_nr, key.recursions,
     //                                    avoidance_areas.size());
     // boost::log::core::get()->flush();
 
-    return ret.first->second;
+    return avoidance_areas;
 }
 
 } //namespace Slic3r
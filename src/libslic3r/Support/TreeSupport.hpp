@@ -1,9 +1,15 @@
 #ifndef TREESUPPORT_H
 #define TREESUPPORT_H
 
+#include <atomic>
 #include <forward_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 #include <unordered_set>
 #include "tbb/concurrent_unordered_map.h"
+#include "tbb/enumerable_thread_specific.h"
 #include "../ExPolygon.hpp"
 #include "../Point.hpp"
 #include "../Slicing.hpp"
@@ -186,6 +192,58 @@ struct SupportNode
     }
 };
 
+/*!
+ * \brief BBS: Bump allocator of the SupportNodes.
+ *
+ * Each thread fills its own chunks of nodes, so the nodes a thread creates one
+ * after another are contiguous in memory. The arena takes no lock and allocates
+ * one chunk per CHUNK_SIZE nodes, the node constructor still allocates its list
+ * of parents. The nodes stay valid until clear(), which destroys them and
+ * releases the memory chunk by chunk.
+ */
+class SupportNodeArena
+{
+public:
+    SupportNodeArena() = default;
+    ~SupportNodeArena() { clear(); }
+
+    SupportNodeArena(const SupportNodeArena&) = delete;
+    SupportNodeArena& operator=(const SupportNodeArena&) = delete;
+
+    template<class... Args>
+    SupportNode* create(Args&&... args)
+    {
+        ThreadChunks &local = m_chunks.local();
+        if (local.chunks.empty() || local.used == CHUNK_SIZE) {
+            local.chunks.emplace_back(new Storage[CHUNK_SIZE]);
+            local.used = 0;
+        }
+        SupportNode *node = new (&local.chunks.back()[local.used]) SupportNode(std::forward<Args>(args)...);
+        ++ local.used;
+        ++ m_size;
+        return node;
+    }
+
+    // Not thread safe, no node may be created while clearing.
+    void   clear();
+    size_t size() const { return m_size; }
+    // Memory reserved by the chunks in bytes.
+    size_t memory() const;
+
+private:
+    static constexpr size_t CHUNK_SIZE = 1024;
+    using Storage = std::aligned_storage_t<sizeof(SupportNode), alignof(SupportNode)>;
+    struct ThreadChunks
+    {
+        std::vector<std::unique_ptr<Storage[]>> chunks;
+        // Nodes constructed in the last chunk.
+        size_t                                  used { 0 };
+    };
+
+    tbb::enumerable_thread_specific<ThreadChunks> m_chunks;
+    std::atomic<size_t>                           m_size { 0 };
+};
+
 /*!
  * \brief Lazily generates tree guidance volumes.
  *
@@ -247,12 +305,35 @@ public:
     Polygons get_contours(size_t layer_nr) const;
     Polygons get_contours_with_holes(size_t layer_nr) const;
 
+    /*!
+     * \brief BBS: Computes the collision and avoidance areas of the radii
+     * used at each layer in parallel.
+     *
+     * The collision areas of all pairs are computed first. Then the avoidance
+     * of each radius is built up from layer 0, one radius per task, as the
+     * avoidance of a layer is grown from the avoidance of the layer below.
+     *
+     * \param layer_radii The node radii indexed by object layer
+     */
+    void precompute_radius_ladder(const std::vector<std::set<coordf_t>>& layer_radii) const;
+
+    struct CacheStats {
+        size_t hits   { 0 };
+        size_t misses { 0 };
+        // lookups which waited for another thread computing the same areas
+        size_t waits  { 0 };
+        double lock_wait_ms { 0 };
+        size_t collision_entries { 0 };
+        size_t avoidance_entries { 0 };
+    };
+    CacheStats cache_stats() const;
+
     SupportNode* create_node(const Point position, const int distance_to_top, const int obj_layer_nr, const int support_roof_layers_below, const bool to_buildplate, SupportNode* parent,
         coordf_t     print_z_, coordf_t height_, coordf_t dist_mm_to_top_ = 0, coordf_t radius_ = 0);
     void clear_nodes();
     std::vector<LayerHeightData> layer_heights;
 
-    std::vector<std::unique_ptr<SupportNode>> contact_nodes;
+    SupportNodeArena node_arena;
     // ExPolygon                  m_machine_border;
 
 private:
@@ -265,17 +346,6 @@ private:
         int recursions;
 
     };
-    struct RadiusLayerPairEquality {
-        constexpr bool operator()(const RadiusLayerPair& _Left, const RadiusLayerPair& _Right) const {
-            return _Left.radius == _Right.radius && _Left.layer_nr == _Right.layer_nr;
-        }
-    };
-    struct RadiusLayerPairHash {
-        size_t operator()(const RadiusLayerPair& elem) const {
-            return std::hash<coord_t>()(elem.radius) ^ std::hash<coord_t>()(elem.layer_nr * 7919);
-        }
-    };
-
     /*!
      * \brief Round \p radius upwards to a multiple of m_radius_sample_resolution
      *
@@ -289,7 +359,7 @@ private:
      *
      * \param key The radius and layer of the node of interest
      */
-    const ExPolygons& calculate_collision(const RadiusLayerPair& key) const;
+    ExPolygons calculate_collision(const RadiusLayerPair& key) const;
 
     /*!
      * \brief Calculate the avoidance areas at the radius and layer indicated
@@ -297,7 +367,34 @@ private:
      *
      * \param key The radius and layer of the node of interest
      */
-    const ExPolygons& calculate_avoidance(const RadiusLayerPair& key) const;
+    ExPolygons calculate_avoidance(const RadiusLayerPair& key) const;
+
+    /*!
+     * \brief BBS: cached areas of a (radius, layer) pair, computed once.
+     *
+     * A thread asking for the areas while another thread computes them waits
+     * for the result instead of computing it again.
+     */
+    struct CacheEntry {
+        std::once_flag    computed;
+        std::atomic<bool> ready { false };
+        ExPolygons        areas;
+    };
+    using CacheMap = std::map<coordf_t, std::unique_ptr<CacheEntry>>;
+
+    /*!
+     * \brief BBS: the caches are sharded by layer, the lock of a layer is only
+     * held while looking up the entry, never while computing the areas.
+     */
+    struct LayerCache {
+        tbb::spin_mutex mutex;
+        CacheMap        collision;
+        CacheMap        avoidance;
+    };
+
+    template<class ComputeFn>
+    const ExPolygons& get_cached(CacheMap LayerCache::*cache, coordf_t radius, size_t layer_nr, ComputeFn &&compute) const;
+    bool is_cached(CacheMap LayerCache::*cache, coordf_t radius, size_t layer_nr) const;
 
     tbb::spin_mutex  m_mutex;
 
@@ -330,19 +427,21 @@ public:
     std::vector<double> m_max_move_distances;
 
     /*!
-     * \brief Caches for the collision, avoidance and internal model polygons
-     * at given radius and layer indices.
+     * \brief Caches for the collision and avoidance polygons at given radius
+     * and layer indices, one LayerCache per layer.
      *
      * These are mutable to allow modification from const function. This is
      * generally considered OK as the functions are still logically const
      * (ie there is no difference in behaviour for the user betweeen
      * calculating the values each time vs caching the results).
-     *
-     * coconut: previously stl::unordered_map is used which seems problematic with tbb::parallel_for.
-     * So we change to tbb::concurrent_unordered_map
      */
-    mutable tbb::concurrent_unordered_map<RadiusLayerPair, ExPolygons, RadiusLayerPairHash, RadiusLayerPairEquality> m_collision_cache;
-    mutable tbb::concurrent_unordered_map<RadiusLayerPair, ExPolygons, RadiusLayerPairHash, RadiusLayerPairEquality> m_avoidance_cache;
+    mutable std::unique_ptr<LayerCache[]> m_layer_caches;
+    size_t m_num_layer_caches = 0;
+
+    mutable std::atomic<size_t>  m_cache_hits { 0 };
+    mutable std::atomic<size_t>  m_cache_misses { 0 };
+    mutable std::atomic<size_t>  m_cache_waits { 0 };
+    mutable std::atomic<int64_t> m_cache_lock_wait_ns { 0 };
 
     friend TreeSupport;
 };
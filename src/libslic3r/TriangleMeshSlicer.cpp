@@ -8,15 +8,26 @@
 #include "MeshBoolean.hpp"
 
 #include <algorithm>
+#include <tuple>
 #include <cmath>
 #include <deque>
 #include <queue>
 #include <mutex>
+#include <numeric>
 #include <utility>
 
 #include <boost/log/trivial.hpp>
 
 #include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define SLIC3R_SLICER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SLIC3R_SLICER_SSE2
+#endif
 
 #ifndef NDEBUG
 //    #define EXPENSIVE_DEBUG_CHECKS
@@ -560,6 +571,253 @@ static inline IntersectionLines slice_make_lines(
     return lines;
 }
 
+// BBS: facets crossing the slicing plane of the current layer. The vertices are rotated so that the first one is the lowest one,
+// as in slice_facet(). The z coordinates are stored as a structure of arrays for the batched classification.
+struct ActiveFacets
+{
+    struct Facet
+    {
+        stl_vertex                  vertices[3];
+        stl_triangle_vertex_indices indices;
+        // Edge i connects vertex i with vertex (i + 1) % 3.
+        Vec3i                       edge_ids;
+        // First layer not crossed by the facet.
+        uint32_t                    layer_end;
+    };
+
+    std::vector<float>      z[3];
+    std::vector<Facet>      facets;
+
+    size_t size() const { return facets.size(); }
+
+    void push_back(const std::vector<stl_vertex> &vertices, const stl_triangle_vertex_indices &indices, const Vec3i &edge_ids, uint32_t layer_end)
+    {
+        const stl_vertex *v[3] { &vertices[indices(0)], &vertices[indices(1)], &vertices[indices(2)] };
+        const float min_z = fminf(v[0]->z(), fminf(v[1]->z(), v[2]->z()));
+        const int   idx_vertex_lowest = (v[1]->z() == min_z) ? 1 : ((v[2]->z() == min_z) ? 2 : 0);
+        Facet      &facet = this->facets.emplace_back();
+        for (int i = 0; i < 3; ++ i) {
+            int k = (idx_vertex_lowest + i) % 3;
+            facet.vertices[i]  = *v[k];
+            facet.indices(i)   = indices(k);
+            facet.edge_ids(i)  = edge_ids(k);
+            this->z[i].emplace_back(v[k]->z());
+        }
+        facet.layer_end = layer_end;
+    }
+
+    // Remove the facets below the layer, keeping the order of the others.
+    void remove_finished(uint32_t layer)
+    {
+        size_t j = 0;
+        for (size_t i = 0; i < this->size(); ++ i)
+            if (this->facets[i].layer_end > layer) {
+                if (i != j) {
+                    this->facets[j] = this->facets[i];
+                    for (int k = 0; k < 3; ++ k)
+                        this->z[k][j] = this->z[k][i];
+                }
+                ++ j;
+            }
+        this->facets.resize(j);
+        for (int k = 0; k < 3; ++ k)
+            this->z[k].resize(j);
+    }
+};
+
+// floor(v) for the coordinates of the intersection points, without the call of floor() for x86-64 without SSE4.1.
+static inline coord_t floor_to_coord(double v)
+{
+    coord_t r = coord_t(v);
+    return double(r) > v ? r - 1 : r;
+}
+
+// Intersection of an edge of an active facet with the slicing plane, calculated the same way as the general case of slice_facet().
+// Returns false if the intersection rounds onto an end point of the edge, which slice_facet() handles as a vertex on the plane.
+static inline bool active_facet_edge_intersection(const ActiveFacets::Facet &facet, int edge, float slice_z, Point &out)
+{
+    // Sort the edge to give a consistent answer.
+    int ia = edge;
+    int ib = (edge + 1) % 3;
+    if (facet.indices(ia) > facet.indices(ib))
+        std::swap(ia, ib);
+    const stl_vertex &a = facet.vertices[ia];
+    const stl_vertex &b = facet.vertices[ib];
+    const double      t = (double(slice_z) - double(b.z())) / (double(a.z()) - double(b.z()));
+    if (t <= 0. || t >= 1.)
+        return false;
+    out.x() = floor_to_coord(double(b.x()) + (double(a.x()) - double(b.x())) * t + 0.5);
+    out.y() = floor_to_coord(double(b.y()) + (double(a.y()) - double(b.y())) * t + 0.5);
+    return true;
+}
+
+static inline void slice_active_facet(const ActiveFacets::Facet &facet, bool general, bool above1, bool above2, float slice_z, IntersectionLines &lines)
+{
+    IntersectionLine il;
+    if (general) {
+        // No vertex on the plane, thus vertex 0 is below the plane and two edges cross it. The first intersection is on edge 0
+        // if vertex 1 is above the plane, otherwise on edge 1. The second one is on edge 2 if vertex 2 is above the plane, otherwise on edge 1.
+        const int edge_first  = above1 ? 0 : 1;
+        const int edge_second = above2 ? 2 : 1;
+        if (active_facet_edge_intersection(facet, edge_first, slice_z, il.b) &&
+            active_facet_edge_intersection(facet, edge_second, slice_z, il.a)) {
+            il.edge_a_id = facet.edge_ids(edge_second);
+            il.edge_b_id = facet.edge_ids(edge_first);
+            lines.emplace_back(il);
+            return;
+        }
+    }
+    // Vertices on the plane are rare, leave them to slice_facet().
+    if (slice_facet(slice_z, facet.vertices, facet.indices, facet.edge_ids, 0, false, il) == FacetSliceType::Slicing) {
+        assert(il.edge_type != IntersectionLine::FacetEdgeType::Horizontal);
+        lines.emplace_back(il);
+    }
+}
+
+// Slice the active facets, which all span the plane. The facets are classified in batches: whether a vertex lies on the plane
+// and which of the vertices 1, 2 are above the plane.
+static void slice_active_facets(const ActiveFacets &active, float slice_z, IntersectionLines &lines)
+{
+    lines.reserve(lines.size() + active.size());
+    const float *z0 = active.z[0].data();
+    const float *z1 = active.z[1].data();
+    const float *z2 = active.z[2].data();
+    size_t       i  = 0;
+#if defined(SLIC3R_SLICER_AVX2)
+    const __m256 plane = _mm256_set1_ps(slice_z);
+    for (; i + 8 <= active.size(); i += 8) {
+        const __m256 v0 = _mm256_loadu_ps(z0 + i);
+        const __m256 v1 = _mm256_loadu_ps(z1 + i);
+        const __m256 v2 = _mm256_loadu_ps(z2 + i);
+        const unsigned on_plane = unsigned(_mm256_movemask_ps(_mm256_or_ps(_mm256_or_ps(
+            _mm256_cmp_ps(v0, plane, _CMP_EQ_OQ), _mm256_cmp_ps(v1, plane, _CMP_EQ_OQ)), _mm256_cmp_ps(v2, plane, _CMP_EQ_OQ))));
+        const unsigned above1   = unsigned(_mm256_movemask_ps(_mm256_cmp_ps(v1, plane, _CMP_GT_OQ)));
+        const unsigned above2   = unsigned(_mm256_movemask_ps(_mm256_cmp_ps(v2, plane, _CMP_GT_OQ)));
+        for (size_t j = 0; j < 8; ++ j)
+            slice_active_facet(active.facets[i + j], ((on_plane >> j) & 1) == 0, (above1 >> j) & 1, (above2 >> j) & 1, slice_z, lines);
+    }
+#elif defined(SLIC3R_SLICER_SSE2)
+    const __m128 plane = _mm_set1_ps(slice_z);
+    for (; i + 4 <= active.size(); i += 4) {
+        const __m128 v0 = _mm_loadu_ps(z0 + i);
+        const __m128 v1 = _mm_loadu_ps(z1 + i);
+        const __m128 v2 = _mm_loadu_ps(z2 + i);
+        const unsigned on_plane = unsigned(_mm_movemask_ps(_mm_or_ps(_mm_or_ps(
+            _mm_cmpeq_ps(v0, plane), _mm_cmpeq_ps(v1, plane)), _mm_cmpeq_ps(v2, plane))));
+        const unsigned above1   = unsigned(_mm_movemask_ps(_mm_cmpgt_ps(v1, plane)));
+        const unsigned above2   = unsigned(_mm_movemask_ps(_mm_cmpgt_ps(v2, plane)));
+        for (size_t j = 0; j < 4; ++ j)
+            slice_active_facet(active.facets[i + j], ((on_plane >> j) & 1) == 0, (above1 >> j) & 1, (above2 >> j) & 1, slice_z, lines);
+    }
+#endif
+    for (; i < active.size(); ++ i)
+        slice_active_facet(active.facets[i], z0[i] != slice_z && z1[i] != slice_z && z2[i] != slice_z, z1[i] > slice_z, z2[i] > slice_z, slice_z, lines);
+}
+
+// BBS: data oriented variant of slice_make_lines() for many slicing planes, producing the same lines without locking.
+// The facets are bucketed by their first layer, then each thread sweeps a range of layers, keeping the facets spanning
+// the current layer in ActiveFacets. The lines of a layer are ordered by the first layer and the index of their facet.
+// The vertices have to be transformed already, zs have to be sorted.
+template<typename ThrowOnCancel>
+static std::vector<IntersectionLines> slice_make_lines_bucketed(
+    const std::vector<stl_vertex>                   &vertices,
+    const std::vector<stl_triangle_vertex_indices>  &indices,
+    const std::vector<Vec3i>                        &face_edge_ids,
+    const std::vector<float>                        &zs,
+    const ThrowOnCancel                              throw_on_cancel_fn)
+{
+    // 1) Layers spanned by each facet. Each vertex is looked up in zs once, a facet spans the layers from the lowest first layer
+    // at or above its vertices up to the highest first layer above its vertices. Horizontal facets are ignored, any valid horizontal
+    // triangle must have a vertical triangle connected, otherwise the part has zero volume.
+    struct VertexLayers {
+        float       z;
+        // First layer at or above the vertex.
+        uint32_t    begin;
+        // First layer above the vertex.
+        uint32_t    end;
+    };
+    std::vector<VertexLayers> vertex_layers(vertices.size());
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, vertices.size()),
+        [&vertices, &zs, &vertex_layers](const tbb::blocked_range<size_t> &range) {
+            for (size_t vertex_idx = range.begin(); vertex_idx < range.end(); ++ vertex_idx) {
+                const float z     = vertices[vertex_idx].z();
+                auto        begin = std::lower_bound(zs.begin(), zs.end(), z);
+                auto        end   = begin;
+                while (end != zs.end() && *end == z)
+                    ++ end;
+                vertex_layers[vertex_idx] = { z, uint32_t(begin - zs.begin()), uint32_t(end - zs.begin()) };
+            }
+        });
+    std::vector<uint32_t> facet_layer_begin(indices.size(), 0);
+    std::vector<uint32_t> facet_layer_end(indices.size(), 0);
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, indices.size()),
+        [&indices, &vertex_layers, &facet_layer_begin, &facet_layer_end](const tbb::blocked_range<size_t> &range) {
+            for (size_t face_idx = range.begin(); face_idx < range.end(); ++ face_idx) {
+                const stl_triangle_vertex_indices &face = indices[face_idx];
+                const VertexLayers &v0 = vertex_layers[face(0)];
+                const VertexLayers &v1 = vertex_layers[face(1)];
+                const VertexLayers &v2 = vertex_layers[face(2)];
+                if (v0.z != v1.z || v1.z != v2.z) {
+                    facet_layer_begin[face_idx] = std::min(v0.begin, std::min(v1.begin, v2.begin));
+                    facet_layer_end[face_idx]   = std::max(v0.end, std::max(v1.end, v2.end));
+                }
+            }
+        });
+    vertex_layers = std::vector<VertexLayers>();
+    throw_on_cancel_fn();
+
+    // 2) Bucket the facets by their first layer, keeping the order of their indices.
+    std::vector<uint32_t> bucket_begin(zs.size() + 1, 0);
+    for (size_t face_idx = 0; face_idx < indices.size(); ++ face_idx)
+        if (facet_layer_begin[face_idx] < facet_layer_end[face_idx])
+            ++ bucket_begin[facet_layer_begin[face_idx] + 1];
+    std::partial_sum(bucket_begin.begin(), bucket_begin.end(), bucket_begin.begin());
+    std::vector<uint32_t> bucketed_facets(bucket_begin.back());
+    std::vector<uint32_t> bucketed_layer_end(bucket_begin.back());
+    {
+        std::vector<uint32_t> cursor(bucket_begin.begin(), bucket_begin.end() - 1);
+        for (size_t face_idx = 0; face_idx < indices.size(); ++ face_idx)
+            if (facet_layer_begin[face_idx] < facet_layer_end[face_idx]) {
+                uint32_t i = cursor[facet_layer_begin[face_idx]] ++;
+                bucketed_facets[i]    = uint32_t(face_idx);
+                bucketed_layer_end[i] = facet_layer_end[face_idx];
+            }
+    }
+    facet_layer_begin = std::vector<uint32_t>();
+    facet_layer_end   = std::vector<uint32_t>();
+    throw_on_cancel_fn();
+
+    // 3) Sweep the layers. Each range of layers starts with collecting the facets of the lower buckets reaching into it,
+    // thus the number of ranges is kept low.
+    std::vector<IntersectionLines> lines(zs.size(), IntersectionLines());
+    const size_t num_ranges = std::min(zs.size(), 4 * size_t(tbb::this_task_arena::max_concurrency()));
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, num_ranges, 1),
+        [&vertices, &indices, &face_edge_ids, &zs, &bucket_begin, &bucketed_facets, &bucketed_layer_end, &lines, num_ranges, throw_on_cancel_fn]
+        (const tbb::blocked_range<size_t> &range) {
+            const uint32_t layer_begin = uint32_t(range.begin() * zs.size() / num_ranges);
+            const uint32_t layer_end   = uint32_t(range.end() * zs.size() / num_ranges);
+            ActiveFacets   active;
+            auto           activate = [&](uint32_t i) {
+                uint32_t face_idx = bucketed_facets[i];
+                active.push_back(vertices, indices[face_idx], face_edge_ids[face_idx], bucketed_layer_end[i]);
+            };
+            for (uint32_t i = 0; i < bucket_begin[layer_begin]; ++ i)
+                if (bucketed_layer_end[i] > layer_begin)
+                    activate(i);
+            for (uint32_t layer = layer_begin; layer < layer_end; ++ layer) {
+                throw_on_cancel_fn();
+                active.remove_finished(layer);
+                for (uint32_t i = bucket_begin[layer]; i < bucket_begin[layer + 1]; ++ i)
+                    activate(i);
+                slice_active_facets(active, zs[layer], lines[layer]);
+            }
+        });
+    return lines;
+}
+
 // For projecting triangle sets onto slice slabs.
 struct SlabLines {
     // Intersection lines of a slice with a triangle set, CCW oriented.
@@ -1891,9 +2149,7 @@ std::vector<Polygons> slice_mesh(
             }
         } else {
             // Copy and scale vertices in XY, don't scale in Z. Possibly apply the transformation.
-            lines = slice_make_lines(
-                transform_mesh_vertices_for_slicing(mesh, params.trafo), 
-                [](const Vec3f &p) { return p; },  mesh.indices, face_edge_ids, zs, throw_on_cancel);
+            lines = slice_make_lines_bucketed(transform_mesh_vertices_for_slicing(mesh, params.trafo), mesh.indices, face_edge_ids, zs, throw_on_cancel);
         }
     }
 
@@ -2000,6 +2256,23 @@ Polygons slice_mesh(
     return layers.front();
 }
 
+std::vector<Lines> slice_mesh_lines(const indexed_triangle_set &mesh, const std::vector<float> &zs, bool bucketed)
+{
+    std::vector<Vec3i>             face_edge_ids = its_face_edge_ids(mesh);
+    std::vector<IntersectionLines> lines         = bucketed ?
+        slice_make_lines_bucketed(transform_mesh_vertices_for_slicing(mesh, Transform3d::Identity()), mesh.indices, face_edge_ids, zs, []{}) :
+        slice_make_lines(mesh.vertices, [](const Vec3f &p) { return Vec3f(scaled<float>(p.x()), scaled<float>(p.y()), p.z()); },
+            mesh.indices, face_edge_ids, zs, []{});
+    std::vector<Lines> out(lines.size());
+    for (size_t i = 0; i < lines.size(); ++ i) {
+        out[i].assign(lines[i].begin(), lines[i].end());
+        std::sort(out[i].begin(), out[i].end(), [](const Line &l, const Line &r) {
+            return std::tie(l.a.x(), l.a.y(), l.b.x(), l.b.y()) < std::tie(r.a.x(), r.a.y(), r.b.x(), r.b.y());
+        });
+    }
+    return out;
+}
+
 std::vector<ExPolygons> slice_mesh_ex(
     const indexed_triangle_set       &mesh,
     const std::vector<float>         &zs,
@@ -69,6 +69,13 @@ Polygons                        slice_mesh(
     const float                       plane_z,
     const MeshSlicingParams          &params);
 
+// The lines of the slicing planes before chaining them into loops, sorted within each plane. The lines are made facet by facet
+// or, if bucketed, by the sweep over the planes slice_mesh() uses for more than one plane. Used exclusively by the unit tests.
+std::vector<Lines>              slice_mesh_lines(
+    const indexed_triangle_set       &mesh,
+    const std::vector<float>         &zs,
+    bool                              bucketed);
+
 std::vector<ExPolygons>         slice_mesh_ex(
     const indexed_triangle_set       &mesh,
     const std::vector<float>         &zs,
@@ -249,7 +249,7 @@ public:
                                       bool                 force_reselection = false); // force reselection of the triangle mesh even in cases that mouse is pointing on the selected triangle
 
     bool                 has_facets(EnforcerBlockerType state) const;
-    static bool          has_facets(const std::pair<std::vector<std::pair<int, int>>, std::vector<bool>> &data, EnforcerBlockerType test_state);
+    static bool          has_facets(const TriangleSplittingData &data, EnforcerBlockerType test_state);
     int                  num_facets(EnforcerBlockerType state) const;
     // Get facets at a given state. Don't triangulate T-joints.
     indexed_triangle_set get_facets(EnforcerBlockerType state) const;
@@ -271,15 +271,15 @@ public:
     void garbage_collect();
 
     // Store the division trees in compact form (a long stream of bits for each triangle of the original mesh).
-    // First vector contains pairs of (triangle index, first bit in the second vector).
-    std::pair<std::vector<std::pair<int, int>>, std::vector<bool>> serialize() const;
+    // The data contains pairs of (triangle index, first bit in the bit stream).
+    TriangleSplittingData serialize() const;
 
     // Load serialized data. Assumes that correct mesh is loaded.
-    void deserialize(const std::pair<std::vector<std::pair<int, int>>, std::vector<bool>> &data,
-                     bool                                                                  needs_reset = true,
-                     EnforcerBlockerType                                                   max_ebt     = EnforcerBlockerType::ExtruderMax,
-                     EnforcerBlockerType                                                   to_delete_filament = EnforcerBlockerType::NONE,
-                     EnforcerBlockerType                                                   replace_filament = EnforcerBlockerType::NONE);
+    void deserialize(const TriangleSplittingData &data,
+                     bool                         needs_reset = true,
+                     EnforcerBlockerType          max_ebt     = EnforcerBlockerType::ExtruderMax,
+                     EnforcerBlockerType          to_delete_filament = EnforcerBlockerType::NONE,
+                     EnforcerBlockerType          replace_filament = EnforcerBlockerType::NONE);
 
     // For all triangles, remove the flag indicating that the triangle was selected by seed fill.
     void seed_fill_unselect_all_triangles();
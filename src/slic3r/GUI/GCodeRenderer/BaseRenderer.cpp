@@ -679,7 +679,7 @@ namespace Slic3r
                 if (!show)
                     return;
                 for (auto gcode_result : gcode_result_list) {
-                    if (gcode_result->moves.size() == 0)
+                    if (! gcode_result->has_moves())
                         return;
                 }
                 ImGuiWrapper& imgui = *wxGetApp().imgui();
@@ -8414,7 +8414,7 @@ void GLCanvas3D::_render_imgui_select_plate_toolbar()
         // Changing parameters does not invalid all plates, need extra logic to validate
         bool gcode_result_valid = true;
         for (auto gcode_result : plate_list.get_nonempty_plates_slice_results()) {
-            if (gcode_result->moves.size() == 0) {
+            if (! gcode_result->has_moves()) {
                 gcode_result_valid = false;
             }
         }
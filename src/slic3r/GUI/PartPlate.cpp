@@ -5996,6 +5996,17 @@ void PartPlateList::update_slice_context_to_current_plate(BackgroundSlicingProce
 	current_plate = m_plate_list[m_current_plate];
 	assert(current_plate != NULL);
 
+	//BBS: only the result of the current plate is loaded into the viewer, park the moves of the other valid results compacted
+	for (PartPlate* plate : m_plate_list) {
+		GCodeProcessorResult* result = plate->get_slice_result();
+		if (result == nullptr)
+			continue;
+		if (plate == current_plate)
+			result->expand_moves();
+		else if (plate->is_slice_result_valid())
+			result->compact_moves();
+	}
+
 	current_plate->update_slice_context(process);
 
 	return;
@@ -0,0 +1,74 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/libslic3r.h"
+#include "libslic3r/Print.hpp"
+#include "libslic3r/GCode/ConflictChecker.hpp"
+
+#include "test_data.hpp"
+#include "test_utils.hpp"
+
+#include <iostream>
+#include <set>
+
+using namespace Slic3r;
+using namespace Slic3r::Test;
+
+// Slices a plate of 20mm cubes in rows of 10, placed spacing mm apart.
+static void init_and_process_plate(Print &print, Model &model, size_t num_objects, double spacing)
+{
+    DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+    config.set_deserialize_strict({ { "sparse_infill_density", "20%" } });
+    for (size_t i = 0; i < num_objects; ++ i) {
+        ModelObject *object = model.add_object();
+        object->name = "cube_" + std::to_string(i);
+        object->add_volume(mesh(TestMesh::cube_20x20x20));
+        object->add_instance()->set_offset(Vec3d(spacing * double(i % 10), spacing * double(i / 10), 0.));
+        object->ensure_on_bed();
+        print.auto_assign_extruders(object);
+    }
+    print.apply(model, config);
+    print.set_status_silent();
+    print.process();
+}
+
+SCENARIO("ConflictChecker finds the conflicts between objects only", "[ConflictChecker]") {
+    GIVEN("Cubes placed apart") {
+        Print print;
+        Model model;
+        init_and_process_plate(print, model, 4, 30.);
+        THEN("No conflict is reported") {
+            REQUIRE(! ConflictChecker::find_inter_of_lines_in_diff_objs(print.objects_mutable(), {}).has_value());
+        }
+    }
+    GIVEN("Two of the cubes overlapping") {
+        Print print;
+        Model model;
+        init_and_process_plate(print, model, 3, 30.);
+        model.objects[2]->instances.front()->set_offset(Vec3d(40., 0., 0.));
+        DynamicPrintConfig config = print.full_print_config();
+        print.apply(model, config);
+        print.process();
+        THEN("The conflict of the overlapping cubes is reported") {
+            ConflictResultOpt conflict = ConflictChecker::find_inter_of_lines_in_diff_objs(print.objects_mutable(), {});
+            REQUIRE(conflict.has_value());
+            std::set<std::string> names { conflict->_objName1, conflict->_objName2 };
+            REQUIRE(names == std::set<std::string>{ "cube_1", "cube_2" });
+        }
+    }
+}
+
+#ifdef TEST_PERFORMANCE
+TEST_CASE("ConflictChecker: 50 object plate timing", "[ConflictChecker]") {
+    for (double spacing : { 25., 19.5 }) {
+        Print print;
+        Model model;
+        init_and_process_plate(print, model, 50, spacing);
+        ConflictResultOpt conflict;
+        long long ms = time_ms([&print, &conflict]() {
+            for (int i = 0; i < 5; ++ i)
+                conflict = ConflictChecker::find_inter_of_lines_in_diff_objs(print.objects_mutable(), {});
+        });
+        std::cout << "spacing " << spacing << " mm, conflict " << conflict.has_value() << ": " << ms / 5 << " ms" << std::endl;
+    }
+}
+#endif // TEST_PERFORMANCE
@@ -2,7 +2,10 @@
 
 #include <memory>
 
+#include <tbb/parallel_for.h>
+
 #include "libslic3r/GCode.hpp"
+#include "libslic3r/GCode/LayerGCodeSpill.hpp"
 
 using namespace Slic3r;
 
@@ -20,3 +23,38 @@ SCENARIO("Origin manipulation", "[GCode]") {
     	}
     }
 }
+
+SCENARIO("Layer G-code spilled to a temporary file", "[GCode]") {
+    GIVEN("2000 layers of G-code of 20 to 40kB each") {
+        const size_t num_layers = 2000;
+        auto layer_gcode = [](size_t idx) {
+            std::string gcode = "; layer " + std::to_string(idx) + "\n";
+            for (size_t i = 0; i < 1000 + idx % 1000; ++ i)
+                gcode += "G1 X" + std::to_string(i % 256) + " Y" + std::to_string(idx % 256) + "\n";
+            return gcode;
+        };
+        for (size_t memory_limit : { size_t(0), size_t(4) << 20 }) {
+            WHEN("The layers are stored in parallel with a memory limit of " + std::to_string(memory_limit) + " bytes") {
+                LayerGCodeSpill spill(num_layers, memory_limit);
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, num_layers), [&spill, &layer_gcode](const tbb::blocked_range<size_t> &range) {
+                    for (size_t idx = range.begin(); idx < range.end(); ++ idx)
+                        spill.store(idx, layer_gcode(idx));
+                });
+                THEN("The memory held stays within the limit") {
+                    if (memory_limit == 0)
+                        REQUIRE(spill.spilled_layers() == 0);
+                    else {
+                        REQUIRE(spill.gcode_bytes_peak() <= memory_limit);
+                        REQUIRE(spill.spilled_layers() > 0);
+                    }
+                }
+                THEN("All layers are taken back unchanged") {
+                    bool all_equal = true;
+                    for (size_t idx = 0; idx < num_layers; ++ idx)
+                        all_equal &= spill.take(idx) == layer_gcode(idx);
+                    REQUIRE(all_equal);
+                }
+            }
+        }
+    }
+}
@@ -1,8 +1,18 @@
 #include <catch2/catch.hpp>
 
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <limits>
 #include <memory>
+#include <sstream>
 
 #include "libslic3r/GCodeWriter.hpp"
+#include "libslic3r/Layer.hpp"
+#include "libslic3r/Print.hpp"
+
+#include "test_data.hpp"
+#include "test_utils.hpp"
 
 using namespace Slic3r;
 
@@ -94,3 +104,105 @@ SCENARIO("set_speed emits values with fixed-point output.", "[GCodeWriter]") {
         }
     }
 }
+
+SCENARIO("GCodeEmitter formats numbers the same way as std::ostream.", "[GCodeWriter]") {
+    GIVEN("Integers and doubles") {
+        const std::vector<int>    ints    { 0, 1, -1, 255, 20000, -2147483647 };
+        const std::vector<double> doubles { 0., 1., -1., 0.04, 0.0325, 127.5, 191.25, 1e-7, 123456789., 2.5e10 };
+        THEN("The emitted strings match std::ostringstream") {
+            for (int v : ints) {
+                std::string out;
+                GCodeEmitter(out) << v;
+                std::ostringstream ss;
+                ss << v;
+                REQUIRE(out == ss.str());
+            }
+            for (double v : doubles) {
+                std::string out;
+                GCodeEmitter(out) << v << ' ' << GCodeEmitter::General{ v, 4 };
+                std::ostringstream ss;
+                ss << v << ' ' << std::setprecision(4) << v;
+                REQUIRE(out == ss.str());
+            }
+        }
+        THEN("The integer types wider or narrower than int are not ambiguous") {
+            std::string out;
+            GCodeEmitter(out) << size_t(42) << ' ' << long(-7) << ' ' << short(-3) << ' ' << std::numeric_limits<uint64_t>::max() << ' ' << std::numeric_limits<int64_t>::min();
+            std::ostringstream ss;
+            ss << size_t(42) << ' ' << long(-7) << ' ' << short(-3) << ' ' << std::numeric_limits<uint64_t>::max() << ' ' << std::numeric_limits<int64_t>::min();
+            REQUIRE(out == ss.str());
+        }
+        THEN("emit_fixed matches set_speed") {
+            GCodeWriter writer;
+            for (double v : { 1., 0.5, 203.200022, 203.200522, 99999.123 }) {
+                std::string out("G1 F");
+                GCodeEmitter(out).emit_fixed(v, GCodeFormatter::XYZF_EXPORT_DIGITS) << '\n';
+                REQUIRE(out == writer.set_speed(v));
+            }
+        }
+    }
+    GIVEN("A GCodeWriter with a Klipper config") {
+        GCodeWriter writer;
+        writer.config.gcode_flavor.value = gcfKlipper;
+        THEN("Pressure advance and jerk are emitted with the std::ostream precision") {
+            REQUIRE_THAT(writer.set_pressure_advance(0.0325), Catch::Equals("SET_PRESSURE_ADVANCE ADVANCE=0.0325; Override pressure advance value\n"));
+            REQUIRE_THAT(writer.set_pressure_advance(0.123456), Catch::Equals("SET_PRESSURE_ADVANCE ADVANCE=0.1235; Override pressure advance value\n"));
+            REQUIRE_THAT(writer.set_jerk_xy(12.5), Catch::Equals("SET_VELOCITY_LIMIT SQUARE_CORNER_VELOCITY=12.5\n"));
+        }
+    }
+}
+
+#ifdef TEST_PERFORMANCE
+// Emits the temperature, jerk and pressure advance commands for the polylines of a sliced model through GCodeWriter and,
+// for comparison, through std::ostringstream the way these commands used to be formatted.
+TEST_CASE("GCodeWriter: emitted bytes per second", "[GCodeWriter]") {
+    Slic3r::Print print;
+    Slic3r::Test::init_and_process_print({ Slic3r::Test::TestMesh::sphere_50mm, Slic3r::Test::TestMesh::cube_20x20x20 }, print, {
+        { "sparse_infill_density", "40%" },
+        { "layer_height", 0.1 }
+    });
+    size_t num_polylines = 0;
+    for (const PrintObject *object : print.objects())
+        for (const Layer *layer : object->layers())
+            for (const LayerRegion *layerm : layer->regions())
+                num_polylines += layerm->perimeters.as_polylines().size() + layerm->fills.as_polylines().size();
+    // The values alternate, so that none of the commands is skipped as a repetition of the previous one.
+    auto temperature = [](size_t i) { return 200 + unsigned(i % 10); };
+    auto jerk        = [](size_t i) { return i % 2 ? 9. : 12.5; };
+
+    std::string emitted;
+    long long   emitted_ms = time_ms([&]() {
+        GCodeWriter writer;
+        writer.config.gcode_flavor.value = gcfMarlinFirmware;
+        for (size_t i = 0; i < num_polylines; ++ i) {
+            emitted += writer.set_temperature(temperature(i));
+            emitted += writer.set_jerk_xy(jerk(i));
+            emitted += writer.set_pressure_advance(0.0325);
+        }
+    });
+    std::string streamed;
+    long long   streamed_ms = time_ms([&]() {
+        for (size_t i = 0; i < num_polylines; ++ i) {
+            {
+                std::ostringstream gcode;
+                gcode << "M104 S" << temperature(i) << " ; set nozzle temperature\n";
+                streamed += gcode.str();
+            }
+            {
+                std::ostringstream gcode;
+                gcode << "M205 X" << jerk(i) << " Y" << jerk(i) << "\n";
+                streamed += gcode.str();
+            }
+            {
+                std::ostringstream gcode;
+                gcode << "M400\n M900 K" << std::setprecision(4) << 0.0325 << "; Override pressure advance value\n";
+                streamed += gcode.str();
+            }
+        }
+    });
+    REQUIRE(emitted == streamed);
+    auto mb_per_s = [](size_t bytes, long long ms) { return double(bytes) / (std::max<long long>(ms, 1) * 1e-3 * 1024. * 1024.); };
+    std::cout << emitted.size() << " bytes: GCodeWriter " << std::setprecision(4) << mb_per_s(emitted.size(), emitted_ms)
+              << " MB/s, std::ostringstream " << mb_per_s(streamed.size(), streamed_ms) << " MB/s" << std::endl;
+}
+#endif // TEST_PERFORMANCE
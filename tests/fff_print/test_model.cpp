@@ -3,11 +3,17 @@
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Model.hpp"
 #include "libslic3r/ModelArrange.hpp"
+#include "libslic3r/ClipperUtils.hpp"
+#include "libslic3r/BitmapArrange.hpp"
+
+#include <algorithm>
+#include <iostream>
 
 #include <boost/nowide/cstdio.hpp>
 #include <boost/filesystem.hpp>
 
 #include "test_data.hpp"
+#include "test_utils.hpp"
 
 using namespace Slic3r;
 using namespace Slic3r::Test;
@@ -59,3 +65,141 @@ SCENARIO("Model construction", "[Model]") {
         }
     }
 }
+
+TEST_CASE("Multi-start arrangement keeps all items on the bed", "[Model]") {
+    using namespace Slic3r::arrangement;
+    ArrangePolygons items;
+    for (int i = 0; i < 12; ++ i) {
+        ArrangePolygon ap;
+        coord_t w = scaled(20. + 5. * (i % 4));
+        coord_t h = scaled(15. + 10. * (i % 3));
+        ap.poly.contour = Polygon({ {0, 0}, {w, 0}, {w, h}, {0, h} });
+        ap.itemid       = i;
+        items.emplace_back(std::move(ap));
+    }
+    BoundingBox bed(Point(0, 0), Point(scaled(180.), scaled(180.)));
+    ArrangeParams params(scaled(2.));
+    params.multi_start = 4;
+    params.progressind = nullptr;
+    size_t packed      = 0;
+    params.on_packed   = [&packed](const ArrangePolygon &ap) { packed += ap.bed_idx == 0; };
+    arrange(items, bed, params);
+
+    // The packing is reported for the items of the arrangement kept only.
+    REQUIRE(packed == items.size());
+    for (size_t i = 0; i < items.size(); ++ i) {
+        REQUIRE(items[i].bed_idx == 0);
+        ExPolygon pi = items[i].transformed_poly();
+        for (size_t j = i + 1; j < items.size(); ++ j)
+            REQUIRE(intersection(to_polygons(pi), to_polygons(items[j].transformed_poly())).empty());
+    }
+}
+
+// Rectangles and frames of various sizes, spread out over the xy plane.
+static Slic3r::arrangement::ArrangePolygons make_arrange_items(int count, coord_t inflation)
+{
+    using namespace Slic3r::arrangement;
+    ArrangePolygons items;
+    for (int i = 0; i < count; ++ i) {
+        ArrangePolygon ap;
+        coord_t w = scaled(8. + 3. * (i % 5));
+        coord_t h = scaled(6. + 4. * (i % 4));
+        ap.poly.contour = Polygon({ {0, 0}, {w, 0}, {w, h}, {0, h} });
+        if (i % 7 == 0) {
+            // A frame, which the smaller items may fill.
+            ap.poly.contour.scale(3.);
+            ap.poly.holes.emplace_back(Polygon({ {w / 2, h / 2}, {w / 2, h * 5 / 2}, {w * 5 / 2, h * 5 / 2}, {w * 5 / 2, h / 2} }));
+        }
+        ap.poly.translate(scaled(300.) * (i % 3), scaled(100.) * (i % 2));
+        ap.inflation = inflation;
+        ap.itemid    = i;
+        items.emplace_back(std::move(ap));
+    }
+    return items;
+}
+
+TEST_CASE("Raster arrangement keeps the items apart and on the bed", "[Model]") {
+    using namespace Slic3r::arrangement;
+    const coord_t   inflation = scaled(1.);
+    ArrangePolygons items     = make_arrange_items(60, inflation);
+    Points          bed       = { {0, 0}, {scaled(200.), 0}, {scaled(200.), scaled(200.)}, {0, scaled(200.)} };
+    ArrangeParams   params;
+    params.raster_threshold = 1;
+    params.progressind      = nullptr;
+    // An item without a shape, left from a former arrangement on the second bed.
+    ArrangePolygon degenerate;
+    degenerate.bed_idx = 1;
+    items.emplace_back(std::move(degenerate));
+    arrange(items, bed, params);
+
+    REQUIRE(items.back().bed_idx == UNARRANGED);
+    items.pop_back();
+    // The items are numbered in the packing order.
+    std::vector<int> itemids;
+    for (const ArrangePolygon &ap : items)
+        itemids.emplace_back(ap.itemid);
+    std::sort(itemids.begin(), itemids.end());
+    for (size_t i = 0; i < itemids.size(); ++ i)
+        REQUIRE(itemids[i] == int(i));
+    for (size_t i = 0; i < items.size(); ++ i) {
+        REQUIRE(items[i].bed_idx >= 0);
+        ExPolygons pi = offset_ex(items[i].transformed_poly(), float(inflation - SCALED_EPSILON));
+        BoundingBox bbox = get_extents(pi);
+        REQUIRE(BoundingBox(bed).contains(bbox.min));
+        REQUIRE(BoundingBox(bed).contains(bbox.max));
+        for (size_t j = i + 1; j < items.size(); ++ j)
+            if (items[j].bed_idx == items[i].bed_idx)
+                REQUIRE(intersection_ex(pi, offset_ex(items[j].transformed_poly(), float(inflation - SCALED_EPSILON))).empty());
+    }
+}
+
+TEST_CASE("ArrangeBitmap tests masks word by word", "[Model]") {
+    using namespace Slic3r::arrangement;
+    ArrangeBitmap bitmap(BoundingBox(Point(0, 0), Point(scaled(100.), scaled(20.))), 0.5);
+    REQUIRE(bitmap.width() == 200);
+    // A square of 10mm at 70mm, thus reaching over the word boundary at pixel 128.
+    ExPolygon square(Polygon({ {0, 0}, {scaled(10.), 0}, {scaled(10.), scaled(10.)}, {0, scaled(10.)} }));
+    bitmap.mark_occupied(square, Point(scaled(60.), scaled(5.)));
+    REQUIRE(bitmap.get_pixel(130, 20));
+    REQUIRE(! bitmap.get_pixel(100, 20));
+
+    RasterMask mask(square, bitmap.pixel_size(), 0, Point(0, 0));
+    REQUIRE(mask.count() > 400);
+    // The rasters are conservative, the square covers the pixels 119 to 140.
+    REQUIRE(bitmap.get_pixel(119, 20));
+    REQUIRE(bitmap.get_pixel(140, 20));
+    for (int x = 0; x + mask.width() <= bitmap.width(); ++ x) {
+        bool expected = x + mask.width() > 119 && x < 141;
+        REQUIRE(bitmap.collides(mask, x, 10) == expected);
+        REQUIRE(bitmap.collides(square, bitmap.from_pixel(x, 10) - mask.origin()) == expected);
+    }
+}
+
+#ifdef TEST_PERFORMANCE
+TEST_CASE("Arrangement: no fit polygons versus raster", "[Model]") {
+    using namespace Slic3r::arrangement;
+    Points bed = { {0, 0}, {scaled(256.), 0}, {scaled(256.), scaled(256.)}, {0, scaled(256.)} };
+    for (int count : { 50, 200, 500 }) {
+        for (bool raster : { false, true }) {
+            ArrangePolygons items = make_arrange_items(count, scaled(1.));
+            ArrangeParams   params;
+            params.raster_threshold = raster ? 1 : 0;
+            params.progressind      = nullptr;
+            long long ms = time_ms([&items, &bed, &params]() { arrange(items, bed, params); });
+            // Density: the area of the items over the area of the bounding boxes of the piles.
+            std::map<int, BoundingBox> piles;
+            double items_area = 0.;
+            for (const ArrangePolygon &ap : items)
+                if (ap.bed_idx >= 0) {
+                    items_area += ap.poly.area();
+                    piles[ap.bed_idx].merge(get_extents(ap.transformed_poly()));
+                }
+            double piles_area = 0.;
+            for (const auto &pile : piles)
+                piles_area += double(pile.second.size().x()) * double(pile.second.size().y());
+            std::cout << (raster ? "raster" : "nfp   ") << " " << count << " items: " << piles.size() << " beds, density "
+                      << items_area / piles_area << ", " << ms << " ms" << std::endl;
+        }
+    }
+}
+#endif // TEST_PERFORMANCE
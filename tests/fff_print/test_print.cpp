@@ -3,8 +3,15 @@
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/Layer.hpp"
+#include "libslic3r/SliceResultCache.hpp"
+#include "libslic3r/GCode/SeamPlacer.hpp"
 
 #include "test_data.hpp"
+#include "test_utils.hpp"
+
+#include <iostream>
+
+#include <boost/filesystem/operations.hpp>
 
 using namespace Slic3r;
 using namespace Slic3r::Test;
@@ -126,3 +133,305 @@ SCENARIO("Print: Brim generation", "[Print]") {
         }
     }
 }
+
+// Export the slicing result of the processed print, clear it and load it back.
+static void cached_data_round_trip(Slic3r::Print &print, bool json)
+{
+    boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("slice_cache_%%%%-%%%%");
+    int exported = 0;
+    REQUIRE(print.export_cached_data(dir.string(), exported, json) == 0);
+    REQUIRE(exported == int(print.objects().size()));
+    REQUIRE(print.load_cached_data(dir.string()) == 0);
+    boost::filesystem::remove_all(dir);
+}
+
+SCENARIO("Print: Cached slicing data round trip", "[Print]") {
+    GIVEN("overhang model with support") {
+        Slic3r::Print print;
+        Slic3r::Test::init_and_process_print({TestMesh::overhang}, print, {
+            { "enable_support", true }
+        });
+        const PrintObject &object = *print.objects().front();
+        size_t layer_count         = object.layer_count();
+        size_t support_layer_count = object.support_layer_count();
+        std::vector<size_t> perimeters, fills, lslices;
+        for (const Layer *layer : object.layers()) {
+            perimeters.emplace_back(layer->regions().front()->perimeters.items_count());
+            fills.emplace_back(layer->regions().front()->fills.items_count());
+            lslices.emplace_back(layer->lslices.size());
+        }
+        auto check = [&]() {
+            REQUIRE(object.layer_count() == layer_count);
+            REQUIRE(object.support_layer_count() == support_layer_count);
+            for (size_t i = 0; i < layer_count; ++ i) {
+                const Layer *layer = object.get_layer(int(i));
+                REQUIRE(layer->regions().front()->perimeters.items_count() == perimeters[i]);
+                REQUIRE(layer->regions().front()->fills.items_count() == fills[i]);
+                REQUIRE(layer->lslices.size() == lslices[i]);
+                if (i > 0)
+                    REQUIRE(layer->lower_layer == object.get_layer(int(i) - 1));
+            }
+        };
+        WHEN("exported in the binary format") {
+            cached_data_round_trip(print, false);
+            THEN("the loaded layers match the sliced ones") {
+                check();
+            }
+        }
+        WHEN("exported in the json format") {
+            cached_data_round_trip(print, true);
+            THEN("the loaded layers match the sliced ones") {
+                check();
+            }
+        }
+        WHEN("exported in the binary format and then in the json format into the same directory") {
+            boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("slice_cache_%%%%-%%%%");
+            int exported = 0;
+            REQUIRE(print.export_cached_data(dir.string(), exported, false) == 0);
+            REQUIRE(print.export_cached_data(dir.string(), exported, true) == 0);
+            size_t binary_files = 0, json_files = 0;
+            for (const boost::filesystem::path &file : boost::filesystem::directory_iterator(dir)) {
+                binary_files += file.extension() == ".bbsc";
+                json_files   += file.extension() == ".json";
+            }
+            THEN("only the json file is left and it is loaded") {
+                REQUIRE(binary_files == 0);
+                REQUIRE(json_files == 1);
+                REQUIRE(print.load_cached_data(dir.string()) == 0);
+                check();
+            }
+            boost::filesystem::remove_all(dir);
+        }
+    }
+}
+
+SCENARIO("Print: Slice result cache", "[Print]") {
+    GIVEN("overhang model with support and an empty cache") {
+        boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("slice_result_cache_%%%%-%%%%");
+        auto cache = std::make_shared<SliceResultCache>(dir.string(), 0);
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize_strict({ { "enable_support", true } });
+
+        Slic3r::Print print1;
+        Slic3r::Model model1;
+        Slic3r::Test::init_print({TestMesh::overhang}, print1, model1, config);
+        print1.set_slice_result_cache(cache);
+        print1.process();
+        WHEN("the same object is processed by another print") {
+            Slic3r::Print print2;
+            Slic3r::Model model2;
+            Slic3r::Test::init_print({TestMesh::overhang}, print2, model2, config);
+            print2.set_slice_result_cache(cache);
+            print2.process();
+            THEN("the result is loaded from the cache") {
+                REQUIRE(cache->statistics().misses == 1);
+                REQUIRE(cache->statistics().stored == 1);
+                REQUIRE(cache->statistics().hits == 1);
+                const PrintObject &object1 = *print1.objects().front();
+                const PrintObject &object2 = *print2.objects().front();
+                REQUIRE(object2.layer_count() == object1.layer_count());
+                REQUIRE(object2.support_layer_count() == object1.support_layer_count());
+                for (size_t i = 0; i < object1.layer_count(); ++ i)
+                    REQUIRE(object2.get_layer(int(i))->regions().front()->perimeters.items_count() ==
+                            object1.get_layer(int(i))->regions().front()->perimeters.items_count());
+            }
+        }
+        WHEN("the same object is processed with a layer range modifier, which is then extended") {
+            auto process_with_layer_range = [&config, &cache](double top) {
+                Slic3r::Print print;
+                Slic3r::Model model;
+                Slic3r::Test::init_print({TestMesh::overhang}, print, model, config);
+                DynamicPrintConfig range_config;
+                range_config.set_deserialize_strict({ { "layer_height", config.opt_float("layer_height") }, { "wall_loops", 4 } });
+                model.objects.front()->layer_config_ranges[{ 0., top }].assign_config(std::move(range_config));
+                print.apply(model, config);
+                print.set_slice_result_cache(cache);
+                print.process();
+            };
+            process_with_layer_range(5.);
+            process_with_layer_range(10.);
+            THEN("the extended range misses the cache") {
+                REQUIRE(cache->statistics().hits == 0);
+                REQUIRE(cache->statistics().misses == 3);
+                REQUIRE(cache->statistics().stored == 3);
+            }
+        }
+        WHEN("the cache is limited to a single byte") {
+            SliceResultCache limited(dir.string(), 1);
+            THEN("all entries are evicted") {
+                REQUIRE(limited.statistics().entries == 0);
+                REQUIRE(limited.statistics().evicted == 1);
+            }
+        }
+        boost::filesystem::remove_all(dir);
+    }
+}
+
+// Extrusions of the PrintObject layer by layer.
+static std::vector<Polylines> object_extrusions(const PrintObject &object)
+{
+    std::vector<Polylines> out;
+    for (const Layer *layer : object.layers()) {
+        Polylines polylines;
+        for (const LayerRegion *layerm : layer->regions())
+            for (const ExtrusionEntityCollection *extrusions : { &layerm->perimeters, &layerm->thin_fills, &layerm->fills })
+                append(polylines, extrusions->as_polylines());
+        out.emplace_back(std::move(polylines));
+    }
+    return out;
+}
+
+SCENARIO("Print: Editing a layer range regenerates its layers only", "[Print]") {
+    GIVEN("20mm cube with a layer range modifier at 10mm to 14mm") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize_strict({ { "layer_height", 0.2 }, { "initial_layer_print_height", 0.2 }, { "sparse_infill_density", "15%" } });
+        auto set_layer_range = [](Model &model, std::initializer_list<Slic3r::ConfigBase::SetDeserializeItem> items) {
+            DynamicPrintConfig range_config;
+            range_config.set_deserialize_strict({ { "layer_height", 0.2 } });
+            range_config.set_deserialize_strict(items);
+            model.objects.front()->layer_config_ranges[{ 10., 14. }].assign_config(std::move(range_config));
+        };
+        // The same object processed from scratch.
+        auto process_from_scratch = [&config, &set_layer_range](std::initializer_list<Slic3r::ConfigBase::SetDeserializeItem> items) {
+            Slic3r::Print print;
+            Slic3r::Model model;
+            Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, config);
+            set_layer_range(model, items);
+            print.apply(model, config);
+            print.process();
+            return object_extrusions(*print.objects().front());
+        };
+
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, config);
+        set_layer_range(model, { { "sparse_infill_density", "30%" }, { "wall_loops", 2 } });
+        print.apply(model, config);
+        print.process();
+        // Layer far below the layer range.
+        auto layerm = [&print]() -> const LayerRegion& { return *print.objects().front()->get_layer(10)->regions().front(); };
+        REQUIRE(! layerm().perimeters.empty());
+        REQUIRE(! layerm().fills.empty());
+        const ExtrusionEntity *perimeters = layerm().perimeters.entities.front();
+        const ExtrusionEntity *fills      = layerm().fills.entities.front();
+
+        WHEN("the infill density of the layer range is changed") {
+            set_layer_range(model, { { "sparse_infill_density", "50%" }, { "wall_loops", 2 } });
+            print.apply(model, config);
+            print.process();
+            THEN("the layers are the same as if sliced from scratch") {
+                REQUIRE(object_extrusions(*print.objects().front()) == process_from_scratch({ { "sparse_infill_density", "50%" }, { "wall_loops", 2 } }));
+            }
+            THEN("the infill of the layers below the range is kept") {
+                REQUIRE(layerm().perimeters.entities.front() == perimeters);
+                REQUIRE(layerm().fills.entities.front() == fills);
+            }
+        }
+        WHEN("the wall loops of the layer range are changed") {
+            set_layer_range(model, { { "sparse_infill_density", "30%" }, { "wall_loops", 4 } });
+            print.apply(model, config);
+            print.process();
+            THEN("the layers are the same as if sliced from scratch") {
+                REQUIRE(object_extrusions(*print.objects().front()) == process_from_scratch({ { "sparse_infill_density", "30%" }, { "wall_loops", 4 } }));
+            }
+            THEN("the walls and infill of the layers below the range are kept") {
+                REQUIRE(layerm().perimeters.entities.front() == perimeters);
+                REQUIRE(layerm().fills.entities.front() == fills);
+            }
+        }
+    }
+}
+
+SCENARIO("Print: A failing object does not interrupt the other objects", "[Print]") {
+    GIVEN("An overhang with support and a 20mm cube without support") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize_strict({ { "layer_height", 0.2 }, { "initial_layer_print_height", 0.2 } });
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::overhang, TestMesh::cube_20x20x20}, print, model, config);
+        model.objects.front()->config.set("enable_support", true);
+        print.apply(model, config);
+        WHEN("the support generation of the overhang throws") {
+            print.set_status_callback([](const PrintBase::SlicingStatus &status) {
+                if (status.text == "Generating support")
+                    throw Slic3r::SlicingError("Support generation failed");
+            });
+            REQUIRE_THROWS_AS(print.process(), Slic3r::SlicingError);
+            const PrintObject &overhang = *print.objects().front();
+            const PrintObject &cube     = *print.objects().back();
+            THEN("the support of the overhang is not done") {
+                REQUIRE(overhang.is_step_done(posInfill));
+                REQUIRE(! overhang.is_step_done(posSupportMaterial));
+                REQUIRE(! overhang.is_step_done(posDetectOverhangsForLift));
+            }
+            THEN("the cube is processed completely") {
+                for (PrintObjectStep step : { posSlice, posPerimeters, posPrepareInfill, posInfill, posIroning, posSupportMaterial, posDetectOverhangsForLift })
+                    REQUIRE(cube.is_step_done(step));
+                REQUIRE(cube.layer_count() == 100);
+                for (const Layer *layer : cube.layers())
+                    REQUIRE(! layer->regions().front()->perimeters.empty());
+            }
+        }
+    }
+}
+
+SCENARIO("Print: Seam visibility cache", "[Print]") {
+    GIVEN("A cube with aligned seams exported to G-code") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize_strict({ { "seam_position", "aligned" } });
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, config);
+        Slic3r::Test::gcode(print);
+        auto visibility = print.seam_visibility_cache().find(*print.objects().front(), spAligned);
+        REQUIRE(visibility);
+        REQUIRE(print.seam_visibility_cache().size() == 1);
+
+        WHEN("the G-code is exported again after a setting change") {
+            config.set_deserialize_strict({ { "gcode_comments", true } });
+            print.apply(model, config);
+            Slic3r::Test::gcode(print);
+            THEN("the visibility is reused") {
+                REQUIRE(print.seam_visibility_cache().size() == 1);
+                REQUIRE(print.seam_visibility_cache().find(*print.objects().front(), spAligned) == visibility);
+            }
+        }
+        WHEN("the mesh of the object is replaced") {
+            ModelObject *object = model.objects.front();
+            object->add_volume(Slic3r::Test::mesh(TestMesh::pyramid));
+            object->delete_volume(0);
+            object->ensure_on_bed();
+            print.apply(model, config);
+            Slic3r::Test::gcode(print);
+            THEN("the visibility is computed again and the visibility of the released mesh is dropped") {
+                auto edited = print.seam_visibility_cache().find(*print.objects().front(), spAligned);
+                REQUIRE(edited);
+                REQUIRE(edited != visibility);
+                REQUIRE(print.seam_visibility_cache().size() == 1);
+            }
+        }
+        WHEN("the print is cleared") {
+            print.clear();
+            THEN("the cache is empty") {
+                REQUIRE(print.seam_visibility_cache().size() == 0);
+            }
+        }
+    }
+}
+
+#ifdef TEST_PERFORMANCE
+TEST_CASE("Print: Cached slicing data export / load timing", "[Print]") {
+    Slic3r::Print print;
+    Slic3r::Test::init_and_process_print({TestMesh::cube_20x20x20, TestMesh::overhang, TestMesh::pyramid, TestMesh::sphere_50mm}, print, {
+        { "enable_support", true },
+        { "sparse_infill_density", "40%" }
+    });
+    for (bool json : { false, true }) {
+        long long ms = time_ms([&print, json]() {
+            for (int i = 0; i < 5; ++ i)
+                cached_data_round_trip(print, json);
+        });
+        std::cout << (json ? "json" : "binary") << " cache round trip: " << ms / 5 << " ms" << std::endl;
+    }
+}
+#endif // TEST_PERFORMANCE
@@ -2,10 +2,20 @@
 
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/GCodeReader.hpp"
+#include "libslic3r/GCode/GCodeProcessor.hpp"
 
 #include "test_data.hpp"
+#include "test_utils.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <boost/filesystem.hpp>
+#include <boost/nowide/cstdio.hpp>
+#include <boost/nowide/fstream.hpp>
 #include <boost/regex.hpp>
 
 using namespace Slic3r;
@@ -269,3 +279,359 @@ SCENARIO( "PrintGCode basic functionality", "[PrintGCode]") {
         }
     }
 }
+
+SCENARIO("Precomputed travel boundaries and cached travels give the same G-code as the travels planned on demand", "[PrintGCode]") {
+    GIVEN("Two objects with holes and reduce_crossing_wall enabled") {
+        auto gcode = [](size_t lookahead, size_t cache_size) {
+            Slic3r::Print print;
+            Slic3r::Model model;
+            Slic3r::Test::init_print({TestMesh::two_hollow_squares, TestMesh::cube_with_hole}, print, model, {
+                { "layer_height",               0.3 },
+                { "reduce_crossing_wall",       true },
+                { "sparse_infill_density",      "10%" }
+                });
+            print.set_travel_boundaries_lookahead(lookahead);
+            print.set_travel_cache_size(cache_size);
+            return Slic3r::Test::gcode(print);
+        };
+        std::string on_demand = gcode(0, 0);
+        REQUIRE(! on_demand.empty());
+        WHEN("the boundaries are precomputed") {
+            THEN("the G-code is the same") {
+                REQUIRE(gcode(4, 0) == on_demand);
+            }
+        }
+        WHEN("the travels are cached") {
+            THEN("the G-code is the same") {
+                REQUIRE(gcode(0, 32) == on_demand);
+                REQUIRE(gcode(4, 1) == on_demand);
+            }
+        }
+    }
+    GIVEN("A single object with holes and reduce_crossing_wall enabled") {
+        auto gcode = [](size_t lookahead) {
+            Slic3r::Print print;
+            Slic3r::Model model;
+            Slic3r::Test::init_print({TestMesh::cube_with_hole}, print, model, {
+                { "layer_height",               0.3 },
+                { "reduce_crossing_wall",       true },
+                { "sparse_infill_density",      "10%" }
+                });
+            print.set_travel_boundaries_lookahead(lookahead);
+            return Slic3r::Test::gcode(print);
+        };
+        WHEN("the boundaries inside the object are precomputed and the boundary around it is built on demand") {
+            THEN("the G-code is the same") {
+                REQUIRE(gcode(4) == gcode(0));
+            }
+        }
+    }
+}
+
+#ifdef TEST_PERFORMANCE
+// Exports the G-code of 100 instances with the travels planned on demand and with the travel boundaries precomputed and cached.
+TEST_CASE("Travel planning on a plate of 100 instances", "[PrintGCode]") {
+    DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+    config.set_deserialize_strict({ { "layer_height", 0.2 }, { "reduce_crossing_wall", true }, { "sparse_infill_density", "10%" } });
+    TriangleMesh mesh = Slic3r::Test::mesh(TestMesh::cube_with_hole);
+    mesh.scale(0.4f);
+    const double spacing = mesh.bounding_box().size().x() + 5.;
+    auto export_gcode = [&](size_t lookahead, size_t cache_size) {
+        Slic3r::Print print;
+        Slic3r::Model model;
+        ModelObject *object = model.add_object();
+        object->name = "object.stl";
+        object->add_volume(mesh);
+        for (int i = 0; i < 100; ++ i)
+            object->add_instance()->set_offset(Vec3d(20. + spacing * (i % 10), 20. + spacing * (i / 10), 0.));
+        object->ensure_on_bed();
+        print.auto_assign_extruders(object);
+        print.apply(model, config);
+        print.validate();
+        print.set_travel_boundaries_lookahead(lookahead);
+        print.set_travel_cache_size(cache_size);
+        print.set_status_silent();
+        print.process();
+        boost::filesystem::path temp = boost::filesystem::unique_path();
+        auto ms = time_ms([&]() { print.export_gcode(temp.string(), nullptr, nullptr); });
+        boost::nowide::ifstream file(temp.string());
+        std::string gcode((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        file.close();
+        boost::nowide::remove(temp.string().c_str());
+        return std::make_pair(gcode, ms);
+    };
+    auto [on_demand, on_demand_ms] = export_gcode(0, 0);
+    auto [cached, cached_ms]       = export_gcode(16, 32);
+    REQUIRE(cached == on_demand);
+    std::cout << "100 instances: G-code export with the travels planned on demand " << on_demand_ms << " ms, precomputed and cached " << cached_ms << " ms" << std::endl;
+}
+#endif // TEST_PERFORMANCE
+
+SCENARIO("GCodeReader parses a file in parallel the same way as serially", "[PrintGCode]") {
+    GIVEN("A G-code file spanning several chunks with line numbers, comments, CR/LF line ends and no final line end") {
+        std::string gcode = "; header\r\nM83\r\n\r\nN10 G1 Z0.2 F3000 ; line number\rG92 E0\n";
+        for (int i = 0; i < 300000; ++ i)
+            gcode += "G1 X" + std::to_string(i % 200) + "." + std::to_string(i % 1000) + " Y" + std::to_string((i * 7) % 200) +
+                     (i % 3 ? " E0.0" + std::to_string(i % 97) : " F" + std::to_string(1200 + i % 5000)) + (i % 11 ? "\n" : " ; comment\n");
+        gcode += "G1 Z10 E-0.8";
+        boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("gcodereader_%%%%-%%%%.gcode");
+        {
+            boost::nowide::ofstream out(path.string(), std::ios::binary);
+            out << gcode;
+        }
+        struct Parsed {
+            std::vector<std::string>                      raw;
+            std::vector<std::array<float, NUM_AXES + 2>>  values;
+            std::vector<size_t>                           lines_ends;
+        };
+        auto collect = [](Parsed &parsed) {
+            return [&parsed](GCodeReader &reader, const GCodeReader::GCodeLine &line) {
+                parsed.raw.emplace_back(line.raw());
+                std::array<float, NUM_AXES + 2> &v = parsed.values.emplace_back();
+                for (int axis = 0; axis < NUM_AXES; ++ axis)
+                    v[axis] = line.has(Axis(axis)) ? line.value(Axis(axis)) : -1.f;
+                // Position of the reader before the line is applied.
+                v[NUM_AXES]     = reader.x();
+                v[NUM_AXES + 1] = reader.e();
+            };
+        };
+        WHEN("The file is parsed serially and in parallel") {
+            Parsed serial, parallel;
+            GCodeReader reader_serial, reader_parallel;
+            reader_serial.apply_config(DynamicPrintConfig::full_print_config());
+            reader_parallel.apply_config(DynamicPrintConfig::full_print_config());
+            REQUIRE(reader_serial.parse_file(path.string(), collect(serial), serial.lines_ends));
+            REQUIRE(reader_parallel.parse_file_parallel(path.string(), collect(parallel), parallel.lines_ends));
+            boost::filesystem::remove(path);
+            THEN("The lines, the axes, the positions and the line ends are the same") {
+                REQUIRE(parallel.raw.size() == serial.raw.size());
+                REQUIRE(parallel.raw == serial.raw);
+                REQUIRE(parallel.values == serial.values);
+                REQUIRE(parallel.lines_ends == serial.lines_ends);
+                REQUIRE(reader_parallel.z() == reader_serial.z());
+                REQUIRE(reader_parallel.e() == reader_serial.e());
+            }
+        }
+    }
+}
+
+TEST_CASE("GCodeReader finds the line ends in blocks the same way as one character at a time", "[PrintGCode]") {
+    std::mt19937 rng(7);
+    for (int round = 0; round < 20000; ++ round) {
+        std::string text(rng() % 100, 'X');
+        for (char &c : text) {
+            unsigned int r = rng() % 40;
+            c = r == 0 ? '\n' : r == 1 ? '\r' : r == 2 ? '\0' : r == 3 ? ';' : char('A' + r % 26);
+        }
+        const char *begin = text.data() + (text.empty() ? 0 : rng() % text.size());
+        const char *end   = text.data() + text.size();
+        const char *line_break = begin;
+        for (; line_break != end && *line_break != '\r' && *line_break != '\n'; ++ line_break) ;
+        const char *end_of_line = begin;
+        for (; end_of_line != end && ! GCodeReader::is_end_of_line(*end_of_line); ++ end_of_line) ;
+        REQUIRE(GCodeReader::find_line_break(begin, end) == line_break);
+        REQUIRE(GCodeReader::find_end_of_line(begin, end) == end_of_line);
+    }
+}
+
+TEST_CASE("GCodeReader reads the axis values spelled with a plus sign or a space", "[PrintGCode]") {
+    std::vector<std::pair<char, float>> values;
+    std::vector<bool>                   parsed;
+    GCodeReader reader;
+    reader.parse_buffer("G1 X+10 Y 20.5 Z\t+0.3 E-1.5 F+-3 ; comment\n", [&values, &parsed](GCodeReader&, const GCodeReader::GCodeLine &line) {
+        for (char axis : { 'X', 'Y', 'Z', 'E', 'F' }) {
+            float value = 0.f;
+            parsed.emplace_back(line.has_value(axis, value));
+            values.emplace_back(axis, value);
+        }
+    });
+    REQUIRE(parsed == std::vector<bool>{ true, true, true, true, false });
+    REQUIRE(values[0].second == Approx(10.f));
+    REQUIRE(values[1].second == Approx(20.5f));
+    REQUIRE(values[2].second == Approx(0.3f));
+    REQUIRE(values[3].second == Approx(-1.5f));
+}
+
+SCENARIO("GCodeProcessorResult compacts the moves losslessly", "[PrintGCode]") {
+    GIVEN("Moves with slowly changing attributes and some arc moves") {
+        using MoveVertex = GCodeProcessorResult::MoveVertex;
+        std::vector<MoveVertex> moves(20000);
+        for (size_t i = 0; i < moves.size(); ++ i) {
+            MoveVertex &move     = moves[i];
+            move.type            = i % 50 == 0 ? EMoveType::Travel : EMoveType::Extrude;
+            move.extrusion_role  = i % 50 == 0 ? erNone : (i / 500) % 2 ? erPerimeter : erInternalInfill;
+            move.extruder_id     = (unsigned char)(i / 5000);
+            move.gcode_id        = (unsigned int)(i * 2 + 1);
+            move.delta_extruder  = move.type == EMoveType::Extrude ? 0.01f * float(i % 7) : 0.f;
+            move.feedrate        = i % 50 == 0 ? 250.f : 60.f;
+            move.width           = 0.42f;
+            move.height          = 0.2f;
+            move.mm3_per_mm      = 0.07f;
+            move.fan_speed       = i < 1000 ? 0.f : 100.f;
+            move.temperature     = 220.f;
+            move.layer_duration  = float(i / 1000);
+            move.time            = { 0.1f * float(i), 0.12f * float(i) };
+            move.position        = Vec3f(float(i % 200), float((i * 7) % 200), 0.2f * float(i / 1000 + 1));
+            move.print_z         = move.position.z();
+            if (i % 97 == 0) {
+                move.move_path_type      = EMovePathType::Arc_move_ccw;
+                move.arc_center_position = Vec3f(100.f, 100.f, move.position.z());
+                for (int j = 0; j < int(i % 5); ++ j)
+                    move.interpolation_points.emplace_back(float(j), float(i % 13), move.position.z());
+            } else
+                move.move_path_type = EMovePathType::Linear_move;
+        }
+        auto same = [](const MoveVertex &l, const MoveVertex &r) {
+            return l.type == r.type && l.extrusion_role == r.extrusion_role && l.move_path_type == r.move_path_type && l.extruder_id == r.extruder_id &&
+                l.cp_color_id == r.cp_color_id && l.gcode_id == r.gcode_id && l.delta_extruder == r.delta_extruder && l.feedrate == r.feedrate &&
+                l.width == r.width && l.height == r.height && l.mm3_per_mm == r.mm3_per_mm && l.fan_speed == r.fan_speed &&
+                l.temperature == r.temperature && l.layer_duration == r.layer_duration && l.time == r.time && l.position == r.position &&
+                l.arc_center_position == r.arc_center_position && l.interpolation_points == r.interpolation_points &&
+                l.object_label_id == r.object_label_id && l.print_z == r.print_z;
+        };
+        WHEN("The moves are compacted") {
+            GCodeProcessorResult result;
+            result.moves = moves;
+            result.compact_moves();
+            THEN("The moves vector is released and the compacted moves take less memory") {
+                REQUIRE(result.moves.empty());
+                REQUIRE(result.compacted_moves.size() == moves.size());
+                REQUIRE(result.compacted_moves.memory_size() * 3 < moves.size() * sizeof(MoveVertex));
+            }
+            THEN("Sequential and random access decode the same moves") {
+                size_t mismatches = 0;
+                result.compacted_moves.for_each(0, moves.size(), [&](size_t idx, const MoveVertex &move) { mismatches += ! same(move, moves[idx]); });
+                REQUIRE(mismatches == 0);
+                for (size_t idx : { size_t(0), size_t(97), size_t(98), size_t(4999), size_t(5000), moves.size() - 1 })
+                    REQUIRE(same(result.compacted_moves[idx], moves[idx]));
+                size_t visited = 0;
+                result.compacted_moves.for_each(9700, 9800, [&](size_t idx, const MoveVertex &move) { mismatches += ! same(move, moves[idx]); ++ visited; });
+                REQUIRE(visited == 100);
+                REQUIRE(mismatches == 0);
+            }
+            THEN("Expanding restores the moves") {
+                result.expand_moves();
+                REQUIRE(result.compacted_moves.empty());
+                REQUIRE(result.moves.size() == moves.size());
+                REQUIRE(std::equal(moves.begin(), moves.end(), result.moves.begin(), same));
+            }
+        }
+    }
+}
+
+// Layers of walls and infill, with travels, dwells, acceleration changes and skippable timelapse and head wrap detection blocks.
+static std::string make_time_estimate_gcode()
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "G21\nG90\nM83\nM204 S5000\nG28\n";
+    for (int layer = 0; layer < 20; ++ layer) {
+        const double z = 0.2 * double(layer + 1);
+        out << "; CHANGE_LAYER\n; Z_HEIGHT: " << z << "\n; LAYER_HEIGHT: 0.2\nG1 Z" << z << " F600\n";
+        const char *features[] = { "Outer wall", "Inner wall", "Sparse infill" };
+        for (int feature = 0; feature < 3; ++ feature) {
+            out << "; FEATURE: " << features[feature] << "\n";
+            out << "M204 S" << (feature == 2 ? 10000 : 2000) << "\n";
+            out << "G1 X" << 50 + feature * 10 << " Y50 F12000\n";
+            for (int i = 0; i < 60; ++ i) {
+                const double angle = 2. * M_PI * double(i) / 60.;
+                const double r     = 20. - 3. * feature + 0.05 * double(layer % 3);
+                out << "G1 X" << 100. + r * std::cos(angle) << " Y" << 100. + r * std::sin(angle) << " E" << 0.03 + 0.001 * double(i % 5)
+                    << " F" << (feature == 0 ? 3000 : 6000 + 600 * (i % 4)) << "\n";
+            }
+        }
+        if (layer % 5 == 4) {
+            out << "; SKIPPABLE_START\n; SKIPTYPE: timelapse\nG1 X10 Y200 F18000\nG4 P500\nG1 X100 Y100 F18000\n; SKIPPABLE_END\n";
+            out << "; SKIPPABLE_START\n; SKIPTYPE: head_wrap_detect\nG1 X200 Y10 F18000\nG1 X190 Y10 F600\n; SKIPPABLE_END\n";
+        }
+        out << "G1 E-0.8 F1800\nG4 S1\nG1 E0.8 F1800\n";
+    }
+    return out.str();
+}
+
+// The expected values were produced by the time estimator before the time modes were planned on their own workers,
+// any change of the estimate is to be justified.
+SCENARIO("GCodeProcessor estimates the print time of both time modes", "[PrintGCode]") {
+    GIVEN("G-code of walls and infill with travels, dwells and skippable blocks") {
+        WHEN("It is processed with the normal and the stealth time estimators enabled") {
+            GCodeProcessor processor;
+            PrintConfig    config;
+            processor.apply_config(config);
+            processor.enable_stealth_time_estimator(true);
+            processor.initialize("time_estimate.gcode");
+            processor.process_buffer(make_time_estimate_gcode());
+            processor.finalize(false);
+            const GCodeProcessorResult &result = processor.get_result();
+            using ETimeMode = PrintEstimatedStatistics::ETimeMode;
+            const auto &normal  = result.print_statistics.modes[size_t(ETimeMode::Normal)];
+            const auto &stealth = result.print_statistics.modes[size_t(ETimeMode::Stealth)];
+            auto role_time = [](const PrintEstimatedStatistics::Mode &mode, ExtrusionRole role) {
+                auto it = std::find_if(mode.roles_times.begin(), mode.roles_times.end(), [role](const auto &rt) { return rt.first == role; });
+                return it == mode.roles_times.end() ? -1.f : it->second;
+            };
+            auto move_time = [](const PrintEstimatedStatistics::Mode &mode, EMoveType type) {
+                auto it = std::find_if(mode.moves_times.begin(), mode.moves_times.end(), [type](const auto &mt) { return mt.first == type; });
+                return it == mode.moves_times.end() ? -1.f : it->second;
+            };
+            THEN("The total times are unchanged") {
+                REQUIRE(result.moves.size() == 3737);
+                REQUIRE(normal.time == Approx(222.912033));
+                REQUIRE(stealth.time == Approx(223.713913));
+            }
+            THEN("The times per extrusion role are unchanged") {
+                REQUIRE(normal.roles_times.size() == 4);
+                REQUIRE(role_time(normal, erNone) == Approx(49.3172264));
+                REQUIRE(role_time(normal, erPerimeter) == Approx(37.6404228));
+                REQUIRE(role_time(normal, erExternalPerimeter) == Approx(85.0468826));
+                REQUIRE(role_time(normal, erInternalInfill) == Approx(50.9067116));
+                REQUIRE(stealth.roles_times.size() == 4);
+                REQUIRE(role_time(stealth, erNone) == Approx(49.8479576));
+                REQUIRE(role_time(stealth, erPerimeter) == Approx(37.7166176));
+                REQUIRE(role_time(stealth, erExternalPerimeter) == Approx(85.0468826));
+                REQUIRE(role_time(stealth, erInternalInfill) == Approx(51.1018028));
+            }
+            THEN("The times per move type are unchanged") {
+                REQUIRE(move_time(normal, EMoveType::Retract) == Approx(0.789394796));
+                REQUIRE(move_time(normal, EMoveType::Unretract) == Approx(17.8537941));
+                REQUIRE(move_time(normal, EMoveType::Travel) == Approx(49.3172264));
+                REQUIRE(move_time(normal, EMoveType::Extrude) == Approx(154.951141));
+                REQUIRE(move_time(stealth, EMoveType::Retract) == Approx(0.840607166));
+                REQUIRE(move_time(stealth, EMoveType::Unretract) == Approx(17.9202118));
+                REQUIRE(move_time(stealth, EMoveType::Travel) == Approx(49.8479576));
+                REQUIRE(move_time(stealth, EMoveType::Extrude) == Approx(155.104797));
+            }
+            THEN("The times of the skippable parts are unchanged") {
+                REQUIRE(result.skippable_part_time.size() == 2);
+                REQUIRE(result.skippable_part_time.at(SkipType::stTimelapse) == Approx(10.7031078));
+                REQUIRE(result.skippable_part_time.at(SkipType::stHeadWrapDetect) == Approx(12.9775591));
+            }
+        }
+    }
+}
+
+#ifdef TEST_PERFORMANCE
+// Parses the G-code of the sliced test meshes from a file, serially and in parallel, and from memory.
+TEST_CASE("GCodeReader: parsed megabytes per second", "[PrintGCode]") {
+    std::string gcode = Slic3r::Test::slice({ TestMesh::sphere_50mm, TestMesh::cube_20x20x20, TestMesh::pyramid }, {
+        { "sparse_infill_density", "40%" },
+        { "layer_height", 0.1 }
+    }, true);
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("gcodereader_%%%%-%%%%.gcode");
+    {
+        boost::nowide::ofstream out(path.string(), std::ios::binary);
+        out << gcode;
+    }
+    size_t lines = 0;
+    auto count = [&lines](GCodeReader&, const GCodeReader::GCodeLine&) { ++ lines; };
+    std::vector<size_t> lines_ends;
+    auto report = [&gcode, &lines](const char *name, long long ms) {
+        std::cout << name << ": " << lines << " lines, " << std::setprecision(4) << double(gcode.size()) / (std::max(ms, 1LL) * 1024. * 1024. / 1000.) << " MB/s" << std::endl;
+        lines = 0;
+    };
+    GCodeReader serial, parallel, buffer;
+    report("parse_file", time_ms([&]() { serial.parse_file(path.string(), count, lines_ends); }));
+    report("parse_file_parallel", time_ms([&]() { parallel.parse_file_parallel(path.string(), count, lines_ends); }));
+    report("parse_buffer", time_ms([&]() { buffer.parse_buffer(gcode, count); }));
+    boost::filesystem::remove(path);
+}
+#endif // TEST_PERFORMANCE
@@ -87,3 +87,66 @@ SCENARIO("PrintObject: object layer heights", "[PrintObject]") {
 #endif
     }
 }
+
+SCENARIO("PrintObject: objects with identical content share the slicing result", "[PrintObject]") {
+    GIVEN("Two separately loaded 20mm cubes and a pyramid") {
+        Slic3r::Print print;
+        Slic3r::Test::init_and_process_print({TestMesh::cube_20x20x20, TestMesh::cube_20x20x20, TestMesh::pyramid}, print, DynamicPrintConfig::full_print_config());
+        const PrintObject &cube1   = *print.objects()[0];
+        const PrintObject &cube2   = *print.objects()[1];
+        const PrintObject &pyramid = *print.objects()[2];
+        THEN("The cubes have the same fingerprint") {
+            REQUIRE(cube1.fingerprint().valid());
+            REQUIRE(cube1.fingerprint() == cube2.fingerprint());
+            REQUIRE(cube2.get_shared_object() == &cube1);
+            REQUIRE(cube2.layers().size() == cube1.layers().size());
+        }
+        THEN("The pyramid is sliced on its own") {
+            REQUIRE(pyramid.fingerprint() != cube1.fingerprint());
+            REQUIRE(pyramid.get_shared_object() == nullptr);
+        }
+    }
+}
+
+SCENARIO("PrintObject: the mesh fingerprints are kept by the volumes", "[PrintObject]") {
+    GIVEN("A processed 20mm cube") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, config);
+        print.process();
+        const ModelVolume   &volume           = *print.objects().front()->model_object()->volumes.front();
+        const Fingerprint128 fingerprint      = print.objects().front()->fingerprint();
+        const Fingerprint128 mesh_fingerprint = volume.mesh_fingerprint();
+        THEN("The volume keeps the fingerprint of its mesh") {
+            REQUIRE(mesh_fingerprint.valid());
+            REQUIRE(volume.mesh_fingerprint() == mesh_fingerprint);
+        }
+        WHEN("A setting is changed and the print is processed again") {
+            config.set_deserialize_strict({ { "wall_loops", 4 } });
+            print.apply(model, config);
+            print.process();
+            THEN("The object fingerprint is unchanged") {
+                REQUIRE(print.objects().front()->fingerprint() == fingerprint);
+            }
+        }
+        WHEN("The mesh of the volume is replaced") {
+            ModelObject &model_object = *model.objects.front();
+            ModelVolume &model_volume = *model_object.volumes.front();
+            REQUIRE(model_volume.mesh_fingerprint() == mesh_fingerprint);
+            TriangleMesh mesh = model_volume.mesh();
+            mesh.scale(0.5f);
+            model_volume.set_mesh(std::move(mesh));
+            model_object.invalidate_bounding_box();
+            model_object.ensure_on_bed();
+            THEN("The mesh fingerprint is calculated again") {
+                REQUIRE(model_volume.mesh_fingerprint() != mesh_fingerprint);
+            }
+            THEN("The object fingerprint changes") {
+                print.apply(model, config);
+                print.process();
+                REQUIRE(print.objects().front()->fingerprint() != fingerprint);
+            }
+        }
+    }
+}
@@ -2,8 +2,12 @@
 
 #include "libslic3r/GCodeReader.hpp"
 #include "libslic3r/Layer.hpp"
+#include "libslic3r/Utils.hpp"
+
+#include <iostream>
 
 #include "test_data.hpp" // get access to init_print, etc
+#include "test_utils.hpp"
 
 using namespace Slic3r::Test;
 using namespace Slic3r;
@@ -119,6 +123,29 @@ SCENARIO("SupportMaterial: support_layers_z and contact_distance", "[SupportMate
     }
 }
 
+#ifdef TEST_PERFORMANCE
+TEST_CASE("SupportMaterial: tree support timing and peak memory", "[SupportMaterial]")
+{
+    for (const char *style : { "default", "tree_hybrid" }) {
+        Slic3r::Print print;
+        long long ms = time_ms([&print, style]() {
+            Slic3r::Test::init_and_process_print({ TestMesh::overhang, TestMesh::bridge, TestMesh::ipadstand, TestMesh::sphere_50mm }, print, {
+                { "enable_support",             true },
+                { "support_type",               "tree(auto)" },
+                { "support_style",              style },
+                { "layer_height",               0.1 },
+                { "initial_layer_print_height", 0.2 }
+            });
+        });
+        size_t support_layers = 0;
+        for (const PrintObject *object : print.objects())
+            support_layers += object->support_layers().size();
+        REQUIRE(support_layers > 0);
+        std::cout << "tree support " << style << ": " << ms << " ms," << log_memory_info(true) << std::endl;
+    }
+}
+#endif // TEST_PERFORMANCE
+
 #if 0
 // Test 8.
 TEST_CASE("SupportMaterial: forced support is generated", "[SupportMaterial]")
@@ -10,9 +10,11 @@
 #include <algorithm>
 #include <future>
 #include <chrono>
+#include <iostream>
 
 //#include "test_options.hpp"
 #include "test_data.hpp"
+#include "test_utils.hpp"
 
 using namespace Slic3r;
 using namespace std;
@@ -301,6 +303,64 @@ SCENARIO( "TriangleMeshSlicer: Cut behavior.") {
         }
     }
 }
+// Test meshes side by side, each one rotated and scaled differently.
+static indexed_triangle_set make_slicing_test_mesh(int copies)
+{
+    indexed_triangle_set its;
+    int i = 0;
+    for (int copy = 0; copy < copies; ++ copy)
+        for (Test::TestMesh m : { Test::TestMesh::ipadstand, Test::TestMesh::sphere_50mm, Test::TestMesh::sloping_hole, Test::TestMesh::cube_with_concave_hole, Test::TestMesh::gt2_teeth }) {
+            TriangleMesh mesh = Test::mesh(m);
+            mesh.rotate_z(0.3f * float(i));
+            mesh.scale(1.f + 0.1f * float(i % 4));
+            mesh.translate(float(80 * i), 0.f, 0.f);
+            its_merge(its, mesh.its);
+            ++ i;
+        }
+    return its;
+}
+
+TEST_CASE("Slicing at many planes gives the slices of the single planes", "[TriangleMeshSlicer]") {
+    const indexed_triangle_set its = make_slicing_test_mesh(1);
+    // Some of the planes pass through vertices and horizontal faces.
+    std::vector<float> zs;
+    for (int i = 0; i <= 300; ++ i)
+        zs.emplace_back(0.1f * float(i));
+    const MeshSlicingParams params;
+    std::vector<Polygons> layers = slice_mesh(its, zs, params);
+    REQUIRE(layers.size() == zs.size());
+    for (size_t i = 0; i < zs.size(); ++ i) {
+        Polygons layer = slice_mesh(its, zs[i], params);
+        REQUIRE(layers[i].size() == layer.size());
+        REQUIRE(std::abs(area(layers[i]) - area(layer)) <= 1e-6 * std::abs(area(layer)) + 1.);
+    }
+}
+
+TEST_CASE("Sweeping the planes gives the lines of slicing facet by facet", "[TriangleMeshSlicer]") {
+    const indexed_triangle_set its = make_slicing_test_mesh(1);
+    std::vector<float> zs;
+    for (int i = 0; i <= 300; ++ i)
+        zs.emplace_back(0.1f * float(i));
+    REQUIRE(slice_mesh_lines(its, zs, true) == slice_mesh_lines(its, zs, false));
+}
+
+#ifdef TEST_PERFORMANCE
+TEST_CASE("TriangleMeshSlicer: slicing timing of a large mesh", "[TriangleMeshSlicer]") {
+    for (int copies : { 1, 10, 40 }) {
+        indexed_triangle_set its = make_slicing_test_mesh(copies);
+        BoundingBoxf3 bbox = bounding_box(its);
+        std::vector<float> zs;
+        for (float z = float(bbox.min.z()) + 0.1f; z < float(bbox.max.z()); z += 0.1f)
+            zs.emplace_back(z);
+        std::vector<Lines> facet_lines, bucketed_lines;
+        long long facet_ms    = time_ms([&]() { facet_lines = slice_mesh_lines(its, zs, false); });
+        long long bucketed_ms = time_ms([&]() { bucketed_lines = slice_mesh_lines(its, zs, true); });
+        REQUIRE(bucketed_lines == facet_lines);
+        std::cout << its.indices.size() << " facets, " << zs.size() << " layers: lines facet by facet " << facet_ms << " ms, bucketed " << bucketed_ms << " ms" << std::endl;
+    }
+}
+#endif // TEST_PERFORMANCE
+
 #ifdef TEST_PERFORMANCE
 TEST_CASE("Regression test for issue #4486 - files take forever to slice") {
     TriangleMesh mesh;
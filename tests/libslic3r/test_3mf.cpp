@@ -2,8 +2,13 @@
 
 #include "libslic3r/Model.hpp"
 #include "libslic3r/Format/3mf.hpp"
+#include "libslic3r/Format/bbs_3mf.hpp"
 #include "libslic3r/Format/STL.hpp"
 
+#include "test_utils.hpp"
+
+#include <iostream>
+
 #include <boost/filesystem/operations.hpp>
 
 using namespace Slic3r;
@@ -131,3 +136,81 @@ SCENARIO("2D convex hull of sinking object", "[3mf]") {
     }
 }
 
+
+// Objects of different sizes, so that a mixed up order of the loaded objects is detected.
+static Model make_bbs_3mf_test_model(int num_objects, double sphere_step)
+{
+    Model model;
+    for (int i = 0; i < num_objects; ++ i) {
+        ModelObject *object = model.add_object();
+        object->name = "object_" + std::to_string(i);
+        object->add_volume(TriangleMesh(its_make_sphere(3. + i % 7, sphere_step)));
+        object->add_instance()->set_offset(Vec3d(20. * (i % 10), 20. * (i / 10), 0.));
+    }
+    return model;
+}
+
+static bool store_bbs_3mf_split(const std::string &path, Model &model)
+{
+    StoreParams params;
+    params.path     = path.c_str();
+    params.model    = &model;
+    params.config   = nullptr;
+    params.strategy = SaveStrategy::Silence | SaveStrategy::SplitModel | SaveStrategy::Zip64;
+    return store_bbs_3mf(params);
+}
+
+static bool load_bbs_3mf_model(const std::string &path, Model &model)
+{
+    DynamicPrintConfig        config;
+    ConfigSubstitutionContext ctxt{ ForwardCompatibilitySubstitutionRule::Disable };
+    PlateDataPtrs             plate_data;
+    std::vector<Preset*>      project_presets;
+    bool                      is_bbl_3mf = false;
+    Semver                    file_version;
+    bool ret = load_bbs_3mf(path.c_str(), &config, &ctxt, &model, &plate_data, &project_presets, &is_bbl_3mf, &file_version, nullptr, LoadStrategy::LoadModel);
+    release_PlateData_list(plate_data);
+    return ret;
+}
+
+SCENARIO("Objects of a project are loaded from their own model files", "[3mf]") {
+    GIVEN("a project with many objects stored in 3D/Objects") {
+        Model src_model = make_bbs_3mf_test_model(40, PI / 20.);
+        std::string test_file = std::string(TEST_DATA_DIR) + "/test_3mf/bbs_objects.3mf";
+        REQUIRE(store_bbs_3mf_split(test_file, src_model));
+
+        WHEN("the project is loaded") {
+            Model dst_model;
+            bool ret = load_bbs_3mf_model(test_file, dst_model);
+            boost::filesystem::remove(test_file);
+            THEN("the objects are loaded in their order with their meshes and convex hulls") {
+                REQUIRE(ret);
+                REQUIRE(dst_model.objects.size() == src_model.objects.size());
+                for (size_t i = 0; i < src_model.objects.size(); ++ i) {
+                    const ModelObject *src = src_model.objects[i];
+                    const ModelObject *dst = dst_model.objects[i];
+                    REQUIRE(dst->name == src->name);
+                    REQUIRE(dst->volumes.size() == 1);
+                    REQUIRE(dst->volumes.front()->mesh().facets_count() == src->volumes.front()->mesh().facets_count());
+                    REQUIRE(dst->volumes.front()->mesh().stats().volume == Approx(src->volumes.front()->mesh().stats().volume));
+                    REQUIRE(! dst->volumes.front()->get_convex_hull().empty());
+                }
+            }
+        }
+    }
+}
+
+#ifdef TEST_PERFORMANCE
+TEST_CASE("bbs_3mf: load time of a project with many objects", "[3mf]") {
+    Model src_model = make_bbs_3mf_test_model(300, PI / 200.);
+    std::string test_file = std::string(TEST_DATA_DIR) + "/test_3mf/bbs_objects_benchmark.3mf";
+    REQUIRE(store_bbs_3mf_split(test_file, src_model));
+    Model dst_model;
+    bool ret = false;
+    long long load_ms = time_ms([&]() { ret = load_bbs_3mf_model(test_file, dst_model); });
+    std::cout << src_model.objects.size() << " objects, " << boost::filesystem::file_size(test_file) / (1024 * 1024) << " MB: load " << load_ms << " ms" << std::endl;
+    boost::filesystem::remove(test_file);
+    REQUIRE(ret);
+    REQUIRE(dst_model.objects.size() == src_model.objects.size());
+}
+#endif // TEST_PERFORMANCE
@@ -0,0 +1,69 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/FilamentGroup.hpp"
+
+#include <random>
+
+using namespace Slic3r;
+
+static FilamentGroupContext make_filament_group_context(int filament_num, int layer_num)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> flush(50.f, 800.f);
+    std::uniform_int_distribution<int> filament(0, filament_num - 1);
+
+    FilamentGroupContext ctx;
+    ctx.model_info.flush_matrix.assign(2, FlushMatrix(filament_num, std::vector<float>(filament_num, 0.f)));
+    for (FlushMatrix &matrix : ctx.model_info.flush_matrix)
+        for (int i = 0; i < filament_num; ++i)
+            for (int j = 0; j < filament_num; ++j)
+                if (i != j)
+                    matrix[i][j] = flush(rng);
+    for (int layer = 0; layer < layer_num; ++layer) {
+        std::vector<unsigned int> lf;
+        // every filament is used at least once
+        lf.emplace_back(layer % filament_num);
+        for (int i = 0; i < 3; ++i)
+            lf.emplace_back(filament(rng));
+        sort_remove_duplicates(lf);
+        ctx.model_info.layer_filaments.emplace_back(std::move(lf));
+    }
+    ctx.group_info.total_filament_num = filament_num;
+    ctx.group_info.max_gap_threshold  = 0.01;
+    return ctx;
+}
+
+TEST_CASE("Parallel k-medoids restarts give the sequential grouping", "[FilamentGroup]") {
+    const int filament_num = 14;
+    FilamentGroupContext ctx = make_filament_group_context(filament_num, 60);
+    std::vector<unsigned int> used_filaments = collect_sorted_used_filaments(ctx.model_info.layer_filaments);
+    REQUIRE(used_filaments.size() == filament_num);
+    auto evaluator = std::make_shared<FlushDistanceEvaluator>(ctx.model_info.flush_matrix, used_filaments, ctx.model_info.layer_filaments);
+
+    // two extruders with two nozzles each
+    const std::vector<std::pair<std::set<int>, int>> cluster_group_size = { { { 0, 1 }, filament_num }, { { 2, 3 }, filament_num } };
+    auto cluster = [&](int threads, FilamentGroupUtils::SolverStats &stats) {
+        KMediods PAM(4, filament_num, evaluator);
+        PAM.set_cluster_group_size(cluster_group_size);
+        PAM.set_memory_threshold(ctx.group_info.max_gap_threshold);
+        PAM.set_threads(threads);
+        PAM.do_clustering(ctx, 60000, 12);
+        stats = PAM.get_stats();
+        return PAM.get_cluster_labels();
+    };
+
+    FilamentGroupUtils::SolverStats stats_1, stats_4;
+    std::vector<int> labels_1 = cluster(1, stats_1);
+    std::vector<int> labels_4 = cluster(4, stats_4);
+
+    REQUIRE(labels_1.size() == filament_num);
+    REQUIRE(labels_1 == labels_4);
+    REQUIRE(stats_1.best_cost == stats_4.best_cost);
+    REQUIRE(! stats_1.timed_out);
+    REQUIRE(stats_1.restarts == 12);
+    REQUIRE(stats_1.evaluations > 0);
+    // the restarts meet at the same centers
+    REQUIRE(stats_1.cache_hits > 0);
+    for (int label : labels_1)
+        REQUIRE((label >= 0 && label < 4));
+}
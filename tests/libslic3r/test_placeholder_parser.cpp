@@ -3,6 +3,10 @@
 #include "libslic3r/PlaceholderParser.hpp"
 #include "libslic3r/PrintConfig.hpp"
 
+#include "test_utils.hpp"
+
+#include <iostream>
+
 using namespace Slic3r;
 
 SCENARIO("Placeholder parser scripting", "[PlaceholderParser]") {
@@ -33,6 +37,21 @@ SCENARIO("Placeholder parser scripting", "[PlaceholderParser]") {
     SECTION("nested config options (legacy syntax)") { REQUIRE(parser.process("[temperature_[foo]]") == "357"); }
     SECTION("array reference") { REQUIRE(parser.process("{temperature[foo]}") == "357"); }
     SECTION("whitespaces and newlines are maintained") { REQUIRE(parser.process("test [ temperature_ [foo] ] \n hu") == "test 357 \n hu"); }
+    SECTION("leading whitespaces are skipped") { REQUIRE(parser.process(" \n [bar] {bar} \n") == "2 2 \n"); }
+    SECTION("vector and legacy variables") { REQUIRE(parser.process("{temperature[2]};[temperature];[temperature_3];{ bar }") == "363;357;378;2"); }
+    SECTION("if / elsif / else") {
+        const std::string templ = "G1{if bar == 1} A{elsif bar == 2} B{temperature[bar]}{if foo > 0} C{else} D{endif}{else} E{endif}\n";
+        REQUIRE(parser.process(templ) == "G1 B363 D\n");
+        // The second time the template is served from the cache of the compiled templates.
+        REQUIRE(parser.process(templ) == "G1 B363 D\n");
+        REQUIRE(parser.process("{if foo == 0}{elsif bar == 2}x{endif}") == "");
+    }
+    SECTION("errors in the branches not taken are reported") {
+        REQUIRE_THROWS_AS(parser.process("{if bar == 2}x{else}{not_a_variable}{endif}"), PlaceholderParserError);
+        REQUIRE_THROWS_AS(parser.process("{if bar == 2}x{elsif not_a_variable}y{endif}"), PlaceholderParserError);
+        REQUIRE_THROWS_AS(parser.process("{if bar}x{endif}"), PlaceholderParserError);
+        REQUIRE_THROWS_AS(parser.process("{if bar == 2}x"), PlaceholderParserError);
+    }
 
     // Test the math expressions.
     SECTION("math: 2*3") { REQUIRE(parser.process("{2*3}") == "6"); }
@@ -111,3 +130,34 @@ SCENARIO("Placeholder parser scripting", "[PlaceholderParser]") {
     SECTION("complex expression2") { REQUIRE(boolean_expression("printer_notes=~/.*PRINTER_VEwerfNDOR_PRUSA3D.*/ or printer_notes=~/.*PRINTertER_MODEL_MK2.*/ or (nozzle_diameter[0]==0.6 and num_extruders>1)")); }
     SECTION("complex expression3") { REQUIRE(! boolean_expression("printer_notes=~/.*PRINTER_VEwerfNDOR_PRUSA3D.*/ or printer_notes=~/.*PRINTertER_MODEL_MK2.*/ or (nozzle_diameter[0]==0.3 and num_extruders>1)")); }
 }
+
+#ifdef TEST_PERFORMANCE
+TEST_CASE("PlaceholderParser: layer change and filament change templates", "[PlaceholderParser]") {
+    PlaceholderParser parser;
+    parser.apply_config(DynamicPrintConfig::full_print_config());
+    parser.set("next_extruder", 1);
+    parser.set("first_layer_center_no_wipe_tower", new ConfigOptionFloats{ 128., 128. });
+    parser.set("flush_volumetric_speeds", new ConfigOptionFloats{ 2., 2., 2., 2. });
+    const std::string time_lapse =
+        ";TIMELAPSE_START\n{if layer_num == 2}\nM971 S11 C10 O0\n{endif}\nG1 Z{max_layer_z + 0.4}\nG1 X0 Y{first_layer_center_no_wipe_tower[1]} F18000\n"
+        "{if timelapse_type == 0}\nM971 S11 C10 O0\n{elsif timelapse_type == 1}\nM991 S0 P{layer_num}\n{endif}\n;TIMELAPSE_END\n";
+    const std::string change_filament =
+        "G392 S0\nM620 S[next_extruder]A\nM204 S9000\nG1 Z{max_layer_z + 3.0} F1200\nM400\nM106 P1 S0\n"
+        "{if toolchange_count > 1}\nG17\nG2 Z{max_layer_z + 0.4} I0.86 J0.86 P1 F10000 ; spiral lift a little\n{endif}\n"
+        "M104 S[nozzle_temperature_range_high]\nT[next_extruder]\nM104 S[nozzle_temperature]\nM620.1 E F{flush_volumetric_speeds[next_extruder]} T{nozzle_temperature_range_high[next_extruder]}\n"
+        "M621 S[next_extruder]A\n";
+    size_t length = 0;
+    long long ms = time_ms([&]() {
+        for (int layer_num = 1; layer_num <= 3000; ++ layer_num) {
+            DynamicConfig config;
+            config.set_key_value("layer_num",        new ConfigOptionInt(layer_num));
+            config.set_key_value("max_layer_z",      new ConfigOptionFloat(0.2 * layer_num));
+            config.set_key_value("toolchange_count", new ConfigOptionInt(layer_num));
+            length += parser.process(time_lapse, 0, &config).size();
+            length += parser.process(change_filament, 0, &config).size();
+        }
+    });
+    REQUIRE(length > 0);
+    std::cout << "3000 layers: " << ms << " ms" << std::endl;
+}
+#endif // TEST_PERFORMANCE
@@ -0,0 +1,84 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/Model.hpp"
+#include "libslic3r/TriangleSelector.hpp"
+
+#include "test_utils.hpp"
+
+#include <iostream>
+
+using namespace Slic3r;
+
+// Paint the mesh with a sphere cursor at every step-th facet, cycling through the states, some of them using the long state encoding.
+static void paint_triangle_selector(TriangleSelector &selector, const TriangleMesh &mesh, int step, float radius)
+{
+    const EnforcerBlockerType states[] = { EnforcerBlockerType::Extruder1, EnforcerBlockerType::Extruder2, EnforcerBlockerType::Extruder5,
+                                           EnforcerBlockerType::Extruder20, EnforcerBlockerType::NONE };
+    for (int facet_idx = 0, i = 0; facet_idx < int(mesh.its.indices.size()); facet_idx += step, ++ i) {
+        const Vec3f center = mesh.its.vertices[mesh.its.indices[facet_idx](0)];
+        selector.select_patch(facet_idx,
+            TriangleSelector::SinglePointCursor::cursor_factory(center, 2.f * center, radius, TriangleSelector::SPHERE, Transform3d::Identity(), TriangleSelector::ClippingPlane()),
+            states[i % 5], Transform3d::Identity(), true);
+    }
+}
+
+TEST_CASE("Painted facets are restored from the packed bit stream", "[TriangleSelector]") {
+    TriangleMesh mesh(its_make_sphere(10., PI / 40.));
+    TriangleSelector selector(mesh);
+    paint_triangle_selector(selector, mesh, 97, 1.5f);
+
+    TriangleSplittingData data = selector.serialize();
+    REQUIRE(! data.empty());
+    REQUIRE(data.num_bits() % 4 == 0);
+    REQUIRE(TriangleSelector::has_facets(data, EnforcerBlockerType::Extruder20));
+    REQUIRE(! TriangleSelector::has_facets(data, EnforcerBlockerType::Extruder3));
+
+    SECTION("deserialized selector serializes to the same data") {
+        TriangleSelector selector2(mesh);
+        selector2.deserialize(data, false);
+        TriangleSplittingData data2 = selector2.serialize();
+        REQUIRE(data2 == data);
+        REQUIRE(data2.words() == data.words());
+        REQUIRE(selector2.get_facets(EnforcerBlockerType::Extruder20).indices.size() == selector.get_facets(EnforcerBlockerType::Extruder20).indices.size());
+    }
+    SECTION("3MF strings restore the same data") {
+        Model        model;
+        ModelObject *object  = model.add_object();
+        ModelVolume *volume  = object->add_volume(mesh);
+        ModelVolume *volume2 = object->add_volume(mesh);
+        REQUIRE(volume->mmu_segmentation_facets.set(selector));
+        REQUIRE(! volume->mmu_segmentation_facets.set(selector));
+        for (int i = 0; i < int(mesh.its.indices.size()); ++ i)
+            if (std::string str = volume->mmu_segmentation_facets.get_triangle_as_string(i); ! str.empty())
+                volume2->mmu_segmentation_facets.set_triangle_from_string(i, str);
+        volume2->mmu_segmentation_facets.shrink_to_fit();
+        REQUIRE(volume2->mmu_segmentation_facets.equals(volume->mmu_segmentation_facets));
+        volume2->mmu_segmentation_facets.reset();
+        REQUIRE(! volume2->mmu_segmentation_facets.equals(volume->mmu_segmentation_facets));
+    }
+    SECTION("another patch makes the data differ") {
+        const Vec3f center = mesh.its.vertices[mesh.its.indices[1](0)];
+        selector.select_patch(1,
+            TriangleSelector::SinglePointCursor::cursor_factory(center, 2.f * center, 0.5f, TriangleSelector::SPHERE, Transform3d::Identity(), TriangleSelector::ClippingPlane()),
+            EnforcerBlockerType::Extruder3, Transform3d::Identity(), true);
+        REQUIRE(selector.serialize() != data);
+    }
+}
+
+#ifdef TEST_PERFORMANCE
+TEST_CASE("TriangleSelector: paint, serialize and compare timing", "[TriangleSelector]") {
+    TriangleMesh mesh(its_make_sphere(50., PI / 700.));
+    TriangleSelector selector(mesh);
+    auto                  paint_ms       = time_ms([&]() { paint_triangle_selector(selector, mesh, 500, 2.f); });
+    TriangleSplittingData data;
+    auto                  serialize_ms   = time_ms([&]() { data = selector.serialize(); });
+    TriangleSelector      selector2(mesh);
+    auto                  deserialize_ms = time_ms([&]() { selector2.deserialize(data, false); });
+    TriangleSplittingData copy           = data;
+    bool                  equal          = false;
+    auto                  compare_ms     = time_ms([&]() { for (int i = 0; i < 100; ++ i) equal = copy == data; });
+    REQUIRE(equal);
+    std::cout << mesh.its.indices.size() << " facets, " << data.triangles().size() << " painted, " << data.num_bits() << " bits: paint " << paint_ms <<
+        " ms, serialize " << serialize_ms << " ms, deserialize " << deserialize_ms << " ms, 100x compare " << compare_ms << " ms" << std::endl;
+}
+#endif // TEST_PERFORMANCE